@@ -3,6 +3,7 @@
 
 #include "ast.h"
 #include "data_types.h"
+#include "stats.h"
 #include <assert.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -12,7 +13,7 @@
 // values, type of the allocated node is specified by the argument.
 // Returns pointer to the created node or NULL if allocation fails.
 node* create_node(node_type type) {
-    node* n = malloc(sizeof(node));
+    node* n = track_malloc(sizeof(node));
     if (n == NULL) {
         fprintf(stderr, "Failed to malloc memory for node\n");
         return NULL;
@@ -27,12 +28,13 @@ node* create_node(node_type type) {
     n->ancestor = NULL;
     n->child_cap = INITIAL_CHILDREN_CAP;
     n->child_count = 0;
-    n->children = calloc(n->child_cap, sizeof(node*));
+    n->children = track_calloc(n->child_cap, sizeof(node*));
     if (n->children == NULL) {
-        free(n);
+        track_free(n);
         fprintf(stderr, "Failed to malloc memory for node children\n");
         return NULL;
     }
+    stats_count(COUNT_NODES, 1);
     return n;
 }
 
@@ -111,8 +113,11 @@ void print_tree(node* n) {
 
 // Appends 'child' under the 'ancestor'
 bool append_node(node* child, node* ancestor) {
-    // Cannot append 'NULL'
-    assert(child != NULL);
+    // A subexpression that failed to parse is NULL, its error is already
+    // reported by the parser.
+    if (child == NULL) {
+        return false;
+    }
 
     // Child is already connected
     if (child->ancestor != NULL) {
@@ -120,8 +125,8 @@ bool append_node(node* child, node* ancestor) {
     }
     if (ancestor->child_count >= ancestor->child_cap) {
         // Increase the size for children.
-        node** new_ptr = realloc(ancestor->children,
-                                 ancestor->child_cap * 2 * sizeof(node*));
+        node** new_ptr = track_reallocarray(
+            ancestor->children, ancestor->child_cap * 2, sizeof(node*));
         // Failed to allocate the memory
         if (new_ptr == NULL) {
             fprintf(stderr, "Failed to increase space for children\n");
@@ -137,6 +142,66 @@ bool append_node(node* child, node* ancestor) {
     return true;
 }
 
+// Inserts 'child' under the 'ancestor' at position 'index', the children
+// from 'index' onwards are shifted by one.
+bool insert_node(node* child, node* ancestor, int index) {
+    assert(child != NULL);
+    assert(index >= 0 && index <= ancestor->child_count);
+
+    // Appending takes care of the capacity, the child is then moved into place.
+    if (!append_node(child, ancestor)) {
+        return false;
+    }
+    for (int i = ancestor->child_count - 1; i > index; i--) {
+        ancestor->children[i] = ancestor->children[i - 1];
+    }
+    ancestor->children[index] = child;
+    return true;
+}
+
+// Puts 'new_n' in place of 'old_n' within the children of 'old_n's ancestor.
+// 'old_n' is left disconnected and has to be freed by the caller.
+// Returns false if 'old_n' has no ancestor or 'new_n' is already connected.
+bool replace_node(node* old_n, node* new_n) {
+    assert(old_n != NULL && new_n != NULL);
+
+    node* p = old_n->ancestor;
+    if (p == NULL || new_n->ancestor != NULL) {
+        return false;
+    }
+    for (int i = 0; i < p->child_count; i++) {
+        if (p->children[i] == old_n) {
+            p->children[i] = new_n;
+            new_n->ancestor = p;
+            old_n->ancestor = NULL;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Disconnects 'n' from its ancestor, keeping the order of the remaining
+// children. Returns 'n' so it can be freed or appended elsewhere.
+node* detach_node(node* n) {
+    assert(n != NULL);
+
+    node* p = n->ancestor;
+    if (p == NULL) {
+        return n;
+    }
+    for (int i = 0; i < p->child_count; i++) {
+        if (p->children[i] == n) {
+            for (int j = i; j < p->child_count - 1; j++) {
+                p->children[j] = p->children[j + 1];
+            }
+            p->child_count--;
+            break;
+        }
+    }
+    n->ancestor = NULL;
+    return n;
+}
+
 node* get_root(node* n) {
     while (n->ancestor != NULL) {
         n = n->ancestor;
@@ -144,6 +209,15 @@ node* get_root(node* n) {
     return n;
 }
 
+// Skips the EXPR wrappers around 'n', returns the first node that is not
+// an EXPR with a single child.
+node* unwrap_expr(node* n) {
+    while (n->data.type == EXPR && n->child_count == 1) {
+        n = n->children[0];
+    }
+    return n;
+}
+
 // Gets the child of node 'n' with type 'type', 'order' is the index of
 // the child (with the desired type) to return. Returns a pointer to the
 // child if found, otherwise returns NULL
@@ -186,10 +260,15 @@ node* get_ancestor_by_type(node* n, node_type type, int order) {
 }
 
 void free_data(node* n) {
+    // Every node owns its copy of the scope id
+    free(n->data.scope_id);
+    n->data.scope_id = NULL;
+
     // Free inner data by type
     switch (n->data.type) {
     case LITERAL:
-        if (n->data.ret_value == U8_SLICE) {
+        if (n->data.ret_value == U8_SLICE ||
+            n->data.ret_value == STRING_LITERAL) {
             free(n->data.str_value);
             n->data.str_value = NULL;
         }
@@ -201,6 +280,7 @@ void free_data(node* n) {
     case PARAM:
     case ASSIGN:
     case VAR:
+    case NULL_COND:
         free(n->data.id_name);
         n->data.id_name = NULL;
         break;
@@ -225,8 +305,8 @@ void delete_tree(node** nod) {
     for (int i = 0; i < n->child_count; i++) {
         delete_tree(&(n->children[i]));
     }
-    free(n->children);
-    free(n);
+    track_free(n->children);
+    track_free(n);
     *nod = NULL;
 }
 
@@ -96,7 +96,11 @@ void print_children(node* n);
 
 node* create_node(node_type type);
 bool append_node(node* child, node* ancestor);
+bool insert_node(node* child, node* ancestor, int index);
+bool replace_node(node* old_n, node* new_n);
+node* detach_node(node* n);
 node* get_root(node* n);
+node* unwrap_expr(node* n);
 void delete_tree(node** nod);
 node* get_child_by_type(node* n, node_type type, int order);
 node* get_ancestor_by_type(node* n, node_type type, int order);
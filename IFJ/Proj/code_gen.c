@@ -5,13 +5,18 @@
 
 #include "code_gen_help.h"
 #include "data_types.h"
+#include "dead_code.h"
 #include "func_look_up.h"
+#include "instr.h"
+#include "parallel.h"
+#include "strbuf.h"
 
 #include <assert.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
-#define fptr stdout
 
 void handle_func_def(node* func_def);
 void handle_stmt_list(node* stmt_list);
@@ -23,6 +28,7 @@ void handle_statement_function(node* function);
 void handle_assign_throw_away_function(node* throw);
 void handle_variable_definition(node* variable);
 void handle_assign(node* assing);
+void handle_condition(node* cond, const char* target, const char* scope);
 void handle_if_statement(node* if_statement);
 void handle_while_statement(node* while_statement);
 void handle_continue_statement(node* continue_statement);
@@ -36,66 +42,225 @@ void handle_literal(node* literal);
 void handle_var(node* var);
 void handle_operand(node* operand);
 void handle_function(node* function);
+char* reg_expression(node* expression, const char* dest);
+
+// The state of the generation is per thread, so the functions can be
+// generated in parallel.
+_Thread_local vector* code_list = NULL;
+_Thread_local error_code gen_err = NO_ERR;
+// Register mode evaluates expressions into LF@$t<n> temporaries using the
+// three operand instructions instead of the data stack.
+_Thread_local bool reg_mode = false;
+_Thread_local int temp_next = 0;  // First free temporary of the current statement
+_Thread_local int temp_count = 0; // Temporaries needed by the current function
+_Thread_local builtin_mask builtins_used;
+_Thread_local l_data label_data = {0};
+_Thread_local l_stack* label_stack = NULL;
+_Thread_local char* function_name_ref = NULL;
+
+// Formats the instructions and appends them to 'code_list'. Failures are
+// remembered in 'gen_err' and returned at the end of the generation.
+void emit(const char* fmt, ...) {
+    char buf[256];
+    char* code = buf;
+    va_list args;
+
+    va_start(args, fmt);
+    int len = vsnprintf(buf, sizeof(buf), fmt, args);
+    va_end(args);
+
+    if (len < 0) {
+        gen_err = INTERNAL_ERR;
+        return;
+    }
+    // Long string literals do not fit into the buffer
+    if ((size_t)len >= sizeof(buf)) {
+        code = malloc(len + 1);
+        if (code == NULL) {
+            gen_err = INTERNAL_ERR;
+            return;
+        }
+        va_start(args, fmt);
+        vsnprintf(code, len + 1, fmt, args);
+        va_end(args);
+    }
 
-fl_tree function_look_up;
-l_data label_data = {0};
-l_stack* label_stack = NULL;
-char* function_name_ref = NULL;
-error_code generate_code(node* ast_tree) {
-    print_tree(ast_tree);
+    if (!instr_emit(code_list, code)) {
+        gen_err = INTERNAL_ERR;
+    }
+    if (code != buf) {
+        free(code);
+    }
+}
 
-    error_code ret_code = NO_ERR;
+// Emits a call of the builtin 'name' and marks it as used. An unknown name
+// sets 'gen_err'.
+void emit_call_builtin(const char* name) {
+    const char* label = NULL;
+    if (builtin_use(&builtins_used, name, &label) != NO_ERR) {
+        gen_err = INTERNAL_ERR;
+        return;
+    }
+    emit("CALL %s\n", label);
+}
 
-    fl_tree_init(&function_look_up);
-    ret_code = fl_tree_insert_functions(&function_look_up);
-    if(ret_code != NO_ERR){
-        fl_tree_free(&function_look_up);
-        return ret_code;
+// Formats a newly allocated string, returns NULL and sets 'gen_err' on
+// failure.
+char* gen_strf(const char* fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    int len = vsnprintf(NULL, 0, fmt, args);
+    va_end(args);
+
+    char* str = len < 0 ? NULL : malloc(len + 1);
+    if (str == NULL) {
+        gen_err = INTERNAL_ERR;
+        return NULL;
     }
+    va_start(args, fmt);
+    vsnprintf(str, len + 1, fmt, args);
+    va_end(args);
+    return str;
+}
 
+// Shared state of the generation, every function has its own result.
+typedef struct {
+    node* ast;
+    bool registers;
+    gen_result* results;
+} gen_job;
+
+// Generates the function definition at 'index' of the program into its own
+// list using the state of the calling thread.
+void generate_function_job(int index, void* arg) {
+    gen_job* job = arg;
+    gen_result* res = &job->results[index];
+
+    node* function_node = job->ast->children[index];
+    // assert FUNC_DEF
+    assert(function_node != NULL);
+    assert(function_node->data.type == FUNC_DEF);
+
+    builtins_used = 0;
+    res->list = instr_list_init();
     // init label stack
     label_stack = l_stack_init();
-    if(label_stack == NULL){
-        fl_tree_free(&function_look_up);
-        return INTERNAL_ERR;
+    if (res->list == NULL || label_stack == NULL) {
+        res->err = INTERNAL_ERR;
+    }
+
+    if (res->err == NO_ERR) {
+        code_list = res->list;
+        gen_err = NO_ERR;
+        reg_mode = job->registers;
+        label_data = (l_data){0};
+
+        handle_func_def(function_node);
+        res->err = gen_err;
     }
 
+    if (label_stack != NULL) {
+        l_stack_free(&label_stack);
+    }
+    res->builtins = builtins_used;
+}
+
+// Generates every function definition of 'ast_tree' into its own entry of
+// 'results', which must hold a zeroed result for each of them. With
+// 'registers' set the expressions are evaluated in frame temporaries. The
+// functions are generated on up to 'jobs' threads.
+error_code generate_functions(node* ast_tree, gen_result* results,
+                              bool registers, int jobs) {
+#ifndef NDEBUG
+    print_tree(ast_tree);
+#endif
+
     // assert PROG
     assert(ast_tree != NULL);
     assert(ast_tree->data.type == PROG);
 
-    // Create prolog
-    fprintf(fptr, ".IFJcode24\n"
-                  "DEFVAR GF@null\n"
-                  "CALL main\n"
-                  "EXIT int@0\n"
-                  "\n");
+    gen_job job = {.ast = ast_tree, .registers = registers, .results = results};
+    parallel_for(ast_tree->child_count, jobs, generate_function_job, &job);
 
     for (int i = 0; i < ast_tree->child_count; i++) {
-        node* function_node = ast_tree->children[i];
+        if (results[i].err != NO_ERR) {
+            return results[i].err;
+        }
+    }
+    return NO_ERR;
+}
 
-        // assert FUNC_DEF
-        assert(function_node != NULL);
-        assert(function_node->data.type == FUNC_DEF);
+// Joins the 'count' functions in 'results' in their order into the
+// instruction list 'list', adds the prolog and the used builtins. The
+// instructions are moved and the results are freed, the array itself is not.
+error_code generate_program(gen_result* results, int count, vector* list) {
+    builtin_mask builtins = 0;
+    error_code ret_code = NO_ERR;
 
-        handle_func_def(function_node);
+    // Create prolog
+    code_list = list;
+    gen_err = NO_ERR;
+    emit("DEFVAR GF@null\n"
+         "DEFVAR GF@$tmp\n"
+         "CALL main\n"
+         "EXIT int@0\n"
+         "\n");
+
+    for (int i = 0; i < count; i++) {
+        gen_result* res = &results[i];
+        if (res->err != NO_ERR && ret_code == NO_ERR) {
+            ret_code = res->err;
+        }
+        if (res->list != NULL && res->list->len > 0) {
+            // The instructions are moved, not copied
+            size_t len = res->list->len;
+            instr* first = vec_get(res->list, 0);
+            if (ret_code == NO_ERR && vec_push_n(list, first, len) == NULL) {
+                ret_code = INTERNAL_ERR;
+            }
+            for (size_t j = 0; ret_code != NO_ERR && j < len; j++) {
+                instr_free(&first[j]);
+            }
+        }
+        if (res->list != NULL) {
+            vec_free(&res->list);
+        }
+        builtins |= res->builtins;
     }
 
-    fl_tree_include(&function_look_up, fptr);
+    if (ret_code == NO_ERR && !builtin_include(builtins, code_list)) {
+        gen_err = INTERNAL_ERR;
+    }
 
-    l_stack_free(&label_stack);
-    fl_tree_free(&function_look_up);
+    if (ret_code != NO_ERR) {
+        return ret_code;
+    }
+    return gen_err;
+}
 
-    return ret_code;
+// Generates the code of the whole program into the instruction list 'list'.
+// With 'registers' set the expressions are evaluated in frame temporaries.
+// The functions are generated on up to 'jobs' threads and concatenated in
+// source order, so the result does not depend on 'jobs'.
+error_code generate_code(node* ast_tree, vector* list, bool registers,
+                         int jobs) {
+    gen_result* results = calloc(ast_tree->child_count + 1, sizeof(gen_result));
+    if (results == NULL) {
+        return INTERNAL_ERR;
+    }
+    generate_functions(ast_tree, results, registers, jobs);
+    error_code err = generate_program(results, ast_tree->child_count, list);
+    free(results);
+    return err;
 }
 
 void handle_func_def(node* func_def) {
     assert(func_def->child_count == 2);
 
-    fprintf(fptr,
-            "LABEL %s\n"
-            "CREATEFRAME\n",
-            func_def->data.id_name);
+    emit("LABEL %s\n"
+         "CREATEFRAME\n",
+         func_def->data.id_name);
 
     function_name_ref = func_def->data.id_name;
 
@@ -110,29 +275,62 @@ void handle_func_def(node* func_def) {
         assert(param != NULL);
         assert(param->data.type == PARAM);
 
-        fprintf(fptr,
-                "DEFVAR TF@%s%s\n"
-                "POPS TF@%s%s\n",
-                param->data.scope_id, param->data.id_name, param->data.scope_id,
-                param->data.id_name);
+        emit("DEFVAR TF@%s%s\n"
+             "POPS TF@%s%s\n",
+             param->data.scope_id, param->data.id_name, param->data.scope_id,
+             param->data.id_name);
     }
 
     node* stmt_list = func_def->children[1];
     handle_func_def_var(stmt_list);
 
-    fprintf(fptr, "PUSHFRAME\n");
+    // The body goes into its own list first, the number of temporaries it
+    // needs is known only afterwards and they have to be defined before the
+    // frame is pushed, like the variables.
+    vector* func_list = code_list;
+    vector* body_list = NULL;
+    if (!reg_mode) {
+        emit("PUSHFRAME\n");
+    } else {
+        body_list = instr_list_init();
+        if (body_list == NULL) {
+            gen_err = INTERNAL_ERR;
+            return;
+        }
+        code_list = body_list;
+        temp_count = 0;
+    }
 
     // Handle Statement list
     handle_stmt_list(stmt_list);
 
     // Generate return statement if there is no return at the end
-    if ((stmt_list->child_count == 0) || (stmt_list->children[stmt_list->child_count - 1]->data.type != RETURN)) {
-        fprintf(fptr, "POPFRAME\n"
-                      "RETURN\n"
-                      "\n");
+    if ((stmt_list->child_count == 0) ||
+        !stmt_terminates(stmt_list->children[stmt_list->child_count - 1])) {
+        emit("POPFRAME\n"
+             "RETURN\n"
+             "\n");
     } else {
-        fprintf(fptr, "\n");
+        emit("\n");
+    }
+
+    if (!reg_mode) {
+        return;
+    }
+    code_list = func_list;
+    for (int i = 0; i < temp_count; i++) {
+        emit("DEFVAR TF@$t%d\n", i);
     }
+    emit("PUSHFRAME\n");
+    if (body_list->len > 0 &&
+        vec_push_n(code_list, vec_get(body_list, 0), body_list->len) == NULL) {
+        gen_err = INTERNAL_ERR;
+        for (size_t i = 0; i < body_list->len; i++) {
+            instr_free(vec_get(body_list, i));
+        }
+    }
+    // The instructions are owned by 'code_list' now
+    vec_free(&body_list);
 }
 
 void handle_func_def_var(node* stmt_list) {
@@ -143,8 +341,8 @@ void handle_func_def_var(node* stmt_list) {
         case VAR_DEF:
         case CONST_DEF:
         case NULL_COND:
-            fprintf(fptr, "DEFVAR TF@%s%s\n", child_node->data.scope_id,
-                    child_node->data.id_name);
+            emit("DEFVAR TF@%s%s\n", child_node->data.scope_id,
+                 child_node->data.id_name);
             break;
         default:
             handle_func_def_var(child_node);
@@ -168,6 +366,7 @@ void handle_stmt_list(node* stmt_list) {
 }
 
 void handle_statement(node* statement) {
+    temp_next = 0;
     switch (statement->data.type) {
     case RETURN:
         handle_statement_return(statement);
@@ -223,14 +422,14 @@ void handle_statement_return(node* ret) {
         assert(opt_exp->child_count == 0);
     }
 
-    fprintf(fptr, "POPFRAME\n"
-                  "RETURN\n");
+    emit("POPFRAME\n"
+         "RETURN\n");
 }
 
 void handle_statement_function(node* function) {
     handle_function(function);
     if (function->data.ret_value != VOID) {
-        fprintf(fptr, "POPS GF@null\n");
+        emit("POPS GF@null\n");
     }
 }
 
@@ -238,17 +437,27 @@ void handle_variable_definition(node* variable) {
     assert(variable != NULL);
     assert(variable->data.type == VAR_DEF || variable->data.type == CONST_DEF);
 
-    // fprintf(fptr,
+    // emit(
     //     "DEFVAR LF@%s%s\n"
     //, variable->data.scope_id, variable->data.id_name);
 
     if (variable->child_count == 1) {
         node* expression = variable->children[0];
 
+        if (reg_mode) {
+            char* dest = gen_strf("LF@%s%s", variable->data.scope_id,
+                                  variable->data.id_name);
+            if (dest != NULL) {
+                free(reg_expression(expression, dest));
+                free(dest);
+            }
+            return;
+        }
+
         handle_expression(expression);
 
-        fprintf(fptr, "POPS LF@%s%s\n", variable->data.scope_id,
-                variable->data.id_name);
+        emit("POPS LF@%s%s\n", variable->data.scope_id,
+             variable->data.id_name);
     } else {
         assert(variable->child_count == 0);
     }
@@ -260,10 +469,19 @@ void handle_assign(node* assing) {
     assert(assing->child_count == 1);
 
     node* expression = assing->children[0];
+    if (reg_mode) {
+        char* dest = gen_strf("LF@%s%s", assing->data.scope_id,
+                              assing->data.id_name);
+        if (dest != NULL) {
+            free(reg_expression(expression, dest));
+            free(dest);
+        }
+        return;
+    }
     handle_expression(expression);
 
-    fprintf(fptr, "POPS LF@%s%s\n", assing->data.scope_id,
-            assing->data.id_name);
+    emit("POPS LF@%s%s\n", assing->data.scope_id,
+         assing->data.id_name);
 }
 
 void handle_assign_throw_away_function(node* throw) {
@@ -273,7 +491,50 @@ void handle_assign_throw_away_function(node* throw) {
 
     handle_expression(expr);
 
-    fprintf(fptr, "POPS GF@null\n");
+    emit("POPS GF@null\n");
+}
+
+// Evaluates the condition 'cond' and jumps to the label
+// '$<function><scope><target>' if it does not hold. The value of a condition
+// with a null binding is stored into the bound variable.
+void handle_condition(node* cond, const char* target, const char* scope) {
+    assert(cond->data.type == COND);
+    assert(cond->child_count > 0);
+
+    node* expr = cond->children[0];
+    node* null_cond = get_child_by_type(cond, NULL_COND, 0);
+    const char* fail = null_cond != NULL ? "nil@nil" : "bool@false";
+
+    if (reg_mode) {
+        char* dest = NULL;
+        if (null_cond != NULL) {
+            dest = gen_strf("LF@%s%s", null_cond->data.scope_id,
+                            null_cond->data.id_name);
+            if (dest == NULL) {
+                return;
+            }
+        }
+        char* value = reg_expression(expr, dest);
+        if (value != NULL) {
+            emit("JUMPIFEQ $%s%s%s %s %s\n", function_name_ref, scope, target,
+                 value, fail);
+        }
+        free(value);
+        free(dest);
+        return;
+    }
+
+    handle_expression(expr);
+
+    if (null_cond != NULL) {
+        emit("POPS LF@%s%s\n"
+             "PUSHS LF@%s%s\n",
+             null_cond->data.scope_id, null_cond->data.id_name,
+             null_cond->data.scope_id, null_cond->data.id_name);
+    }
+    emit("PUSHS %s\n"
+         "JUMPIFEQS $%s%s%s\n",
+         fail, function_name_ref, scope, target);
 }
 
 void handle_if_statement(node* if_statement) {
@@ -284,79 +545,47 @@ void handle_if_statement(node* if_statement) {
     node* cond = if_statement->children[0];
     assert(cond->data.type == COND);
 
-    assert(cond->child_count > 0);
-    node* expr = cond->children[0];
-    handle_expression(expr);
-
-    bool have_null = false;
-    if (cond->child_count == 2) {
-        have_null = true;
-        node* null_cond = cond->children[1];
-
-        fprintf(fptr,
-                "POPS LF@%s%s\n"
-                "PUSHS LF@%s%s\n",
-                null_cond->data.scope_id, null_cond->data.id_name,
-                null_cond->data.scope_id, null_cond->data.id_name);
-    } else {
-        assert(cond->child_count == 1);
-    }
-
     node* if_statement_block = if_statement->children[1];
     assert(if_statement_block->data.type == STMT_LIST);
 
     if (if_statement->child_count == 2) {
-        if (have_null) {
-            fprintf(fptr,
-                    "PUSHS nil@nil\n"
-                    "JUMPIFEQS $%s%sifend\n",
-                    function_name_ref, if_statement->data.scope_id);
-        } else {
-            fprintf(fptr,
-                    "PUSHS bool@false\n"
-                    "JUMPIFEQS $%s%sifend\n",
-                    function_name_ref, if_statement->data.scope_id);
-        }
+        handle_condition(cond, "ifend", if_statement->data.scope_id);
 
         // HANDLE THE BLOCK
         handle_stmt_list(if_statement_block);
 
-        fprintf(fptr, "LABEL $%s%sifend\n", function_name_ref,
-                if_statement->data.scope_id);
+        emit("LABEL $%s%sifend\n", function_name_ref,
+             if_statement->data.scope_id);
     } else {
         assert(if_statement->child_count == 3);
         node* else_block = if_statement->children[2];
         assert(else_block->data.type == ELSE);
         assert(else_block->child_count == 1);
 
-        if (have_null) {
-            fprintf(fptr,
-                    "PUSHS nil@nil\n"
-                    "JUMPIFEQS $%s%sifelse\n",
-                    function_name_ref, if_statement->data.scope_id);
-        } else {
-            fprintf(fptr,
-                    "PUSHS bool@false\n"
-                    "JUMPIFEQS $%s%sifelse\n",
-                    function_name_ref, if_statement->data.scope_id);
-        }
+        handle_condition(cond, "ifelse", if_statement->data.scope_id);
 
         // HANDLE THE BLOCK
         handle_stmt_list(if_statement_block);
 
-        fprintf(fptr,
-                "JUMP $%s%sifend\n"
-                "LABEL $%s%sifelse\n",
-                function_name_ref, if_statement->data.scope_id,
-                function_name_ref, if_statement->data.scope_id);
+        // No need to jump over the else block if the if block never gets
+        // to its end.
+        if (if_statement_block->child_count == 0 ||
+            !stmt_terminates(
+                if_statement_block
+                    ->children[if_statement_block->child_count - 1])) {
+            emit("JUMP $%s%sifend\n", function_name_ref,
+                 if_statement->data.scope_id);
+        }
+        emit("LABEL $%s%sifelse\n", function_name_ref,
+             if_statement->data.scope_id);
 
         node* else_stmt_block = else_block->children[0];
         assert(else_stmt_block->data.type == STMT_LIST);
         // HANDLE THE BLOCK
         handle_stmt_list(else_stmt_block);
 
-        fprintf(fptr, "LABEL $%s%sifend\n", function_name_ref,
-                if_statement->data.scope_id);
+        emit("LABEL $%s%sifend\n", function_name_ref,
+             if_statement->data.scope_id);
     }
 }
 
@@ -374,10 +603,6 @@ void handle_while_statement(node* while_statement) {
     node* while_cnt = get_child_by_type(while_statement, WHILE_CNT, 0);
     node* while_else = get_child_by_type(while_statement, WHILE_ELSE, 0);
 
-    assert(cond->child_count > 0);
-    node* expression = cond->children[0];
-    node* nullcond = get_child_by_type(cond, NULL_COND, 0);
-
     char* label = while_statement->data.label;
     if (label == NULL) {
         label = "WHILE";
@@ -388,35 +613,23 @@ void handle_while_statement(node* while_statement) {
     l_stack_push(label_stack, &label_data);
 
     // if(nullcond != NULL){
-    //     fprintf(fptr,
+    //     emit(
     //         "DEFVAR LF@%s%s\n"
     //     , nullcond->data.scope_id, nullcond->data.id_name);
     // }
-    fprintf(fptr, "LABEL $%s%s%s$while\n", function_name_ref, label_data.scope,
-            label_data.name);
-
-    handle_expression(expression);
+    emit("LABEL $%s%s%s$while\n", function_name_ref, label_data.scope,
+         label_data.name);
 
-    if (nullcond != NULL) {
-        fprintf(fptr,
-                "POPS LF@%s%s\n"
-                "PUSHS LF@%s%s\n",
-                nullcond->data.scope_id, nullcond->data.id_name,
-                nullcond->data.scope_id, nullcond->data.id_name);
+    char* end = gen_strf("%s$end", label_data.name);
+    if (end != NULL) {
+        handle_condition(cond, end, label_data.scope);
+        free(end);
     }
 
-    if (nullcond != NULL) {
-        fprintf(fptr, "PUSHS nil@nil\n");
-    } else {
-        fprintf(fptr, "PUSHS bool@false\n");
-    }
-    fprintf(fptr, "JUMPIFEQS $%s%s%s$end\n", function_name_ref,
-            label_data.scope, label_data.name);
-
     handle_stmt_list(stmt);
 
-    fprintf(fptr, "LABEL $%s%s%s$continue\n", function_name_ref,
-            label_data.scope, label_data.name);
+    emit("LABEL $%s%s%s$continue\n", function_name_ref,
+         label_data.scope, label_data.name);
 
     if (while_cnt != NULL) {
         assert(while_cnt->child_count == 1);
@@ -425,11 +638,11 @@ void handle_while_statement(node* while_statement) {
         handle_stmt_list(while_cnt_stmt);
     }
 
-    fprintf(fptr, "JUMP $%s%s%s$while\n", function_name_ref, label_data.scope,
-            label_data.name);
+    emit("JUMP $%s%s%s$while\n", function_name_ref, label_data.scope,
+         label_data.name);
 
-    fprintf(fptr, "LABEL $%s%s%s$end\n", function_name_ref, label_data.scope,
-            label_data.name);
+    emit("LABEL $%s%s%s$end\n", function_name_ref, label_data.scope,
+         label_data.name);
 
     if (while_else != NULL) {
         assert(while_else->child_count == 1);
@@ -438,8 +651,8 @@ void handle_while_statement(node* while_statement) {
         handle_stmt_list(while_else_stmt);
     }
 
-    fprintf(fptr, "LABEL $%s%s%s$break\n", function_name_ref, label_data.scope,
-            label_data.name);
+    emit("LABEL $%s%s%s$break\n", function_name_ref, label_data.scope,
+         label_data.name);
 
     l_stack_pop(label_stack, &label_data);
 }
@@ -457,8 +670,8 @@ void handle_break_statement(node* break_statement) {
         break_scope = break_statement->data.scope_id;
         break_label = break_statement->data.label;
     }
-    fprintf(fptr, "JUMP $%s%s%s$break\n", function_name_ref, break_scope,
-            break_label);
+    emit("JUMP $%s%s%s$break\n", function_name_ref, break_scope,
+         break_label);
 }
 
 void handle_continue_statement(node* continue_statement) {
@@ -474,8 +687,8 @@ void handle_continue_statement(node* continue_statement) {
         continue_scope = continue_statement->data.scope_id;
         continue_label = continue_statement->data.label;
     }
-    fprintf(fptr, "JUMP $%s%s%s$continue\n", function_name_ref,
-            continue_scope, continue_label);
+    emit("JUMP $%s%s%s$continue\n", function_name_ref,
+         continue_scope, continue_label);
 }
 
 void handle_expression(node* expression) {
@@ -483,12 +696,229 @@ void handle_expression(node* expression) {
     assert(expression->data.type == EXPR);
     assert(expression->child_count == 1);
 
+    if (reg_mode) {
+        char* value = reg_expression(expression, NULL);
+        if (value != NULL) {
+            emit("PUSHS %s\n", value);
+        }
+        free(value);
+        return;
+    }
+
     node* child = expression->children[0];
     assert(child != NULL);
 
     handle_expression_rec(child);
 }
 
+// Returns the next free temporary of the statement.
+char* reg_temp() {
+    if (temp_next == temp_count) {
+        temp_count++;
+    }
+    return gen_strf("LF@$t%d", temp_next++);
+}
+
+// Returns the operand of the literal 'literal'. It is built in a string
+// builder, the string literals are the longest operands of the program.
+char* gen_literal(node* literal) {
+    vector* sb = vec_init(16, sizeof(char));
+    if (sb == NULL) {
+        gen_err = INTERNAL_ERR;
+        return NULL;
+    }
+    bool ok;
+    switch (literal->data.ret_value) {
+    case STRING_LITERAL:
+    case U8_SLICE:
+        ok = strbuf_puts(sb, "string@") &&
+             strbuf_escape(sb, literal->data.str_value);
+        break;
+    case I32:
+        ok = strbuf_puts(sb, "int@") &&
+             strbuf_int(sb, literal->data.int_value);
+        break;
+    case F64:
+        ok = strbuf_puts(sb, "float@") &&
+             strbuf_float(sb, literal->data.float_value);
+        break;
+    case BOOLEAN:
+        ok = strbuf_puts(sb, literal->data.bool_value ? "bool@true"
+                                                      : "bool@false");
+        break;
+    default:
+        ok = strbuf_puts(sb, "nil@nil");
+        break;
+    }
+    if (!ok) {
+        vec_free(&sb);
+        gen_err = INTERNAL_ERR;
+        return NULL;
+    }
+    char* operand = vec_to_str(&sb);
+    if (operand == NULL) {
+        gen_err = INTERNAL_ERR;
+    }
+    return operand;
+}
+
+// Returns the three operand instruction computing the binary operator 'n'.
+const char* reg_binary_instr(node* n) {
+    switch (n->data.type) {
+    case MUL:
+        return "MUL";
+    case DIV:
+        return n->data.ret_value == I32 ? "IDIV" : "DIV";
+    case ADD:
+        return "ADD";
+    case SUB:
+        return "SUB";
+    case EQUAL:
+    case NOT_EQUAL:
+        return "EQ";
+    case EQUALMORE:
+    case LESS:
+        return "LT";
+    case EQUALLESS:
+    case MORE:
+        return "GT";
+    case B_AND:
+        return "AND";
+    case B_OR:
+        return "OR";
+    default:
+        return NULL;
+    }
+}
+
+// Returns the variable 'dest' or a new temporary if it is NULL.
+char* reg_result(const char* dest) {
+    return dest != NULL ? gen_strf("%s", dest) : reg_temp();
+}
+
+// Evaluates 'n' and returns the operand holding its value. Operators store
+// their result into 'dest' if it is not NULL, otherwise into a temporary.
+// Temporaries used by the operands are free again once the operator is done.
+char* reg_expression_rec(node* n, const char* dest) {
+    int base = temp_next;
+    char* result = NULL;
+
+    switch (n->data.type) {
+    case LITERAL:
+    case NULL_LIT:
+        return gen_literal(n);
+    case VAR:
+        return gen_strf("LF@%s%s", n->data.scope_id, n->data.id_name);
+    case EXPR:
+        return reg_expression_rec(n->children[0], dest);
+    case FUNC:
+        // Conversions have their own instructions, other calls keep using
+        // the data stack for the arguments and the result.
+        if (strcmp(n->data.id_name, "ifj.i2f") == 0 ||
+            strcmp(n->data.id_name, "ifj.f2i") == 0) {
+            node* arg = n->children[0]->children[0]->children[0];
+            char* value = reg_expression_rec(arg, NULL);
+            temp_next = base;
+            result = value != NULL ? reg_result(dest) : NULL;
+            if (result != NULL) {
+                emit("%s %s %s\n",
+                     n->data.id_name[4] == 'i' ? "INT2FLOAT" : "FLOAT2INT",
+                     result, value);
+            }
+            free(value);
+            return result;
+        }
+        handle_function(n);
+        result = reg_result(dest);
+        if (result != NULL) {
+            emit("POPS %s\n", result);
+        }
+        return result;
+    case ORELSE: {
+        char* left = reg_expression_rec(n->children[0], NULL);
+        if (left != NULL) {
+            emit("PUSHS %s\n", left);
+        }
+        free(left);
+        const char* helper = "bld.orelse_unreachable";
+        if (n->children[1]->data.type != UNREACHABLE) {
+            char* right = reg_expression_rec(n->children[1], NULL);
+            if (right != NULL) {
+                emit("PUSHS %s\n", right);
+            }
+            free(right);
+            helper = "bld.orelse";
+        }
+        temp_next = base;
+        emit_call_builtin(helper);
+        result = reg_result(dest);
+        if (result != NULL) {
+            emit("POPS %s\n", result);
+        }
+        return result;
+    }
+    case INT_NEGATE:
+    case B_NEG: {
+        char* value = reg_expression_rec(n->children[0], NULL);
+        temp_next = base;
+        result = value != NULL ? reg_result(dest) : NULL;
+        if (result != NULL && n->data.type == INT_NEGATE) {
+            emit("MUL %s %s int@-1\n", result, value);
+        } else if (result != NULL) {
+            emit("NOT %s %s\n", result, value);
+        }
+        free(value);
+        return result;
+    }
+    default:
+        break;
+    }
+
+    const char* instr = reg_binary_instr(n);
+    if (instr == NULL) {
+        fprintf(stderr, "\nUknown node type: %s\n", get_type_str(n->data.type));
+        gen_err = INTERNAL_ERR;
+        return NULL;
+    }
+    assert(n->child_count == 2);
+    char* left = reg_expression_rec(n->children[0], NULL);
+    char* right = reg_expression_rec(n->children[1], NULL);
+    // The result may reuse the temporary of an operand, the operands are
+    // read before it is written.
+    temp_next = base;
+    if (left != NULL && right != NULL) {
+        result = reg_result(dest);
+    }
+    if (result != NULL) {
+        emit("%s %s %s %s\n", instr, result, left, right);
+        if (n->data.type == NOT_EQUAL || n->data.type == EQUALMORE ||
+            n->data.type == EQUALLESS) {
+            emit("NOT %s %s\n", result, result);
+        }
+    }
+    free(left);
+    free(right);
+    return result;
+}
+
+// Evaluates the expression 'expression' in register mode and returns the
+// operand holding its value, or NULL on failure. With 'dest' set the value
+// always ends up in that variable.
+char* reg_expression(node* expression, const char* dest) {
+    assert(expression != NULL);
+    assert(expression->data.type == EXPR);
+
+    int base = temp_next;
+    char* value = reg_expression_rec(expression, dest);
+    temp_next = base;
+    if (value == NULL || dest == NULL || strcmp(value, dest) == 0) {
+        return value;
+    }
+    emit("MOVE %s %s\n", dest, value);
+    free(value);
+    return gen_strf("%s", dest);
+}
+
 void handle_expression_rec(node* child) {
     switch (child->data.type) {
     case LITERAL:
@@ -535,7 +965,7 @@ void handle_expression_rec(node* child) {
 void handle_null_literal(node* literal) {
     assert(literal->child_count == 0);
 
-    fprintf(fptr, "PUSHS nil@nil\n");
+    emit("PUSHS nil@nil\n");
 }
 
 void handle_literal(node* literal) {
@@ -544,22 +974,20 @@ void handle_literal(node* literal) {
     switch (literal->data.ret_value) {
     case STRING_LITERAL:
     case U8_SLICE:
-        fprintf(fptr, "PUSHS string@");
-        print_string_format(fptr, literal->data.str_value);
-        fprintf(fptr, "\n");
-        break;
     case I32:
-        fprintf(fptr, "PUSHS int@%d\n", literal->data.int_value);
-        break;
-    case F64:
-        fprintf(fptr, "PUSHS float@%a\n", literal->data.float_value);
+    case F64: {
+        char* operand = gen_literal(literal);
+        if (operand != NULL && !instr_append(code_list, I_PUSHS, operand)) {
+            gen_err = INTERNAL_ERR;
+        }
         break;
+    }
     case DT_NULL:
-        fprintf(fptr, "PUSHS nil@nil\n");
+        emit("PUSHS nil@nil\n");
         break;
     case BOOLEAN:
-        fprintf(fptr, "PUSHS bool@%s\n",
-                literal->data.bool_value ? "true" : "false");
+        emit("PUSHS bool@%s\n",
+             literal->data.bool_value ? "true" : "false");
         break;
     default:
         fprintf(stderr, "\nUknown node return type: %d\n",
@@ -572,7 +1000,7 @@ void handle_var(node* var) {
     assert(var->child_count == 0);
     assert(var->data.type == VAR);
 
-    fprintf(fptr, "PUSHS LF@%s%s\n", var->data.scope_id, var->data.id_name);
+    emit("PUSHS LF@%s%s\n", var->data.scope_id, var->data.id_name);
 }
 
 void handle_operand(node* operand) {
@@ -610,66 +1038,64 @@ void handle_operand(node* operand) {
     }
     switch (operand->data.type) {
     case MUL:
-        fprintf(fptr, "MULS\n");
+        emit("MULS\n");
         break;
     case DIV:
         if (operand->data.ret_value == I32) {
-            fprintf(fptr, "IDIVS\n");
+            emit("IDIVS\n");
         } else if (operand->data.ret_value == F64) {
-            fprintf(fptr, "DIVS\n");
+            emit("DIVS\n");
         } else {
             fprintf(stderr, "Uknow type in DIV\n");
             assert(false);
         }
         break;
     case ADD:
-        fprintf(fptr, "ADDS\n");
+        emit("ADDS\n");
         break;
     case SUB:
-        fprintf(fptr, "SUBS\n");
+        emit("SUBS\n");
         break;
     case ORELSE:
         if(operand->children[1]->data.type == UNREACHABLE){
-            fprintf(fptr, "CALL %s\n",
-                fl_tree_use(&function_look_up, "bld.orelse_unreachable"));
+            emit_call_builtin("bld.orelse_unreachable");
         }
         else {
-            fprintf(fptr, "CALL %s\n",
-                fl_tree_use(&function_look_up, "bld.orelse"));
+            emit_call_builtin("bld.orelse");
         }
         break;
     case EQUAL:
-        fprintf(fptr, "EQS\n");
+        emit("EQS\n");
         break;
     case NOT_EQUAL:
-        fprintf(fptr, "EQS\nNOTS\n");
+        emit("EQS\nNOTS\n");
         break;
     case EQUALMORE:
-        fprintf(fptr, "LTS\n"
-                      "NOTS\n");
+        emit("LTS\n"
+             "NOTS\n");
         break;
     case EQUALLESS:
-        fprintf(fptr, "GTS\n"
-                      "NOTS\n");
+        emit("GTS\n"
+             "NOTS\n");
         break;
     case MORE:
-        fprintf(fptr, "GTS\n");
+        emit("GTS\n");
         break;
     case LESS:
-        fprintf(fptr, "LTS\n");
+        emit("LTS\n");
         break;
     case B_AND:
-        fprintf(fptr, "ANDS\n");
+        emit("ANDS\n");
         break;
     case B_OR:
-        fprintf(fptr, "ORS\n");
+        emit("ORS\n");
         break;
     case INT_NEGATE:
-        fprintf(fptr, "PUSHS int@-1\n"
-                      "MULS\n");
+        emit("PUSHS int@-1\n"
+             "MULS\n");
         break;
     case B_NEG:
-        fprintf(fptr, "NOTS\n");
+        emit("NOTS\n");
         break;
     default:
         fprintf(stderr, "\nUknown node type: %s\n",
@@ -700,10 +1126,9 @@ void handle_function(node* function) {
     }
 
     if (strncmp(function->data.id_name, "ifj.", 4) == 0) {
-        fprintf(fptr, "CALL %s\n",
-                fl_tree_use(&function_look_up, function->data.id_name));
+        emit_call_builtin(function->data.id_name);
     } else {
-        fprintf(fptr, "CALL %s\n", function->data.id_name);
+        emit("CALL %s\n", function->data.id_name);
     }
 }
 
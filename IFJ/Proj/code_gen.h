@@ -5,7 +5,22 @@
 
 #include "ast.h"
 #include "error.h"
+#include "func_look_up.h"
+#include "vector.h"
 
-error_code generate_code(node* ast_tree);
+#include <stdbool.h>
+
+// Code of a single function.
+typedef struct {
+    vector* list;
+    builtin_mask builtins; // Builtins called by the function
+    error_code err;
+} gen_result;
+
+error_code generate_functions(node* ast_tree, gen_result* results,
+                              bool registers, int jobs);
+error_code generate_program(gen_result* results, int count, vector* list);
+error_code generate_code(node* ast_tree, vector* list, bool registers,
+                         int jobs);
 
 #endif
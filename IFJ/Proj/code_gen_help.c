@@ -5,20 +5,6 @@
 
 #include <stdlib.h>
 
-void print_string_format(FILE* fptr, const char* string){
-    size_t offset = 0;
-    char c;
-    while((c = string[offset]) != '\0'){
-        if((0 <= c && c <= 32) || c == 35 || c == 92){
-            fprintf(fptr, "\\%03d", c);
-        }
-        else{
-            fputc(c, fptr);
-        }
-        offset++;
-    }
-}
-
 #define L_STACK_ALLOC_BLOCK_SIZE 8
 l_stack* l_stack_init(){
     l_stack* ptr = malloc(sizeof(l_stack));
@@ -18,7 +18,6 @@ typedef struct label_stack {
     size_t current;
 } l_stack;
 
-void print_string_format(FILE* fptr, const char* string);
 l_stack* l_stack_init();
 bool l_stack_push(l_stack* stack, l_data* label);
 void l_stack_pop(l_stack* stack, l_data* label);
@@ -0,0 +1,503 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Constant folding and propagation over the analysed AST.
+//
+// The pass runs after semantic analysis, so every node already carries its
+// 'ret_value' and every variable its 'scope_id'. Operator subtrees whose
+// operands are literals are evaluated at compile time and replaced by a single
+// literal. Constants initialized with a literal value are substituted into all
+// of their uses and their definitions are dropped.
+//
+// Anything whose result depends on the target interpreter (i32 overflow,
+// division by zero, rounding of negative integer division, non-finite floats)
+// is left untouched so the program keeps its runtime behaviour.
+
+#include "const_fold.h"
+#include "data_types.h"
+#include "util.h"
+#include "vector.h"
+
+#include <assert.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Constant known at compile time, 'def' is the detached CONST_DEF node that
+// still owns the name, scope and value.
+typedef struct {
+    node* def;
+    node* value;
+} const_entry;
+
+// Returns true if 'n' is a literal the pass knows how to evaluate.
+bool fold_is_value(node* n) {
+    n = unwrap_expr(n);
+    if (n->data.type == NULL_LIT) {
+        return true;
+    }
+    if (n->data.type != LITERAL) {
+        return false;
+    }
+    return n->data.ret_value == I32 || n->data.ret_value == F64 ||
+           n->data.ret_value == BOOLEAN;
+}
+
+// Creates a standalone copy of the literal 'lit'.
+node* fold_copy_value(node* lit) {
+    node* n = create_node(lit->data.type);
+    if (n == NULL) {
+        return NULL;
+    }
+    n->data.ret_value = lit->data.ret_value;
+    switch (lit->data.ret_value) {
+    case I32:
+        n->data.int_value = lit->data.int_value;
+        break;
+    case F64:
+        n->data.float_value = lit->data.float_value;
+        break;
+    case BOOLEAN:
+        n->data.bool_value = lit->data.bool_value;
+        break;
+    default:
+        break;
+    }
+    return n;
+}
+
+// Replaces 'n' with the literal described by 'res' and frees 'n'.
+error_code fold_replace(node* n, node_data* res) {
+    node* lit = create_node(LITERAL);
+    if (lit == NULL) {
+        return INTERNAL_ERR;
+    }
+    lit->data = *res;
+    lit->data.type = LITERAL;
+    lit->data.scope_id = NULL;
+
+    if (!replace_node(n, lit)) {
+        delete_tree(&lit);
+        return INTERNAL_ERR;
+    }
+    delete_tree(&n);
+    return NO_ERR;
+}
+
+// Evaluates the binary 'op' over two i32 values. Returns false when the
+// result has to be left for runtime.
+bool fold_eval_i32(node_type op, int32_t a, int32_t b, node_data* res) {
+    int64_t r;
+    res->ret_value = I32;
+    switch (op) {
+    case ADD:
+        r = (int64_t)a + b;
+        break;
+    case SUB:
+        r = (int64_t)a - b;
+        break;
+    case MUL:
+        r = (int64_t)a * b;
+        break;
+    case DIV:
+        // IDIV rounding of negative operands is up to the interpreter, only
+        // fold when truncation and flooring agree.
+        if (b == 0 || (a == INT32_MIN && b == -1)) {
+            return false;
+        }
+        if (a % b != 0 && (a < 0 || b < 0)) {
+            return false;
+        }
+        r = a / b;
+        break;
+    default:
+        res->ret_value = BOOLEAN;
+        switch (op) {
+        case EQUAL:
+            res->bool_value = a == b;
+            return true;
+        case NOT_EQUAL:
+            res->bool_value = a != b;
+            return true;
+        case MORE:
+            res->bool_value = a > b;
+            return true;
+        case LESS:
+            res->bool_value = a < b;
+            return true;
+        case EQUALMORE:
+            res->bool_value = a >= b;
+            return true;
+        case EQUALLESS:
+            res->bool_value = a <= b;
+            return true;
+        default:
+            return false;
+        }
+    }
+    if (r < INT32_MIN || r > INT32_MAX) {
+        return false;
+    }
+    res->int_value = (int32_t)r;
+    return true;
+}
+
+// Evaluates the binary 'op' over two f64 values. Returns false when the
+// result has to be left for runtime.
+bool fold_eval_f64(node_type op, double a, double b, node_data* res) {
+    double r;
+    res->ret_value = F64;
+    switch (op) {
+    case ADD:
+        r = a + b;
+        break;
+    case SUB:
+        r = a - b;
+        break;
+    case MUL:
+        r = a * b;
+        break;
+    case DIV:
+        if (b == 0.0) {
+            return false;
+        }
+        r = a / b;
+        break;
+    default:
+        res->ret_value = BOOLEAN;
+        switch (op) {
+        case EQUAL:
+            res->bool_value = a == b;
+            return true;
+        case NOT_EQUAL:
+            res->bool_value = a != b;
+            return true;
+        case MORE:
+            res->bool_value = a > b;
+            return true;
+        case LESS:
+            res->bool_value = a < b;
+            return true;
+        case EQUALMORE:
+            res->bool_value = a >= b;
+            return true;
+        case EQUALLESS:
+            res->bool_value = a <= b;
+            return true;
+        default:
+            return false;
+        }
+    }
+    if (!isfinite(r)) {
+        return false;
+    }
+    res->float_value = r;
+    return true;
+}
+
+// Evaluates the binary 'op' over two bool values.
+bool fold_eval_bool(node_type op, bool a, bool b, node_data* res) {
+    res->ret_value = BOOLEAN;
+    switch (op) {
+    case EQUAL:
+        res->bool_value = a == b;
+        return true;
+    case NOT_EQUAL:
+        res->bool_value = a != b;
+        return true;
+    case B_AND:
+        res->bool_value = a && b;
+        return true;
+    case B_OR:
+        res->bool_value = a || b;
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Tries to fold binary operator 'n'. Returns true in 'done' if 'n' was
+// replaced (and freed).
+error_code fold_binary(node* n, bool* done) {
+    assert(n->child_count == 2);
+    node* l = n->children[0];
+    node* r = n->children[1];
+    if (!fold_is_value(l) || !fold_is_value(r)) {
+        return NO_ERR;
+    }
+    l = unwrap_expr(l);
+    r = unwrap_expr(r);
+
+    node_data res = {0};
+    bool ok = false;
+
+    if (l->data.type == NULL_LIT || r->data.type == NULL_LIT) {
+        // Comparison with null is known once both sides are known.
+        bool same = l->data.type == r->data.type;
+        res.ret_value = BOOLEAN;
+        if (n->data.type == EQUAL) {
+            res.bool_value = same;
+            ok = true;
+        } else if (n->data.type == NOT_EQUAL) {
+            res.bool_value = !same;
+            ok = true;
+        }
+    } else if (l->data.ret_value != r->data.ret_value) {
+        ok = false;
+    } else if (l->data.ret_value == I32) {
+        ok = fold_eval_i32(n->data.type, l->data.int_value, r->data.int_value,
+                           &res);
+    } else if (l->data.ret_value == F64) {
+        ok = fold_eval_f64(n->data.type, l->data.float_value,
+                           r->data.float_value, &res);
+    } else if (l->data.ret_value == BOOLEAN) {
+        ok = fold_eval_bool(n->data.type, l->data.bool_value,
+                            r->data.bool_value, &res);
+    }
+
+    if (!ok) {
+        return NO_ERR;
+    }
+    *done = true;
+    return fold_replace(n, &res);
+}
+
+// Tries to fold unary operator 'n'.
+error_code fold_unary(node* n, bool* done) {
+    assert(n->child_count == 1);
+    if (!fold_is_value(n->children[0])) {
+        return NO_ERR;
+    }
+    node* c = unwrap_expr(n->children[0]);
+    node_data res = {0};
+    res.ret_value = c->data.ret_value;
+
+    if (n->data.type == INT_NEGATE && c->data.ret_value == I32) {
+        if (c->data.int_value == INT32_MIN) {
+            return NO_ERR;
+        }
+        res.int_value = -c->data.int_value;
+    } else if (n->data.type == INT_NEGATE && c->data.ret_value == F64) {
+        res.float_value = -c->data.float_value;
+    } else if (n->data.type == B_NEG && c->data.ret_value == BOOLEAN) {
+        res.bool_value = !c->data.bool_value;
+    } else {
+        return NO_ERR;
+    }
+
+    *done = true;
+    return fold_replace(n, &res);
+}
+
+// 'lit orelse x' is 'lit', 'null orelse x' is 'x'. Unlike the generated code,
+// the unused side is not evaluated, which matches the language semantics.
+error_code fold_orelse(node* n, bool* done) {
+    assert(n->child_count == 2);
+    node* l = n->children[0];
+    node* r = n->children[1];
+    if (!fold_is_value(l)) {
+        return NO_ERR;
+    }
+
+    node* keep;
+    if (unwrap_expr(l)->data.type != NULL_LIT) {
+        keep = l;
+    } else if (r->data.type != UNREACHABLE) {
+        keep = r;
+    } else {
+        // 'null orelse unreachable' has to panic at runtime.
+        return NO_ERR;
+    }
+
+    detach_node(keep);
+    if (!replace_node(n, keep)) {
+        delete_tree(&keep);
+        return INTERNAL_ERR;
+    }
+    delete_tree(&n);
+    *done = true;
+    return NO_ERR;
+}
+
+// Folds the conversions inserted by semantic analysis ('ifj.i2f', 'ifj.f2i')
+// when their argument is a literal.
+error_code fold_conversion(node* n, bool* done) {
+    bool i2f = strcmp(n->data.id_name, "ifj.i2f") == 0;
+    bool f2i = strcmp(n->data.id_name, "ifj.f2i") == 0;
+    if (!i2f && !f2i) {
+        return NO_ERR;
+    }
+
+    node* params = get_child_by_type(n, INPUT_PARAM_LIST, 0);
+    node* param = get_child_by_type(params, INPUT_PARAM, 0);
+    if (param == NULL || param->child_count != 1 ||
+        !fold_is_value(param->children[0])) {
+        return NO_ERR;
+    }
+    node* arg = unwrap_expr(param->children[0]);
+    node_data res = {0};
+
+    if (i2f && arg->data.ret_value == I32) {
+        res.ret_value = F64;
+        res.float_value = (double)arg->data.int_value;
+    } else if (f2i && arg->data.ret_value == F64) {
+        double d = arg->data.float_value;
+        if (d < INT32_MIN || d > INT32_MAX || has_decimals(d)) {
+            return NO_ERR;
+        }
+        res.ret_value = I32;
+        res.int_value = (int32_t)d;
+    } else {
+        return NO_ERR;
+    }
+
+    *done = true;
+    return fold_replace(n, &res);
+}
+
+// Finds the constant that variable 'var' refers to, or NULL.
+const_entry* fold_find_const(vector* consts, node* var) {
+    if (var->data.scope_id == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < consts->len; i++) {
+        const_entry* e = vec_get(consts, i);
+        if (strcmp(e->def->data.id_name, var->data.id_name) == 0 &&
+            strcmp(e->def->data.scope_id, var->data.scope_id) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+// Frees the definitions collected in 'consts' and empties it.
+void fold_clear_consts(vector* consts) {
+    for (size_t i = 0; i < consts->len; i++) {
+        const_entry* e = vec_get(consts, i);
+        delete_tree(&e->def);
+    }
+    vec_clear(consts);
+}
+
+error_code fold_node(node* n, vector* consts, fold_stats* stats);
+
+// Folds the children of 'n' in source order. Children may replace or remove
+// themselves while being folded.
+error_code fold_children(node* n, vector* consts, fold_stats* stats) {
+    int i = 0;
+    while (i < n->child_count) {
+        int count = n->child_count;
+        error_code err = fold_node(n->children[i], consts, stats);
+        if (err != NO_ERR) {
+            return err;
+        }
+        // The child detached itself, the next one moved to its index.
+        if (n->child_count == count) {
+            i++;
+        }
+    }
+    return NO_ERR;
+}
+
+error_code fold_node(node* n, vector* consts, fold_stats* stats) {
+    error_code err;
+    bool done = false;
+
+    // Scope ids are unique only within a function.
+    if (n->data.type == FUNC_DEF) {
+        fold_clear_consts(consts);
+    }
+
+    err = fold_children(n, consts, stats);
+    if (err != NO_ERR) {
+        return err;
+    }
+
+    switch (n->data.type) {
+    case VAR: {
+        const_entry* e = fold_find_const(consts, n);
+        if (e == NULL) {
+            break;
+        }
+        node* lit = fold_copy_value(e->value);
+        if (lit == NULL) {
+            return INTERNAL_ERR;
+        }
+        if (!replace_node(n, lit)) {
+            delete_tree(&lit);
+            return INTERNAL_ERR;
+        }
+        delete_tree(&n);
+        stats->propagated++;
+        break;
+    }
+    case CONST_DEF: {
+        if (n->child_count != 1 || !fold_is_value(n->children[0])) {
+            break;
+        }
+        const_entry e = {.def = n, .value = unwrap_expr(n->children[0])};
+        if (vec_push(consts, &e) == NULL) {
+            return INTERNAL_ERR;
+        }
+        // Every use gets the value substituted, the definition is dead.
+        detach_node(n);
+        stats->removed++;
+        break;
+    }
+    case MUL:
+    case DIV:
+    case ADD:
+    case SUB:
+    case EQUAL:
+    case NOT_EQUAL:
+    case EQUALMORE:
+    case EQUALLESS:
+    case MORE:
+    case LESS:
+    case B_AND:
+    case B_OR:
+        err = fold_binary(n, &done);
+        break;
+    case INT_NEGATE:
+    case B_NEG:
+        err = fold_unary(n, &done);
+        break;
+    case ORELSE:
+        err = fold_orelse(n, &done);
+        break;
+    case FUNC:
+        err = fold_conversion(n, &done);
+        break;
+    default:
+        break;
+    }
+
+    if (done) {
+        stats->folded++;
+    }
+    return err;
+}
+
+// Folds constant subexpressions and propagates constants in the whole 'ast'.
+// 'stats' may be NULL if the caller is not interested in the counters.
+error_code fold_constants(node* ast, fold_stats* stats) {
+    assert(ast != NULL);
+
+    fold_stats local = {0};
+    if (stats == NULL) {
+        stats = &local;
+    }
+
+    vector* consts = vec_init(8, sizeof(const_entry));
+    if (consts == NULL) {
+        return INTERNAL_ERR;
+    }
+
+    error_code err = fold_node(ast, consts, stats);
+
+    fold_clear_consts(consts);
+    vec_free(&consts);
+    return err;
+}
@@ -0,0 +1,21 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Constant folding and propagation over the analysed AST.
+
+#ifndef IFJ_PROJEKT_2024_CONST_FOLD_H
+#define IFJ_PROJEKT_2024_CONST_FOLD_H
+
+#include "ast.h"
+#include "error.h"
+
+// Counters describing what the folding pass did.
+typedef struct {
+    int folded;     // Operator nodes replaced by a literal
+    int propagated; // Uses of a constant replaced by its value
+    int removed;    // Constant definitions dropped after propagation
+} fold_stats;
+
+error_code fold_constants(node* ast, fold_stats* stats);
+
+#endif // IFJ_PROJEKT_2024_CONST_FOLD_H
@@ -0,0 +1,263 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Dead code and unreachable branch elimination over the analysed AST.
+//
+// Should run after 'fold_constants()', so that conditions built from
+// constants are already reduced to a single literal. The pass
+//   - replaces IF statements with a constant condition by the taken branch,
+//   - removes WHILE loops without an else block whose condition is constant
+//     false,
+//   - drops statements following return, break and continue,
+//   - removes functions that cannot be reached from main.
+
+#include "dead_code.h"
+#include "data_types.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Returns the constant value of the condition 'cond' in 'value', returns false
+// if the condition is not a constant. Conditions with a null binding
+// ('|x|') are constant only when the expression is null.
+bool dce_cond_value(node* cond, bool* value) {
+    assert(cond->data.type == COND);
+
+    node* expr = unwrap_expr(cond->children[0]);
+    if (get_child_by_type(cond, NULL_COND, 0) != NULL) {
+        if (expr->data.type == NULL_LIT) {
+            *value = false;
+            return true;
+        }
+        return false;
+    }
+    if (expr->data.type == LITERAL && expr->data.ret_value == BOOLEAN) {
+        *value = expr->data.bool_value;
+        return true;
+    }
+    return false;
+}
+
+// Returns true if control never continues past the statement 's'.
+bool stmt_terminates(node* s) {
+    switch (s->data.type) {
+    case RETURN:
+    case BREAK:
+    case CONTINUE:
+        return true;
+    case IF: {
+        node* body = get_child_by_type(s, STMT_LIST, 0);
+        node* else_node = get_child_by_type(s, ELSE, 0);
+        if (else_node == NULL) {
+            return false;
+        }
+        node* else_body = get_child_by_type(else_node, STMT_LIST, 0);
+        // Statements after a terminating one were already dropped, so it is
+        // enough to look at the last statement of each branch.
+        return body->child_count > 0 && else_body->child_count > 0 &&
+               stmt_terminates(body->children[body->child_count - 1]) &&
+               stmt_terminates(else_body->children[else_body->child_count - 1]);
+    }
+    default:
+        return false;
+    }
+}
+
+// Moves all the statements of 'body' into 'list' at 'index'. Returns the
+// number of moved statements or -1 on failure.
+int dce_splice(node* body, node* list, int index) {
+    int count = 0;
+    while (body->child_count > 0) {
+        node* s = detach_node(body->children[0]);
+        if (!insert_node(s, list, index + count)) {
+            delete_tree(&s);
+            return -1;
+        }
+        count++;
+    }
+    return count;
+}
+
+// Replaces the statement 's' (child of 'list' at 'index') by 'body', which
+// may be NULL to just remove it. Returns the number of statements now in
+// place of 's' or -1 on failure.
+int dce_replace_stmt(node* s, node* body, node* list, int index) {
+    int count = 0;
+    if (body != NULL) {
+        count = dce_splice(body, list, index);
+        if (count < 0) {
+            return -1;
+        }
+    }
+    detach_node(s);
+    delete_tree(&s);
+    return count;
+}
+
+// Prunes the statement 's' at 'index' of 'list' if its condition is constant.
+// Returns the number of statements occupying its place afterwards
+// (1 if it was left as is) or -1 on failure.
+int dce_prune(node* s, node* list, int index, dce_stats* stats) {
+    bool value;
+
+    if (s->data.type == IF) {
+        node* cond = get_child_by_type(s, COND, 0);
+        if (!dce_cond_value(cond, &value)) {
+            return 1;
+        }
+        node* body = NULL;
+        if (value) {
+            body = get_child_by_type(s, STMT_LIST, 0);
+        } else if (get_child_by_type(s, ELSE, 0) != NULL) {
+            body = get_child_by_type(get_child_by_type(s, ELSE, 0), STMT_LIST,
+                                     0);
+        }
+        stats->branches++;
+        return dce_replace_stmt(s, body, list, index);
+    }
+
+    if (s->data.type == WHILE) {
+        node* cond = get_child_by_type(s, COND, 0);
+        if (!dce_cond_value(cond, &value) || value) {
+            return 1;
+        }
+        // Break and continue inside the else block jump to the labels of this
+        // loop, so such a loop has to stay.
+        if (get_child_by_type(s, WHILE_ELSE, 0) != NULL) {
+            return 1;
+        }
+        stats->branches++;
+        return dce_replace_stmt(s, NULL, list, index);
+    }
+
+    return 1;
+}
+
+error_code dce_node(node* n, dce_stats* stats);
+
+// Eliminates dead code inside the statement list 'list'.
+error_code dce_stmt_list(node* list, dce_stats* stats) {
+    int i = 0;
+    while (i < list->child_count) {
+        node* s = list->children[i];
+
+        // Nested blocks first, so spliced statements are already processed.
+        error_code err = dce_node(s, stats);
+        if (err != NO_ERR) {
+            return err;
+        }
+
+        int count = dce_prune(s, list, i, stats);
+        if (count < 0) {
+            return INTERNAL_ERR;
+        }
+
+        for (int j = i; j < i + count; j++) {
+            if (!stmt_terminates(list->children[j])) {
+                continue;
+            }
+            // Everything after the terminating statement is unreachable.
+            while (list->child_count > j + 1) {
+                node* dead = detach_node(list->children[j + 1]);
+                delete_tree(&dead);
+                stats->statements++;
+            }
+            return NO_ERR;
+        }
+        i += count;
+    }
+    return NO_ERR;
+}
+
+error_code dce_node(node* n, dce_stats* stats) {
+    if (n->data.type == STMT_LIST) {
+        return dce_stmt_list(n, stats);
+    }
+    // Statement lists are nested only in statements, never in expressions.
+    for (int i = 0; i < n->child_count; i++) {
+        node_type t = n->children[i]->data.type;
+        if (t == STMT_LIST || t == ELSE || t == WHILE_CNT || t == WHILE_ELSE) {
+            error_code err = dce_node(n->children[i], stats);
+            if (err != NO_ERR) {
+                return err;
+            }
+        }
+    }
+    return NO_ERR;
+}
+
+// Returns the index of the function 'name' among the children of 'prog' or -1.
+int dce_find_function(node* prog, const char* name) {
+    for (int i = 0; i < prog->child_count; i++) {
+        if (strcmp(prog->children[i]->data.id_name, name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Marks the user functions called anywhere inside 'n' and those reachable
+// from them.
+void dce_mark_calls(node* prog, node* n, bool* reached) {
+    if (n->data.type == FUNC && strncmp(n->data.id_name, "ifj.", 4) != 0) {
+        int idx = dce_find_function(prog, n->data.id_name);
+        if (idx >= 0 && !reached[idx]) {
+            reached[idx] = true;
+            dce_mark_calls(prog, prog->children[idx], reached);
+        }
+    }
+    for (int i = 0; i < n->child_count; i++) {
+        dce_mark_calls(prog, n->children[i], reached);
+    }
+}
+
+// Removes the functions that are never called from main.
+error_code dce_functions(node* prog, dce_stats* stats) {
+    int main_idx = dce_find_function(prog, "main");
+    if (main_idx < 0) {
+        return NO_ERR;
+    }
+
+    bool* reached = calloc(prog->child_count, sizeof(bool));
+    if (reached == NULL) {
+        return INTERNAL_ERR;
+    }
+    reached[main_idx] = true;
+    dce_mark_calls(prog, prog->children[main_idx], reached);
+
+    // Walk backwards so the indices in 'reached' stay valid.
+    for (int i = prog->child_count - 1; i >= 0; i--) {
+        if (!reached[i]) {
+            node* f = detach_node(prog->children[i]);
+            delete_tree(&f);
+            stats->functions++;
+        }
+    }
+    free(reached);
+    return NO_ERR;
+}
+
+// Eliminates dead code in the whole program 'ast'. Uncalled functions are
+// removed only with 'functions' set, 'ast' has to hold all of them then.
+// 'stats' may be NULL if the caller is not interested in the counters.
+error_code eliminate_dead_code(node* ast, bool functions, dce_stats* stats) {
+    assert(ast != NULL);
+    assert(ast->data.type == PROG);
+
+    dce_stats local = {0};
+    if (stats == NULL) {
+        stats = &local;
+    }
+
+    for (int i = 0; i < ast->child_count; i++) {
+        error_code err = dce_node(ast->children[i], stats);
+        if (err != NO_ERR) {
+            return err;
+        }
+    }
+
+    // Branches are pruned first, they might have contained the only calls.
+    return functions ? dce_functions(ast, stats) : NO_ERR;
+}
@@ -0,0 +1,22 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Dead code and unreachable branch elimination over the analysed AST.
+
+#ifndef IFJ_PROJEKT_2024_DEAD_CODE_H
+#define IFJ_PROJEKT_2024_DEAD_CODE_H
+
+#include "ast.h"
+#include "error.h"
+
+// Counters describing what the elimination pass did.
+typedef struct {
+    int branches;   // IF and WHILE statements with a constant condition
+    int statements; // Statements dropped after return, break or continue
+    int functions;  // Function definitions never called from main
+} dce_stats;
+
+error_code eliminate_dead_code(node* ast, bool functions, dce_stats* stats);
+bool stmt_terminates(node* s);
+
+#endif // IFJ_PROJEKT_2024_DEAD_CODE_H
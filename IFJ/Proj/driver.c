@@ -0,0 +1,381 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Compilation of a whole program from its source to IFJcode24.
+//
+// Everything a compilation allocates is freed at its end, also when it
+// fails, so that one process can compile any number of programs. Only the
+// symtable of the builtin functions is kept between them.
+
+#include "driver.h"
+
+#include <stdlib.h>
+
+#include "ast.h"
+#include "code_gen.h"
+#include "const_fold.h"
+#include "dead_code.h"
+#include "flat_ast.h"
+#include "func_cache.h"
+#include "func_look_up.h"
+#include "inliner.h"
+#include "instr.h"
+#include "ir.h"
+#include "licm.h"
+#include "parser.h"
+#include "peephole.h"
+#include "scope_stack.h"
+#include "semantic.h"
+#include "stats.h"
+#include "symtable.h"
+#include "util.h"
+
+// Creates the symtable stack with the scope of the builtin functions and
+// builds the code of the builtins.
+error_code driver_init(driver* drv) {
+    if (builtin_init() != NO_ERR) {
+        return INTERNAL_ERR;
+    }
+    drv->symtable_stack = vec_init(4, sizeof(b_tree*));
+    if (drv->symtable_stack == NULL) {
+        return INTERNAL_ERR;
+    }
+    error_code err = enter_scope(drv->symtable_stack);
+    if (err == NO_ERR &&
+        populate_with_builtins(drv->symtable_stack) != INSERT_SUCCESS) {
+        err = INTERNAL_ERR;
+    }
+    if (err != NO_ERR) {
+        driver_free(drv);
+    }
+    return err;
+}
+
+// Removes the scopes above the first 'len' ones without checking them.
+void driver_drop_scopes(vector* symtable_stack, size_t len) {
+    while (symtable_stack->len > len) {
+        b_tree* symtable = vec_pop(symtable_stack);
+        if (symtable != NULL) {
+            rb_tree_free(symtable);
+            free(symtable);
+        }
+    }
+}
+
+void driver_free(driver* drv) {
+    if (drv->symtable_stack != NULL) {
+        driver_drop_scopes(drv->symtable_stack, 0);
+        vec_free(&drv->symtable_stack);
+    }
+}
+
+// Analyses the parsed program 'ast'. Its functions are declared in a scope
+// of their own above the builtins, which is left afterwards.
+error_code driver_analyse(driver* drv, const driver_options* opts, node* ast,
+                          func_cache* cache) {
+    vector* symtable_stack = drv->symtable_stack;
+    size_t builtins_len = symtable_stack->len;
+
+    scope_stack* scp_s = scope_stack_init(3);
+    if (scp_s == NULL) {
+        fprintf(stderr, "Failed to alocate memory!\n Ending program!\n");
+        return INTERNAL_ERR;
+    }
+
+    error_code err = enter_scope(symtable_stack);
+    if (err != NO_ERR) {
+        scope_stack_free(&scp_s);
+        return err;
+    }
+
+    if (opts->cache_dir != NULL) {
+        // Only the functions missing in the cache are analysed.
+        err = semantically_analyse_parallel(ast, symtable_stack, opts->jobs,
+                                            cache->hit);
+    } else if (opts->jobs > 1) {
+        err = semantically_analyse_parallel(ast, symtable_stack, opts->jobs,
+                                            NULL);
+    } else {
+        err = semantically_analyse(ast, symtable_stack, scp_s);
+    }
+    if (err != NO_ERR) {
+        fprintf(stderr, "The program encountered a problem during semantical "
+                        "analysis. Aborting...\n");
+    }
+
+    DEBUG_PRINT("semantical analysis ended with %s", ERROR_STRINGS[err]);
+
+    // A failed analysis leaves its scopes behind.
+    driver_drop_scopes(symtable_stack, builtins_len + 1);
+    leave_scope(symtable_stack);
+    scope_stack_free(&scp_s);
+
+    if (err == NO_ERR && opts->cache_dir != NULL) {
+        cache_detach_hits(cache, ast);
+    }
+    return err;
+}
+
+// Runs the optimization passes over the analysed tree.
+error_code driver_optimize(const driver_options* opts, node* ast) {
+    error_code err;
+    // With the cache every function is compiled on its own, the code of a
+    // caller must not depend on the bodies of other functions.
+    if (opts->cache_dir == NULL) {
+        inline_stats i_stats = {0};
+        err = inline_functions(ast, &i_stats);
+        if (err != NO_ERR) {
+            return err;
+        }
+        if (opts->opt_report) {
+            fprintf(stderr, "inlining: %d calls of %d functions inlined\n",
+                    i_stats.calls, i_stats.functions);
+        }
+    }
+
+    fold_stats f_stats = {0};
+    err = fold_constants(ast, &f_stats);
+    if (err != NO_ERR) {
+        return err;
+    }
+    if (opts->opt_report) {
+        fprintf(stderr,
+                "constant folding: %d folded, %d propagated, %d definitions "
+                "removed\n",
+                f_stats.folded, f_stats.propagated, f_stats.removed);
+    }
+
+    dce_stats d_stats = {0};
+    // With the cache the uncalled functions are removed from the code.
+    err = eliminate_dead_code(ast, opts->cache_dir == NULL, &d_stats);
+    if (err != NO_ERR) {
+        return err;
+    }
+    if (opts->opt_report) {
+        fprintf(stderr,
+                "dead code: %d branches pruned, %d statements dropped, %d "
+                "functions removed\n",
+                d_stats.branches, d_stats.statements, d_stats.functions);
+    }
+
+    licm_stats l_stats = {0};
+    err = hoist_loop_invariants(ast, &l_stats);
+    if (err != NO_ERR) {
+        return err;
+    }
+    if (opts->opt_report) {
+        fprintf(stderr,
+                "loop invariants: %d expressions hoisted out of %d loops\n",
+                l_stats.hoisted, l_stats.loops);
+    }
+    return NO_ERR;
+}
+
+// Generates the code of 'ast' into 'code'. With the cache the functions
+// found in it are taken from there and the fresh ones are stored.
+error_code driver_generate(const driver_options* opts, node* ast,
+                           func_cache* cache, vector* code) {
+    if (opts->cache_dir == NULL) {
+        return generate_code(ast, code, opts->registers, opts->jobs);
+    }
+
+    gen_result* fresh = calloc(ast->child_count + 1, sizeof(gen_result));
+    if (fresh == NULL) {
+        return INTERNAL_ERR;
+    }
+    error_code err =
+        generate_functions(ast, fresh, opts->registers, opts->jobs);
+    error_code store_err = cache_store(cache, fresh);
+    err = err != NO_ERR ? err : store_err;
+    free(fresh);
+    if (err == NO_ERR && opts->optimize) {
+        err = cache_prune(cache);
+    }
+    if (err == NO_ERR) {
+        err = generate_program(cache->results, cache->count, code);
+    }
+    return err;
+}
+
+// Runs the peephole optimizer over 'code', 'count_before' is the number of
+// instructions of the unoptimized program for the report.
+error_code driver_peephole(const driver_options* opts, vector* code,
+                           size_t count_before) {
+    if (!opts->optimize) {
+        if (opts->opt_report) {
+            fprintf(stderr, "instructions: %zu\n", code->len);
+        }
+        return NO_ERR;
+    }
+
+    peephole_stats p_stats = {0};
+    error_code err = peephole_optimize(code, &p_stats);
+    if (err != NO_ERR) {
+        return err;
+    }
+    if (opts->opt_report) {
+        fprintf(stderr, "peephole: %zu rewrites\n", p_stats.rewrites);
+        fprintf(stderr,
+                "instructions: %zu -> %zu (tree passes) -> %zu (peephole)\n",
+                count_before, p_stats.before, p_stats.after);
+    }
+    return NO_ERR;
+}
+
+// Runs the passes over the IR of the functions of 'code'.
+error_code driver_ir(const driver_options* opts, vector* code) {
+    if (!opts->optimize) {
+        return NO_ERR;
+    }
+
+    ir_stats r_stats = {0};
+    error_code err = ir_optimize(code, &r_stats, opts->ir_dump ? stderr : NULL);
+    if (err != NO_ERR) {
+        return err;
+    }
+    if (opts->opt_report) {
+        fprintf(stderr,
+                "ir: %zu copies propagated, %zu expressions reused, %zu dead "
+                "instructions removed in %zu functions\n",
+                r_stats.copies, r_stats.reused, r_stats.removed,
+                r_stats.functions);
+        fprintf(stderr, "instructions: %zu -> %zu (ir)\n", r_stats.before,
+                r_stats.after);
+    }
+    return NO_ERR;
+}
+
+// Compiles the program read from 'in' and writes its code to 'out'. Nothing
+// is written when the compilation fails, the error is returned.
+error_code driver_compile(driver* drv, const driver_options* opts, FILE* in,
+                          FILE* out) {
+    double start = now_ms();
+    func_cache cache = {0};
+    vector* code = NULL;
+
+    stats_begin(PHASE_PARSE);
+    node* ast_tree = create_node(PROG);
+    if (ast_tree == NULL) {
+        fprintf(stderr, "Failed to alocate memory!\n Ending program!\n");
+        return INTERNAL_ERR;
+    }
+
+    error_code err = parse(ast_tree, in);
+    DEBUG_PRINT("parsing ended with code %d", err)
+    if (err != NO_ERR) {
+        fprintf(stderr, "The program encountered a problem during semantic or "
+                        "lexical analysis. Aborting...\n");
+        goto cleanup;
+    }
+
+    if (opts->cache_dir != NULL) {
+        err = cache_load(&cache, opts->cache_dir, ast_tree, opts->registers,
+                         opts->optimize);
+        if (err != NO_ERR) {
+            fprintf(stderr, "Failed to alocate memory!\n Ending program!\n");
+            goto cleanup;
+        }
+    }
+    stats_end(PHASE_PARSE);
+
+    stats_begin(PHASE_SEMANTIC);
+    err = driver_analyse(drv, opts, ast_tree, &cache);
+    if (err != NO_ERR) {
+        goto cleanup;
+    }
+    stats_end(PHASE_SEMANTIC);
+
+    if (opts->ast_report) {
+        flat_ast flat;
+        err = flat_build(ast_tree, &flat);
+        if (err != NO_ERR) {
+            fprintf(stderr, "Failed to alocate memory!\n Ending program!\n");
+            goto cleanup;
+        }
+        flat_report(ast_tree, &flat, stderr);
+        flat_free(&flat);
+    }
+
+    // Code generation does not modify the tree, so the unoptimized program
+    // can be generated first to compare the instruction counts.
+    size_t count_before = 0;
+    if (opts->opt_report) {
+        vector* list = instr_list_init();
+        err = list == NULL ? INTERNAL_ERR
+                           : generate_code(ast_tree, list, false, opts->jobs);
+        if (list != NULL) {
+            count_before = list->len;
+            instr_list_free(&list);
+        }
+        if (err != NO_ERR) {
+            fprintf(stderr, "The program encountered a problem during code "
+                            "generation. Aborting...\n");
+            goto cleanup;
+        }
+    }
+
+    stats_begin(PHASE_OPTIMIZE);
+    if (opts->optimize) {
+        err = driver_optimize(opts, ast_tree);
+        if (err != NO_ERR) {
+            fprintf(stderr, "The program encountered a problem during "
+                            "optimization. Aborting...\n");
+            goto cleanup;
+        }
+    }
+    stats_end(PHASE_OPTIMIZE);
+
+    stats_begin(PHASE_GENERATE);
+    code = instr_list_init();
+    err = code == NULL ? INTERNAL_ERR
+                       : driver_generate(opts, ast_tree, &cache, code);
+    if (err != NO_ERR) {
+        fprintf(stderr, "The program encountered a problem during code "
+                        "generation . Aborting...\n");
+        goto cleanup;
+    }
+    stats_end(PHASE_GENERATE);
+
+    stats_begin(PHASE_PEEPHOLE);
+    err = driver_peephole(opts, code, count_before);
+    if (err != NO_ERR) {
+        fprintf(stderr, "The program encountered a problem during "
+                        "optimization. Aborting...\n");
+        goto cleanup;
+    }
+    stats_end(PHASE_PEEPHOLE);
+
+    stats_begin(PHASE_IR);
+    err = driver_ir(opts, code);
+    if (err != NO_ERR) {
+        fprintf(stderr, "The program encountered a problem during "
+                        "optimization. Aborting...\n");
+        goto cleanup;
+    }
+    stats_end(PHASE_IR);
+    stats_count(COUNT_INSTRS, code->len);
+
+    stats_begin(PHASE_OUTPUT);
+    if (!instr_list_write(code, out)) {
+        fprintf(stderr, "Failed to write the program!\n Ending program!\n");
+        err = INTERNAL_ERR;
+        goto cleanup;
+    }
+
+    if (opts->cache_dir != NULL) {
+        fprintf(stderr,
+                "cache: %d of %d functions reused, compiled in %.2f ms\n",
+                cache.hits, cache.count, now_ms() - start);
+    }
+
+cleanup:
+    if (code != NULL) {
+        instr_list_free(&code);
+    }
+    cache_free(&cache);
+    delete_tree(&ast_tree);
+    if (err == NO_ERR) {
+        stats_end(PHASE_OUTPUT);
+    }
+    return err;
+}
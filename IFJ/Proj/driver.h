@@ -0,0 +1,39 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Compilation of a whole program from its source to IFJcode24.
+
+#ifndef IFJ_PROJEKT_2024_DRIVER_H
+#define IFJ_PROJEKT_2024_DRIVER_H
+
+#include "error.h"
+#include "vector.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// What the compilation does, set by the command line options.
+typedef struct {
+    bool optimize;         // Runs the optimization passes
+    bool registers;        // Evaluates expressions in frame temporaries
+    bool opt_report;       // Prints what the optimizations did to stderr
+    bool ast_report;       // Compares the tree and its flat form on stderr
+    bool ir_dump;          // Prints the IR of the functions to stderr
+    int jobs;              // Threads analysing and generating the functions
+    const char* cache_dir; // Directory of the function cache, may be NULL
+} driver_options;
+
+// State kept between the programs compiled by one process.
+typedef struct {
+    // Holds only the scope of the builtin functions between the programs.
+    vector* symtable_stack;
+} driver;
+
+error_code driver_init(driver* drv);
+
+error_code driver_compile(driver* drv, const driver_options* opts, FILE* in,
+                          FILE* out);
+
+void driver_free(driver* drv);
+
+#endif // IFJ_PROJEKT_2024_DRIVER_H
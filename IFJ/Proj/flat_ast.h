@@ -0,0 +1,52 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Abstract syntax tree flattened into arrays indexed by node number, only
+// measured by --ast-report.
+
+#ifndef IFJ_PROJEKT_2024_FLAT_AST_H
+#define IFJ_PROJEKT_2024_FLAT_AST_H
+
+#include "ast.h"
+#include "error.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Index of a node, FLAT_NONE marks a missing one.
+typedef int32_t flat_id;
+#define FLAT_NONE (-1)
+
+// Nodes are numbered in pre-order, so the root is 0 and every subtree
+// occupies a contiguous range of indices. Strings in 'data' are borrowed from
+// the tree the arrays were built from.
+typedef struct {
+    size_t count;          // Number of nodes
+    uint8_t* kind;         // node_type of each node
+    uint8_t* ret_value;    // data_type of each node
+    flat_id* parent;       // Ancestor of each node
+    flat_id* first_child;  // First child of each node
+    flat_id* next_sibling; // Next child of the same ancestor
+    flat_id* payload;      // Index into 'data' or FLAT_NONE
+    node_data* data;       // Data of the nodes carrying any
+    size_t data_count;     // Number of entries in 'data'
+} flat_ast;
+
+error_code flat_build(node* root, flat_ast* flat);
+
+void flat_free(flat_ast* flat);
+
+flat_id flat_child_by_type(const flat_ast* flat, flat_id n, node_type type,
+                           int order);
+
+flat_id flat_ancestor_by_type(const flat_ast* flat, flat_id n, node_type type,
+                              int order);
+
+size_t flat_memory(const flat_ast* flat);
+
+size_t tree_memory(const node* n);
+
+void flat_report(node* root, const flat_ast* flat, FILE* out);
+
+#endif // IFJ_PROJEKT_2024_FLAT_AST_H
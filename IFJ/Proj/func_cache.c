@@ -0,0 +1,357 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Code of unchanged functions reused from the previous compilations.
+//
+// Every function definition gets a key hashed from its parsed subtree, the
+// signatures of the user functions it calls and the options changing the
+// generated code. A function whose key has a file in the cache directory is
+// neither analysed nor generated, its instructions and the builtins it uses
+// are read from the file. The others are compiled as usual and stored.
+//
+// Whether a function is called at all depends on the whole program, so the
+// uncalled functions are removed only after all the code is known, by
+// following the CALL instructions from main.
+//
+// A cache file holds the names of the used builtins on the first line and
+// the instructions of the function on the rest.
+
+#include "func_cache.h"
+#include "instr.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_FNV_OFFSET 14695981039346656037ull
+#define CACHE_FNV_PRIME 1099511628211ull
+
+// Adds the 'len' bytes of 'data' to the FNV-1a hash 'hash'.
+uint64_t cache_hash(uint64_t hash, const void* data, size_t len) {
+    const unsigned char* bytes = data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ bytes[i]) * CACHE_FNV_PRIME;
+    }
+    return hash;
+}
+
+// Adds the string 's' with its terminator, so "ab" "c" and "a" "bc" differ.
+uint64_t cache_hash_str(uint64_t hash, const char* s) {
+    if (s == NULL) {
+        s = "";
+    }
+    return cache_hash(hash, s, strlen(s) + 1);
+}
+
+// Adds the parsed subtree 'n' to 'hash'.
+uint64_t cache_hash_tree(uint64_t hash, const node* n) {
+    int32_t head[3] = {n->data.type, n->data.ret_value, n->child_count};
+    hash = cache_hash(hash, head, sizeof(head));
+
+    // Only literals keep a value in the union, every other node holds a
+    // name or NULL there. All the names count, a renamed |capture| must
+    // change the key just as a renamed variable.
+    if (n->data.type == LITERAL) {
+        if (n->data.ret_value == I32) {
+            hash = cache_hash(hash, &n->data.int_value,
+                              sizeof(n->data.int_value));
+        } else if (n->data.ret_value == F64) {
+            hash = cache_hash(hash, &n->data.float_value,
+                              sizeof(n->data.float_value));
+        } else if (n->data.ret_value == BOOLEAN) {
+            hash = cache_hash(hash, &n->data.bool_value,
+                              sizeof(n->data.bool_value));
+        } else {
+            hash = cache_hash_str(hash, n->data.str_value);
+        }
+    } else if (n->data.id_name != NULL) {
+        hash = cache_hash_str(hash, n->data.id_name);
+    }
+
+    for (int i = 0; i < n->child_count; i++) {
+        hash = cache_hash_tree(hash, n->children[i]);
+    }
+    return hash;
+}
+
+// Adds the signatures of the user functions of 'ast' called inside 'n'.
+uint64_t cache_hash_calls(uint64_t hash, node* ast, const node* n) {
+    if (n->data.type == FUNC && strncmp(n->data.id_name, "ifj.", 4) != 0) {
+        node* def = NULL;
+        for (int i = 0; i < ast->child_count && def == NULL; i++) {
+            if (strcmp(ast->children[i]->data.id_name, n->data.id_name) == 0) {
+                def = ast->children[i];
+            }
+        }
+        hash = cache_hash_str(hash, n->data.id_name);
+        // A missing function changes the key as well.
+        int32_t ret_value = def != NULL ? (int32_t)def->data.ret_value : -1;
+        hash = cache_hash(hash, &ret_value, sizeof(ret_value));
+        node* params = get_child_by_type(def, PARAM_LIST, 0);
+        if (params != NULL) {
+            hash = cache_hash_tree(hash, params);
+        }
+    }
+    for (int i = 0; i < n->child_count; i++) {
+        hash = cache_hash_calls(hash, ast, n->children[i]);
+    }
+    return hash;
+}
+
+// Returns the path of the file of 'key' or NULL on allocation failure.
+char* cache_path(const func_cache* cache, uint64_t key) {
+    size_t len = strlen(cache->dir) + 1 + 16 + strlen(".ifjc") + 1;
+    char* path = malloc(len);
+    if (path != NULL) {
+        snprintf(path, len, "%s/%016" PRIx64 ".ifjc", cache->dir, key);
+    }
+    return path;
+}
+
+// Reads the whole file 'path', returns NULL if there is none.
+char* cache_read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    char* text = NULL;
+    long len = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) >= 0 &&
+        fseek(f, 0, SEEK_SET) == 0) {
+        text = malloc(len + 1);
+    }
+    if (text != NULL && fread(text, 1, len, f) != (size_t)len) {
+        free(text);
+        text = NULL;
+    }
+    if (text != NULL) {
+        text[len] = '\0';
+    }
+    fclose(f);
+    return text;
+}
+
+// Fills 'res' from the cache file 'text'. Returns false if the file is
+// damaged, 'res' is left empty then.
+bool cache_parse(char* text, gen_result* res) {
+    char* code = strchr(text, '\n');
+    if (strncmp(text, "builtins", 8) != 0 || code == NULL) {
+        return false;
+    }
+    *code++ = '\0';
+
+    res->builtins = 0;
+    res->list = instr_list_init();
+    bool ok = res->list != NULL;
+
+    char* save = NULL;
+    for (char* name = strtok_r(text + 8, " ", &save); ok && name != NULL;
+         name = strtok_r(NULL, " ", &save)) {
+        builtin b = builtin_find(name);
+        ok = b != BUILTIN_COUNT;
+        if (ok) {
+            res->builtins |= (builtin_mask)1 << b;
+        }
+    }
+    ok = ok && instr_emit(res->list, code);
+
+    if (!ok) {
+        instr_list_free(&res->list);
+        res->builtins = 0;
+    }
+    return ok;
+}
+
+// Writes the code of 'res' into the file of 'key'. The file is renamed into
+// place once complete, a concurrent compilation never reads half of it.
+error_code cache_write(const func_cache* cache, uint64_t key,
+                       gen_result* res) {
+    char* path = cache_path(cache, key);
+    size_t tmp_len = path != NULL ? strlen(path) + 32 : 0;
+    char* tmp = path != NULL ? malloc(tmp_len) : NULL;
+    if (path == NULL || tmp == NULL) {
+        free(path);
+        free(tmp);
+        return INTERNAL_ERR;
+    }
+    snprintf(tmp, tmp_len, "%s.%ld.tmp", path, (long)getpid());
+
+    // The cache only speeds things up, failing to write it is not an error.
+    FILE* f = fopen(tmp, "w");
+    if (f != NULL) {
+        fputs("builtins", f);
+        for (int b = 0; b < BUILTIN_COUNT; b++) {
+            if (res->builtins & ((builtin_mask)1 << b)) {
+                fprintf(f, " %s", BUILTINS[b].name);
+            }
+        }
+        fputc('\n', f);
+        for (size_t i = 0; i < res->list->len; i++) {
+            instr* ins = vec_get(res->list, i);
+            fputs(OPCODE_STRINGS[ins->op], f);
+            for (int j = 0; j < ins->argc; j++) {
+                fputc(' ', f);
+                fputs(ins->args[j], f);
+            }
+            fputc('\n', f);
+        }
+        if (fclose(f) != 0 || rename(tmp, path) != 0) {
+            remove(tmp);
+        }
+    }
+
+    free(path);
+    free(tmp);
+    return NO_ERR;
+}
+
+// Computes the keys of the functions of the parsed 'ast' and loads the code
+// of those found in the directory 'dir'. 'registers' and 'optimize' are the
+// options the code is generated with.
+error_code cache_load(func_cache* cache, const char* dir, node* ast,
+                      bool registers, bool optimize) {
+    assert(cache != NULL && dir != NULL);
+    assert(ast != NULL && ast->data.type == PROG);
+
+    *cache = (func_cache){.dir = dir, .count = ast->child_count};
+    cache->keys = calloc(cache->count + 1, sizeof(uint64_t));
+    cache->hit = calloc(cache->count + 1, sizeof(bool));
+    cache->results = calloc(cache->count + 1, sizeof(gen_result));
+    if (cache->keys == NULL || cache->hit == NULL || cache->results == NULL) {
+        cache_free(cache);
+        return INTERNAL_ERR;
+    }
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Cannot create the cache directory %s\n", dir);
+    }
+
+    uint64_t options = cache_hash_str(CACHE_FNV_OFFSET, CACHE_VERSION);
+    options = cache_hash(options, &registers, sizeof(registers));
+    options = cache_hash(options, &optimize, sizeof(optimize));
+
+    for (int i = 0; i < cache->count; i++) {
+        node* func_def = ast->children[i];
+        uint64_t key = cache_hash_tree(options, func_def);
+        cache->keys[i] = cache_hash_calls(key, ast, func_def);
+
+        char* path = cache_path(cache, cache->keys[i]);
+        if (path == NULL) {
+            cache_free(cache);
+            return INTERNAL_ERR;
+        }
+        char* text = cache_read_file(path);
+        free(path);
+        if (text != NULL && cache_parse(text, &cache->results[i])) {
+            cache->hit[i] = true;
+            cache->hits++;
+        }
+        free(text);
+    }
+    return NO_ERR;
+}
+
+// Removes the functions whose code was loaded from the analysed 'ast', the
+// remaining ones are the misses in their order.
+void cache_detach_hits(func_cache* cache, node* ast) {
+    assert(ast->child_count == cache->count);
+
+    for (int i = cache->count - 1; i >= 0; i--) {
+        if (cache->hit[i]) {
+            node* f = detach_node(ast->children[i]);
+            delete_tree(&f);
+        }
+    }
+}
+
+// Takes over the 'fresh' code of the functions that were not loaded, in
+// their order, and stores the successfully generated ones.
+error_code cache_store(func_cache* cache, gen_result* fresh) {
+    error_code err = NO_ERR;
+    int next = 0;
+    for (int i = 0; i < cache->count; i++) {
+        if (cache->hit[i]) {
+            continue;
+        }
+        cache->results[i] = fresh[next++];
+        if (err == NO_ERR && cache->results[i].err == NO_ERR) {
+            err = cache_write(cache, cache->keys[i], &cache->results[i]);
+        }
+    }
+    return err;
+}
+
+// Returns the index of the function labeled 'name' or -1.
+int cache_find_function(const func_cache* cache, const char* name) {
+    for (int i = 0; i < cache->count; i++) {
+        vector* list = cache->results[i].list;
+        if (list == NULL || list->len == 0) {
+            continue;
+        }
+        instr* label = vec_get(list, 0);
+        if (label->op == I_LABEL && strcmp(label->args[0], name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Frees the code of the functions never called from main.
+error_code cache_prune(func_cache* cache) {
+    int main_idx = cache_find_function(cache, "main");
+    if (main_idx < 0) {
+        return NO_ERR;
+    }
+
+    bool* reached = calloc(cache->count + 1, sizeof(bool));
+    int* queue = malloc((cache->count + 1) * sizeof(int));
+    if (reached == NULL || queue == NULL) {
+        free(reached);
+        free(queue);
+        return INTERNAL_ERR;
+    }
+
+    int head = 0;
+    int tail = 0;
+    reached[main_idx] = true;
+    queue[tail++] = main_idx;
+    while (head < tail) {
+        vector* list = cache->results[queue[head++]].list;
+        for (size_t j = 0; j < list->len; j++) {
+            instr* ins = vec_get(list, j);
+            if (ins->op != I_CALL) {
+                continue;
+            }
+            int callee = cache_find_function(cache, ins->args[0]);
+            if (callee >= 0 && !reached[callee]) {
+                reached[callee] = true;
+                queue[tail++] = callee;
+            }
+        }
+    }
+
+    for (int i = 0; i < cache->count; i++) {
+        if (!reached[i]) {
+            instr_list_free(&cache->results[i].list);
+            cache->results[i].builtins = 0;
+        }
+    }
+    free(reached);
+    free(queue);
+    return NO_ERR;
+}
+
+// Frees everything held by 'cache'.
+void cache_free(func_cache* cache) {
+    for (int i = 0; cache->results != NULL && i < cache->count; i++) {
+        instr_list_free(&cache->results[i].list);
+    }
+    free(cache->keys);
+    free(cache->hit);
+    free(cache->results);
+    *cache = (func_cache){0};
+}
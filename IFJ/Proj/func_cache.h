@@ -0,0 +1,39 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Code of unchanged functions reused from the previous compilations.
+
+#ifndef IFJ_PROJEKT_2024_FUNC_CACHE_H
+#define IFJ_PROJEKT_2024_FUNC_CACHE_H
+
+#include "ast.h"
+#include "code_gen.h"
+#include "error.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Changes whenever the generated code of an unchanged function may change.
+#define CACHE_VERSION "2"
+
+typedef struct {
+    const char* dir;     // Directory holding one file per function
+    int count;           // Functions of the program
+    uint64_t* keys;      // Key of every function
+    bool* hit;           // Functions whose code was loaded
+    int hits;            // Number of loaded functions
+    gen_result* results; // Code of every function
+} func_cache;
+
+error_code cache_load(func_cache* cache, const char* dir, node* ast,
+                      bool registers, bool optimize);
+
+void cache_detach_hits(func_cache* cache, node* ast);
+
+error_code cache_store(func_cache* cache, gen_result* fresh);
+
+error_code cache_prune(func_cache* cache);
+
+void cache_free(func_cache* cache);
+
+#endif // IFJ_PROJEKT_2024_FUNC_CACHE_H
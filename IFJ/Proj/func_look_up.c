@@ -1,486 +1,415 @@
 // Projekt: Implementace přeladače jazyka IFJ24
 // Autor: Dominik Václavík (xvacla37)
+//
+// The builtin functions are a read-only table indexed by 'builtin'. A name is
+// found through a perfect hash, the functions used by a program are kept in
+// a bit mask and only their code is appended after the program.
+//
+// The code is turned into instructions once per process, their operands lie
+// in one block shared by the instruction lists of all the programs, so
+// appending a builtin copies its instructions without allocating.
 
 #include "func_look_up.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
-#include <assert.h>
-#include <stdbool.h>
 
-void fl_tree_init(fl_tree* tree) {
-    assert(tree != NULL);
-
-    tree->root = NULL;
-}
-
-fl_node* fl_tree_alloc_node(fl_node* parent, char* symbol, char* translated, char* code) {
-    assert(symbol != NULL);
-
-    fl_node* node = malloc(sizeof(fl_node));
-    if (node == NULL)
-        return NULL;
-    node->parent = parent;
-    node->left = NULL;
-    node->right = NULL;
-    node->color = RED;
-    node->symbol = symbol;
-    node->data.translated = translated;
-    node->data.code = code;
-    node->data.counter = 0;
-    return node;
-}
-
-void fl_left_rotate(fl_node* x, fl_tree* tree) {
-    fl_node* y = x->right;
-    x->right = y->left;
-    if (y->left != NULL)
-        y->left->parent = x;
-
-    y->parent = x->parent;
-
-    if (x->parent == NULL)
-        tree->root = y;
-    else if (x == x->parent->left)
-        x->parent->left = y;
-    else
-        x->parent->right = y;
-
-    y->left = x;
-    x->parent = y;
+const builtin_instr CODE_WRITE[] = {
+    {I_LABEL, 1, {"ifj$write"}},
+    {I_POPS, 1, {"GF@null"}},
+    {I_WRITE, 1, {"GF@null"}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_READSTR[] = {
+    {I_LABEL, 1, {"ifj$readstr"}},
+    {I_READ, 2, {"GF@null", "string"}},
+    {I_PUSHS, 1, {"GF@null"}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_READI32[] = {
+    {I_LABEL, 1, {"ifj$readi32"}},
+    {I_READ, 2, {"GF@null", "int"}},
+    {I_PUSHS, 1, {"GF@null"}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_READF64[] = {
+    {I_LABEL, 1, {"ifj$readf64"}},
+    {I_READ, 2, {"GF@null", "float"}},
+    {I_PUSHS, 1, {"GF@null"}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_I2F[] = {
+    {I_LABEL, 1, {"ifj$i2f"}},
+    {I_INT2FLOATS, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_F2I[] = {
+    {I_LABEL, 1, {"ifj$f2i"}},
+    {I_FLOAT2INTS, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_STRING[] = {
+    {I_LABEL, 1, {"ifj$string"}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_LENGTH[] = {
+    {I_LABEL, 1, {"ifj$length"}},
+    {I_POPS, 1, {"GF@null"}},
+    {I_STRLEN, 2, {"GF@null", "GF@null"}},
+    {I_PUSHS, 1, {"GF@null"}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_CONCAT[] = {
+    {I_LABEL, 1, {"ifj$concat"}},
+    {I_CREATEFRAME, 0, {NULL}},
+    {I_DEFVAR, 1, {"TF@s2"}},
+    {I_POPS, 1, {"TF@s2"}},
+    {I_DEFVAR, 1, {"TF@s1"}},
+    {I_POPS, 1, {"TF@s1"}},
+    {I_PUSHFRAME, 0, {NULL}},
+    {I_CONCAT, 3, {"LF@s1", "LF@s1", "LF@s2"}},
+    {I_PUSHS, 1, {"LF@s1"}},
+    {I_POPFRAME, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_SUBSTRING[] = {
+    {I_LABEL, 1, {"ifj$substring"}},
+    {I_CREATEFRAME, 0, {NULL}},
+    {I_DEFVAR, 1, {"TF@j"}},
+    {I_POPS, 1, {"TF@j"}},
+    {I_DEFVAR, 1, {"TF@i"}},
+    {I_POPS, 1, {"TF@i"}},
+    {I_DEFVAR, 1, {"TF@s"}},
+    {I_POPS, 1, {"TF@s"}},
+    {I_DEFVAR, 1, {"TF@lenght"}},
+    {I_DEFVAR, 1, {"TF@final"}},
+    {I_DEFVAR, 1, {"TF@char"}},
+    {I_PUSHFRAME, 0, {NULL}},
+    {I_PUSHS, 1, {"LF@i"}},
+    {I_PUSHS, 1, {"int@0"}},
+    {I_LTS, 0, {NULL}},
+    {I_PUSHS, 1, {"bool@true"}},
+    {I_JUMPIFEQS, 1, {"ifj$substring$err"}},
+    {I_PUSHS, 1, {"LF@j"}},
+    {I_PUSHS, 1, {"int@0"}},
+    {I_LTS, 0, {NULL}},
+    {I_PUSHS, 1, {"bool@true"}},
+    {I_JUMPIFEQS, 1, {"ifj$substring$err"}},
+    {I_PUSHS, 1, {"LF@i"}},
+    {I_PUSHS, 1, {"LF@j"}},
+    {I_GTS, 0, {NULL}},
+    {I_PUSHS, 1, {"bool@true"}},
+    {I_JUMPIFEQS, 1, {"ifj$substring$err"}},
+    {I_STRLEN, 2, {"LF@lenght", "LF@s"}},
+    {I_PUSHS, 1, {"LF@i"}},
+    {I_PUSHS, 1, {"LF@lenght"}},
+    {I_LTS, 0, {NULL}},
+    {I_PUSHS, 1, {"bool@false"}},
+    {I_JUMPIFEQS, 1, {"ifj$substring$err"}},
+    {I_PUSHS, 1, {"LF@j"}},
+    {I_PUSHS, 1, {"LF@lenght"}},
+    {I_GTS, 0, {NULL}},
+    {I_PUSHS, 1, {"bool@true"}},
+    {I_JUMPIFEQS, 1, {"ifj$substring$err"}},
+    {I_MOVE, 2, {"LF@final", "string@"}},
+    {I_LABEL, 1, {"ifj$substring$loop"}},
+    {I_JUMPIFEQ, 3, {"ifj$substring$end", "LF@i", "LF@j"}},
+    {I_GETCHAR, 3, {"LF@char", "LF@s", "LF@i"}},
+    {I_CONCAT, 3, {"LF@final", "LF@final", "LF@char"}},
+    {I_ADD, 3, {"LF@i", "LF@i", "int@1"}},
+    {I_JUMP, 1, {"ifj$substring$loop"}},
+    {I_LABEL, 1, {"ifj$substring$end"}},
+    {I_PUSHS, 1, {"LF@final"}},
+    {I_POPFRAME, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+    {I_LABEL, 1, {"ifj$substring$err"}},
+    {I_PUSHS, 1, {"nil@nil"}},
+    {I_POPFRAME, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_STRCMP[] = {
+    {I_LABEL, 1, {"ifj$strcmp"}},
+    {I_CREATEFRAME, 0, {NULL}},
+    {I_DEFVAR, 1, {"TF@s1"}},
+    {I_POPS, 1, {"TF@s1"}},
+    {I_DEFVAR, 1, {"TF@s2"}},
+    {I_POPS, 1, {"TF@s2"}},
+    {I_DEFVAR, 1, {"TF@result"}},
+    {I_DEFVAR, 1, {"TF@len1"}},
+    {I_DEFVAR, 1, {"TF@len2"}},
+    {I_DEFVAR, 1, {"TF@i"}},
+    {I_DEFVAR, 1, {"TF@char1"}},
+    {I_DEFVAR, 1, {"TF@char2"}},
+    {I_PUSHFRAME, 0, {NULL}},
+    {I_STRLEN, 2, {"LF@len1", "LF@s1"}},
+    {I_STRLEN, 2, {"LF@len2", "LF@s2"}},
+    {I_MOVE, 2, {"LF@i", "int@0"}},
+    {I_LABEL, 1, {"strcmp$loop"}},
+    {I_JUMPIFEQ, 3, {"strcmp$done", "LF@i", "LF@len1"}},
+    {I_JUMPIFEQ, 3, {"strcmp$done", "LF@i", "LF@len2"}},
+    {I_GETCHAR, 3, {"LF@char1", "LF@s1", "LF@i"}},
+    {I_GETCHAR, 3, {"LF@char2", "LF@s2", "LF@i"}},
+    {I_JUMPIFNEQ, 3, {"strcmp$diff", "LF@char1", "LF@char2"}},
+    {I_ADD, 3, {"LF@i", "LF@i", "int@1"}},
+    {I_JUMP, 1, {"strcmp$loop"}},
+    {I_LABEL, 1, {"strcmp$diff"}},
+    {I_LT, 3, {"LF@result", "LF@char1", "LF@char2"}},
+    {I_JUMPIFEQ, 3, {"strcmp$return_minus1", "LF@result", "bool@true"}},
+    {I_GT, 3, {"LF@result", "LF@char1", "LF@char2"}},
+    {I_JUMPIFEQ, 3, {"strcmp$return_plus1", "LF@result", "bool@true"}},
+    {I_LABEL, 1, {"strcmp$done"}},
+    {I_LT, 3, {"LF@result", "LF@len1", "LF@len2"}},
+    {I_JUMPIFEQ, 3, {"strcmp$return_minus1", "LF@result", "bool@true"}},
+    {I_GT, 3, {"LF@result", "LF@len1", "LF@len2"}},
+    {I_JUMPIFEQ, 3, {"strcmp$return_plus1", "LF@result", "bool@true"}},
+    {I_MOVE, 2, {"LF@result", "int@0"}},
+    {I_JUMP, 1, {"strcmp$return"}},
+    {I_LABEL, 1, {"strcmp$return_minus1"}},
+    {I_MOVE, 2, {"LF@result", "int@1"}},
+    {I_JUMP, 1, {"strcmp$return"}},
+    {I_LABEL, 1, {"strcmp$return_plus1"}},
+    {I_MOVE, 2, {"LF@result", "int@-1"}},
+    {I_LABEL, 1, {"strcmp$return"}},
+    {I_PUSHS, 1, {"LF@result"}},
+    {I_POPFRAME, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_ORD[] = {
+    {I_LABEL, 1, {"ifj$ord"}},
+    {I_CREATEFRAME, 0, {NULL}},
+    {I_DEFVAR, 1, {"TF@i"}},
+    {I_POPS, 1, {"TF@i"}},
+    {I_DEFVAR, 1, {"TF@s"}},
+    {I_POPS, 1, {"TF@s"}},
+    {I_DEFVAR, 1, {"TF@result"}},
+    {I_DEFVAR, 1, {"TF@ret"}},
+    {I_DEFVAR, 1, {"TF@len"}},
+    {I_PUSHFRAME, 0, {NULL}},
+    {I_STRLEN, 2, {"LF@len", "LF@s"}},
+    {I_MOVE, 2, {"LF@result", "int@0"}},
+    {I_LT, 3, {"LF@ret", "LF@i", "int@0"}},
+    {I_JUMPIFEQ, 3, {"ord$return", "LF@ret", "bool@true"}},
+    {I_LT, 3, {"LF@ret", "LF@i", "LF@len"}},
+    {I_NOT, 2, {"LF@ret", "LF@ret"}},
+    {I_JUMPIFEQ, 3, {"ord$return", "LF@ret", "bool@true"}},
+    {I_STRI2INT, 3, {"LF@result", "LF@s", "LF@i"}},
+    {I_LABEL, 1, {"ord$return"}},
+    {I_PUSHS, 1, {"LF@result"}},
+    {I_POPFRAME, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_CHR[] = {
+    {I_LABEL, 1, {"ifj$chr"}},
+    {I_INT2CHARS, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_ORELSE[] = {
+    {I_LABEL, 1, {"$bld$orelse"}},
+    {I_CREATEFRAME, 0, {NULL}},
+    {I_DEFVAR, 1, {"TF@elsevalue"}},
+    {I_POPS, 1, {"TF@elsevalue"}},
+    {I_DEFVAR, 1, {"TF@ifvalue"}},
+    {I_POPS, 1, {"TF@ifvalue"}},
+    {I_PUSHFRAME, 0, {NULL}},
+    {I_JUMPIFEQ, 3, {"$bld$orelse$else", "LF@ifvalue", "nil@nil"}},
+    {I_PUSHS, 1, {"LF@ifvalue"}},
+    {I_POPFRAME, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+    {I_LABEL, 1, {"$bld$orelse$else"}},
+    {I_PUSHS, 1, {"LF@elsevalue"}},
+    {I_POPFRAME, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+};
+
+const builtin_instr CODE_ORELSE_UNREACHABLE[] = {
+    {I_LABEL, 1, {"$bld$orelse$unreachable"}},
+    {I_CREATEFRAME, 0, {NULL}},
+    {I_DEFVAR, 1, {"TF@ifvalue"}},
+    {I_POPS, 1, {"TF@ifvalue"}},
+    {I_PUSHFRAME, 0, {NULL}},
+    {I_JUMPIFEQ, 3, {"$bld$orelse$unreachable$else", "LF@ifvalue", "nil@nil"}},
+    {I_PUSHS, 1, {"LF@ifvalue"}},
+    {I_POPFRAME, 0, {NULL}},
+    {I_RETURN, 0, {NULL}},
+    {I_LABEL, 1, {"$bld$orelse$unreachable$else"}},
+    {I_WRITE, 1, {"string@panic:\\032reached\\032unreachable\\032code\\010"}},
+    {I_EXIT, 1, {"int@57"}},
+};
+
+#define CODE(code) code, sizeof(code) / sizeof(code[0])
+
+const builtin_def BUILTINS[BUILTIN_COUNT] = {
+    [BUILTIN_WRITE] = {"ifj.write", "ifj$write", CODE(CODE_WRITE)},
+    [BUILTIN_READSTR] = {"ifj.readstr", "ifj$readstr", CODE(CODE_READSTR)},
+    [BUILTIN_READI32] = {"ifj.readi32", "ifj$readi32", CODE(CODE_READI32)},
+    [BUILTIN_READF64] = {"ifj.readf64", "ifj$readf64", CODE(CODE_READF64)},
+    [BUILTIN_I2F] = {"ifj.i2f", "ifj$i2f", CODE(CODE_I2F)},
+    [BUILTIN_F2I] = {"ifj.f2i", "ifj$f2i", CODE(CODE_F2I)},
+    [BUILTIN_STRING] = {"ifj.string", "ifj$string", CODE(CODE_STRING)},
+    [BUILTIN_LENGTH] = {"ifj.length", "ifj$length", CODE(CODE_LENGTH)},
+    [BUILTIN_CONCAT] = {"ifj.concat", "ifj$concat", CODE(CODE_CONCAT)},
+    [BUILTIN_SUBSTRING] = {"ifj.substring", "ifj$substring", CODE(CODE_SUBSTRING)},
+    [BUILTIN_STRCMP] = {"ifj.strcmp", "ifj$strcmp", CODE(CODE_STRCMP)},
+    [BUILTIN_ORD] = {"ifj.ord", "ifj$ord", CODE(CODE_ORD)},
+    [BUILTIN_CHR] = {"ifj.chr", "ifj$chr", CODE(CODE_CHR)},
+    [BUILTIN_ORELSE] = {"bld.orelse", "$bld$orelse", CODE(CODE_ORELSE)},
+    [BUILTIN_ORELSE_UNREACHABLE] = {"bld.orelse_unreachable", "$bld$orelse$unreachable", CODE(CODE_ORELSE_UNREACHABLE)},
+};
+
+// Seed of the hash, chosen so that no two builtin names share a slot.
+#define BUILTIN_HASH_SEED 2u
+#define BUILTIN_HASH_BITS 5
+
+// Builtin in each slot of the perfect hash, BUILTIN_COUNT if empty.
+const uint8_t BUILTIN_SLOTS[1 << BUILTIN_HASH_BITS] = {
+    [0] = BUILTIN_STRING,
+    [1] = BUILTIN_COUNT,
+    [2] = BUILTIN_COUNT,
+    [3] = BUILTIN_READF64,
+    [4] = BUILTIN_COUNT,
+    [5] = BUILTIN_COUNT,
+    [6] = BUILTIN_ORD,
+    [7] = BUILTIN_COUNT,
+    [8] = BUILTIN_COUNT,
+    [9] = BUILTIN_ORELSE_UNREACHABLE,
+    [10] = BUILTIN_COUNT,
+    [11] = BUILTIN_STRCMP,
+    [12] = BUILTIN_COUNT,
+    [13] = BUILTIN_COUNT,
+    [14] = BUILTIN_COUNT,
+    [15] = BUILTIN_READSTR,
+    [16] = BUILTIN_COUNT,
+    [17] = BUILTIN_I2F,
+    [18] = BUILTIN_LENGTH,
+    [19] = BUILTIN_SUBSTRING,
+    [20] = BUILTIN_ORELSE,
+    [21] = BUILTIN_CONCAT,
+    [22] = BUILTIN_COUNT,
+    [23] = BUILTIN_COUNT,
+    [24] = BUILTIN_READI32,
+    [25] = BUILTIN_COUNT,
+    [26] = BUILTIN_COUNT,
+    [27] = BUILTIN_CHR,
+    [28] = BUILTIN_COUNT,
+    [29] = BUILTIN_WRITE,
+    [30] = BUILTIN_F2I,
+    [31] = BUILTIN_COUNT,
+};
+
+// FNV-1a hash of 'name' reduced to the slots of 'BUILTIN_SLOTS'.
+uint32_t builtin_hash(const char* name) {
+    uint32_t hash = BUILTIN_HASH_SEED;
+    for (; *name != '\0'; name++) {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+    return hash >> (32 - BUILTIN_HASH_BITS);
 }
 
-void fl_right_rotate(fl_node* x, fl_tree* tree) {
-    fl_node* y = x->left;
-    x->left = y->right;
-    if (y->right != NULL)
-        y->right->parent = x;
-
-    y->parent = x->parent;
-
-    if (x->parent == NULL)
-        tree->root = y;
-    else if (x == x->parent->left)
-        x->parent->left = y;
-    else
-        x->parent->right = y;
-
-    y->right = x;
-    x->parent = y;
+// Returns the builtin called 'name' or BUILTIN_COUNT if there is none.
+builtin builtin_find(const char* name) {
+    builtin b = BUILTIN_SLOTS[builtin_hash(name)];
+    if (b == BUILTIN_COUNT || strcmp(BUILTINS[b].name, name) != 0) {
+        return BUILTIN_COUNT;
+    }
+    return b;
 }
 
-void fl_tree_fix_insert(fl_node* node, fl_tree* tree) {
-    fl_node* parent = NULL;
-    fl_node* grandparent = NULL;
-
-    while ((node != tree->root) && (node->color != BLACK) &&
-           (node->parent->color == RED)) {
-        parent = node->parent;
-        grandparent = parent->parent;
-
-        // Parent is the left child of grandparent
-        if (parent == grandparent->left) {
-            fl_node* uncle = grandparent->right;
-
-            // Case 1: Uncle is red, recoloring needed
-            if (uncle != NULL && uncle->color == RED) {
-                grandparent->color = RED;
-                parent->color = BLACK;
-                uncle->color = BLACK;
-                node = grandparent;
-            } else {
-                // Case 2: Node is right child of its parent, left rotate needed
-                if (node == parent->right) {
-                    fl_left_rotate(parent, tree);
-                    node = parent;
-                    parent = node->parent;
-                }
-
-                // Case 3: Node is left child of its parent, right rotate needed
-                fl_right_rotate(grandparent, tree);
-                parent->color = BLACK;
-                grandparent->color = RED;
-                node = parent;
+// Instructions of each builtin built by 'builtin_build()'.
+instr* builtin_code[BUILTIN_COUNT];
+bool builtin_ready = false;
+pthread_once_t builtin_once = PTHREAD_ONCE_INIT;
+
+// Builds the instructions of all the builtins with their operands copied
+// into one block, which is shared with 'instr_share_operands()'. Both live
+// until the process ends.
+void builtin_build(void) {
+    size_t count = 0;
+    size_t size = 0;
+    for (int b = 0; b < BUILTIN_COUNT; b++) {
+        count += BUILTINS[b].len;
+        for (size_t i = 0; i < BUILTINS[b].len; i++) {
+            const builtin_instr* code = &BUILTINS[b].code[i];
+            for (int j = 0; j < code->argc; j++) {
+                size += strlen(code->args[j]) + 1;
             }
         }
-        // Parent is the right child of grandparent
-        else {
-            fl_node* uncle = grandparent->left;
+    }
 
-            // Case 1: Uncle is red, recoloring needed
-            if (uncle != NULL && uncle->color == RED) {
-                grandparent->color = RED;
-                parent->color = BLACK;
-                uncle->color = BLACK;
-                node = grandparent;
-            } else {
-                // Case 2: Node is left child of its parent, right rotate needed
-                if (node == parent->left) {
-                    fl_right_rotate(parent, tree);
-                    node = parent;
-                    parent = node->parent;
-                }
+    instr* all = calloc(count, sizeof(instr));
+    char* block = malloc(size);
+    if (all == NULL || block == NULL) {
+        free(all);
+        free(block);
+        return;
+    }
 
-                // Case 3: Node is right child of its parent, left rotate needed
-                fl_left_rotate(grandparent, tree);
-                parent->color = BLACK;
-                grandparent->color = RED;
-                node = parent;
+    instr* ins = all;
+    char* next = block;
+    for (int b = 0; b < BUILTIN_COUNT; b++) {
+        builtin_code[b] = ins;
+        for (size_t i = 0; i < BUILTINS[b].len; i++, ins++) {
+            const builtin_instr* code = &BUILTINS[b].code[i];
+            ins->op = code->op;
+            ins->argc = code->argc;
+            for (int j = 0; j < code->argc; j++) {
+                size_t len = strlen(code->args[j]) + 1;
+                memcpy(next, code->args[j], len);
+                ins->args[j] = next;
+                next += len;
             }
         }
     }
-
-    // Ensure the root is always black
-    tree->root->color = BLACK;
+    instr_share_operands(block, size);
+    builtin_ready = true;
 }
 
-bool fl_tree_insert(fl_tree* tree, char* symbol, char* translated, char* code) {
-    assert(tree != NULL);
-    assert(symbol != NULL);
-
-    fl_node* current = tree->root;
-    fl_node* parent = NULL;
-
-    int cmp_res;
-
-    while (current != NULL) {
-        parent = current;
-        cmp_res = strcmp(current->symbol, symbol);
-        if (cmp_res < 0) {
-            current = current->right;
-        } else if (cmp_res > 0) {
-            current = current->left;
-        } else {
-            fprintf(stderr, "Symbol already in table!\n");
-            return false;
-        }
-    }
-
-    current = fl_tree_alloc_node(parent, symbol, translated, code);
-    if (current == NULL) {
-        fprintf(stderr, "Mer err in table!\n");
-        return false;
-    }
-
-    if (parent == NULL) {
-        tree->root = current;
-    }
-
-    else if (cmp_res < 0) {
-        parent->right = current;
-    } else {
-        parent->left = current;
-    }
-
-    fl_tree_fix_insert(current, tree);
-
-    return true;
+// Builds the code of the builtins unless it is already built. Called by
+// 'driver_init()' before any thread is started, later calls only check it.
+error_code builtin_init(void) {
+    pthread_once(&builtin_once, builtin_build);
+    return builtin_ready ? NO_ERR : INTERNAL_ERR;
 }
 
-fl_data* fl_tree_find(fl_tree* tree, const char* symbol) {
-    assert(tree != NULL);
-    assert(symbol != NULL);
-
-    fl_node** node = &(tree->root);
-    while ((*node) != NULL) {
-        int cmp_res = strcmp((*node)->symbol, symbol);
-        if (cmp_res < 0) {
-            node = &((*node)->right);
-        } else if (cmp_res > 0) {
-            node = &((*node)->left);
-        } else {
-            return &(*node)->data;
-        }
+// Marks the builtin 'name' as used in 'used' and stores its label in
+// '*label'. Returns INTERNAL_ERR if there is no such builtin.
+error_code builtin_use(builtin_mask* used, const char* name,
+                       const char** label) {
+    builtin b = builtin_find(name);
+    if (b == BUILTIN_COUNT) {
+        return INTERNAL_ERR;
     }
-
-    return NULL;
+    *used |= (builtin_mask)1 << b;
+    *label = BUILTINS[b].label;
+    return NO_ERR;
 }
 
-void fl_tree_free(fl_tree* tree) {
-    assert(tree != NULL);
-
-    fl_node* curr = tree->root;
-    while (curr != NULL) {
-        if (curr->left != NULL) {
-            curr = curr->left;
-            curr->parent->left = NULL;
+// Appends the code of the builtins in 'used' to 'list'. The operands are
+// shared, not copied. Returns false on allocation failure.
+bool builtin_include(builtin_mask used, vector* list) {
+    if (builtin_init() != NO_ERR) {
+        return false;
+    }
+    for (int b = 0; b < BUILTIN_COUNT; b++) {
+        if (!(used & ((builtin_mask)1 << b))) {
             continue;
         }
-        if (curr->right != NULL) {
-            curr = curr->right;
-            curr->parent->right = NULL;
-            continue;
+        if (vec_push_n(list, builtin_code[b], BUILTINS[b].len) == NULL) {
+            return false;
         }
-        fl_node* parent = curr->parent;
-        free(curr);
-        curr = parent;
     }
-    tree->root = NULL;
-}
-
-char* fl_tree_use(fl_tree* tree, const char* func_id) {
-    fl_data* data = fl_tree_find(tree, func_id);
-    assert(data != NULL);
-    data->counter++;
-    return data->translated;
-}
-
-void fl_tree_include_rec(fl_node* node, FILE* fptr){
-    if(node == NULL) return;
-    if(node->data.counter > 0){
-        fprintf(fptr, 
-            "%s\n"
-        , node->data.code);
-    }
-    fl_tree_include_rec(node->right, fptr);
-    fl_tree_include_rec(node->left, fptr);
-}
-
-void fl_tree_include(fl_tree* tree, FILE* fptr) {
-    assert(tree != NULL);
-
-    fl_node* curr = tree->root;
-    fl_tree_include_rec(curr, fptr);
+    return true;
 }
-
-error_code fl_tree_insert_functions(fl_tree* tree){
-    if ( fl_tree_insert(tree, "ifj.write", "ifj$write",
-        "LABEL ifj$write\n"
-        "POPS GF@null\n"
-        "WRITE GF@null\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.readstr", "ifj$readstr",
-        "LABEL ifj$readstr\n"
-        "READ GF@null string\n"
-        "PUSHS GF@null\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.readi32", "ifj$readi32",
-        "LABEL ifj$readi32\n"
-        "READ GF@null int\n"
-        "PUSHS GF@null\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.readf64", "ifj$readf64",
-        "LABEL ifj$readf64\n"
-        "READ GF@null float\n"
-        "PUSHS GF@null\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.i2f", "ifj$i2f",
-        "LABEL ifj$i2f\n"
-        "INT2FLOATS\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.f2i", "ifj$f2i",
-        "LABEL ifj$f2i\n"
-        "FLOAT2INTS\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.string", "ifj$string",
-        "LABEL ifj$string\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.length", "ifj$length",
-        "LABEL ifj$length\n"
-        "POPS GF@null\n"
-        "STRLEN GF@null GF@null\n"
-        "PUSHS GF@null\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.concat", "ifj$concat",
-        "LABEL ifj$concat\n"
-        "CREATEFRAME\n"
-        "DEFVAR TF@s2\n"
-        "POPS TF@s2\n"
-        "DEFVAR TF@s1\n"
-        "POPS TF@s1\n"
-        "PUSHFRAME\n"
-        "CONCAT LF@s1 LF@s1 LF@s2\n"
-        "PUSHS LF@s1\n"
-        "POPFRAME\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.substring", "ifj$substring",
-        "LABEL ifj$substring\n"
-        "CREATEFRAME\n"
-        "DEFVAR TF@j\n"
-        "POPS TF@j\n"
-        "DEFVAR TF@i\n"
-        "POPS TF@i\n"
-        "DEFVAR TF@s\n"
-        "POPS TF@s\n"
-        "DEFVAR TF@lenght\n"
-        "DEFVAR TF@final\n"
-        "DEFVAR TF@char\n"
-        "PUSHFRAME\n"
-        "PUSHS LF@i\n"
-        "PUSHS int@0\n"
-        "LTS\n"
-        "PUSHS bool@true\n"
-        "JUMPIFEQS ifj$substring$err\n"
-        "PUSHS LF@j\n"
-        "PUSHS int@0\n"
-        "LTS\n"
-        "PUSHS bool@true\n"
-        "JUMPIFEQS ifj$substring$err\n"
-        "PUSHS LF@i\n"
-        "PUSHS LF@j\n"
-        "GTS\n"
-        "PUSHS bool@true\n"
-        "JUMPIFEQS ifj$substring$err\n"
-        "STRLEN LF@lenght LF@s\n"
-        "PUSHS LF@i\n"
-        "PUSHS LF@lenght\n"
-        "LTS\n"
-        "PUSHS bool@false\n"
-        "JUMPIFEQS ifj$substring$err\n"
-        "PUSHS LF@j\n"
-        "PUSHS LF@lenght\n"
-        "GTS\n"
-        "PUSHS bool@true\n"
-        "JUMPIFEQS ifj$substring$err\n"
-        "MOVE LF@final string@\n"
-        "LABEL ifj$substring$loop\n"
-        "JUMPIFEQ ifj$substring$end LF@i LF@j\n"
-        "GETCHAR LF@char LF@s LF@i\n"
-        "CONCAT LF@final LF@final LF@char\n"
-        "ADD LF@i LF@i int@1\n"
-        "JUMP ifj$substring$loop\n"
-        "LABEL ifj$substring$end\n"
-        "PUSHS LF@final\n"
-        "POPFRAME\n"
-        "RETURN\n"
-        "LABEL ifj$substring$err\n"
-        "PUSHS nil@nil\n"
-        "POPFRAME\n"
-        "RETURN\n"    
-    ) &&
-
-    fl_tree_insert(tree, "ifj.strcmp", "ifj$strcmp", 
-        "LABEL ifj$strcmp\n"
-        "CREATEFRAME\n"
-        "DEFVAR TF@s1\n"
-        "POPS TF@s1\n"
-        "DEFVAR TF@s2\n"
-        "POPS TF@s2\n"
-        "DEFVAR TF@result\n"
-        "DEFVAR TF@len1\n"
-        "DEFVAR TF@len2\n"
-        "DEFVAR TF@i\n"
-        "DEFVAR TF@char1\n"
-        "DEFVAR TF@char2 \n"
-        "PUSHFRAME\n"
-        "STRLEN LF@len1 LF@s1\n"
-        "STRLEN LF@len2 LF@s2\n"
-        "MOVE LF@i int@0\n"
-        "LABEL strcmp$loop\n"
-        "JUMPIFEQ strcmp$done LF@i LF@len1\n"
-        "JUMPIFEQ strcmp$done LF@i LF@len2\n"
-        "GETCHAR LF@char1 LF@s1 LF@i\n"
-        "GETCHAR LF@char2 LF@s2 LF@i\n"
-        "JUMPIFNEQ strcmp$diff LF@char1 LF@char2\n"
-        "ADD LF@i LF@i int@1\n"
-        "JUMP strcmp$loop\n"
-        "LABEL strcmp$diff\n"
-        "LT LF@result LF@char1 LF@char2\n"
-        "JUMPIFEQ strcmp$return_minus1 LF@result bool@true\n"
-        "GT LF@result LF@char1 LF@char2\n"
-        "JUMPIFEQ strcmp$return_plus1 LF@result bool@true\n"
-        "LABEL strcmp$done\n"
-        "LT LF@result LF@len1 LF@len2\n"
-        "JUMPIFEQ strcmp$return_minus1 LF@result bool@true\n"
-        "GT LF@result LF@len1 LF@len2\n"
-        "JUMPIFEQ strcmp$return_plus1 LF@result bool@true\n"
-        "MOVE LF@result int@0\n"
-        "JUMP strcmp$return\n"
-        "LABEL strcmp$return_minus1\n"
-        "MOVE LF@result int@1\n"
-        "JUMP strcmp$return\n"
-        "LABEL strcmp$return_plus1\n"
-        "MOVE LF@result int@-1\n"
-        "LABEL strcmp$return\n"
-        "PUSHS LF@result \n"
-        "POPFRAME\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.ord", "ifj$ord",
-        "LABEL ifj$ord\n"
-        "CREATEFRAME\n"
-        "DEFVAR TF@i\n"
-        "POPS TF@i\n"
-        "DEFVAR TF@s\n"
-        "POPS TF@s\n"
-        "DEFVAR TF@result\n"
-        "DEFVAR TF@ret\n"
-        "DEFVAR TF@len\n"
-        "PUSHFRAME\n"
-        "STRLEN LF@len LF@s\n"
-        "MOVE LF@result int@0\n"
-        "LT LF@ret LF@i int@0\n"
-        "JUMPIFEQ ord$return LF@ret bool@true\n"
-        "LT LF@ret LF@i LF@len\n"
-        "NOT LF@ret LF@ret\n"
-        "JUMPIFEQ ord$return LF@ret bool@true\n"
-        "STRI2INT LF@result LF@s LF@i\n"
-        "LABEL ord$return\n"
-        "PUSHS LF@result\n"
-        "POPFRAME\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "ifj.chr", "ifj$chr",
-        "LABEL ifj$chr\n"
-        "INT2CHARS\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "bld.orelse", "$bld$orelse", 
-        "LABEL $bld$orelse\n"
-        "CREATEFRAME\n"
-        "DEFVAR TF@elsevalue\n"
-        "POPS TF@elsevalue\n"
-        "DEFVAR TF@ifvalue\n"
-        "POPS TF@ifvalue\n"
-        "PUSHFRAME\n"
-        "JUMPIFEQ $bld$orelse$else LF@ifvalue nil@nil\n"
-        "PUSHS LF@ifvalue\n"
-        "POPFRAME\n"
-        "RETURN\n"
-        "LABEL $bld$orelse$else\n"
-        "PUSHS LF@elsevalue\n"
-        "POPFRAME\n"
-        "RETURN\n"
-    ) &&
-
-    fl_tree_insert(tree, "bld.orelse_unreachable", "$bld$orelse$unreachable", 
-        "LABEL $bld$orelse$unreachable\n"
-        "CREATEFRAME\n"
-        "DEFVAR TF@ifvalue\n"
-        "POPS TF@ifvalue\n"
-        "PUSHFRAME\n"
-        "JUMPIFEQ $bld$orelse$unreachable$else LF@ifvalue nil@nil\n"
-        "PUSHS LF@ifvalue\n"
-        "POPFRAME\n"
-        "RETURN\n"
-        "LABEL $bld$orelse$unreachable$else\n"
-        "WRITE string@panic:\\032reached\\032unreachable\\032code\\010\n"
-        "EXIT int@57\n"
-    )){
-        return NO_ERR;
-    }
-    else {
-        return INTERNAL_ERR;
-    }
-}
\ No newline at end of file
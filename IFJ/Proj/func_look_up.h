@@ -3,41 +3,57 @@
 #ifndef IFJ_PROJEKT_2024_FUNC_LOOK_UP_H
 #define IFJ_PROJEKT_2024_FUNC_LOOK_UP_H
 
-#include <stdio.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 
 #include "error.h"
-
-#define INSERT_SUCCESS 0
-#define INSERT_ALREADY_IN 1
-#define INSERT_MEM_ERR 2
-
-typedef enum { BLACK, RED } t_color;
-
-typedef struct fl_tree_data {
-    char* translated;
-    char* code;
-    int counter;
-} fl_data;
-
-typedef struct fl_tree_node {
-    struct fl_tree_node* parent;
-    struct fl_tree_node* left;
-    struct fl_tree_node* right;
-    t_color color;
-    char* symbol;
-    fl_data data;
-} fl_node;
-
+#include "instr.h"
+#include "vector.h"
+
+// Builtin functions, the order is the order of their code in the program.
+typedef enum {
+    BUILTIN_WRITE, // ifj.write
+    BUILTIN_READSTR, // ifj.readstr
+    BUILTIN_READI32, // ifj.readi32
+    BUILTIN_READF64, // ifj.readf64
+    BUILTIN_I2F, // ifj.i2f
+    BUILTIN_F2I, // ifj.f2i
+    BUILTIN_STRING, // ifj.string
+    BUILTIN_LENGTH, // ifj.length
+    BUILTIN_CONCAT, // ifj.concat
+    BUILTIN_SUBSTRING, // ifj.substring
+    BUILTIN_STRCMP, // ifj.strcmp
+    BUILTIN_ORD, // ifj.ord
+    BUILTIN_CHR, // ifj.chr
+    BUILTIN_ORELSE, // bld.orelse
+    BUILTIN_ORELSE_UNREACHABLE, // bld.orelse_unreachable
+    BUILTIN_COUNT
+} builtin;
+
+// Set of builtins, bit 'b' stands for builtin 'b'.
+typedef uint32_t builtin_mask;
+
+// Instruction of the code of a builtin, see 'builtin_init()'.
 typedef struct {
-    fl_node* root;
-} fl_tree;
+    opcode op;
+    int argc;
+    const char* args[INSTR_MAX_ARGS];
+} builtin_instr;
 
-void fl_tree_init(fl_tree* tree);
+typedef struct {
+    const char* name;  // Name used in the source, e.g. ifj.write
+    const char* label; // Label of the code
+    const builtin_instr* code;
+    size_t len;        // Number of instructions in 'code'
+} builtin_def;
 
-error_code fl_tree_insert_functions(fl_tree* tree);
-char* fl_tree_use(fl_tree* tree, const char* func_id);
-void fl_tree_include(fl_tree* tree, FILE* fptr);
+extern const builtin_def BUILTINS[BUILTIN_COUNT];
 
-void fl_tree_free(fl_tree* tree);
+builtin builtin_find(const char* name);
+error_code builtin_init(void);
+error_code builtin_use(builtin_mask* used, const char* name,
+                       const char** label);
+bool builtin_include(builtin_mask used, vector* list);
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,279 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Generates random programs, checks that the optimized code behaves as the
+// unoptimized one and measures the compiler and its code on them.
+
+#include "driver.h"
+#include "interp.h"
+#include "prog_gen.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+// Compiler settings compared, the first one is the reference.
+typedef struct {
+    const char* name;
+    driver_options opts;
+} gen_level;
+
+const gen_level GEN_LEVELS[] = {
+    {"-O0", {.optimize = false, .registers = false, .jobs = 1}},
+    {"-O", {.optimize = true, .registers = true, .jobs = 1}},
+    {"--stack-exprs", {.optimize = true, .registers = false, .jobs = 1}},
+    {"-j 4", {.optimize = true, .registers = true, .jobs = 4}},
+};
+
+#define GEN_LEVEL_COUNT ((int)(sizeof(GEN_LEVELS) / sizeof(GEN_LEVELS[0])))
+
+// Statements of the programs measured by --bench.
+const int GEN_BENCH_SIZES[] = {100, 1000, 10000};
+
+// A compilation is repeated for at least this long when measured.
+#define GEN_BENCH_MS 200.0
+
+// Writes the program given by 'opts' into a new string.
+error_code gen_source(const pgen_options* opts, char** text, size_t* len) {
+    *text = NULL;
+    FILE* out = open_memstream(text, len);
+    if (out == NULL) {
+        return INTERNAL_ERR;
+    }
+    error_code err = pgen_program(opts, out);
+    if (fclose(out) != 0) {
+        err = INTERNAL_ERR;
+    }
+    return err;
+}
+
+// Compiles 'len' bytes of 'source' into the new string 'code'.
+error_code gen_compile(driver* drv, const driver_options* opts, char* source,
+                       size_t len, char** code) {
+    size_t code_len = 0;
+    *code = NULL;
+    FILE* src_file = fmemopen(source, len, "r");
+    FILE* code_file = open_memstream(code, &code_len);
+    error_code err = INTERNAL_ERR;
+    if (src_file != NULL && code_file != NULL) {
+        err = driver_compile(drv, opts, src_file, code_file);
+    }
+    if (src_file != NULL) {
+        fclose(src_file);
+    }
+    if (code_file != NULL && fclose(code_file) != 0) {
+        err = INTERNAL_ERR;
+    }
+    return err;
+}
+
+// Runs 'code' on PGEN_INPUT, its output goes into the new string 'output'.
+// Returns the exit code of the interpreter.
+int gen_run(const char* code, char** output, uint64_t* executed, double* ms) {
+    char input[] = PGEN_INPUT;
+    size_t output_len = 0;
+    *output = NULL;
+    *executed = 0;
+    *ms = 0;
+    interp_program prog;
+    run_code err = interp_load(&prog, code);
+    if (err != RUN_OK) {
+        return err;
+    }
+    FILE* in = fmemopen(input, strlen(input), "r");
+    FILE* out = open_memstream(output, &output_len);
+    int result = RUN_INTERNAL_ERR;
+    if (in != NULL && out != NULL) {
+        double start = now_ms();
+        result = interp_run(&prog, in, out);
+        *ms = now_ms() - start;
+        *executed = prog.executed;
+    }
+    if (in != NULL) {
+        fclose(in);
+    }
+    if (out != NULL) {
+        fclose(out);
+    }
+    interp_free(&prog);
+    return result;
+}
+
+// Compiles and runs the program of every seed from 'opts' on at every
+// level. Returns the number of programs that failed or differed.
+int gen_check(driver* drv, pgen_options opts, int count) {
+    int failed = 0;
+    for (int i = 0; i < count; i++, opts.seed++) {
+        char* source;
+        size_t len;
+        if (gen_source(&opts, &source, &len) != NO_ERR) {
+            free(source);
+            fprintf(stderr, "Failed to generate the program.\n");
+            return failed + 1;
+        }
+
+        char* expected = NULL;
+        int expected_code = 0;
+        bool ok = true;
+        for (int l = 0; l < GEN_LEVEL_COUNT && ok; l++) {
+            char* code;
+            char* output = NULL;
+            uint64_t executed;
+            double ms;
+            error_code err =
+                gen_compile(drv, &GEN_LEVELS[l].opts, source, len, &code);
+            int result = 0;
+            if (err != NO_ERR) {
+                printf("seed %llu: %s fails to compile with %d\n",
+                       (unsigned long long)opts.seed, GEN_LEVELS[l].name,
+                       err);
+                ok = false;
+            } else {
+                result = gen_run(code, &output, &executed, &ms);
+            }
+            if (ok && l == 0) {
+                expected = output;
+                expected_code = result;
+                output = NULL;
+            } else if (ok && (result != expected_code ||
+                              strcmp(output, expected) != 0)) {
+                printf("seed %llu: %s exits with %d, %s with %d%s\n",
+                       (unsigned long long)opts.seed, GEN_LEVELS[l].name,
+                       result, GEN_LEVELS[0].name, expected_code,
+                       result == expected_code ? ", the outputs differ" : "");
+                ok = false;
+            }
+            free(output);
+            free(code);
+        }
+        failed += !ok;
+        free(expected);
+        free(source);
+    }
+    printf("%d programs checked, %d failed\n", count, failed);
+    return failed;
+}
+
+// Compiles the program repeatedly at 'level' and runs its code once.
+void gen_bench_level(driver* drv, const gen_level* level, char* source,
+                     size_t len, int lines) {
+    char* code = NULL;
+    int compiles = 0;
+    double start = now_ms();
+    double ms;
+    do {
+        free(code);
+        if (gen_compile(drv, &level->opts, source, len, &code) != NO_ERR) {
+            printf("%-6d %-8s fails to compile\n", lines, level->name);
+            free(code);
+            return;
+        }
+        compiles++;
+        ms = now_ms() - start;
+    } while (ms < GEN_BENCH_MS);
+
+    char* output;
+    uint64_t executed;
+    double run_ms;
+    int result = gen_run(code, &output, &executed, &run_ms);
+    printf("%-6d %-8s %12.3f %12.0f %10.2f %14llu", lines, level->name,
+           ms / compiles, lines / (ms / compiles) * 1000.0, run_ms,
+           (unsigned long long)executed);
+    if (result != RUN_OK) {
+        printf("  exits with %d", result);
+    }
+    putchar('\n');
+    free(output);
+    free(code);
+}
+
+// Measures the compile throughput and the runtime of the code without and
+// with the optimizations on programs of growing size.
+error_code gen_bench(driver* drv, pgen_options opts) {
+    printf("%-6s %-8s %12s %12s %10s %14s\n", "lines", "level",
+           "compile [ms]", "lines/s", "run [ms]", "instructions");
+    for (size_t s = 0; s < sizeof(GEN_BENCH_SIZES) / sizeof(int); s++) {
+        opts.statements = GEN_BENCH_SIZES[s];
+        char* source;
+        size_t len;
+        if (gen_source(&opts, &source, &len) != NO_ERR) {
+            free(source);
+            return INTERNAL_ERR;
+        }
+        int lines = 0;
+        for (size_t i = 0; i < len; i++) {
+            lines += source[i] == '\n';
+        }
+        gen_bench_level(drv, &GEN_LEVELS[0], source, len, lines);
+        gen_bench_level(drv, &GEN_LEVELS[1], source, len, lines);
+        free(source);
+    }
+    return NO_ERR;
+}
+
+int main(int argc, char** argv) {
+    // ifjgen [options]      writes a random program to stdout
+    // --seed <n>            seed of the program, or of the first one checked
+    // --size <n>            statements of the program
+    // --functions <n>       functions besides main
+    // --depth <n>           deepest nesting of IF and WHILE
+    // --iterations <n>      most iterations of a single loop
+    // --check <n>           compiles <n> programs from the seed on at every
+    //                       level, runs them and compares their output and
+    //                       exit code to the code of -O0
+    // --bench               measures the compile throughput and the runtime
+    //                       of the code at -O0 and -O on growing programs
+    // The generated programs read PGEN_INPUT.
+    pgen_options opts;
+    pgen_defaults(&opts);
+    int check = 0;
+    bool bench = false;
+    for (int i = 1; i < argc; i++) {
+        bool value = i + 1 < argc;
+        if (strcmp(argv[i], "--seed") == 0 && value) {
+            opts.seed = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--size") == 0 && value) {
+            opts.statements = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--functions") == 0 && value) {
+            opts.functions = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--depth") == 0 && value) {
+            opts.depth = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && value) {
+            opts.iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--check") == 0 && value) {
+            check = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return INTERNAL_ERR;
+        }
+    }
+    if (opts.statements < 1 || opts.functions < 0 || opts.depth < 0 ||
+        opts.iterations < 1) {
+        fprintf(stderr, "Invalid program size\n");
+        return INTERNAL_ERR;
+    }
+
+    if (check == 0 && !bench) {
+        return pgen_program(&opts, stdout);
+    }
+    driver drv;
+    error_code err = driver_init(&drv);
+    if (err != NO_ERR) {
+        fprintf(stderr, "Failed to alocate memory!\n Ending program!\n");
+        return err;
+    }
+    int result = 0;
+    if (check > 0 && gen_check(&drv, opts, check) > 0) {
+        result = 1;
+    }
+    if (bench && gen_bench(&drv, opts) != NO_ERR) {
+        result = INTERNAL_ERR;
+    }
+    driver_free(&drv);
+    return result;
+}
@@ -0,0 +1,574 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Inline expansion of small user functions over the analysed AST.
+//
+// A function is inlined when its body has at most INLINE_MAX_NODES nodes,
+// contains no loop and calls no user function, so it cannot be recursive.
+// Its body is prepared once: the parameters become constants, every return
+// stores its value into the INLINE_RESULT variable and the statements
+// following an IF which returns on some of its paths are moved into the
+// branch that continues, so a return is always the last statement executed.
+// Bodies that would need the statements copied into both branches are not
+// inlined.
+//
+// At a call site the prepared body is copied right before the statement with
+// the call, the arguments initialize the parameter constants and the call is
+// replaced by a read of the result. Every scope id of the copy gets the
+// prefix INLINE_PREFIX with the number of the call site, so its variables and
+// IF labels stay distinct from those of the caller and of the other copies.
+//
+// The inlined body runs before the rest of the statement, so a call is
+// inlined only when everything evaluated before it in the statement has no
+// side effects and cannot fail. Loop conditions are evaluated repeatedly and
+// calls in them are left alone.
+
+#include "inliner.h"
+#include "data_types.h"
+#include "dead_code.h"
+#include "licm.h"
+#include "util.h"
+#include "vector.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Function that may be inlined.
+typedef struct {
+    const char* name; // Name of the function
+    node* body;       // Prepared STMT_LIST, NULL if it is not inlined
+    bool used;        // Some of its calls were inlined
+} inline_func;
+
+// State shared by the whole pass.
+typedef struct {
+    inline_func* funcs; // One for every function of the program
+    int count;          // Number of 'funcs'
+    int next_id;        // Number of the next inlined call site
+    vector* none;       // Empty list of written variables for licm_invariant
+    inline_stats* stats;
+} inline_ctx;
+
+// Returns the number of nodes of 'n'.
+int inline_size(node* n) {
+    int size = 1;
+    for (int i = 0; i < n->child_count; i++) {
+        size += inline_size(n->children[i]);
+    }
+    return size;
+}
+
+// Returns true if 'n' contains no loop and no call of a user function.
+bool inline_allowed(node* n) {
+    switch (n->data.type) {
+    case WHILE:
+    case FOR:
+    case BREAK:
+    case CONTINUE:
+        return false;
+    case FUNC:
+        if (strncmp(n->data.id_name, "ifj.", 4) != 0) {
+            return false;
+        }
+        break;
+    default:
+        break;
+    }
+    for (int i = 0; i < n->child_count; i++) {
+        if (!inline_allowed(n->children[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if there is a return inside 'n'.
+bool inline_has_return(node* n) {
+    if (n->data.type == RETURN) {
+        return true;
+    }
+    for (int i = 0; i < n->child_count; i++) {
+        if (inline_has_return(n->children[i])) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the scope id 'scope' with 'prefix' in front of it.
+char* inline_scope(const char* prefix, const char* scope) {
+    size_t len = strlen(prefix) + strlen(scope) + 1;
+    char* str = malloc(len);
+    if (str != NULL) {
+        snprintf(str, len, "%s%s", prefix, scope);
+    }
+    return str;
+}
+
+// Creates a node of 'type' naming the variable 'name' of the scope 'scope'.
+node* inline_name_node(node_type type, const char* name, const char* scope,
+                       data_type ret_value) {
+    node* n = create_node(type);
+    if (n == NULL) {
+        return NULL;
+    }
+    n->data.ret_value = ret_value;
+    n->data.id_name = d_string(name);
+    n->data.scope_id = d_string(scope);
+    if (n->data.id_name == NULL || n->data.scope_id == NULL) {
+        delete_tree(&n);
+        return NULL;
+    }
+    return n;
+}
+
+// Copies the subtree 'n', 'prefix' is put in front of every scope id. The
+// strings freed with a node are duplicated, the others are shared as they
+// are in the rest of the tree.
+node* inline_copy(node* n, const char* prefix) {
+    node* copy = create_node(n->data.type);
+    if (copy == NULL) {
+        return NULL;
+    }
+    copy->data = n->data;
+    copy->data.scope_id = NULL;
+
+    bool ok = true;
+    switch (n->data.type) {
+    case LITERAL:
+        if (n->data.ret_value == U8_SLICE ||
+            n->data.ret_value == STRING_LITERAL) {
+            copy->data.str_value = d_string(n->data.str_value);
+            ok = copy->data.str_value != NULL;
+        }
+        break;
+    case FUNC:
+    case FUNC_DEF:
+    case VAR_DEF:
+    case CONST_DEF:
+    case PARAM:
+    case ASSIGN:
+    case VAR:
+    case NULL_COND:
+        copy->data.id_name = d_string(n->data.id_name);
+        ok = copy->data.id_name != NULL;
+        break;
+    case WHILE:
+        if (n->data.label != NULL) {
+            copy->data.label = d_string(n->data.label);
+            ok = copy->data.label != NULL;
+        }
+        break;
+    default:
+        break;
+    }
+    if (ok && n->data.scope_id != NULL) {
+        copy->data.scope_id = inline_scope(prefix, n->data.scope_id);
+        ok = copy->data.scope_id != NULL;
+    }
+    if (!ok) {
+        delete_tree(&copy);
+        return NULL;
+    }
+
+    for (int i = 0; i < n->child_count; i++) {
+        node* child = inline_copy(n->children[i], prefix);
+        if (child == NULL || !append_node(child, copy)) {
+            delete_tree(&child);
+            delete_tree(&copy);
+            return NULL;
+        }
+    }
+    return copy;
+}
+
+// Removes the statements of 'list' from 'index' to the end.
+void inline_drop_from(node* list, int index) {
+    while (list->child_count > index) {
+        node* s = detach_node(list->children[list->child_count - 1]);
+        delete_tree(&s);
+    }
+}
+
+// Returns the STMT_LIST of the else branch of 'if_node', it is created if
+// 'create' is set. Returns NULL if there is none or it cannot be created.
+node* inline_else_body(node* if_node, bool create) {
+    node* else_node = get_child_by_type(if_node, ELSE, 0);
+    if (else_node != NULL) {
+        return get_child_by_type(else_node, STMT_LIST, 0);
+    }
+    if (!create) {
+        return NULL;
+    }
+    else_node = create_node(ELSE);
+    node* body = create_node(STMT_LIST);
+    if (else_node == NULL || body == NULL || !append_node(body, else_node) ||
+        !append_node(else_node, if_node)) {
+        delete_tree(&body);
+        delete_tree(&else_node);
+        return NULL;
+    }
+    return body;
+}
+
+// Returns true if control never leaves the end of the statement list 'list'.
+bool inline_list_terminates(node* list) {
+    return list != NULL && list->child_count > 0 &&
+           stmt_terminates(list->children[list->child_count - 1]);
+}
+
+// Moves the statements of 'list' from 'index' to the end into 'target'.
+bool inline_move_from(node* list, int index, node* target) {
+    while (list->child_count > index) {
+        node* s = detach_node(list->children[index]);
+        if (!append_node(s, target)) {
+            delete_tree(&s);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Restructures 'list' so that every return is the last statement of its list
+// and nothing follows the IF statements containing one. Sets '*inlinable' to
+// false if the statements after such an IF would have to be copied into both
+// of its branches.
+error_code inline_normalize(node* list, bool* inlinable) {
+    for (int i = 0; i < list->child_count && *inlinable; i++) {
+        node* s = list->children[i];
+        if (s->data.type == RETURN) {
+            inline_drop_from(list, i + 1);
+            return NO_ERR;
+        }
+        if (s->data.type != IF || !inline_has_return(s)) {
+            continue;
+        }
+
+        node* then_body = get_child_by_type(s, STMT_LIST, 0);
+        node* else_body = inline_else_body(s, false);
+        error_code err = inline_normalize(then_body, inlinable);
+        if (err == NO_ERR && else_body != NULL) {
+            err = inline_normalize(else_body, inlinable);
+        }
+        if (err != NO_ERR || !*inlinable || i + 1 == list->child_count) {
+            return err;
+        }
+
+        // A missing else branch continues past the IF.
+        bool then_ends = inline_list_terminates(then_body);
+        bool else_ends = inline_list_terminates(else_body);
+        if (then_ends && else_ends) {
+            inline_drop_from(list, i + 1);
+            return NO_ERR;
+        }
+        if (!then_ends && !else_ends) {
+            *inlinable = false;
+            return NO_ERR;
+        }
+        node* target = then_ends ? inline_else_body(s, true) : then_body;
+        if (target == NULL || !inline_move_from(list, i + 1, target)) {
+            return INTERNAL_ERR;
+        }
+        return inline_normalize(target, inlinable);
+    }
+    return NO_ERR;
+}
+
+// Replaces the returns inside 'n' by assignments of their values to the
+// result variable of the type 'ret_value'.
+error_code inline_returns(node* n, data_type ret_value) {
+    for (int i = n->child_count - 1; i >= 0; i--) {
+        node* child = n->children[i];
+        if (child->data.type != RETURN) {
+            error_code err = inline_returns(child, ret_value);
+            if (err != NO_ERR) {
+                return err;
+            }
+            continue;
+        }
+
+        node* opt_expr = child->children[0];
+        assert(opt_expr->data.type == OPT_EXPR);
+        if (opt_expr->child_count == 0) {
+            detach_node(child);
+            delete_tree(&child);
+            continue;
+        }
+        node* assign = inline_name_node(ASSIGN, INLINE_RESULT, "", ret_value);
+        if (assign == NULL) {
+            return INTERNAL_ERR;
+        }
+        node* expr = detach_node(opt_expr->children[0]);
+        if (!append_node(expr, assign) || !replace_node(child, assign)) {
+            delete_tree(&expr);
+            delete_tree(&assign);
+            return INTERNAL_ERR;
+        }
+        delete_tree(&child);
+    }
+    return NO_ERR;
+}
+
+// Prepares the body of 'func_def' for inlining into '*body', leaves it NULL
+// if the function is not inlined.
+error_code inline_prepare(node* func_def, node** body) {
+    *body = NULL;
+    node* params = get_child_by_type(func_def, PARAM_LIST, 0);
+    node* stmts = get_child_by_type(func_def, STMT_LIST, 0);
+    if (strcmp(func_def->data.id_name, "main") == 0 || params == NULL ||
+        stmts == NULL || inline_size(stmts) > INLINE_MAX_NODES ||
+        !inline_allowed(stmts)) {
+        return NO_ERR;
+    }
+
+    node* copy = inline_copy(stmts, "");
+    if (copy == NULL) {
+        return INTERNAL_ERR;
+    }
+    bool inlinable = true;
+    error_code err = inline_normalize(copy, &inlinable);
+    if (err == NO_ERR && inlinable) {
+        err = inline_returns(copy, func_def->data.ret_value);
+    }
+    if (err != NO_ERR || !inlinable) {
+        delete_tree(&copy);
+        return err;
+    }
+
+    // The parameters come first, the arguments are appended to them at the
+    // call sites.
+    for (int i = params->child_count - 1; i >= 0; i--) {
+        node* param = params->children[i];
+        node* def = inline_name_node(CONST_DEF, param->data.id_name,
+                                     param->data.scope_id,
+                                     param->data.ret_value);
+        if (def == NULL || !insert_node(def, copy, 0)) {
+            delete_tree(&def);
+            delete_tree(&copy);
+            return INTERNAL_ERR;
+        }
+    }
+    if (func_def->data.ret_value != VOID) {
+        node* result = inline_name_node(VAR_DEF, INLINE_RESULT, "",
+                                        func_def->data.ret_value);
+        if (result == NULL ||
+            !insert_node(result, copy, params->child_count)) {
+            delete_tree(&result);
+            delete_tree(&copy);
+            return INTERNAL_ERR;
+        }
+    }
+    *body = copy;
+    return NO_ERR;
+}
+
+// Returns the function inlined at the call 'call' or NULL.
+inline_func* inline_lookup(node* call, inline_ctx* ctx) {
+    for (int i = 0; i < ctx->count; i++) {
+        if (ctx->funcs[i].body != NULL &&
+            strcmp(ctx->funcs[i].name, call->data.id_name) == 0) {
+            return &ctx->funcs[i];
+        }
+    }
+    return NULL;
+}
+
+// Returns the first call inside the expression 'n' that can be inlined.
+// '*safe' is cleared once something evaluated before the call could not be
+// moved after it.
+node* inline_search(node* n, bool* safe, inline_ctx* ctx) {
+    if (n->data.type == FUNC && inline_lookup(n, ctx) != NULL) {
+        // The arguments are evaluated right before the body, they move with
+        // it.
+        bool args_safe = true;
+        node* inner = inline_search(n->children[0], &args_safe, ctx);
+        return inner != NULL ? inner : n;
+    }
+    for (int i = 0; i < n->child_count; i++) {
+        node* found = inline_search(n->children[i], safe, ctx);
+        if (found != NULL || !*safe) {
+            return found;
+        }
+    }
+    if (!licm_invariant(n, ctx->none)) {
+        *safe = false;
+    }
+    return NULL;
+}
+
+// Returns the expression of the statement 's' evaluated before anything
+// else it does, NULL if it has none or it may be evaluated repeatedly.
+node* inline_stmt_expr(node* s) {
+    switch (s->data.type) {
+    case FUNC:
+        return s;
+    case VAR_DEF:
+    case CONST_DEF:
+    case ASSIGN:
+    case ASSIGN_THROW_AWAY:
+        return get_child_by_type(s, EXPR, 0);
+    case RETURN:
+        return get_child_by_type(s->children[0], EXPR, 0);
+    case IF:
+        return get_child_by_type(s, COND, 0)->children[0];
+    default:
+        return NULL;
+    }
+}
+
+// Inlines 'call' found in the statement 's', the child of 'list' at '*index'.
+// The body is inserted before 's' and '*index' moved past it. Sets
+// '*removed' if 's' was only the call and has been removed.
+error_code inline_call(node* call, node* s, node* list, int* index,
+                       bool* removed, inline_ctx* ctx) {
+    inline_func* func = inline_lookup(call, ctx);
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), INLINE_PREFIX "%d", ctx->next_id);
+
+    node* body = inline_copy(func->body, prefix);
+    if (body == NULL) {
+        return INTERNAL_ERR;
+    }
+    node* args = call->children[0];
+    assert(args->data.type == INPUT_PARAM_LIST);
+    for (int i = 0; i < args->child_count; i++) {
+        node* expr = detach_node(args->children[i]->children[0]);
+        if (!append_node(expr, body->children[i])) {
+            delete_tree(&expr);
+            delete_tree(&body);
+            return INTERNAL_ERR;
+        }
+    }
+
+    *removed = s == call || (s->data.type == ASSIGN_THROW_AWAY &&
+                             unwrap_expr(s->children[0]) == call);
+    if (*removed) {
+        detach_node(s);
+        delete_tree(&s);
+    } else {
+        node* ref = inline_name_node(VAR, INLINE_RESULT, prefix,
+                                     call->data.ret_value);
+        if (ref == NULL || !replace_node(call, ref)) {
+            delete_tree(&ref);
+            delete_tree(&body);
+            return INTERNAL_ERR;
+        }
+        delete_tree(&call);
+    }
+
+    while (body->child_count > 0) {
+        node* stmt = detach_node(body->children[0]);
+        if (!insert_node(stmt, list, *index)) {
+            delete_tree(&stmt);
+            delete_tree(&body);
+            return INTERNAL_ERR;
+        }
+        (*index)++;
+    }
+    delete_tree(&body);
+
+    func->used = true;
+    ctx->next_id++;
+    ctx->stats->calls++;
+    return NO_ERR;
+}
+
+error_code inline_stmt_list(node* list, inline_ctx* ctx);
+
+// Processes the statement lists nested in the statement 's'.
+error_code inline_nested(node* s, inline_ctx* ctx) {
+    for (int i = 0; i < s->child_count; i++) {
+        node* child = s->children[i];
+        error_code err = NO_ERR;
+        if (child->data.type == STMT_LIST) {
+            err = inline_stmt_list(child, ctx);
+        } else if (child->data.type == ELSE || child->data.type == WHILE_CNT ||
+                   child->data.type == WHILE_ELSE) {
+            err = inline_nested(child, ctx);
+        }
+        if (err != NO_ERR) {
+            return err;
+        }
+    }
+    return NO_ERR;
+}
+
+error_code inline_stmt_list(node* list, inline_ctx* ctx) {
+    int i = 0;
+    while (i < list->child_count) {
+        node* s = list->children[i];
+        error_code err = inline_nested(s, ctx);
+        if (err != NO_ERR) {
+            return err;
+        }
+
+        bool removed = false;
+        while (!removed) {
+            node* expr = inline_stmt_expr(s);
+            bool safe = true;
+            node* call = expr != NULL ? inline_search(expr, &safe, ctx) : NULL;
+            if (call == NULL) {
+                break;
+            }
+            err = inline_call(call, s, list, &i, &removed, ctx);
+            if (err != NO_ERR) {
+                return err;
+            }
+        }
+        if (!removed) {
+            i++;
+        }
+    }
+    return NO_ERR;
+}
+
+// Inlines the calls of small functions in all the functions of 'ast'. The
+// inlined functions stay in the program, dead code elimination removes those
+// no longer called. 'stats' may be NULL if the caller is not interested in
+// the counters.
+error_code inline_functions(node* ast, inline_stats* stats) {
+    assert(ast != NULL);
+    assert(ast->data.type == PROG);
+
+    inline_stats local = {0};
+    inline_ctx ctx = {.funcs = NULL,
+                      .count = ast->child_count,
+                      .next_id = 0,
+                      .none = NULL,
+                      .stats = stats != NULL ? stats : &local};
+
+    ctx.funcs = calloc(ast->child_count + 1, sizeof(inline_func));
+    ctx.none = vec_init(1, sizeof(node*));
+    error_code err = ctx.funcs == NULL || ctx.none == NULL ? INTERNAL_ERR
+                                                           : NO_ERR;
+    for (int i = 0; err == NO_ERR && i < ctx.count; i++) {
+        ctx.funcs[i].name = ast->children[i]->data.id_name;
+        err = inline_prepare(ast->children[i], &ctx.funcs[i].body);
+    }
+
+    for (int i = 0; err == NO_ERR && i < ast->child_count; i++) {
+        node* body = get_child_by_type(ast->children[i], STMT_LIST, 0);
+        if (body == NULL) {
+            continue;
+        }
+        // The call sites are numbered per function, which keeps the code of
+        // a function independent of the others.
+        ctx.next_id = 0;
+        err = inline_stmt_list(body, &ctx);
+    }
+
+    for (int i = 0; ctx.funcs != NULL && i < ctx.count; i++) {
+        if (ctx.funcs[i].used) {
+            ctx.stats->functions++;
+        }
+        delete_tree(&ctx.funcs[i].body);
+    }
+    free(ctx.funcs);
+    if (ctx.none != NULL) {
+        vec_free(&ctx.none);
+    }
+    return err;
+}
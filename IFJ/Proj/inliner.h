@@ -0,0 +1,30 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Inline expansion of small user functions over the analysed AST.
+
+#ifndef IFJ_PROJEKT_2024_INLINER_H
+#define IFJ_PROJEKT_2024_INLINER_H
+
+#include "ast.h"
+#include "error.h"
+
+// Prefix of the scopes of the inlined bodies, it cannot clash with the scope
+// ids given by the semantic analysis.
+#define INLINE_PREFIX "$i"
+
+// Name of the variable holding the value returned by an inlined body.
+#define INLINE_RESULT "$r"
+
+// Functions with bodies of more nodes are never inlined.
+#define INLINE_MAX_NODES 48
+
+// Counters describing what the pass did.
+typedef struct {
+    int calls;     // Inlined calls
+    int functions; // Functions with some of their calls inlined
+} inline_stats;
+
+error_code inline_functions(node* ast, inline_stats* stats);
+
+#endif // IFJ_PROJEKT_2024_INLINER_H
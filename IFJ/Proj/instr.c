@@ -0,0 +1,201 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// In-memory representation of the generated IFJcode24 instructions.
+
+#include "instr.h"
+#include "strbuf.h"
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+const char* const OPCODE_STRINGS[] = {
+    "MOVE",       "CREATEFRAME", "PUSHFRAME",  "POPFRAME",   "DEFVAR",
+    "CALL",       "RETURN",      "PUSHS",      "POPS",       "CLEARS",
+    "ADD",        "SUB",         "MUL",        "DIV",        "IDIV",
+    "ADDS",       "SUBS",        "MULS",       "DIVS",       "IDIVS",
+    "LT",         "GT",          "EQ",         "LTS",        "GTS",
+    "EQS",        "AND",         "OR",         "NOT",        "ANDS",
+    "ORS",        "NOTS",        "INT2FLOAT",  "FLOAT2INT",  "INT2CHAR",
+    "STRI2INT",   "INT2FLOATS",  "FLOAT2INTS", "INT2CHARS",  "STRI2INTS",
+    "READ",       "WRITE",       "CONCAT",     "STRLEN",     "GETCHAR",
+    "SETCHAR",    "TYPE",        "LABEL",      "JUMP",       "JUMPIFEQ",
+    "JUMPIFNEQ",  "JUMPIFEQS",   "JUMPIFNEQS", "EXIT",       "BREAK",
+    "DPRINT"};
+
+// Initializes an empty instruction list.
+vector* instr_list_init() { return vec_init(64, sizeof(instr)); }
+
+// Block of operands owned by the process instead of the instructions.
+const char* shared_operands = NULL;
+size_t shared_len = 0;
+
+// Makes the 'len' bytes of 'block' operands that may be shared by any number
+// of instructions, they are never freed with them.
+void instr_share_operands(const char* block, size_t len) {
+    shared_operands = block;
+    shared_len = len;
+}
+
+// Frees the operand 'arg' unless it is a shared one.
+void instr_free_arg(char* arg) {
+    if ((uintptr_t)arg - (uintptr_t)shared_operands >= shared_len) {
+        free(arg);
+    }
+}
+
+// Frees the operands of 'ins'.
+void instr_free(instr* ins) {
+    for (int i = 0; i < ins->argc; i++) {
+        instr_free_arg(ins->args[i]);
+        ins->args[i] = NULL;
+    }
+    ins->argc = 0;
+}
+
+// Frees the list together with all of its instructions.
+void instr_list_free(vector** list) {
+    if (*list == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < (*list)->len; i++) {
+        instr_free(vec_get(*list, i));
+    }
+    vec_free(list);
+}
+
+// Returns the opcode named by the 'len' characters of 'name' or
+// I_OPCODE_COUNT if there is no such opcode.
+opcode instr_find_opcode(const char* name, size_t len) {
+    for (int i = 0; i < I_OPCODE_COUNT; i++) {
+        if (strlen(OPCODE_STRINGS[i]) == len &&
+            strncmp(OPCODE_STRINGS[i], name, len) == 0) {
+            return i;
+        }
+    }
+    return I_OPCODE_COUNT;
+}
+
+// Parses a single line of IFJcode24 and appends it to 'list'. Empty lines
+// are skipped. Returns false on unknown opcode or allocation failure.
+bool instr_emit_line(vector* list, const char* line, size_t len) {
+    const char* end = line + len;
+    const char* words[INSTR_MAX_ARGS + 1];
+    size_t lens[INSTR_MAX_ARGS + 1];
+    int count = 0;
+
+    // Operands never contain whitespace, strings are escaped.
+    while (line < end) {
+        while (line < end && (*line == ' ' || *line == '\t')) {
+            line++;
+        }
+        if (line == end) {
+            break;
+        }
+        if (count == INSTR_MAX_ARGS + 1) {
+            return false;
+        }
+        words[count] = line;
+        while (line < end && *line != ' ' && *line != '\t') {
+            line++;
+        }
+        lens[count] = line - words[count];
+        count++;
+    }
+    if (count == 0) {
+        return true;
+    }
+
+    instr ins = {0};
+    ins.op = instr_find_opcode(words[0], lens[0]);
+    if (ins.op == I_OPCODE_COUNT) {
+        fprintf(stderr, "Unknown instruction %.*s\n", (int)lens[0], words[0]);
+        return false;
+    }
+    for (int i = 1; i < count; i++) {
+        ins.args[i - 1] = strndup(words[i], lens[i]);
+        ins.argc++;
+        if (ins.args[i - 1] == NULL) {
+            instr_free(&ins);
+            return false;
+        }
+    }
+    if (vec_push(list, &ins) == NULL) {
+        instr_free(&ins);
+        return false;
+    }
+    return true;
+}
+
+// Appends the instructions in 'code' (one per line) to 'list'.
+// Returns false on unknown instruction or allocation failure.
+bool instr_emit(vector* list, const char* code) {
+    assert(list != NULL);
+    assert(code != NULL);
+
+    while (*code != '\0') {
+        const char* end = strchr(code, '\n');
+        if (end == NULL) {
+            end = code + strlen(code);
+        }
+        if (!instr_emit_line(list, code, end - code)) {
+            return false;
+        }
+        code = (*end == '\0') ? end : end + 1;
+    }
+    return true;
+}
+
+// Appends the instruction 'op' with the single operand 'arg' to 'list'
+// without formatting and parsing it. The list takes over 'arg', it is freed
+// on failure.
+bool instr_append(vector* list, opcode op, char* arg) {
+    instr ins = {.op = op, .argc = 1, .args = {arg}};
+    if (vec_push(list, &ins) == NULL) {
+        instr_free(&ins);
+        return false;
+    }
+    return true;
+}
+
+// Writes the program in 'list' as IFJcode24 text into 'out'. The text is
+// built in a buffer and written in blocks. Returns false on allocation or
+// write failure.
+bool instr_list_write(vector* list, FILE* out) {
+    vector* sb = vec_init(STRBUF_FLUSH_SIZE, sizeof(char));
+    if (sb == NULL) {
+        return false;
+    }
+    bool ok = strbuf_puts(sb, ".IFJcode24\n");
+    for (size_t i = 0; ok && i < list->len; i++) {
+        instr* ins = vec_get(list, i);
+        // A line is put together first and appended at once, the long ones
+        // are appended piece by piece.
+        char line[256];
+        size_t len = strlen(OPCODE_STRINGS[ins->op]);
+        memcpy(line, OPCODE_STRINGS[ins->op], len);
+        int j = 0;
+        for (; j < ins->argc; j++) {
+            size_t arg_len = strlen(ins->args[j]);
+            if (len + arg_len + 2 > sizeof(line)) {
+                break;
+            }
+            line[len++] = ' ';
+            memcpy(line + len, ins->args[j], arg_len);
+            len += arg_len;
+        }
+        ok = strbuf_put(sb, line, len);
+        for (; ok && j < ins->argc; j++) {
+            ok = strbuf_putc(sb, ' ') && strbuf_puts(sb, ins->args[j]);
+        }
+        ok = ok && strbuf_putc(sb, '\n');
+        if (ok && sb->len >= STRBUF_FLUSH_SIZE) {
+            ok = strbuf_flush(sb, out);
+        }
+    }
+    ok = ok && strbuf_flush(sb, out);
+    vec_free(&sb);
+    return ok;
+}
@@ -0,0 +1,95 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// In-memory representation of the generated IFJcode24 instructions.
+
+#ifndef IFJ_PROJEKT_2024_INSTR_H
+#define IFJ_PROJEKT_2024_INSTR_H
+
+#include "vector.h"
+#include <stdbool.h>
+#include <stdio.h>
+
+#define INSTR_MAX_ARGS 3
+
+// IFJcode24 opcodes
+typedef enum {
+    I_MOVE,
+    I_CREATEFRAME,
+    I_PUSHFRAME,
+    I_POPFRAME,
+    I_DEFVAR,
+    I_CALL,
+    I_RETURN,
+    I_PUSHS,
+    I_POPS,
+    I_CLEARS,
+    I_ADD,
+    I_SUB,
+    I_MUL,
+    I_DIV,
+    I_IDIV,
+    I_ADDS,
+    I_SUBS,
+    I_MULS,
+    I_DIVS,
+    I_IDIVS,
+    I_LT,
+    I_GT,
+    I_EQ,
+    I_LTS,
+    I_GTS,
+    I_EQS,
+    I_AND,
+    I_OR,
+    I_NOT,
+    I_ANDS,
+    I_ORS,
+    I_NOTS,
+    I_INT2FLOAT,
+    I_FLOAT2INT,
+    I_INT2CHAR,
+    I_STRI2INT,
+    I_INT2FLOATS,
+    I_FLOAT2INTS,
+    I_INT2CHARS,
+    I_STRI2INTS,
+    I_READ,
+    I_WRITE,
+    I_CONCAT,
+    I_STRLEN,
+    I_GETCHAR,
+    I_SETCHAR,
+    I_TYPE,
+    I_LABEL,
+    I_JUMP,
+    I_JUMPIFEQ,
+    I_JUMPIFNEQ,
+    I_JUMPIFEQS,
+    I_JUMPIFNEQS,
+    I_EXIT,
+    I_BREAK,
+    I_DPRINT,
+    I_OPCODE_COUNT
+} opcode;
+
+extern const char* const OPCODE_STRINGS[];
+
+// Single instruction, the operands are owned by the instruction unless
+// they are shared, see 'instr_share_operands()'.
+typedef struct {
+    opcode op;
+    int argc;
+    char* args[INSTR_MAX_ARGS];
+} instr;
+
+vector* instr_list_init();
+void instr_list_free(vector** list);
+bool instr_emit(vector* list, const char* code);
+bool instr_append(vector* list, opcode op, char* arg);
+void instr_share_operands(const char* block, size_t len);
+void instr_free_arg(char* arg);
+void instr_free(instr* ins);
+bool instr_list_write(vector* list, FILE* out);
+
+#endif // IFJ_PROJEKT_2024_INSTR_H
@@ -0,0 +1,1406 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Interpreter of IFJcode24 for running and profiling the generated programs.
+//
+// The text is decoded once before the run. Labels become instruction
+// indices, constants are parsed into a pool and variable names are replaced
+// by numbers. A frame is an array of (name, value) slots in the order of the
+// DEFVARs, every operand remembers the slot its variable was found in and
+// checks it first. Frames created by the same code put a variable always
+// into the same slot, so the search is nearly never needed.
+//
+// The loop jumps from the end of one instruction straight to the code of the
+// next one through a table of label addresses (a GNU C extension), every
+// instruction has its own indirect jump the processor can predict.
+//
+// Every executed instruction is counted, the counts of the LABEL
+// instructions tell how many times each function was called and how many
+// times each loop went around.
+
+#include "interp.h"
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+// Number of the most executed labels in the report.
+#define INTERP_REPORT_LABELS 20
+
+// Operands of every opcode: 'v' variable, 's' variable or constant,
+// 'l' label, 't' type.
+const char* const INTERP_SIGNATURES[] = {
+    [I_MOVE] = "vs",       [I_CREATEFRAME] = "", [I_PUSHFRAME] = "",
+    [I_POPFRAME] = "",     [I_DEFVAR] = "v",     [I_CALL] = "l",
+    [I_RETURN] = "",       [I_PUSHS] = "s",      [I_POPS] = "v",
+    [I_CLEARS] = "",       [I_ADD] = "vss",      [I_SUB] = "vss",
+    [I_MUL] = "vss",       [I_DIV] = "vss",      [I_IDIV] = "vss",
+    [I_ADDS] = "",         [I_SUBS] = "",        [I_MULS] = "",
+    [I_DIVS] = "",         [I_IDIVS] = "",       [I_LT] = "vss",
+    [I_GT] = "vss",        [I_EQ] = "vss",       [I_LTS] = "",
+    [I_GTS] = "",          [I_EQS] = "",         [I_AND] = "vss",
+    [I_OR] = "vss",        [I_NOT] = "vs",       [I_ANDS] = "",
+    [I_ORS] = "",          [I_NOTS] = "",        [I_INT2FLOAT] = "vs",
+    [I_FLOAT2INT] = "vs",  [I_INT2CHAR] = "vs",  [I_STRI2INT] = "vss",
+    [I_INT2FLOATS] = "",   [I_FLOAT2INTS] = "",  [I_INT2CHARS] = "",
+    [I_STRI2INTS] = "",    [I_READ] = "vt",      [I_WRITE] = "s",
+    [I_CONCAT] = "vss",    [I_STRLEN] = "vs",    [I_GETCHAR] = "vss",
+    [I_SETCHAR] = "vss",   [I_TYPE] = "vs",      [I_LABEL] = "l",
+    [I_JUMP] = "l",        [I_JUMPIFEQ] = "lss", [I_JUMPIFNEQ] = "lss",
+    [I_JUMPIFEQS] = "l",   [I_JUMPIFNEQS] = "l", [I_EXIT] = "s",
+    [I_BREAK] = "",        [I_DPRINT] = "s"};
+
+const char* const VALUE_TYPE_STRINGS[] = {"",    "nil",  "int",
+                                          "float", "bool", "string"};
+
+// Open addressing table of names.
+typedef struct {
+    char** keys;
+    uint32_t* values;
+    size_t cap;
+    size_t count;
+} interp_names;
+
+typedef struct {
+    uint32_t name;
+    value val;
+} interp_slot;
+
+typedef struct {
+    interp_slot* slots;
+    uint32_t count;
+    uint32_t cap;
+} interp_frame;
+
+typedef struct {
+    interp_program* prog;
+    interp_frame global;
+    interp_frame temp;
+    bool has_temp;
+    // Local frames, the ones past 'frame_count' keep their slots for reuse.
+    interp_frame* frames;
+    size_t frame_count;
+    size_t frame_cap;
+    value* stack;
+    size_t stack_len;
+    size_t stack_cap;
+    uint32_t* calls;
+    size_t call_len;
+    size_t call_cap;
+    char* line; // Buffer of READ
+    size_t line_cap;
+    FILE* in;
+    FILE* out;
+    run_code err;
+    const char* msg;
+} interp_vm;
+
+// Allocates a string of the 'len' bytes of 'data' with one reference.
+istr* istr_new(const char* data, size_t len) {
+    if (len > UINT32_MAX) {
+        return NULL;
+    }
+    istr* s = malloc(sizeof(istr) + len + 1);
+    if (s == NULL) {
+        return NULL;
+    }
+    s->refs = 1;
+    s->len = (uint32_t)len;
+    memcpy(s->data, data, len);
+    s->data[len] = '\0';
+    return s;
+}
+
+void val_retain(const value* v) {
+    if (v->type == VAL_STRING) {
+        v->s->refs++;
+    }
+}
+
+void val_release(value* v) {
+    if (v->type == VAL_STRING && --v->s->refs == 0) {
+        free(v->s);
+    }
+    v->type = VAL_UNDEF;
+}
+
+// Stores 'v' into 'dst', the reference held by 'v' is taken over.
+void val_move(value* dst, value v) {
+    val_release(dst);
+    *dst = v;
+}
+
+// Stores a copy of 'src' into 'dst'.
+void val_copy(value* dst, const value* src) {
+    val_retain(src);
+    val_move(dst, *src);
+}
+
+// FNV-1a hash of 's'.
+uint32_t interp_hash(const char* s) {
+    uint32_t hash = 2166136261u;
+    for (; *s != '\0'; s++) {
+        hash = (hash ^ (unsigned char)*s) * 16777619u;
+    }
+    return hash;
+}
+
+// Returns the slot of 'key' in 'names', empty if it is missing.
+size_t names_slot(const interp_names* names, const char* key) {
+    size_t slot = interp_hash(key) & (names->cap - 1);
+    while (names->keys[slot] != NULL && strcmp(names->keys[slot], key) != 0) {
+        slot = (slot + 1) & (names->cap - 1);
+    }
+    return slot;
+}
+
+// Returns the value of 'key' or UINT32_MAX if it is missing.
+uint32_t names_get(const interp_names* names, const char* key) {
+    if (names->cap == 0) {
+        return UINT32_MAX;
+    }
+    size_t slot = names_slot(names, key);
+    return names->keys[slot] != NULL ? names->values[slot] : UINT32_MAX;
+}
+
+// Inserts 'key' which must be missing, keeps the table at most half full.
+bool names_put(interp_names* names, const char* key, uint32_t value) {
+    if ((names->count + 1) * 2 > names->cap) {
+        interp_names grown = {.cap = names->cap == 0 ? 64 : names->cap * 2};
+        grown.keys = calloc(grown.cap, sizeof(char*));
+        grown.values = calloc(grown.cap, sizeof(uint32_t));
+        if (grown.keys == NULL || grown.values == NULL) {
+            free(grown.keys);
+            free(grown.values);
+            return false;
+        }
+        for (size_t i = 0; i < names->cap; i++) {
+            if (names->keys[i] != NULL) {
+                size_t slot = names_slot(&grown, names->keys[i]);
+                grown.keys[slot] = names->keys[i];
+                grown.values[slot] = names->values[i];
+            }
+        }
+        grown.count = names->count;
+        free(names->keys);
+        free(names->values);
+        *names = grown;
+    }
+    char* copy = strdup(key);
+    if (copy == NULL) {
+        return false;
+    }
+    size_t slot = names_slot(names, key);
+    names->keys[slot] = copy;
+    names->values[slot] = value;
+    names->count++;
+    return true;
+}
+
+void names_free(interp_names* names) {
+    for (size_t i = 0; i < names->cap; i++) {
+        free(names->keys[i]);
+    }
+    free(names->keys);
+    free(names->values);
+    *names = (interp_names){0};
+}
+
+// Parses the constant 'arg' into 'v'. Returns false if it is malformed or
+// cannot be allocated.
+bool interp_parse_const(const char* arg, value* v) {
+    const char* at = strchr(arg, '@');
+    if (at == NULL) {
+        return false;
+    }
+    size_t type_len = at - arg;
+    const char* text = at + 1;
+    char* end = NULL;
+
+    if (type_len == 3 && strncmp(arg, "int", 3) == 0) {
+        v->type = VAL_INT;
+        v->i = strtoll(text, &end, 10);
+        if (*end != '\0') {
+            v->i = strtoll(text, &end, 0);
+        }
+        return *text != '\0' && *end == '\0';
+    }
+    if (type_len == 5 && strncmp(arg, "float", 5) == 0) {
+        v->type = VAL_FLOAT;
+        v->f = strtod(text, &end);
+        return *text != '\0' && *end == '\0';
+    }
+    if (type_len == 4 && strncmp(arg, "bool", 4) == 0) {
+        v->type = VAL_BOOL;
+        v->b = strcmp(text, "true") == 0;
+        return v->b || strcmp(text, "false") == 0;
+    }
+    if (type_len == 3 && strncmp(arg, "nil", 3) == 0) {
+        v->type = VAL_NIL;
+        return strcmp(text, "nil") == 0;
+    }
+    if (type_len != 6 || strncmp(arg, "string", 6) != 0) {
+        return false;
+    }
+
+    // Escapes are a backslash and three decimal digits.
+    size_t len = strlen(text);
+    char* bytes = malloc(len + 1);
+    if (bytes == NULL) {
+        return false;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (text[i] != '\\') {
+            bytes[n++] = text[i];
+            continue;
+        }
+        int code = 0;
+        for (int d = 1; d <= 3; d++) {
+            if (i + d >= len || text[i + d] < '0' || text[i + d] > '9') {
+                free(bytes);
+                return false;
+            }
+            code = code * 10 + text[i + d] - '0';
+        }
+        if (code > 255) {
+            free(bytes);
+            return false;
+        }
+        bytes[n++] = (char)code;
+        i += 3;
+    }
+    v->s = istr_new(bytes, n);
+    free(bytes);
+    if (v->s == NULL) {
+        return false;
+    }
+    v->type = VAL_STRING;
+    return true;
+}
+
+// Decodes the operand 'arg' of the kind given by 'sig' into 'o'.
+run_code interp_decode_operand(char sig, const char* arg, interp_names* vars,
+                               const interp_names* labels, vector* consts,
+                               operand* o) {
+    *o = (operand){.kind = OPND_NONE};
+
+    if (sig == 'l') {
+        o->kind = OPND_LABEL;
+        o->index = names_get(labels, arg);
+        return o->index == UINT32_MAX ? RUN_SEMANTIC_ERR : RUN_OK;
+    }
+    if (sig == 't') {
+        o->kind = OPND_TYPE;
+        for (int t = VAL_INT; t <= VAL_STRING; t++) {
+            if (strcmp(arg, VALUE_TYPE_STRINGS[t]) == 0) {
+                o->index = t;
+                return RUN_OK;
+            }
+        }
+        return RUN_SYNTAX_ERR;
+    }
+
+    if (strncmp(arg, "GF@", 3) == 0) {
+        o->kind = OPND_GF;
+    } else if (strncmp(arg, "LF@", 3) == 0) {
+        o->kind = OPND_LF;
+    } else if (strncmp(arg, "TF@", 3) == 0) {
+        o->kind = OPND_TF;
+    }
+    if (o->kind != OPND_NONE) {
+        if (arg[3] == '\0') {
+            return RUN_SYNTAX_ERR;
+        }
+        o->index = names_get(vars, arg + 3);
+        if (o->index == UINT32_MAX) {
+            o->index = vars->count;
+            if (!names_put(vars, arg + 3, o->index)) {
+                return RUN_INTERNAL_ERR;
+            }
+        }
+        return RUN_OK;
+    }
+    if (sig == 'v') {
+        return RUN_SYNTAX_ERR;
+    }
+
+    value v = {.type = VAL_UNDEF};
+    if (!interp_parse_const(arg, &v)) {
+        val_release(&v);
+        return RUN_SYNTAX_ERR;
+    }
+    o->kind = OPND_CONST;
+    o->index = consts->len;
+    if (vec_push(consts, &v) == NULL) {
+        val_release(&v);
+        return RUN_INTERNAL_ERR;
+    }
+    return RUN_OK;
+}
+
+// Prints the instruction 'index' of 'prog' as text into 'out'.
+void interp_print_instr(const interp_program* prog, size_t index, FILE* out) {
+    instr* ins = vec_get(prog->text, index);
+    fputs(OPCODE_STRINGS[ins->op], out);
+    for (int i = 0; i < ins->argc; i++) {
+        fprintf(out, " %s", ins->args[i]);
+    }
+}
+
+// Decodes the instructions in 'prog->text' into 'prog->code'.
+run_code interp_decode(interp_program* prog) {
+    interp_names labels = {0};
+    interp_names vars = {0};
+    vector* consts = vec_init(64, sizeof(value));
+    prog->count = prog->text->len;
+    prog->code = calloc(prog->count + 1, sizeof(interp_instr));
+    prog->counts = calloc(prog->count + 1, sizeof(uint64_t));
+    if (consts == NULL || prog->code == NULL || prog->counts == NULL) {
+        vec_free(&consts);
+        return RUN_INTERNAL_ERR;
+    }
+
+    run_code err = RUN_OK;
+    for (size_t i = 0; i < prog->count && err == RUN_OK; i++) {
+        instr* ins = vec_get(prog->text, i);
+        if (ins->op != I_LABEL || ins->argc != 1) {
+            continue;
+        }
+        if (names_get(&labels, ins->args[0]) != UINT32_MAX) {
+            err = RUN_SEMANTIC_ERR;
+        } else if (!names_put(&labels, ins->args[0], (uint32_t)i)) {
+            err = RUN_INTERNAL_ERR;
+        }
+        if (err != RUN_OK) {
+            fprintf(stderr, "Label %s defined twice\n", ins->args[0]);
+        }
+    }
+
+    for (size_t i = 0; i < prog->count && err == RUN_OK; i++) {
+        instr* ins = vec_get(prog->text, i);
+        const char* sig = INTERP_SIGNATURES[ins->op];
+        prog->code[i].op = (uint8_t)ins->op;
+        if ((size_t)ins->argc != strlen(sig)) {
+            err = RUN_SYNTAX_ERR;
+        }
+        for (int j = 0; j < ins->argc && err == RUN_OK; j++) {
+            err = interp_decode_operand(sig[j], ins->args[j], &vars, &labels,
+                                        consts, &prog->code[i].args[j]);
+        }
+        if (err != RUN_OK) {
+            fprintf(stderr, "Invalid instruction %zu: ", i + 1);
+            interp_print_instr(prog, i, stderr);
+            fputc('\n', stderr);
+        }
+    }
+    prog->code[prog->count].op = I_OPCODE_COUNT;
+
+    prog->const_count = consts->len;
+    prog->consts = vec_leak(&consts);
+    names_free(&labels);
+    names_free(&vars);
+    return err;
+}
+
+// Loads the IFJcode24 program 'text' into 'prog'.
+run_code interp_load(interp_program* prog, const char* text) {
+    assert(prog != NULL && text != NULL);
+
+    *prog = (interp_program){0};
+    char* copy = strdup(text);
+    prog->text = instr_list_init();
+    if (copy == NULL || prog->text == NULL) {
+        free(copy);
+        interp_free(prog);
+        return RUN_INTERNAL_ERR;
+    }
+
+    // Comments run to the end of the line, '#' is escaped in strings.
+    for (char* c = strchr(copy, '#'); c != NULL; c = strchr(c, '#')) {
+        while (*c != '\0' && *c != '\n') {
+            *c++ = ' ';
+        }
+    }
+    char* header = copy + strspn(copy, " \t\r\n");
+    size_t header_len = strcspn(header, " \t\r\n");
+    if (header_len != strlen(".IFJcode24") ||
+        strncasecmp(header, ".IFJcode24", header_len) != 0) {
+        fprintf(stderr, "Missing .IFJcode24 header\n");
+        free(copy);
+        interp_free(prog);
+        return RUN_HEADER_ERR;
+    }
+    memset(header, ' ', header_len);
+    for (char* c = copy; *c != '\0'; c++) {
+        if (*c == '\r') {
+            *c = ' ';
+        }
+    }
+
+    bool ok = instr_emit(prog->text, copy);
+    free(copy);
+    run_code err = ok ? interp_decode(prog) : RUN_OPCODE_ERR;
+    if (err != RUN_OK) {
+        interp_free(prog);
+    }
+    return err;
+}
+
+// Frees everything held by 'prog'.
+void interp_free(interp_program* prog) {
+    for (size_t i = 0; prog->consts != NULL && i < prog->const_count; i++) {
+        val_release(&prog->consts[i]);
+    }
+    free(prog->consts);
+    free(prog->code);
+    free(prog->counts);
+    instr_list_free(&prog->text);
+    *prog = (interp_program){0};
+}
+
+// Records the run time error 'err', returns false for convenience.
+bool interp_fail(interp_vm* vm, run_code err, const char* msg) {
+    vm->err = err;
+    vm->msg = msg;
+    return false;
+}
+
+// Releases the values of 'f' keeping its slots.
+void frame_clear(interp_frame* f) {
+    for (uint32_t i = 0; i < f->count; i++) {
+        val_release(&f->slots[i].val);
+    }
+    f->count = 0;
+}
+
+// Returns the frame of an operand of 'kind' or NULL if it does not exist.
+interp_frame* interp_frame_of(interp_vm* vm, uint8_t kind) {
+    if (kind == OPND_GF) {
+        return &vm->global;
+    }
+    if (kind == OPND_LF) {
+        return vm->frame_count > 0 ? &vm->frames[vm->frame_count - 1] : NULL;
+    }
+    return vm->has_temp ? &vm->temp : NULL;
+}
+
+// Returns the variable 'o' or NULL if it does not exist.
+value* interp_var(interp_vm* vm, operand* o) {
+    interp_frame* f = interp_frame_of(vm, o->kind);
+    if (f == NULL) {
+        interp_fail(vm, RUN_FRAME_ERR, "the frame does not exist");
+        return NULL;
+    }
+    if (o->slot < f->count && f->slots[o->slot].name == o->index) {
+        return &f->slots[o->slot].val;
+    }
+    for (uint32_t i = 0; i < f->count; i++) {
+        if (f->slots[i].name == o->index) {
+            o->slot = i;
+            return &f->slots[i].val;
+        }
+    }
+    interp_fail(vm, RUN_VARIABLE_ERR, "the variable is not defined");
+    return NULL;
+}
+
+// Returns the value of the constant or variable 'o', NULL if there is none.
+// Uninitialized variables are allowed only if 'undef' is set.
+const value* interp_symb(interp_vm* vm, operand* o, bool undef) {
+    if (o->kind == OPND_CONST) {
+        return &vm->prog->consts[o->index];
+    }
+    value* v = interp_var(vm, o);
+    if (v != NULL && v->type == VAL_UNDEF && !undef) {
+        interp_fail(vm, RUN_MISSING_VALUE_ERR, "the variable has no value");
+        return NULL;
+    }
+    return v;
+}
+
+// Defines the variable 'o' in its frame.
+bool interp_defvar(interp_vm* vm, operand* o) {
+    interp_frame* f = interp_frame_of(vm, o->kind);
+    if (f == NULL) {
+        return interp_fail(vm, RUN_FRAME_ERR, "the frame does not exist");
+    }
+    for (uint32_t i = 0; i < f->count; i++) {
+        if (f->slots[i].name == o->index) {
+            return interp_fail(vm, RUN_SEMANTIC_ERR,
+                               "the variable is already defined");
+        }
+    }
+    if (f->count == f->cap) {
+        uint32_t cap = f->cap == 0 ? 8 : f->cap * 2;
+        interp_slot* slots = reallocarray(f->slots, cap, sizeof(interp_slot));
+        if (slots == NULL) {
+            return interp_fail(vm, RUN_INTERNAL_ERR, "out of memory");
+        }
+        f->slots = slots;
+        f->cap = cap;
+    }
+    o->slot = f->count;
+    f->slots[f->count++] = (interp_slot){o->index, {.type = VAL_UNDEF}};
+    return true;
+}
+
+// Moves the temporary frame onto the stack of local frames.
+bool interp_pushframe(interp_vm* vm) {
+    if (!vm->has_temp) {
+        return interp_fail(vm, RUN_FRAME_ERR, "the frame does not exist");
+    }
+    if (vm->frame_count == vm->frame_cap) {
+        size_t cap = vm->frame_cap == 0 ? 16 : vm->frame_cap * 2;
+        interp_frame* frames =
+            reallocarray(vm->frames, cap, sizeof(interp_frame));
+        if (frames == NULL) {
+            return interp_fail(vm, RUN_INTERNAL_ERR, "out of memory");
+        }
+        memset(frames + vm->frame_cap, 0,
+               (cap - vm->frame_cap) * sizeof(interp_frame));
+        vm->frames = frames;
+        vm->frame_cap = cap;
+    }
+    // The slots of a popped frame become the next temporary frame.
+    interp_frame spare = vm->frames[vm->frame_count];
+    vm->frames[vm->frame_count++] = vm->temp;
+    vm->temp = spare;
+    vm->has_temp = false;
+    return true;
+}
+
+// Moves the topmost local frame into the temporary one.
+bool interp_popframe(interp_vm* vm) {
+    if (vm->frame_count == 0) {
+        return interp_fail(vm, RUN_FRAME_ERR, "no local frame");
+    }
+    frame_clear(&vm->temp);
+    interp_frame spare = vm->temp;
+    vm->temp = vm->frames[--vm->frame_count];
+    vm->frames[vm->frame_count] = spare;
+    vm->has_temp = true;
+    return true;
+}
+
+// Pushes 'v' onto the data stack, the reference is taken over.
+bool interp_push(interp_vm* vm, value v) {
+    if (vm->stack_len == vm->stack_cap) {
+        size_t cap = vm->stack_cap == 0 ? 64 : vm->stack_cap * 2;
+        value* stack = reallocarray(vm->stack, cap, sizeof(value));
+        if (stack == NULL) {
+            val_release(&v);
+            return interp_fail(vm, RUN_INTERNAL_ERR, "out of memory");
+        }
+        vm->stack = stack;
+        vm->stack_cap = cap;
+    }
+    vm->stack[vm->stack_len++] = v;
+    return true;
+}
+
+// Pops the topmost value of the data stack into 'v'.
+bool interp_pop(interp_vm* vm, value* v) {
+    if (vm->stack_len == 0) {
+        return interp_fail(vm, RUN_MISSING_VALUE_ERR, "the stack is empty");
+    }
+    *v = vm->stack[--vm->stack_len];
+    return true;
+}
+
+// Pops the second operand into 'b' and the first one into 'a'.
+bool interp_pop2(interp_vm* vm, value* a, value* b) {
+    if (vm->stack_len < 2) {
+        return interp_fail(vm, RUN_MISSING_VALUE_ERR, "the stack is empty");
+    }
+    *b = vm->stack[--vm->stack_len];
+    *a = vm->stack[--vm->stack_len];
+    return true;
+}
+
+// Computes the arithmetic 'op' of 'a' and 'b' into 'res'.
+bool interp_arith(interp_vm* vm, opcode op, const value* a, const value* b,
+                  value* res) {
+    if (a->type != b->type || (a->type != VAL_INT && a->type != VAL_FLOAT)) {
+        return interp_fail(vm, RUN_OPERAND_TYPE_ERR,
+                           "arithmetic needs two ints or two floats");
+    }
+    res->type = a->type;
+    if (a->type == VAL_INT) {
+        // Overflow wraps around instead of being undefined.
+        uint64_t x = (uint64_t)a->i;
+        uint64_t y = (uint64_t)b->i;
+        switch (op) {
+        case I_ADD:
+        case I_ADDS:
+            res->i = (int64_t)(x + y);
+            return true;
+        case I_SUB:
+        case I_SUBS:
+            res->i = (int64_t)(x - y);
+            return true;
+        case I_MUL:
+        case I_MULS:
+            res->i = (int64_t)(x * y);
+            return true;
+        case I_IDIV:
+        case I_IDIVS:
+            if (b->i == 0) {
+                return interp_fail(vm, RUN_OPERAND_VALUE_ERR,
+                                   "division by zero");
+            }
+            res->i = b->i == -1 ? (int64_t)(0 - x) : a->i / b->i;
+            return true;
+        default:
+            return interp_fail(vm, RUN_OPERAND_TYPE_ERR,
+                               "DIV needs float operands");
+        }
+    }
+    switch (op) {
+    case I_ADD:
+    case I_ADDS:
+        res->f = a->f + b->f;
+        return true;
+    case I_SUB:
+    case I_SUBS:
+        res->f = a->f - b->f;
+        return true;
+    case I_MUL:
+    case I_MULS:
+        res->f = a->f * b->f;
+        return true;
+    case I_DIV:
+    case I_DIVS:
+        if (b->f == 0.0) {
+            return interp_fail(vm, RUN_OPERAND_VALUE_ERR, "division by zero");
+        }
+        res->f = a->f / b->f;
+        return true;
+    default:
+        return interp_fail(vm, RUN_OPERAND_TYPE_ERR,
+                           "IDIV needs int operands");
+    }
+}
+
+// Compares two values of the same type, returns <0, 0 or >0.
+int interp_cmp(const value* a, const value* b) {
+    switch (a->type) {
+    case VAL_INT:
+        return (a->i > b->i) - (a->i < b->i);
+    case VAL_FLOAT:
+        return (a->f > b->f) - (a->f < b->f);
+    case VAL_BOOL:
+        return (int)a->b - (int)b->b;
+    case VAL_STRING: {
+        uint32_t len = a->s->len < b->s->len ? a->s->len : b->s->len;
+        int cmp = memcmp(a->s->data, b->s->data, len);
+        if (cmp != 0) {
+            return cmp;
+        }
+        return (a->s->len > b->s->len) - (a->s->len < b->s->len);
+    }
+    default:
+        return 0;
+    }
+}
+
+// Computes the relation 'op' (LT, GT or EQ) of 'a' and 'b' into 'res'. Only
+// EQ accepts nil, with operands of any type.
+bool interp_relation(interp_vm* vm, opcode op, const value* a,
+                     const value* b, value* res) {
+    bool eq = op == I_EQ || op == I_EQS;
+    res->type = VAL_BOOL;
+    if (eq && (a->type == VAL_NIL || b->type == VAL_NIL)) {
+        res->b = a->type == b->type;
+        return true;
+    }
+    if (a->type != b->type || a->type == VAL_NIL) {
+        return interp_fail(vm, RUN_OPERAND_TYPE_ERR,
+                           "comparison of different types");
+    }
+    int cmp = interp_cmp(a, b);
+    if (eq) {
+        res->b = cmp == 0;
+    } else if (op == I_LT || op == I_LTS) {
+        res->b = cmp < 0;
+    } else {
+        res->b = cmp > 0;
+    }
+    return true;
+}
+
+// Computes the logical 'op' of 'a' and 'b' ('b' is unused by NOT).
+bool interp_logic(interp_vm* vm, opcode op, const value* a, const value* b,
+                  value* res) {
+    bool not = op == I_NOT || op == I_NOTS;
+    if (a->type != VAL_BOOL || (!not && b->type != VAL_BOOL)) {
+        return interp_fail(vm, RUN_OPERAND_TYPE_ERR,
+                           "logic needs bool operands");
+    }
+    res->type = VAL_BOOL;
+    if (not) {
+        res->b = !a->b;
+    } else if (op == I_AND || op == I_ANDS) {
+        res->b = a->b && b->b;
+    } else {
+        res->b = a->b || b->b;
+    }
+    return true;
+}
+
+// Computes the conversion 'op' of 'a' into 'res', STRI2INT takes the index
+// from 'b'.
+bool interp_convert(interp_vm* vm, opcode op, const value* a, const value* b,
+                    value* res) {
+    switch (op) {
+    case I_INT2FLOAT:
+    case I_INT2FLOATS:
+        if (a->type != VAL_INT) {
+            break;
+        }
+        res->type = VAL_FLOAT;
+        res->f = (double)a->i;
+        return true;
+    case I_FLOAT2INT:
+    case I_FLOAT2INTS:
+        if (a->type != VAL_FLOAT) {
+            break;
+        }
+        if (!(a->f > -9223372036854775808.0 &&
+              a->f < 9223372036854775808.0)) {
+            return interp_fail(vm, RUN_OPERAND_VALUE_ERR,
+                               "the float does not fit an int");
+        }
+        res->type = VAL_INT;
+        res->i = (int64_t)a->f;
+        return true;
+    case I_INT2CHAR:
+    case I_INT2CHARS:
+        if (a->type != VAL_INT) {
+            break;
+        }
+        if (a->i < 0 || a->i > 255) {
+            return interp_fail(vm, RUN_STRING_ERR, "invalid character code");
+        }
+        {
+            char c = (char)a->i;
+            res->type = VAL_STRING;
+            res->s = istr_new(&c, 1);
+        }
+        return res->s != NULL ||
+               interp_fail(vm, RUN_INTERNAL_ERR, "out of memory");
+    default:
+        if (a->type != VAL_STRING || b->type != VAL_INT) {
+            break;
+        }
+        if (b->i < 0 || b->i >= a->s->len) {
+            return interp_fail(vm, RUN_STRING_ERR, "index out of the string");
+        }
+        res->type = VAL_INT;
+        res->i = (unsigned char)a->s->data[b->i];
+        return true;
+    }
+    return interp_fail(vm, RUN_OPERAND_TYPE_ERR,
+                       "wrong type of the converted value");
+}
+
+// Reads a line of the type 'type' into 'res', nil if it is missing or
+// malformed.
+bool interp_read(interp_vm* vm, value_type type, value* res) {
+    ssize_t len = getline(&vm->line, &vm->line_cap, vm->in);
+    res->type = VAL_NIL;
+    if (len < 0) {
+        return true;
+    }
+    if (len > 0 && vm->line[len - 1] == '\n') {
+        vm->line[--len] = '\0';
+    }
+
+    char* end = NULL;
+    switch (type) {
+    case VAL_INT:
+        res->i = strtoll(vm->line, &end, 10);
+        if (len > 0 && *end == '\0') {
+            res->type = VAL_INT;
+        }
+        break;
+    case VAL_FLOAT:
+        res->f = strtod(vm->line, &end);
+        if (len > 0 && *end == '\0') {
+            res->type = VAL_FLOAT;
+        }
+        break;
+    case VAL_BOOL:
+        res->type = VAL_BOOL;
+        res->b = strcasecmp(vm->line, "true") == 0;
+        break;
+    default:
+        res->s = istr_new(vm->line, len);
+        if (res->s == NULL) {
+            return interp_fail(vm, RUN_INTERNAL_ERR, "out of memory");
+        }
+        res->type = VAL_STRING;
+        break;
+    }
+    return true;
+}
+
+// Writes 'v' into 'out' in the format of WRITE.
+void interp_write(const value* v, FILE* out) {
+    switch (v->type) {
+    case VAL_INT:
+        fprintf(out, "%" PRId64, v->i);
+        break;
+    case VAL_FLOAT:
+        fprintf(out, "%a", v->f);
+        break;
+    case VAL_BOOL:
+        fputs(v->b ? "true" : "false", out);
+        break;
+    case VAL_STRING:
+        fwrite(v->s->data, 1, v->s->len, out);
+        break;
+    default:
+        break;
+    }
+}
+
+// Frees everything held by 'vm'.
+void interp_vm_free(interp_vm* vm) {
+    frame_clear(&vm->global);
+    free(vm->global.slots);
+    frame_clear(&vm->temp);
+    free(vm->temp.slots);
+    for (size_t i = 0; i < vm->frame_cap; i++) {
+        frame_clear(&vm->frames[i]);
+        free(vm->frames[i].slots);
+    }
+    free(vm->frames);
+    for (size_t i = 0; i < vm->stack_len; i++) {
+        val_release(&vm->stack[i]);
+    }
+    free(vm->stack);
+    free(vm->calls);
+    free(vm->line);
+}
+
+// Runs the loaded 'prog' reading its input from 'in' and writing its output
+// to 'out'. Returns the code of EXIT, 0 at the end of the program or the
+// run_code of an error, which is also reported on stderr.
+int interp_run(interp_program* prog, FILE* in, FILE* out) {
+    assert(prog != NULL && prog->code != NULL);
+
+    // Addresses of the code of every opcode, I_OPCODE_COUNT ends the run.
+    static void* const TARGETS[I_OPCODE_COUNT + 1] = {
+        [I_MOVE] = &&do_move,
+        [I_CREATEFRAME] = &&do_createframe,
+        [I_PUSHFRAME] = &&do_pushframe,
+        [I_POPFRAME] = &&do_popframe,
+        [I_DEFVAR] = &&do_defvar,
+        [I_CALL] = &&do_call,
+        [I_RETURN] = &&do_return,
+        [I_PUSHS] = &&do_pushs,
+        [I_POPS] = &&do_pops,
+        [I_CLEARS] = &&do_clears,
+        [I_ADD] = &&do_arith,
+        [I_SUB] = &&do_arith,
+        [I_MUL] = &&do_arith,
+        [I_DIV] = &&do_arith,
+        [I_IDIV] = &&do_arith,
+        [I_ADDS] = &&do_arith_s,
+        [I_SUBS] = &&do_arith_s,
+        [I_MULS] = &&do_arith_s,
+        [I_DIVS] = &&do_arith_s,
+        [I_IDIVS] = &&do_arith_s,
+        [I_LT] = &&do_relation,
+        [I_GT] = &&do_relation,
+        [I_EQ] = &&do_relation,
+        [I_LTS] = &&do_relation_s,
+        [I_GTS] = &&do_relation_s,
+        [I_EQS] = &&do_relation_s,
+        [I_AND] = &&do_logic,
+        [I_OR] = &&do_logic,
+        [I_NOT] = &&do_not,
+        [I_ANDS] = &&do_logic_s,
+        [I_ORS] = &&do_logic_s,
+        [I_NOTS] = &&do_not_s,
+        [I_INT2FLOAT] = &&do_convert,
+        [I_FLOAT2INT] = &&do_convert,
+        [I_INT2CHAR] = &&do_convert,
+        [I_STRI2INT] = &&do_stri2int,
+        [I_INT2FLOATS] = &&do_convert_s,
+        [I_FLOAT2INTS] = &&do_convert_s,
+        [I_INT2CHARS] = &&do_convert_s,
+        [I_STRI2INTS] = &&do_stri2int_s,
+        [I_READ] = &&do_read,
+        [I_WRITE] = &&do_write,
+        [I_CONCAT] = &&do_concat,
+        [I_STRLEN] = &&do_strlen,
+        [I_GETCHAR] = &&do_getchar,
+        [I_SETCHAR] = &&do_setchar,
+        [I_TYPE] = &&do_type,
+        [I_LABEL] = &&do_label,
+        [I_JUMP] = &&do_jump,
+        [I_JUMPIFEQ] = &&do_jumpif,
+        [I_JUMPIFNEQ] = &&do_jumpif,
+        [I_JUMPIFEQS] = &&do_jumpif_s,
+        [I_JUMPIFNEQS] = &&do_jumpif_s,
+        [I_EXIT] = &&do_exit,
+        [I_BREAK] = &&do_break,
+        [I_DPRINT] = &&do_dprint,
+        [I_OPCODE_COUNT] = &&do_end,
+    };
+
+    interp_vm vm = {.prog = prog, .in = in, .out = out};
+    interp_instr* code = prog->code;
+    uint64_t* counts = prog->counts;
+    interp_instr* ins = NULL;
+    size_t ip = 0;
+    int result = 0;
+
+    value* dst;
+    const value* a;
+    const value* b;
+    value res;
+    value x;
+    value y;
+
+#define DISPATCH()                                                             \
+    do {                                                                       \
+        ins = &code[ip];                                                       \
+        counts[ip]++;                                                          \
+        goto* TARGETS[ins->op];                                                \
+    } while (0)
+#define NEXT()                                                                 \
+    do {                                                                       \
+        ip++;                                                                  \
+        DISPATCH();                                                            \
+    } while (0)
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            goto fail;                                                         \
+        }                                                                      \
+    } while (0)
+#define VAR(i) CHECK((dst = interp_var(&vm, &ins->args[i])) != NULL)
+#define SYMB(i, v) CHECK(((v) = interp_symb(&vm, &ins->args[i], false)) != NULL)
+#define FAIL(err, msg)                                                         \
+    do {                                                                       \
+        interp_fail(&vm, (err), (msg));                                        \
+        goto fail;                                                             \
+    } while (0)
+
+    DISPATCH();
+
+do_move:
+    SYMB(1, a);
+    VAR(0);
+    val_copy(dst, a);
+    NEXT();
+
+do_createframe:
+    frame_clear(&vm.temp);
+    vm.has_temp = true;
+    NEXT();
+
+do_pushframe:
+    CHECK(interp_pushframe(&vm));
+    NEXT();
+
+do_popframe:
+    CHECK(interp_popframe(&vm));
+    NEXT();
+
+do_defvar:
+    CHECK(interp_defvar(&vm, &ins->args[0]));
+    NEXT();
+
+do_call:
+    if (vm.call_len == vm.call_cap) {
+        size_t cap = vm.call_cap == 0 ? 64 : vm.call_cap * 2;
+        uint32_t* calls = reallocarray(vm.calls, cap, sizeof(uint32_t));
+        if (calls == NULL) {
+            FAIL(RUN_INTERNAL_ERR, "out of memory");
+        }
+        vm.calls = calls;
+        vm.call_cap = cap;
+    }
+    vm.calls[vm.call_len++] = (uint32_t)(ip + 1);
+    ip = ins->args[0].index;
+    DISPATCH();
+
+do_return:
+    if (vm.call_len == 0) {
+        FAIL(RUN_MISSING_VALUE_ERR, "no call to return from");
+    }
+    ip = vm.calls[--vm.call_len];
+    DISPATCH();
+
+do_pushs:
+    SYMB(0, a);
+    val_retain(a);
+    CHECK(interp_push(&vm, *a));
+    NEXT();
+
+do_pops:
+    VAR(0);
+    CHECK(interp_pop(&vm, &x));
+    val_move(dst, x);
+    NEXT();
+
+do_clears:
+    while (vm.stack_len > 0) {
+        val_release(&vm.stack[--vm.stack_len]);
+    }
+    NEXT();
+
+do_arith:
+    SYMB(1, a);
+    SYMB(2, b);
+    CHECK(interp_arith(&vm, ins->op, a, b, &res));
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_arith_s:
+    CHECK(interp_pop2(&vm, &x, &y));
+    if (!interp_arith(&vm, ins->op, &x, &y, &res)) {
+        val_release(&x);
+        val_release(&y);
+        goto fail;
+    }
+    CHECK(interp_push(&vm, res));
+    NEXT();
+
+do_relation:
+    SYMB(1, a);
+    SYMB(2, b);
+    CHECK(interp_relation(&vm, ins->op, a, b, &res));
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_relation_s:
+    CHECK(interp_pop2(&vm, &x, &y));
+    {
+        bool ok = interp_relation(&vm, ins->op, &x, &y, &res);
+        val_release(&x);
+        val_release(&y);
+        CHECK(ok);
+    }
+    CHECK(interp_push(&vm, res));
+    NEXT();
+
+do_logic:
+    SYMB(1, a);
+    SYMB(2, b);
+    CHECK(interp_logic(&vm, ins->op, a, b, &res));
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_logic_s:
+    CHECK(interp_pop2(&vm, &x, &y));
+    {
+        bool ok = interp_logic(&vm, ins->op, &x, &y, &res);
+        val_release(&x);
+        val_release(&y);
+        CHECK(ok);
+    }
+    CHECK(interp_push(&vm, res));
+    NEXT();
+
+do_not:
+    SYMB(1, a);
+    CHECK(interp_logic(&vm, ins->op, a, NULL, &res));
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_not_s:
+    CHECK(interp_pop(&vm, &x));
+    {
+        bool ok = interp_logic(&vm, ins->op, &x, NULL, &res);
+        val_release(&x);
+        CHECK(ok);
+    }
+    CHECK(interp_push(&vm, res));
+    NEXT();
+
+do_convert:
+    SYMB(1, a);
+    CHECK(interp_convert(&vm, ins->op, a, NULL, &res));
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_convert_s:
+    CHECK(interp_pop(&vm, &x));
+    {
+        bool ok = interp_convert(&vm, ins->op, &x, NULL, &res);
+        val_release(&x);
+        CHECK(ok);
+    }
+    CHECK(interp_push(&vm, res));
+    NEXT();
+
+do_stri2int:
+    SYMB(1, a);
+    SYMB(2, b);
+    CHECK(interp_convert(&vm, ins->op, a, b, &res));
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_stri2int_s:
+    CHECK(interp_pop2(&vm, &x, &y));
+    {
+        bool ok = interp_convert(&vm, ins->op, &x, &y, &res);
+        val_release(&x);
+        val_release(&y);
+        CHECK(ok);
+    }
+    CHECK(interp_push(&vm, res));
+    NEXT();
+
+do_read:
+    VAR(0);
+    CHECK(interp_read(&vm, ins->args[1].index, &res));
+    val_move(dst, res);
+    NEXT();
+
+do_write:
+    SYMB(0, a);
+    interp_write(a, vm.out);
+    NEXT();
+
+do_concat:
+    SYMB(1, a);
+    SYMB(2, b);
+    if (a->type != VAL_STRING || b->type != VAL_STRING) {
+        FAIL(RUN_OPERAND_TYPE_ERR, "CONCAT needs strings");
+    }
+    {
+        size_t len = (size_t)a->s->len + b->s->len;
+        istr* s = len <= UINT32_MAX ? malloc(sizeof(istr) + len + 1) : NULL;
+        if (s == NULL) {
+            FAIL(RUN_INTERNAL_ERR, "out of memory");
+        }
+        s->refs = 1;
+        s->len = (uint32_t)len;
+        memcpy(s->data, a->s->data, a->s->len);
+        memcpy(s->data + a->s->len, b->s->data, b->s->len);
+        s->data[len] = '\0';
+        res = (value){.type = VAL_STRING, .s = s};
+    }
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_strlen:
+    SYMB(1, a);
+    if (a->type != VAL_STRING) {
+        FAIL(RUN_OPERAND_TYPE_ERR, "STRLEN needs a string");
+    }
+    res = (value){.type = VAL_INT, .i = a->s->len};
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_getchar:
+    SYMB(1, a);
+    SYMB(2, b);
+    if (a->type != VAL_STRING || b->type != VAL_INT) {
+        FAIL(RUN_OPERAND_TYPE_ERR, "GETCHAR needs a string and an int");
+    }
+    if (b->i < 0 || b->i >= a->s->len) {
+        FAIL(RUN_STRING_ERR, "index out of the string");
+    }
+    res = (value){.type = VAL_STRING, .s = istr_new(&a->s->data[b->i], 1)};
+    if (res.s == NULL) {
+        FAIL(RUN_INTERNAL_ERR, "out of memory");
+    }
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_setchar:
+    VAR(0);
+    SYMB(1, a);
+    SYMB(2, b);
+    if (dst->type == VAL_UNDEF) {
+        FAIL(RUN_MISSING_VALUE_ERR, "the variable has no value");
+    }
+    if (dst->type != VAL_STRING || a->type != VAL_INT ||
+        b->type != VAL_STRING) {
+        FAIL(RUN_OPERAND_TYPE_ERR, "SETCHAR needs a string, int and string");
+    }
+    if (a->i < 0 || a->i >= dst->s->len || b->s->len == 0) {
+        FAIL(RUN_STRING_ERR, "index out of the string");
+    }
+    {
+        char c = b->s->data[0];
+        int64_t index = a->i;
+        // The string may be shared, it is changed in a copy then.
+        if (dst->s->refs > 1) {
+            istr* copy = istr_new(dst->s->data, dst->s->len);
+            if (copy == NULL) {
+                FAIL(RUN_INTERNAL_ERR, "out of memory");
+            }
+            val_move(dst, (value){.type = VAL_STRING, .s = copy});
+        }
+        dst->s->data[index] = c;
+    }
+    NEXT();
+
+do_type:
+    CHECK((a = interp_symb(&vm, &ins->args[1], true)) != NULL);
+    {
+        const char* name = VALUE_TYPE_STRINGS[a->type];
+        res = (value){.type = VAL_STRING, .s = istr_new(name, strlen(name))};
+    }
+    if (res.s == NULL) {
+        FAIL(RUN_INTERNAL_ERR, "out of memory");
+    }
+    VAR(0);
+    val_move(dst, res);
+    NEXT();
+
+do_label:
+    NEXT();
+
+do_jump:
+    ip = ins->args[0].index;
+    DISPATCH();
+
+do_jumpif:
+    SYMB(1, a);
+    SYMB(2, b);
+    CHECK(interp_relation(&vm, I_EQ, a, b, &res));
+    if (res.b == (ins->op == I_JUMPIFEQ)) {
+        ip = ins->args[0].index;
+        DISPATCH();
+    }
+    NEXT();
+
+do_jumpif_s:
+    CHECK(interp_pop2(&vm, &x, &y));
+    {
+        bool ok = interp_relation(&vm, I_EQ, &x, &y, &res);
+        val_release(&x);
+        val_release(&y);
+        CHECK(ok);
+    }
+    if (res.b == (ins->op == I_JUMPIFEQS)) {
+        ip = ins->args[0].index;
+        DISPATCH();
+    }
+    NEXT();
+
+do_exit:
+    SYMB(0, a);
+    if (a->type != VAL_INT) {
+        FAIL(RUN_OPERAND_TYPE_ERR, "EXIT needs an int");
+    }
+    if (a->i < 0 || a->i > 9) {
+        FAIL(RUN_OPERAND_VALUE_ERR, "EXIT code out of 0-9");
+    }
+    result = (int)a->i;
+    goto done;
+
+do_break:
+    fprintf(stderr,
+            "BREAK at instruction %zu: %zu local frames, %zu values on the "
+            "stack, %zu calls\n",
+            ip + 1, vm.frame_count, vm.stack_len, vm.call_len);
+    NEXT();
+
+do_dprint:
+    SYMB(0, a);
+    interp_write(a, stderr);
+    NEXT();
+
+do_end:
+    goto done;
+
+fail:
+    fflush(out);
+    fprintf(stderr, "Runtime error %d at instruction %zu (", vm.err, ip + 1);
+    interp_print_instr(prog, ip, stderr);
+    fprintf(stderr, "): %s\n", vm.msg);
+    result = vm.err;
+
+done:
+#undef DISPATCH
+#undef NEXT
+#undef CHECK
+#undef VAR
+#undef SYMB
+#undef FAIL
+    fflush(out);
+    prog->executed = 0;
+    for (size_t i = 0; i < prog->count; i++) {
+        prog->executed += counts[i];
+    }
+    interp_vm_free(&vm);
+    return result;
+}
+
+// Count of an opcode or of an instruction in the report.
+typedef struct {
+    uint64_t count;
+    size_t index;
+} interp_rank;
+
+// Sorts the ranks by their counts, the highest first.
+int interp_by_count(const void* a, const void* b) {
+    uint64_t x = ((const interp_rank*)a)->count;
+    uint64_t y = ((const interp_rank*)b)->count;
+    return (x < y) - (x > y);
+}
+
+// Writes the executions of every opcode and of the most executed labels of
+// the finished run of 'prog' taking 'ms' into 'out'.
+void interp_report(const interp_program* prog, double ms, FILE* out) {
+    fprintf(out, "executed %" PRIu64 " instructions in %.3f ms",
+            prog->executed, ms);
+    if (ms > 0) {
+        fprintf(out, " (%.1f M/s)", prog->executed / ms / 1000.0);
+    }
+    fputc('\n', out);
+
+    interp_rank ops[I_OPCODE_COUNT];
+    for (size_t i = 0; i < I_OPCODE_COUNT; i++) {
+        ops[i] = (interp_rank){0, i};
+    }
+    for (size_t i = 0; i < prog->count; i++) {
+        ops[prog->code[i].op].count += prog->counts[i];
+    }
+    qsort(ops, I_OPCODE_COUNT, sizeof(interp_rank), interp_by_count);
+    fprintf(out, "%-12s %14s %7s\n", "instruction", "count", "share");
+    for (size_t i = 0; i < I_OPCODE_COUNT && ops[i].count > 0; i++) {
+        fprintf(out, "%-12s %14" PRIu64 " %6.2f%%\n",
+                OPCODE_STRINGS[ops[i].index], ops[i].count,
+                100.0 * ops[i].count / prog->executed);
+    }
+
+    interp_rank* labels = malloc((prog->count + 1) * sizeof(interp_rank));
+    if (labels == NULL) {
+        return;
+    }
+    size_t label_count = 0;
+    for (size_t i = 0; i < prog->count; i++) {
+        if (prog->code[i].op == I_LABEL && prog->counts[i] > 0) {
+            labels[label_count++] = (interp_rank){prog->counts[i], i};
+        }
+    }
+    qsort(labels, label_count, sizeof(interp_rank), interp_by_count);
+    fprintf(out, "%-40s %14s\n", "label", "count");
+    for (size_t i = 0; i < label_count && i < INTERP_REPORT_LABELS; i++) {
+        instr* ins = vec_get(prog->text, labels[i].index);
+        fprintf(out, "%-40s %14" PRIu64 "\n", ins->args[0], labels[i].count);
+    }
+    free(labels);
+}
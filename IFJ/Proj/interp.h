@@ -0,0 +1,103 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Interpreter of IFJcode24 for running and profiling the generated programs.
+
+#ifndef IFJ_PROJEKT_2024_INTERP_H
+#define IFJ_PROJEKT_2024_INTERP_H
+
+#include "instr.h"
+#include "vector.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Exit codes of the interpreter, the same as the reference one uses. A
+// program ended by EXIT returns its own code from 0 to 9.
+typedef enum {
+    RUN_OK = 0,
+    RUN_HEADER_ERR = 21,        // Missing .IFJcode24 header
+    RUN_OPCODE_ERR = 22,        // Unknown instruction
+    RUN_SYNTAX_ERR = 23,        // Malformed operands
+    RUN_SEMANTIC_ERR = 52,      // Undefined label, redefined variable
+    RUN_OPERAND_TYPE_ERR = 53,  // Wrong operand types
+    RUN_VARIABLE_ERR = 54,      // Access to an undefined variable
+    RUN_FRAME_ERR = 55,         // Missing frame
+    RUN_MISSING_VALUE_ERR = 56, // Uninitialized variable, empty stack
+    RUN_OPERAND_VALUE_ERR = 57, // Division by zero, wrong EXIT code
+    RUN_STRING_ERR = 58,        // Index out of the string
+    RUN_INTERNAL_ERR = 99,
+} run_code;
+
+typedef enum {
+    VAL_UNDEF, // Defined variable without a value
+    VAL_NIL,
+    VAL_INT,
+    VAL_FLOAT,
+    VAL_BOOL,
+    VAL_STRING
+} value_type;
+
+// Reference counted string, it may hold any bytes.
+typedef struct {
+    uint32_t refs;
+    uint32_t len;
+    char data[];
+} istr;
+
+typedef struct {
+    uint8_t type; // value_type
+    union {
+        int64_t i;
+        double f;
+        bool b;
+        istr* s;
+    };
+} value;
+
+typedef enum {
+    OPND_NONE,
+    OPND_GF,
+    OPND_LF,
+    OPND_TF,
+    OPND_CONST,
+    OPND_LABEL,
+    OPND_TYPE
+} operand_kind;
+
+// Operand with everything known before the run resolved. 'index' is the
+// number of the variable name, the constant in the pool, the instruction a
+// label stands at or the value_type read by READ. 'slot' is where in its
+// frame the variable was found the last time.
+typedef struct {
+    uint8_t kind; // operand_kind
+    uint32_t index;
+    uint32_t slot;
+} operand;
+
+typedef struct {
+    uint8_t op; // opcode, I_OPCODE_COUNT ends the program
+    operand args[INSTR_MAX_ARGS];
+} interp_instr;
+
+typedef struct {
+    vector* text;        // Instructions as read, for the messages
+    interp_instr* code;  // Decoded instructions followed by the end
+    size_t count;        // Number of instructions without the end
+    value* consts;       // Constant operands
+    size_t const_count;  // Number of constants
+    uint64_t* counts;    // Executions of every instruction
+    uint64_t executed;   // Executed instructions in total
+} interp_program;
+
+run_code interp_load(interp_program* prog, const char* text);
+
+int interp_run(interp_program* prog, FILE* in, FILE* out);
+
+void interp_report(const interp_program* prog, double ms, FILE* out);
+
+void interp_free(interp_program* prog);
+
+#endif // IFJ_PROJEKT_2024_INTERP_H
@@ -0,0 +1,78 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Runs an IFJcode24 program, used to measure the code of the compiler.
+
+#include "interp.h"
+#include "util.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Reads the whole file 'path', returns NULL if it cannot be read.
+char* read_file(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return NULL;
+    }
+    char* text = NULL;
+    long len = -1;
+    if (fseek(f, 0, SEEK_END) == 0 && (len = ftell(f)) >= 0 &&
+        fseek(f, 0, SEEK_SET) == 0) {
+        text = malloc(len + 1);
+    }
+    if (text != NULL && fread(text, 1, len, f) != (size_t)len) {
+        free(text);
+        text = NULL;
+    }
+    if (text != NULL) {
+        text[len] = '\0';
+    }
+    fclose(f);
+    return text;
+}
+
+int main(int argc, char** argv) {
+    // ifjinterp [--profile] <program>
+    // --profile  prints the executions of every instruction and of the most
+    //            executed labels to stderr
+    // The program reads its input from stdin and writes to stdout.
+    bool profile = false;
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (path == NULL && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return RUN_INTERNAL_ERR;
+        }
+    }
+    if (path == NULL) {
+        fprintf(stderr, "Usage: %s [--profile] <program>\n", argv[0]);
+        return RUN_INTERNAL_ERR;
+    }
+
+    char* text = read_file(path);
+    if (text == NULL) {
+        fprintf(stderr, "Cannot read %s\n", path);
+        return RUN_INTERNAL_ERR;
+    }
+    interp_program prog;
+    run_code err = interp_load(&prog, text);
+    free(text);
+    if (err != RUN_OK) {
+        return err;
+    }
+
+    double start = now_ms();
+    int result = interp_run(&prog, stdin, stdout);
+    double ms = now_ms() - start;
+    if (profile) {
+        interp_report(&prog, ms, stderr);
+    }
+    interp_free(&prog);
+    return result;
+}
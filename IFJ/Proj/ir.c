@@ -0,0 +1,1312 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Intermediate representation of the generated functions, basic blocks of
+// instructions over typed virtual registers, and the global optimizations
+// done on it.
+//
+// The IR is built from the code the generator produced from the analysed
+// tree, so the constructs of the language are lowered only once. Every
+// function with a frame of its own is split into basic blocks ending with
+// their branches. The variables of its frame become virtual registers, each
+// with the type joined from all of its definitions. The passes are
+//   - copy propagation: a register holding a copy of another register or of
+//     a constant is read as that register or constant, a copy is available
+//     in a block when it is available at the ends of all its predecessors,
+//   - common subexpression elimination: an expression computed again in a
+//     block is replaced by a copy of the register that still holds it,
+//   - dead store elimination: definitions of registers not live after them
+//     are removed unless they have another effect or may stop the program
+//     with a runtime error, the DEFVARs of unused registers go too, and a
+//     temporary defined only to be copied is defined in place of the copy.
+// A register may be defined several times, the dataflow over the blocks
+// stands in for the renaming to static single assignments, so the
+// registers are lowered back to the frame variables they came from.
+
+#include "ir.h"
+
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+// The passes are repeated until they change nothing or this many times.
+#define IR_ROUNDS 4
+
+// How an instruction uses one of its operands.
+typedef enum {
+    IR_ARG_OTHER,  // Label or type, never a register
+    IR_ARG_READ,   // Read
+    IR_ARG_WRITE,  // Overwritten
+    IR_ARG_UPDATE, // Read and written
+} ir_arg_kind;
+
+const char* const IR_TYPE_STRINGS[] = {"none",   "int", "float", "bool",
+                                       "string", "nil", "any"};
+
+// Returns how the instruction 'op' uses its operand at 'index'.
+ir_arg_kind ir_arg(opcode op, int index) {
+    switch (op) {
+    case I_LABEL:
+    case I_JUMP:
+    case I_CALL:
+    case I_JUMPIFEQS:
+    case I_JUMPIFNEQS:
+        return IR_ARG_OTHER;
+    case I_JUMPIFEQ:
+    case I_JUMPIFNEQ:
+        return index == 0 ? IR_ARG_OTHER : IR_ARG_READ;
+    case I_DEFVAR:
+    case I_POPS:
+        return IR_ARG_WRITE;
+    case I_READ:
+        return index == 0 ? IR_ARG_WRITE : IR_ARG_OTHER;
+    case I_SETCHAR:
+        return index == 0 ? IR_ARG_UPDATE : IR_ARG_READ;
+    case I_PUSHS:
+    case I_WRITE:
+    case I_EXIT:
+    case I_DPRINT:
+        return IR_ARG_READ;
+    default:
+        return index == 0 ? IR_ARG_WRITE : IR_ARG_READ;
+    }
+}
+
+// Returns true if the instruction 'op' ends a basic block.
+bool ir_ends_block(opcode op) {
+    switch (op) {
+    case I_JUMP:
+    case I_JUMPIFEQ:
+    case I_JUMPIFNEQ:
+    case I_JUMPIFEQS:
+    case I_JUMPIFNEQS:
+    case I_RETURN:
+    case I_EXIT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Returns the type of the constant 'arg' or IR_ANY for a variable.
+ir_type ir_const_type(const char* arg) {
+    if (strncmp(arg, "int@", 4) == 0) {
+        return IR_INT;
+    }
+    if (strncmp(arg, "float@", 6) == 0) {
+        return IR_FLOAT;
+    }
+    if (strncmp(arg, "bool@", 5) == 0) {
+        return IR_BOOL;
+    }
+    if (strncmp(arg, "string@", 7) == 0) {
+        return IR_STRING;
+    }
+    if (strncmp(arg, "nil@", 4) == 0) {
+        return IR_NIL;
+    }
+    return IR_ANY;
+}
+
+// FNV-1a hash of 's'.
+uint32_t ir_hash(const char* s) {
+    uint32_t hash = 2166136261u;
+    for (; *s != '\0'; s++) {
+        hash = (hash ^ (unsigned char)*s) * 16777619u;
+    }
+    return hash;
+}
+
+bool ir_map_init(ir_map* map, size_t cap) {
+    map->keys = calloc(cap, sizeof(char*));
+    map->values = malloc(cap * sizeof(int));
+    map->cap = cap;
+    map->count = 0;
+    return map->keys != NULL && map->values != NULL;
+}
+
+void ir_map_free(ir_map* map) {
+    free(map->keys);
+    free(map->values);
+    *map = (ir_map){0};
+}
+
+// Returns the value of 'key' or -1 if it is not in the map.
+int ir_map_find(const ir_map* map, const char* key) {
+    if (map->cap == 0) {
+        return -1;
+    }
+    size_t slot = ir_hash(key) & (map->cap - 1);
+    while (map->keys[slot] != NULL) {
+        if (strcmp(map->keys[slot], key) == 0) {
+            return map->values[slot];
+        }
+        slot = (slot + 1) & (map->cap - 1);
+    }
+    return -1;
+}
+
+// Inserts 'key' missing in the map, the table is kept at most half full.
+bool ir_map_put(ir_map* map, const char* key, int value) {
+    if ((map->count + 1) * 2 > map->cap) {
+        ir_map grown;
+        if (!ir_map_init(&grown, map->cap == 0 ? 64 : map->cap * 2)) {
+            ir_map_free(&grown);
+            return false;
+        }
+        for (size_t i = 0; i < map->cap; i++) {
+            if (map->keys[i] != NULL) {
+                ir_map_put(&grown, map->keys[i], map->values[i]);
+            }
+        }
+        ir_map_free(map);
+        *map = grown;
+    }
+    size_t slot = ir_hash(key) & (map->cap - 1);
+    while (map->keys[slot] != NULL) {
+        slot = (slot + 1) & (map->cap - 1);
+    }
+    map->keys[slot] = key;
+    map->values[slot] = value;
+    map->count++;
+    return true;
+}
+
+// Sets of registers, copies etc. as bit arrays.
+typedef uint64_t ir_word;
+#define IR_WORD_BITS 64
+
+size_t ir_words(size_t bits) {
+    return (bits + IR_WORD_BITS - 1) / IR_WORD_BITS;
+}
+
+bool ir_bit(const ir_word* set, size_t i) {
+    return (set[i / IR_WORD_BITS] >> (i % IR_WORD_BITS)) & 1;
+}
+
+void ir_bit_set(ir_word* set, size_t i) {
+    set[i / IR_WORD_BITS] |= (ir_word)1 << (i % IR_WORD_BITS);
+}
+
+void ir_bit_clear(ir_word* set, size_t i) {
+    set[i / IR_WORD_BITS] &= ~((ir_word)1 << (i % IR_WORD_BITS));
+}
+
+ir_instr* ir_at(ir_function* fn, size_t i) { return vec_at(fn->code, i); }
+
+ir_block* ir_block_at(ir_function* fn, size_t b) {
+    return vec_at(fn->blocks, b);
+}
+
+const char* ir_reg_name(ir_function* fn, int reg) {
+    return *(char**)vec_at(fn->regs, reg);
+}
+
+// Returns the register named by the operand 'arg' or -1 if it names none.
+// The temporary frame is the frame of the function only before
+// PUSHFRAME, 'framed' tells if it was executed already.
+int ir_arg_reg(ir_function* fn, const char* arg, bool framed, bool* ok) {
+    bool local = strncmp(arg, "LF@", 3) == 0;
+    if (!local && (framed || strncmp(arg, "TF@", 3) != 0)) {
+        return -1;
+    }
+    int reg = ir_map_find(&fn->reg_map, arg + 3);
+    if (reg >= 0) {
+        return reg;
+    }
+    char* name = d_string(arg + 3);
+    if (name == NULL || vec_push(fn->regs, &name) == NULL) {
+        free(name);
+        *ok = false;
+        return -1;
+    }
+    reg = (int)fn->regs->len - 1;
+    if (!ir_map_put(&fn->reg_map, name, reg)) {
+        *ok = false;
+        return -1;
+    }
+    return reg;
+}
+
+// Returns the type of the operand 'index' of 'ins'.
+ir_type ir_operand_type(ir_function* fn, ir_instr* ins, int index) {
+    int reg = ins->reg[index];
+    return reg >= 0 ? fn->types[reg] : ir_const_type(ins->ins.args[index]);
+}
+
+// Returns the type of the value 'ins' stores into its first operand. An
+// operand of unknown type gives IR_NONE, so that the types only grow.
+ir_type ir_result_type(ir_function* fn, ir_instr* ins) {
+    ir_type a = ins->ins.argc > 1 ? ir_operand_type(fn, ins, 1) : IR_ANY;
+    ir_type b = ins->ins.argc > 2 ? ir_operand_type(fn, ins, 2) : IR_ANY;
+    switch (ins->ins.op) {
+    case I_MOVE:
+        return a;
+    case I_ADD:
+    case I_SUB:
+    case I_MUL:
+        if (a == IR_NONE || b == IR_NONE) {
+            return IR_NONE;
+        }
+        return a == b && (a == IR_INT || a == IR_FLOAT) ? a : IR_ANY;
+    case I_DIV:
+    case I_INT2FLOAT:
+        return IR_FLOAT;
+    case I_IDIV:
+    case I_FLOAT2INT:
+    case I_STRI2INT:
+    case I_STRLEN:
+        return IR_INT;
+    case I_LT:
+    case I_GT:
+    case I_EQ:
+    case I_AND:
+    case I_OR:
+    case I_NOT:
+        return IR_BOOL;
+    case I_INT2CHAR:
+    case I_CONCAT:
+    case I_GETCHAR:
+    case I_SETCHAR:
+    case I_TYPE:
+        return IR_STRING;
+    default:
+        return IR_ANY;
+    }
+}
+
+ir_type ir_join(ir_type a, ir_type b) {
+    if (a == IR_NONE || a == b) {
+        return b;
+    }
+    return b == IR_NONE ? a : IR_ANY;
+}
+
+// Joins the types of all definitions of every register until they settle.
+bool ir_infer_types(ir_function* fn) {
+    fn->types = calloc(fn->regs->len + 1, sizeof(ir_type));
+    if (fn->types == NULL) {
+        return false;
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < fn->code->len; i++) {
+            ir_instr* ins = ir_at(fn, i);
+            int reg = ins->ins.argc > 0 ? ins->reg[0] : -1;
+            if (reg < 0 || ins->ins.op == I_DEFVAR ||
+                ir_arg(ins->ins.op, 0) == IR_ARG_READ) {
+                continue;
+            }
+            ir_type type = ir_join(fn->types[reg], ir_result_type(fn, ins));
+            if (type != fn->types[reg]) {
+                fn->types[reg] = type;
+                changed = true;
+            }
+        }
+    }
+    return true;
+}
+
+// Splits the code into basic blocks and links them by their branches. A
+// jump out of the function makes it unoptimizable.
+bool ir_build_blocks(ir_function* fn) {
+    size_t count = fn->code->len;
+    for (size_t i = 0; i < count; i++) {
+        ir_instr* ins = ir_at(fn, i);
+        bool leader = i == 0 || ins->ins.op == I_LABEL ||
+                      ir_ends_block(ir_at(fn, i - 1)->ins.op);
+        if (leader) {
+            if (fn->blocks->len > 0) {
+                ir_block_at(fn, fn->blocks->len - 1)->end = i;
+            }
+            ir_block block = {.first = i, .end = count};
+            if (vec_push(fn->blocks, &block) == NULL) {
+                return false;
+            }
+        }
+        if (ins->ins.op == I_LABEL &&
+            !ir_map_put(&fn->label_map, ins->ins.args[0],
+                        (int)fn->blocks->len - 1)) {
+            return false;
+        }
+    }
+
+    for (size_t b = 0; b < fn->blocks->len; b++) {
+        ir_block* block = ir_block_at(fn, b);
+        opcode last = ir_at(fn, block->end - 1)->ins.op;
+        bool jumps = ir_ends_block(last) && last != I_RETURN && last != I_EXIT;
+        if (jumps) {
+            const char* label = ir_at(fn, block->end - 1)->ins.args[0];
+            int target = ir_map_find(&fn->label_map, label);
+            if (target < 0) {
+                fn->optimizable = false;
+            } else {
+                block->succ[block->succ_count++] = target;
+            }
+        }
+        bool falls = last != I_JUMP && last != I_RETURN && last != I_EXIT;
+        if (falls && b + 1 < fn->blocks->len) {
+            block->succ[block->succ_count++] = (int)b + 1;
+        }
+    }
+    return true;
+}
+
+// Checks that the local frame is the frame of the function between its only
+// PUSHFRAME and the POPFRAMEs, the registers cannot be tracked otherwise.
+// Before the PUSHFRAME the registers may be only declared and popped, after
+// a POPFRAME the block must return without touching them.
+bool ir_check_frame(ir_function* fn) {
+    size_t pushes = 0;
+    for (size_t b = 0; b < fn->blocks->len; b++) {
+        ir_block* block = ir_block_at(fn, b);
+        bool popped = false;
+        for (size_t i = block->first; i < block->end; i++) {
+            ir_instr* ins = ir_at(fn, i);
+            if (ins->ins.op == I_PUSHFRAME) {
+                pushes++;
+            } else if (ins->ins.op == I_POPFRAME) {
+                popped = true;
+            }
+            bool declares = ins->ins.op == I_DEFVAR || ins->ins.op == I_POPS;
+            for (int a = 0; a < ins->ins.argc; a++) {
+                bool local = strncmp(ins->ins.args[a], "LF@", 3) == 0;
+                bool temp = strncmp(ins->ins.args[a], "TF@", 3) == 0;
+                if ((pushes == 0 && (local || (temp && !declares))) ||
+                    (popped && (local || temp))) {
+                    return false;
+                }
+            }
+        }
+        opcode last = ir_at(fn, block->end - 1)->ins.op;
+        if (popped && last != I_RETURN && last != I_EXIT) {
+            return false;
+        }
+    }
+    return pushes == 1;
+}
+
+// Builds the IR of the function in the 'count' instructions at 'code',
+// which are taken over by 'fn' also when the building fails.
+error_code ir_build(ir_function* fn, instr* code, size_t count) {
+    *fn = (ir_function){.optimizable = true};
+    fn->code = vec_init(count + 1, sizeof(ir_instr));
+    fn->blocks = vec_init(16, sizeof(ir_block));
+    fn->regs = vec_init(16, sizeof(char*));
+    bool ok = fn->code != NULL && fn->blocks != NULL && fn->regs != NULL;
+    for (size_t i = 0; i < count; i++) {
+        ir_instr ins = {.ins = code[i], .reg = {-1, -1, -1}};
+        if (!ok || vec_push(fn->code, &ins) == NULL) {
+            instr_free(&code[i]);
+            ok = false;
+        }
+    }
+    if (!ok) {
+        return INTERNAL_ERR;
+    }
+
+    bool framed = false;
+    for (size_t i = 0; i < count && ok; i++) {
+        ir_instr* ins = ir_at(fn, i);
+        for (int a = 0; a < ins->ins.argc && ok; a++) {
+            if (ir_arg(ins->ins.op, a) != IR_ARG_OTHER) {
+                ins->reg[a] = ir_arg_reg(fn, ins->ins.args[a], framed, &ok);
+            }
+        }
+        framed = framed || ins->ins.op == I_PUSHFRAME;
+    }
+    if (!ok || !ir_build_blocks(fn) || !ir_infer_types(fn)) {
+        return INTERNAL_ERR;
+    }
+    fn->optimizable = fn->optimizable && ir_check_frame(fn) &&
+                      fn->blocks->len * (fn->regs->len + 1) <= IR_MAX_BITS;
+    return NO_ERR;
+}
+
+void ir_dump_arg(ir_function* fn, ir_instr* ins, int a, FILE* out) {
+    int reg = ins->reg[a];
+    if (reg >= 0) {
+        fprintf(out, " %%%s:%s", ir_reg_name(fn, reg),
+                IR_TYPE_STRINGS[fn->types[reg]]);
+    } else {
+        fprintf(out, " %s", ins->ins.args[a]);
+    }
+}
+
+// Writes the blocks of 'fn' with their successors and its typed registers
+// to 'out'.
+void ir_dump(ir_function* fn, FILE* out) {
+    ir_instr* entry = ir_at(fn, 0);
+    fprintf(out, "function %s: %zu blocks, %zu registers%s\n",
+            entry->ins.argc > 0 ? entry->ins.args[0] : "?", fn->blocks->len,
+            fn->regs->len, fn->optimizable ? "" : ", not optimized");
+    for (size_t b = 0; b < fn->blocks->len; b++) {
+        ir_block* block = ir_block_at(fn, b);
+        fprintf(out, "  block %zu ->", b);
+        for (int s = 0; s < block->succ_count; s++) {
+            fprintf(out, " %d", block->succ[s]);
+        }
+        fputc('\n', out);
+        for (size_t i = block->first; i < block->end; i++) {
+            ir_instr* ins = ir_at(fn, i);
+            if (ins->dead) {
+                continue;
+            }
+            fprintf(out, "    %s", OPCODE_STRINGS[ins->ins.op]);
+            for (int a = 0; a < ins->ins.argc; a++) {
+                ir_dump_arg(fn, ins, a, out);
+            }
+            fputc('\n', out);
+        }
+    }
+}
+
+// Replaces the operand 'a' of 'ins' by the register 'reg' or, when it is
+// -1, by the constant 'text'.
+bool ir_set_arg(ir_function* fn, ir_instr* ins, int a, int reg,
+                const char* text) {
+    char* arg;
+    if (reg >= 0) {
+        const char* name = ir_reg_name(fn, reg);
+        arg = malloc(strlen(name) + 4);
+        if (arg != NULL) {
+            memcpy(arg, "LF@", 3);
+            strcpy(arg + 3, name);
+        }
+    } else {
+        arg = d_string(text);
+    }
+    if (arg == NULL) {
+        return false;
+    }
+    instr_free_arg(ins->ins.args[a]);
+    ins->ins.args[a] = arg;
+    ins->reg[a] = reg;
+    return true;
+}
+
+// Predecessors of the blocks, those of block 'b' are
+// 'list[start[b]]' to 'list[start[b + 1] - 1]'.
+typedef struct {
+    int* start;
+    int* list;
+} ir_preds;
+
+bool ir_preds_init(ir_function* fn, ir_preds* preds) {
+    size_t count = fn->blocks->len;
+    preds->start = calloc(count + 2, sizeof(int));
+    preds->list = malloc((2 * count + 1) * sizeof(int));
+    if (preds->start == NULL || preds->list == NULL) {
+        return false;
+    }
+    for (size_t b = 0; b < count; b++) {
+        ir_block* block = ir_block_at(fn, b);
+        for (int s = 0; s < block->succ_count; s++) {
+            preds->start[block->succ[s] + 2]++;
+        }
+    }
+    for (size_t b = 0; b < count; b++) {
+        preds->start[b + 2] += preds->start[b + 1];
+    }
+    for (size_t b = 0; b < count; b++) {
+        ir_block* block = ir_block_at(fn, b);
+        for (int s = 0; s < block->succ_count; s++) {
+            preds->list[preds->start[block->succ[s] + 1]++] = (int)b;
+        }
+    }
+    return true;
+}
+
+void ir_preds_free(ir_preds* preds) {
+    free(preds->start);
+    free(preds->list);
+}
+
+// Copies 'MOVE dst src' of a function. Those touching register 'r' as
+// either of their operands are 'touch[touch_start[r]]' up to
+// 'touch[touch_start[r + 1] - 1]'.
+typedef struct {
+    size_t count;
+    int* dst;
+    int* src;            // Register copied or -1 for a constant
+    char** text;         // The constant
+    int* of_instr;       // Copy made by each instruction or -1
+    int* touch_start;
+    int* touch;
+} ir_copies;
+
+void ir_copies_free(ir_copies* copies) {
+    for (size_t c = 0; c < copies->count; c++) {
+        free(copies->text[c]);
+    }
+    free(copies->dst);
+    free(copies->src);
+    free(copies->text);
+    free(copies->of_instr);
+    free(copies->touch_start);
+    free(copies->touch);
+}
+
+// Returns true if 'ins' copies a register or a constant to another
+// register.
+bool ir_is_copy(ir_instr* ins) {
+    return !ins->dead && ins->ins.op == I_MOVE && ins->reg[0] >= 0 &&
+           ins->reg[1] != ins->reg[0] &&
+           (ins->reg[1] >= 0 || ir_const_type(ins->ins.args[1]) != IR_ANY);
+}
+
+bool ir_copies_init(ir_function* fn, ir_copies* copies) {
+    size_t regs = fn->regs->len;
+    *copies = (ir_copies){0};
+    for (size_t i = 0; i < fn->code->len; i++) {
+        copies->count += ir_is_copy(ir_at(fn, i));
+    }
+    size_t n = copies->count + 1;
+    copies->dst = malloc(n * sizeof(int));
+    copies->src = malloc(n * sizeof(int));
+    copies->text = calloc(n, sizeof(char*));
+    copies->of_instr = malloc((fn->code->len + 1) * sizeof(int));
+    copies->touch_start = calloc(regs + 2, sizeof(int));
+    copies->touch = malloc(2 * n * sizeof(int));
+    if (copies->dst == NULL || copies->src == NULL || copies->text == NULL ||
+        copies->of_instr == NULL || copies->touch_start == NULL ||
+        copies->touch == NULL) {
+        copies->count = 0;
+        return false;
+    }
+
+    size_t c = 0;
+    for (size_t i = 0; i < fn->code->len; i++) {
+        ir_instr* ins = ir_at(fn, i);
+        copies->of_instr[i] = -1;
+        if (!ir_is_copy(ins)) {
+            continue;
+        }
+        copies->of_instr[i] = (int)c;
+        copies->dst[c] = ins->reg[0];
+        copies->src[c] = ins->reg[1];
+        if (ins->reg[1] < 0) {
+            copies->text[c] = d_string(ins->ins.args[1]);
+            if (copies->text[c] == NULL) {
+                copies->count = c;
+                return false;
+            }
+        }
+        copies->touch_start[ins->reg[0] + 2]++;
+        if (ins->reg[1] >= 0) {
+            copies->touch_start[ins->reg[1] + 2]++;
+        }
+        c++;
+    }
+    for (size_t r = 0; r < regs; r++) {
+        copies->touch_start[r + 2] += copies->touch_start[r + 1];
+    }
+    for (c = 0; c < copies->count; c++) {
+        copies->touch[copies->touch_start[copies->dst[c] + 1]++] = (int)c;
+        if (copies->src[c] >= 0) {
+            copies->touch[copies->touch_start[copies->src[c] + 1]++] = (int)c;
+        }
+    }
+    return true;
+}
+
+// Available copies, 'count' is the number of the bits set.
+typedef struct {
+    ir_word* bits;
+    size_t words;
+    size_t count;
+} ir_copy_set;
+
+// Removes the copies involving the register 'reg' from 'set', walking
+// either the copies of the register or those in the set, whichever is
+// shorter.
+void ir_copies_kill(ir_copies* copies, int reg, ir_copy_set* set) {
+    int first = copies->touch_start[reg];
+    int last = copies->touch_start[reg + 1];
+    if ((size_t)(last - first) <= set->count) {
+        for (int t = first; t < last; t++) {
+            if (ir_bit(set->bits, copies->touch[t])) {
+                ir_bit_clear(set->bits, copies->touch[t]);
+                set->count--;
+            }
+        }
+        return;
+    }
+    for (size_t w = 0; w < set->words && set->count > 0; w++) {
+        for (ir_word word = set->bits[w]; word != 0; word &= word - 1) {
+            size_t c = w * IR_WORD_BITS + __builtin_ctzll(word);
+            if (copies->dst[c] == reg || copies->src[c] == reg) {
+                ir_bit_clear(set->bits, c);
+                set->count--;
+            }
+        }
+    }
+}
+
+// Returns the copy into the register 'reg' available in 'set' or -1 if
+// there is none.
+int ir_copies_find(ir_copies* copies, int reg, ir_copy_set* set) {
+    int first = copies->touch_start[reg];
+    int last = copies->touch_start[reg + 1];
+    if ((size_t)(last - first) <= set->count) {
+        for (int t = first; t < last; t++) {
+            int c = copies->touch[t];
+            if (copies->dst[c] == reg && ir_bit(set->bits, c)) {
+                return c;
+            }
+        }
+        return -1;
+    }
+    for (size_t w = 0; w < set->words; w++) {
+        for (ir_word word = set->bits[w]; word != 0; word &= word - 1) {
+            size_t c = w * IR_WORD_BITS + __builtin_ctzll(word);
+            if (copies->dst[c] == reg) {
+                return (int)c;
+            }
+        }
+    }
+    return -1;
+}
+
+// Updates the available copies 'set' by the instruction 'i'. The registers
+// it writes are added to 'written' unless it is NULL.
+void ir_copies_transfer(ir_function* fn, ir_copies* copies, size_t i,
+                        ir_copy_set* set, ir_word* written) {
+    ir_instr* ins = ir_at(fn, i);
+    if (ins->dead) {
+        return;
+    }
+    for (int a = 0; a < ins->ins.argc; a++) {
+        ir_arg_kind kind = ir_arg(ins->ins.op, a);
+        int reg = ins->reg[a];
+        if (reg < 0 || (kind != IR_ARG_WRITE && kind != IR_ARG_UPDATE)) {
+            continue;
+        }
+        ir_copies_kill(copies, reg, set);
+        if (written != NULL) {
+            ir_bit_set(written, reg);
+        }
+    }
+    int c = copies->of_instr[i];
+    if (c >= 0 && !ir_bit(set->bits, c)) {
+        ir_bit_set(set->bits, c);
+        set->count++;
+    }
+}
+
+// Returns the number of the bits set in the 'words' words of 'bits'.
+size_t ir_count_bits(const ir_word* bits, size_t words) {
+    size_t count = 0;
+    for (size_t w = 0; w < words; w++) {
+        count += (size_t)__builtin_popcountll(bits[w]);
+    }
+    return count;
+}
+
+// Replaces the read registers by the values they are copies of.
+error_code ir_propagate_copies(ir_function* fn, ir_stats* stats) {
+    size_t blocks = fn->blocks->len;
+    ir_copies copies;
+    ir_preds preds = {0};
+    bool ok = ir_copies_init(fn, &copies) && ir_preds_init(fn, &preds);
+    size_t words = ir_words(copies.count);
+    size_t reg_words = ir_words(fn->regs->len);
+    if (!ok || copies.count == 0 ||
+        blocks * words * IR_WORD_BITS > IR_MAX_BITS) {
+        ir_copies_free(&copies);
+        ir_preds_free(&preds);
+        return ok ? NO_ERR : INTERNAL_ERR;
+    }
+
+    size_t size = blocks * words * sizeof(ir_word);
+    ir_word* in = malloc(size);
+    ir_word* out = malloc(size);
+    ir_word* gen = calloc(blocks * words, sizeof(ir_word));
+    ir_word* written = calloc(blocks * reg_words + 1, sizeof(ir_word));
+    ir_copy_set set = {.bits = malloc(words * sizeof(ir_word)),
+                       .words = words};
+    if (in == NULL || out == NULL || gen == NULL || written == NULL ||
+        set.bits == NULL) {
+        ok = false;
+        blocks = 0;
+    }
+
+    // The copies made by every block and the registers it writes, a copy
+    // is available after the block if it is made there or is available
+    // before it and none of its registers is written.
+    for (size_t b = 0; b < blocks; b++) {
+        ir_block* block = ir_block_at(fn, b);
+        ir_copy_set b_gen = {.bits = gen + b * words, .words = words};
+        for (size_t i = block->first; i < block->end; i++) {
+            ir_copies_transfer(fn, &copies, i, &b_gen,
+                               written + b * reg_words);
+        }
+    }
+
+    // Everything is available until shown otherwise, except at the entry.
+    if (ok) {
+        memset(out, 0xff, size);
+    }
+    bool changed = ok;
+    while (changed) {
+        changed = false;
+        for (size_t b = 0; b < blocks; b++) {
+            ir_word* b_in = in + b * words;
+            if (b == 0 || preds.start[b] == preds.start[b + 1]) {
+                memset(b_in, 0, words * sizeof(ir_word));
+            } else {
+                memset(b_in, 0xff, words * sizeof(ir_word));
+                for (int p = preds.start[b]; p < preds.start[b + 1]; p++) {
+                    ir_word* p_out = out + preds.list[p] * words;
+                    for (size_t w = 0; w < words; w++) {
+                        b_in[w] &= p_out[w];
+                    }
+                }
+            }
+            ir_word* b_out = out + b * words;
+            ir_word* b_gen = gen + b * words;
+            ir_word* b_written = written + b * reg_words;
+            for (size_t w = 0; w < words; w++) {
+                ir_word word = b_in[w];
+                for (ir_word rest = word; rest != 0; rest &= rest - 1) {
+                    size_t c = w * IR_WORD_BITS + __builtin_ctzll(rest);
+                    if (ir_bit(b_written, copies.dst[c]) ||
+                        (copies.src[c] >= 0 &&
+                         ir_bit(b_written, copies.src[c]))) {
+                        word &= ~((ir_word)1 << (c % IR_WORD_BITS));
+                    }
+                }
+                word |= b_gen[w];
+                changed = changed || word != b_out[w];
+                b_out[w] = word;
+            }
+        }
+    }
+
+    for (size_t b = 0; b < blocks && ok; b++) {
+        ir_block* block = ir_block_at(fn, b);
+        memcpy(set.bits, in + b * words, words * sizeof(ir_word));
+        set.count = ir_count_bits(set.bits, words);
+        for (size_t i = block->first; i < block->end && ok; i++) {
+            ir_instr* ins = ir_at(fn, i);
+            for (int a = 0; a < ins->ins.argc && !ins->dead; a++) {
+                int reg = ins->reg[a];
+                if (reg < 0 || ir_arg(ins->ins.op, a) != IR_ARG_READ) {
+                    continue;
+                }
+                int c = ir_copies_find(&copies, reg, &set);
+                if (c >= 0) {
+                    ok = ok && ir_set_arg(fn, ins, a, copies.src[c],
+                                          copies.text[c]);
+                    stats->copies++;
+                }
+            }
+            ir_copies_transfer(fn, &copies, i, &set, NULL);
+        }
+    }
+
+    free(in);
+    free(out);
+    free(gen);
+    free(written);
+    free(set.bits);
+    ir_copies_free(&copies);
+    ir_preds_free(&preds);
+    return ok ? NO_ERR : INTERNAL_ERR;
+}
+
+// Returns true if 'op' computes its result only from its operands.
+bool ir_is_pure(opcode op) {
+    switch (op) {
+    case I_ADD:
+    case I_SUB:
+    case I_MUL:
+    case I_DIV:
+    case I_IDIV:
+    case I_LT:
+    case I_GT:
+    case I_EQ:
+    case I_AND:
+    case I_OR:
+    case I_NOT:
+    case I_INT2FLOAT:
+    case I_FLOAT2INT:
+    case I_INT2CHAR:
+    case I_STRI2INT:
+    case I_CONCAT:
+    case I_STRLEN:
+    case I_GETCHAR:
+    case I_TYPE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool ir_is_commutative(opcode op) {
+    return op == I_ADD || op == I_MUL || op == I_EQ || op == I_AND ||
+           op == I_OR;
+}
+
+// Returns true if 'a' computes the same value as 'b' did.
+bool ir_same_expr(ir_instr* a, ir_instr* b) {
+    if (a->ins.op != b->ins.op || a->ins.argc != b->ins.argc) {
+        return false;
+    }
+    bool same = true;
+    for (int i = 1; i < a->ins.argc; i++) {
+        same = same && strcmp(a->ins.args[i], b->ins.args[i]) == 0;
+    }
+    if (!same && a->ins.argc == 3 && ir_is_commutative(a->ins.op)) {
+        same = strcmp(a->ins.args[1], b->ins.args[2]) == 0 &&
+               strcmp(a->ins.args[2], b->ins.args[1]) == 0;
+    }
+    return same;
+}
+
+// Returns true if 'ins' reads the register 'reg'.
+bool ir_reads_reg(ir_instr* ins, int reg) {
+    for (int a = 0; a < ins->ins.argc; a++) {
+        ir_arg_kind kind = ir_arg(ins->ins.op, a);
+        if (ins->reg[a] == reg &&
+            (kind == IR_ARG_READ || kind == IR_ARG_UPDATE)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns true if 'ins' reads or writes the register 'reg'.
+bool ir_uses_reg(ir_instr* ins, int reg) {
+    for (int a = 0; a < ins->ins.argc; a++) {
+        if (ins->reg[a] == reg) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Replaces expressions computed again in a block by a copy of the register
+// holding their earlier result.
+error_code ir_eliminate_common(ir_function* fn, ir_stats* stats) {
+    // Instructions whose results are still held by their registers
+    vector* avail = vec_init(16, sizeof(size_t));
+    if (avail == NULL) {
+        return INTERNAL_ERR;
+    }
+    for (size_t b = 0; b < fn->blocks->len; b++) {
+        ir_block* block = ir_block_at(fn, b);
+        vec_clear(avail);
+        for (size_t i = block->first; i < block->end; i++) {
+            ir_instr* ins = ir_at(fn, i);
+            if (ins->dead) {
+                continue;
+            }
+            bool candidate = ir_is_pure(ins->ins.op) && ins->reg[0] >= 0;
+            for (int a = 1; a < ins->ins.argc && candidate; a++) {
+                candidate = ins->reg[a] >= 0 ||
+                            ir_const_type(ins->ins.args[a]) != IR_ANY;
+            }
+
+            if (candidate) {
+                for (size_t e = 0; e < avail->len; e++) {
+                    ir_instr* prev = ir_at(fn, *(size_t*)vec_at(avail, e));
+                    if (!ir_same_expr(ins, prev)) {
+                        continue;
+                    }
+                    for (int a = 2; a < ins->ins.argc; a++) {
+                        instr_free_arg(ins->ins.args[a]);
+                        ins->ins.args[a] = NULL;
+                        ins->reg[a] = -1;
+                    }
+                    ins->ins.op = I_MOVE;
+                    ins->ins.argc = 2;
+                    if (!ir_set_arg(fn, ins, 1, prev->reg[0], NULL)) {
+                        vec_free(&avail);
+                        return INTERNAL_ERR;
+                    }
+                    stats->reused++;
+                    candidate = false;
+                    break;
+                }
+            }
+
+            // The registers written here no longer hold what they did.
+            for (int a = 0; a < ins->ins.argc; a++) {
+                ir_arg_kind kind = ir_arg(ins->ins.op, a);
+                int reg = ins->reg[a];
+                if (reg < 0 ||
+                    (kind != IR_ARG_WRITE && kind != IR_ARG_UPDATE)) {
+                    continue;
+                }
+                for (size_t e = avail->len; e-- > 0;) {
+                    ir_instr* prev = ir_at(fn, *(size_t*)vec_at(avail, e));
+                    if (ir_uses_reg(prev, reg)) {
+                        vec_remove(avail, e);
+                    }
+                }
+            }
+            if (ins->ins.op == I_POPFRAME) {
+                vec_clear(avail);
+            }
+            if (candidate && !ir_reads_reg(ins, ins->reg[0]) &&
+                vec_push(avail, &i) == NULL) {
+                vec_free(&avail);
+                return INTERNAL_ERR;
+            }
+        }
+    }
+    vec_free(&avail);
+    return NO_ERR;
+}
+
+// Returns true if 'ins' has no effect besides its result and cannot stop
+// the program with an error, given the types of its operands.
+bool ir_is_removable(ir_function* fn, ir_instr* ins) {
+    int argc = ins->ins.argc;
+    ir_type a = argc > 1 ? ir_operand_type(fn, ins, 1) : IR_NONE;
+    ir_type b = argc > 2 ? ir_operand_type(fn, ins, 2) : IR_NONE;
+    bool typed = a != IR_NONE && a != IR_ANY;
+    switch (ins->ins.op) {
+    case I_MOVE:
+    case I_TYPE:
+        return true;
+    case I_ADD:
+    case I_SUB:
+    case I_MUL:
+        return a == b && (a == IR_INT || a == IR_FLOAT);
+    case I_LT:
+    case I_GT:
+        return a == b && typed && a != IR_NIL;
+    case I_EQ:
+        return (a == b && typed) || (a == IR_NIL && b != IR_NONE) ||
+               (b == IR_NIL && a != IR_NONE);
+    case I_AND:
+    case I_OR:
+        return a == IR_BOOL && b == IR_BOOL;
+    case I_NOT:
+        return a == IR_BOOL;
+    case I_INT2FLOAT:
+        return a == IR_INT;
+    case I_CONCAT:
+        return a == IR_STRING && b == IR_STRING;
+    case I_STRLEN:
+        return a == IR_STRING;
+    case I_DIV:
+    case I_IDIV:
+        // Only a constant divisor is surely not zero.
+        return a == (ins->ins.op == I_DIV ? IR_FLOAT : IR_INT) && a == b &&
+               ins->reg[2] < 0 && strcmp(ins->ins.args[2], "int@0") != 0 &&
+               strcmp(ins->ins.args[2], "float@0x0p+0") != 0 &&
+               strcmp(ins->ins.args[2], "float@-0x0p+0") != 0;
+    default:
+        return false;
+    }
+}
+
+// Updates the registers 'live' before the instruction 'ins' from those
+// live after it.
+void ir_live_transfer(ir_instr* ins, ir_word* live, size_t words) {
+    if (ins->dead) {
+        return;
+    }
+    // Nothing of the frame of the function is read after it is popped.
+    if (ins->ins.op == I_POPFRAME) {
+        memset(live, 0, words * sizeof(ir_word));
+    }
+    for (int a = 0; a < ins->ins.argc; a++) {
+        if (ins->reg[a] >= 0 && ir_arg(ins->ins.op, a) == IR_ARG_WRITE) {
+            ir_bit_clear(live, ins->reg[a]);
+        }
+    }
+    for (int a = 0; a < ins->ins.argc; a++) {
+        ir_arg_kind kind = ir_arg(ins->ins.op, a);
+        if (ins->reg[a] >= 0 &&
+            (kind == IR_ARG_READ || kind == IR_ARG_UPDATE)) {
+            ir_bit_set(live, ins->reg[a]);
+        }
+    }
+}
+
+// Computes the registers live at the start of every block into 'live_in'.
+void ir_liveness(ir_function* fn, ir_word* live_in, ir_word* live,
+                 size_t words) {
+    size_t blocks = fn->blocks->len;
+    memset(live_in, 0, blocks * words * sizeof(ir_word));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = blocks; b-- > 0;) {
+            ir_block* block = ir_block_at(fn, b);
+            memset(live, 0, words * sizeof(ir_word));
+            for (int s = 0; s < block->succ_count; s++) {
+                ir_word* s_in = live_in + block->succ[s] * words;
+                for (size_t w = 0; w < words; w++) {
+                    live[w] |= s_in[w];
+                }
+            }
+            for (size_t i = block->end; i-- > block->first;) {
+                ir_live_transfer(ir_at(fn, i), live, words);
+            }
+            if (memcmp(live, live_in + b * words, words * sizeof(ir_word)) !=
+                0) {
+                memcpy(live_in + b * words, live, words * sizeof(ir_word));
+                changed = true;
+            }
+        }
+    }
+}
+
+// Returns the last instruction before 'i' in its block not removed yet or
+// NULL if there is none.
+ir_instr* ir_prev_live(ir_function* fn, ir_block* block, size_t i) {
+    while (i-- > block->first) {
+        ir_instr* ins = ir_at(fn, i);
+        if (!ins->dead) {
+            return ins;
+        }
+    }
+    return NULL;
+}
+
+// Removes the definitions of registers never read afterwards and the
+// copies of registers to themselves. The copy 'MOVE x r' of a register 'r'
+// dead after it is merged into the instruction right before it defining
+// 'r', which then defines 'x' itself.
+error_code ir_eliminate_dead(ir_function* fn, ir_stats* stats) {
+    size_t blocks = fn->blocks->len;
+    size_t words = ir_words(fn->regs->len);
+    ir_word* live_in = malloc((blocks * words + 1) * sizeof(ir_word));
+    ir_word* live = malloc((words + 1) * sizeof(ir_word));
+    if (live_in == NULL || live == NULL) {
+        free(live_in);
+        free(live);
+        return INTERNAL_ERR;
+    }
+
+    bool removed = true;
+    while (removed) {
+        removed = false;
+        ir_liveness(fn, live_in, live, words);
+        for (size_t b = 0; b < blocks; b++) {
+            ir_block* block = ir_block_at(fn, b);
+            memset(live, 0, words * sizeof(ir_word));
+            for (int s = 0; s < block->succ_count; s++) {
+                ir_word* s_in = live_in + block->succ[s] * words;
+                for (size_t w = 0; w < words; w++) {
+                    live[w] |= s_in[w];
+                }
+            }
+            for (size_t i = block->end; i-- > block->first;) {
+                ir_instr* ins = ir_at(fn, i);
+                int dst = ins->ins.argc > 0 ? ins->reg[0] : -1;
+                bool self_move = ins->ins.op == I_MOVE && dst >= 0 &&
+                                 ins->reg[1] == dst;
+                bool dead_def = dst >= 0 && ins->ins.op != I_DEFVAR &&
+                                ir_arg(ins->ins.op, 0) == IR_ARG_WRITE &&
+                                !ir_bit(live, dst) && ir_is_removable(fn, ins);
+                if (!ins->dead && (self_move || dead_def)) {
+                    ins->dead = true;
+                    stats->removed++;
+                    removed = true;
+                } else if (!ins->dead && ins->ins.op == I_MOVE && dst >= 0 &&
+                           ins->reg[1] >= 0 && !ir_bit(live, ins->reg[1])) {
+                    ir_instr* def = ir_prev_live(fn, block, i);
+                    if (def != NULL && def->ins.op != I_DEFVAR &&
+                        def->ins.argc > 0 && def->reg[0] == ins->reg[1] &&
+                        ir_arg(def->ins.op, 0) == IR_ARG_WRITE) {
+                        if (!ir_set_arg(fn, def, 0, dst, NULL)) {
+                            free(live_in);
+                            free(live);
+                            return INTERNAL_ERR;
+                        }
+                        ins->dead = true;
+                        stats->removed++;
+                        removed = true;
+                    }
+                }
+                ir_live_transfer(ins, live, words);
+            }
+        }
+    }
+
+    // Registers left without any use need no declaration.
+    memset(live, 0, words * sizeof(ir_word));
+    for (size_t i = 0; i < fn->code->len; i++) {
+        ir_instr* ins = ir_at(fn, i);
+        for (int a = 0; a < ins->ins.argc && !ins->dead; a++) {
+            if (ins->reg[a] >= 0 && ins->ins.op != I_DEFVAR) {
+                ir_bit_set(live, ins->reg[a]);
+            }
+        }
+    }
+    for (size_t i = 0; i < fn->code->len; i++) {
+        ir_instr* ins = ir_at(fn, i);
+        if (!ins->dead && ins->ins.op == I_DEFVAR && ins->reg[0] >= 0 &&
+            !ir_bit(live, ins->reg[0])) {
+            ins->dead = true;
+            stats->removed++;
+        }
+    }
+
+    free(live_in);
+    free(live);
+    return NO_ERR;
+}
+
+// Moves the instructions left by the passes to 'out' and frees the removed
+// ones, the function keeps no instructions afterwards.
+bool ir_lower(ir_function* fn, vector* out) {
+    bool ok = true;
+    for (size_t i = 0; i < fn->code->len; i++) {
+        ir_instr* ins = ir_at(fn, i);
+        if (ins->dead || !ok || vec_push(out, &ins->ins) == NULL) {
+            ok = ok && ins->dead;
+            instr_free(&ins->ins);
+        }
+    }
+    fn->code->len = 0;
+    return ok;
+}
+
+void ir_free(ir_function* fn) {
+    if (fn->code != NULL) {
+        for (size_t i = 0; i < fn->code->len; i++) {
+            instr_free(&((ir_instr*)vec_at(fn->code, i))->ins);
+        }
+        vec_free(&fn->code);
+    }
+    if (fn->regs != NULL) {
+        for (size_t r = 0; r < fn->regs->len; r++) {
+            free(*(char**)vec_at(fn->regs, r));
+        }
+        vec_free(&fn->regs);
+    }
+    if (fn->blocks != NULL) {
+        vec_free(&fn->blocks);
+    }
+    free(fn->types);
+    ir_map_free(&fn->reg_map);
+    ir_map_free(&fn->label_map);
+    *fn = (ir_function){0};
+}
+
+// Runs the passes over 'fn' until they stop finding anything.
+error_code ir_optimize_function(ir_function* fn, ir_stats* stats) {
+    stats->functions++;
+    for (int round = 0; round < IR_ROUNDS; round++) {
+        size_t done = stats->copies + stats->reused + stats->removed;
+        error_code err = ir_propagate_copies(fn, stats);
+        if (err == NO_ERR) {
+            err = ir_eliminate_common(fn, stats);
+        }
+        if (err == NO_ERR) {
+            err = ir_eliminate_dead(fn, stats);
+        }
+        if (err != NO_ERR) {
+            return err;
+        }
+        if (stats->copies + stats->reused + stats->removed == done) {
+            break;
+        }
+    }
+    return NO_ERR;
+}
+
+// Collects the indices of the labels of 'list' that are called, the
+// entries of the functions, into 'entries' in their order.
+error_code ir_find_entries(vector* list, vector* entries) {
+    ir_map called = {0};
+    error_code err = NO_ERR;
+    for (size_t i = 0; i < list->len && err == NO_ERR; i++) {
+        instr* ins = vec_at(list, i);
+        if (ins->op == I_CALL && ir_map_find(&called, ins->args[0]) < 0 &&
+            !ir_map_put(&called, ins->args[0], 0)) {
+            err = INTERNAL_ERR;
+        }
+    }
+    for (size_t i = 0; i < list->len && err == NO_ERR; i++) {
+        instr* ins = vec_at(list, i);
+        if (ins->op == I_LABEL && ir_map_find(&called, ins->args[0]) >= 0 &&
+            vec_push(entries, &i) == NULL) {
+            err = INTERNAL_ERR;
+        }
+    }
+    ir_map_free(&called);
+    return err;
+}
+
+// Builds the IR of every function of 'list', optimizes it and lowers it
+// back into 'list'. The code before the first function is kept as it is.
+// The IR of every function is written to 'dump' if it is not NULL.
+error_code ir_optimize(vector* list, ir_stats* stats, FILE* dump) {
+    assert(list != NULL);
+    stats->before = list->len;
+
+    vector* entries = vec_init(16, sizeof(size_t));
+    vector* out = instr_list_init();
+    error_code err = entries == NULL || out == NULL
+                         ? INTERNAL_ERR
+                         : ir_find_entries(list, entries);
+
+    // Instructions up to 'next' are owned by 'out' or freed.
+    size_t next = 0;
+    if (err == NO_ERR && entries->len > 0) {
+        size_t prolog = *(size_t*)vec_at(entries, 0);
+        if (prolog > 0 && vec_push_n(out, vec_get(list, 0), prolog) == NULL) {
+            err = INTERNAL_ERR;
+        } else {
+            next = prolog;
+        }
+    }
+    for (size_t f = 0; err == NO_ERR && f < entries->len; f++) {
+        size_t end =
+            f + 1 < entries->len ? *(size_t*)vec_at(entries, f + 1) : list->len;
+        ir_function fn;
+        err = ir_build(&fn, vec_get(list, next), end - next);
+        next = end;
+        if (err == NO_ERR && fn.optimizable) {
+            err = ir_optimize_function(&fn, stats);
+        }
+        if (err == NO_ERR && dump != NULL) {
+            ir_dump(&fn, dump);
+        }
+        if (err == NO_ERR && !ir_lower(&fn, out)) {
+            err = INTERNAL_ERR;
+        }
+        ir_free(&fn);
+    }
+    if (entries != NULL) {
+        vec_free(&entries);
+    }
+
+    if (err != NO_ERR) {
+        for (size_t i = next; i < list->len; i++) {
+            instr_free(vec_get(list, i));
+        }
+        list->len = 0;
+        if (out != NULL) {
+            instr_list_free(&out);
+        }
+        return err;
+    }
+    // Without any function the list stays as it was.
+    if (next == 0) {
+        instr_list_free(&out);
+        stats->after = list->len;
+        return NO_ERR;
+    }
+
+    // Move the result back, the operands were taken over by 'out'.
+    vec_clear(list);
+    if (out->len > 0 && vec_push_n(list, vec_get(out, 0), out->len) == NULL) {
+        instr_list_free(&out);
+        return INTERNAL_ERR;
+    }
+    vec_free(&out);
+    stats->after = list->len;
+    return NO_ERR;
+}
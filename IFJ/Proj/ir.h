@@ -0,0 +1,96 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Intermediate representation of the generated functions, basic blocks of
+// instructions over typed virtual registers, and the global optimizations
+// done on it.
+
+#ifndef IFJ_PROJEKT_2024_IR_H
+#define IFJ_PROJEKT_2024_IR_H
+
+#include "error.h"
+#include "instr.h"
+#include "vector.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Functions whose dataflow sets would take more bits are left as they are.
+#define IR_MAX_BITS ((size_t)1 << 26)
+
+// Type of a register joined from all of its definitions. IR_NONE is a
+// register without a known definition yet, IR_ANY one of several types.
+typedef enum {
+    IR_NONE,
+    IR_INT,
+    IR_FLOAT,
+    IR_BOOL,
+    IR_STRING,
+    IR_NIL,
+    IR_ANY,
+} ir_type;
+
+extern const char* const IR_TYPE_STRINGS[];
+
+// Instruction of the IR, the operands naming a register are marked.
+typedef struct {
+    instr ins;
+    int reg[INSTR_MAX_ARGS]; // Register of every operand or -1
+    bool dead;               // Removed by a pass, dropped when lowering
+} ir_instr;
+
+// Basic block, a range of the instructions entered only at its start.
+typedef struct {
+    size_t first;    // First instruction
+    size_t end;      // One past the last instruction
+    int succ[2];     // Blocks the control may continue to
+    int succ_count;
+} ir_block;
+
+// Open addressing map from strings to indices, the keys are not owned.
+typedef struct {
+    const char** keys;
+    int* values;
+    size_t cap;
+    size_t count;
+} ir_map;
+
+// One function of the program.
+typedef struct {
+    vector* code;    // ir_instr
+    vector* blocks;  // ir_block
+    vector* regs;    // char*, names of the registers without the frame
+    ir_type* types;  // Type of every register
+    ir_map reg_map;  // Register names to their indices
+    ir_map label_map; // Labels to the blocks starting with them
+    bool optimizable; // The function fits what the passes expect
+} ir_function;
+
+// Counters describing what the passes did.
+typedef struct {
+    size_t functions; // Functions the passes ran on
+    size_t copies;    // Operands replaced by the copied value
+    size_t reused;    // Expressions replaced by an earlier result
+    size_t removed;   // Dead instructions removed
+    size_t before;    // Instructions before the passes
+    size_t after;     // Instructions after the passes
+} ir_stats;
+
+error_code ir_build(ir_function* fn, instr* code, size_t count);
+
+void ir_dump(ir_function* fn, FILE* out);
+
+error_code ir_propagate_copies(ir_function* fn, ir_stats* stats);
+
+error_code ir_eliminate_common(ir_function* fn, ir_stats* stats);
+
+error_code ir_eliminate_dead(ir_function* fn, ir_stats* stats);
+
+bool ir_lower(ir_function* fn, vector* out);
+
+void ir_free(ir_function* fn);
+
+error_code ir_optimize(vector* list, ir_stats* stats, FILE* dump);
+
+#endif // IFJ_PROJEKT_2024_IR_H
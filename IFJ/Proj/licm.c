@@ -0,0 +1,384 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Loop-invariant code motion over the analysed AST.
+//
+// Expressions inside a loop that read only variables not written by the loop
+// are computed once into a new constant defined right before the loop
+// statement, the loop then reads the constant. Only expressions that have no
+// side effects and cannot stop the interpreter are moved, the hoisted value is
+// computed even when the loop body never runs. The loop itself and its labels
+// stay untouched, so break and continue jump exactly where they used to.
+//
+// Inner loops are processed first. Constants hoisted out of an inner loop are
+// moved further out when their value does not depend on the outer loop either.
+
+#include "licm.h"
+#include "data_types.h"
+#include "util.h"
+#include "vector.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Builtins without side effects that always succeed.
+const char* const LICM_PURE_BUILTINS[] = {
+    "ifj.length", "ifj.concat", "ifj.substring", "ifj.strcmp",
+    "ifj.ord",    "ifj.i2f",    "ifj.string",
+};
+
+#define LICM_PURE_COUNT                                                        \
+    (sizeof(LICM_PURE_BUILTINS) / sizeof(LICM_PURE_BUILTINS[0]))
+
+// State shared by the whole pass.
+typedef struct {
+    int next_id; // Number of the next hoisted constant
+    licm_stats* stats;
+} licm_ctx;
+
+// Returns true if the nodes 'a' and 'b' name the same variable.
+bool licm_same_var(node* a, node* b) {
+    const char* scope_a = a->data.scope_id != NULL ? a->data.scope_id : "";
+    const char* scope_b = b->data.scope_id != NULL ? b->data.scope_id : "";
+    return strcmp(a->data.id_name, b->data.id_name) == 0 &&
+           strcmp(scope_a, scope_b) == 0;
+}
+
+// Collects the nodes of 'n' writing into a variable into 'written'.
+bool licm_collect_writes(node* n, vector* written) {
+    switch (n->data.type) {
+    case ASSIGN:
+    case VAR_DEF:
+    case CONST_DEF:
+    case NULL_COND:
+        if (vec_push(written, &n) == NULL) {
+            return false;
+        }
+        break;
+    default:
+        break;
+    }
+    for (int i = 0; i < n->child_count; i++) {
+        if (!licm_collect_writes(n->children[i], written)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if the variable 'var' is written by one of 'written'.
+bool licm_is_written(vector* written, node* var) {
+    for (size_t i = 0; i < written->len; i++) {
+        node* w = *(node**)vec_get(written, i);
+        if (licm_same_var(w, var)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns true if 'f' calls a builtin listed in 'LICM_PURE_BUILTINS'.
+bool licm_pure_call(node* f) {
+    for (size_t i = 0; i < LICM_PURE_COUNT; i++) {
+        if (strcmp(f->data.id_name, LICM_PURE_BUILTINS[i]) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns true if the value of the expression 'n' is the same in every
+// iteration of a loop writing 'written' and computing it cannot fail.
+bool licm_invariant(node* n, vector* written) {
+    switch (n->data.type) {
+    case LITERAL:
+    case NULL_LIT:
+        return true;
+    case VAR:
+        return !licm_is_written(written, n);
+    case FUNC:
+        if (!licm_pure_call(n)) {
+            return false;
+        }
+        break;
+    case DIV: {
+        // Division by zero stops the interpreter.
+        node* divisor = unwrap_expr(n->children[1]);
+        if (divisor->data.type != LITERAL ||
+            (divisor->data.ret_value == I32 && divisor->data.int_value == 0) ||
+            (divisor->data.ret_value == F64 &&
+             divisor->data.float_value == 0.0)) {
+            return false;
+        }
+        break;
+    }
+    case ORELSE:
+        if (n->children[1]->data.type == UNREACHABLE) {
+            return false;
+        }
+        break;
+    case EXPR:
+    case INPUT_PARAM_LIST:
+    case INPUT_PARAM:
+    case MUL:
+    case ADD:
+    case SUB:
+    case EQUAL:
+    case NOT_EQUAL:
+    case EQUALMORE:
+    case EQUALLESS:
+    case MORE:
+    case LESS:
+    case B_AND:
+    case B_OR:
+    case B_NEG:
+    case INT_NEGATE:
+        break;
+    default:
+        return false;
+    }
+    for (int i = 0; i < n->child_count; i++) {
+        if (!licm_invariant(n->children[i], written)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns true if 'n' computes something, hoisting plain operands would
+// just copy them.
+bool licm_worth(node* n) {
+    switch (n->data.type) {
+    case FUNC:
+    case DIV:
+    case ORELSE:
+    case MUL:
+    case ADD:
+    case SUB:
+    case EQUAL:
+    case NOT_EQUAL:
+    case EQUALMORE:
+    case EQUALLESS:
+    case MORE:
+    case LESS:
+    case B_AND:
+    case B_OR:
+    case B_NEG:
+    case INT_NEGATE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Creates a node of 'type' naming the hoisted constant 'name'.
+node* licm_name_node(node_type type, const char* name, data_type ret_value) {
+    node* n = create_node(type);
+    if (n == NULL) {
+        return NULL;
+    }
+    n->data.ret_value = ret_value;
+    n->data.id_name = d_string(name);
+    n->data.scope_id = d_string("");
+    if (n->data.id_name == NULL || n->data.scope_id == NULL) {
+        delete_tree(&n);
+        return NULL;
+    }
+    return n;
+}
+
+// Moves the expression 'n' into a new constant defined at '*index' of 'list'
+// and puts a read of the constant in its place.
+error_code licm_hoist(node* n, node* list, int* index, licm_ctx* ctx) {
+    char name[32];
+    snprintf(name, sizeof(name), LICM_PREFIX "%d", ctx->next_id);
+
+    node* def = licm_name_node(CONST_DEF, name, n->data.ret_value);
+    node* ref = licm_name_node(VAR, name, n->data.ret_value);
+    node* expr = create_node(EXPR);
+    if (def == NULL || ref == NULL || expr == NULL) {
+        delete_tree(&def);
+        delete_tree(&ref);
+        delete_tree(&expr);
+        return INTERNAL_ERR;
+    }
+    expr->data.ret_value = n->data.ret_value;
+
+    if (!replace_node(n, ref)) {
+        delete_tree(&def);
+        delete_tree(&ref);
+        delete_tree(&expr);
+        return INTERNAL_ERR;
+    }
+    if (!append_node(n, expr) || !append_node(expr, def)) {
+        delete_tree(&n);
+        delete_tree(&expr);
+        delete_tree(&def);
+        return INTERNAL_ERR;
+    }
+    if (!insert_node(def, list, *index)) {
+        delete_tree(&def);
+        return INTERNAL_ERR;
+    }
+
+    (*index)++;
+    ctx->next_id++;
+    ctx->stats->hoisted++;
+    return NO_ERR;
+}
+
+// Hoists the largest invariant expressions found inside 'n' to '*index' of
+// 'list'.
+error_code licm_walk(node* n, vector* written, node* list, int* index,
+                     licm_ctx* ctx) {
+    if (licm_worth(n) && licm_invariant(n, written)) {
+        return licm_hoist(n, list, index, ctx);
+    }
+    for (int i = 0; i < n->child_count; i++) {
+        error_code err = licm_walk(n->children[i], written, list, index, ctx);
+        if (err != NO_ERR) {
+            return err;
+        }
+    }
+    return NO_ERR;
+}
+
+// Moves the constants hoisted out of inner loops to '*index' of 'list' if
+// they do not depend on the loop with 'body'. Moved definitions are removed
+// from 'written'.
+error_code licm_move_hoisted(node* body, vector* written, node* list,
+                             int* index, licm_ctx* ctx) {
+    int i = 0;
+    while (i < body->child_count) {
+        node* s = body->children[i];
+        if (s->data.type != CONST_DEF ||
+            strncmp(s->data.id_name, LICM_PREFIX, strlen(LICM_PREFIX)) != 0 ||
+            !licm_invariant(s->children[0], written)) {
+            i++;
+            continue;
+        }
+        for (size_t j = 0; j < written->len; j++) {
+            if (*(node**)vec_get(written, j) == s) {
+                vec_remove(written, j);
+                break;
+            }
+        }
+        detach_node(s);
+        if (!insert_node(s, list, *index)) {
+            delete_tree(&s);
+            return INTERNAL_ERR;
+        }
+        (*index)++;
+        ctx->stats->hoisted++;
+    }
+    return NO_ERR;
+}
+
+// Hoists the invariants of the WHILE or FOR 'loop' which is the child of
+// 'list' at '*index'. '*index' is moved past the inserted definitions.
+error_code licm_loop(node* loop, node* list, int* index, licm_ctx* ctx) {
+    node* cond = get_child_by_type(loop, COND, 0);
+    node* body = get_child_by_type(loop, STMT_LIST, 0);
+    node* cnt = get_child_by_type(loop, WHILE_CNT, 0);
+    assert(cond != NULL && body != NULL);
+
+    // The else block runs once after the loop, its writes do not matter.
+    vector* written = vec_init(8, sizeof(node*));
+    if (written == NULL) {
+        return INTERNAL_ERR;
+    }
+    if (!licm_collect_writes(cond, written) ||
+        !licm_collect_writes(body, written) ||
+        (cnt != NULL && !licm_collect_writes(cnt, written))) {
+        vec_free(&written);
+        return INTERNAL_ERR;
+    }
+
+    int start = *index;
+    error_code err = licm_move_hoisted(body, written, list, index, ctx);
+
+    // The expression iterated by FOR is evaluated only once.
+    if (err == NO_ERR && loop->data.type == WHILE) {
+        err = licm_walk(cond->children[0], written, list, index, ctx);
+    }
+    if (err == NO_ERR) {
+        err = licm_walk(body, written, list, index, ctx);
+    }
+    if (err == NO_ERR && cnt != NULL) {
+        err = licm_walk(cnt, written, list, index, ctx);
+    }
+
+    if (*index != start) {
+        ctx->stats->loops++;
+    }
+    vec_free(&written);
+    return err;
+}
+
+error_code licm_stmt_list(node* list, licm_ctx* ctx);
+
+// Processes the statement lists nested in the statement 's'.
+error_code licm_nested(node* s, licm_ctx* ctx) {
+    for (int i = 0; i < s->child_count; i++) {
+        node* child = s->children[i];
+        error_code err = NO_ERR;
+        if (child->data.type == STMT_LIST) {
+            err = licm_stmt_list(child, ctx);
+        } else if (child->data.type == ELSE || child->data.type == WHILE_CNT ||
+                   child->data.type == WHILE_ELSE) {
+            err = licm_nested(child, ctx);
+        }
+        if (err != NO_ERR) {
+            return err;
+        }
+    }
+    return NO_ERR;
+}
+
+error_code licm_stmt_list(node* list, licm_ctx* ctx) {
+    int i = 0;
+    while (i < list->child_count) {
+        node* s = list->children[i];
+
+        // Inner loops first, their hoisted constants may move further out.
+        error_code err = licm_nested(s, ctx);
+        if (err == NO_ERR &&
+            (s->data.type == WHILE || s->data.type == FOR)) {
+            err = licm_loop(s, list, &i, ctx);
+        }
+        if (err != NO_ERR) {
+            return err;
+        }
+        i++;
+    }
+    return NO_ERR;
+}
+
+// Hoists loop-invariant expressions out of all the loops of 'ast'. 'stats'
+// may be NULL if the caller is not interested in the counters.
+error_code hoist_loop_invariants(node* ast, licm_stats* stats) {
+    assert(ast != NULL);
+    assert(ast->data.type == PROG);
+
+    licm_stats local = {0};
+    licm_ctx ctx = {.next_id = 0, .stats = stats != NULL ? stats : &local};
+
+    for (int i = 0; i < ast->child_count; i++) {
+        node* func_def = ast->children[i];
+        node* body = get_child_by_type(func_def, STMT_LIST, 0);
+        if (body == NULL) {
+            continue;
+        }
+        // The constants are local, numbering them per function keeps the
+        // code of a function independent of the others.
+        ctx.next_id = 0;
+        error_code err = licm_stmt_list(body, &ctx);
+        if (err != NO_ERR) {
+            return err;
+        }
+    }
+    return NO_ERR;
+}
@@ -0,0 +1,28 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Loop-invariant code motion over the analysed AST.
+
+#ifndef IFJ_PROJEKT_2024_LICM_H
+#define IFJ_PROJEKT_2024_LICM_H
+
+#include "ast.h"
+#include "error.h"
+#include "vector.h"
+
+#include <stdbool.h>
+
+// Prefix of the constants holding the hoisted values, it cannot clash with
+// the user identifiers.
+#define LICM_PREFIX "$licm"
+
+// Counters describing what the pass did.
+typedef struct {
+    int loops;     // Loops something was hoisted from
+    int hoisted;   // Hoisted expressions
+} licm_stats;
+
+error_code hoist_loop_invariants(node* ast, licm_stats* stats);
+bool licm_invariant(node* n, vector* written);
+
+#endif // IFJ_PROJEKT_2024_LICM_H
@@ -1,81 +1,102 @@
 // Projekt: Implementace přeladače jazyka IFJ24
 // Autor: Dominik Václavík (xvacla37)
 
-#include "code_gen.h"
+#include "driver.h"
 #include "error.h"
-#include "parser.h"
-#include "scope_stack.h"
-#include "semantic.h"
-#include "symtable.h"
-#include "vector.h"
+#include "server.h"
+#include "stats.h"
+#include <stdbool.h>
 #include <stdio.h>
-
-int main() {
-
-    DEBUG_PRINT("%s", "NDEBUG not defined, debugging.")
-
-    node* ast_tree = create_node(PROG);
-    if (ast_tree == NULL) {
-        fprintf(stderr, "Failed to alocate memory!\n Ending program!\n");
-        return INTERNAL_ERR;
+#include <stdlib.h>
+#include <string.h>
+
+int main(int argc, char** argv) {
+    // -O0           disables the optimization passes
+    // --stack-exprs evaluates expressions on the data stack instead of in
+    //               frame temporaries
+    // --opt-report  prints what the optimizations did to stderr
+    // -j <n>        analyses and generates the functions on <n> threads
+    // --ast-report  compares the memory and traversal time of the tree and
+    //               its flat form on stderr, the flat form is not used by
+    //               the compiler itself
+    // --cache <dir> reuses the code of unchanged functions stored in <dir>
+    //               and reports the compilation time on stderr
+    // --stats       prints the time and peak memory of every phase and the
+    //               sizes of what they produced to stderr
+    // --ir-dump     prints the blocks and registers of every function after
+    //               the IR passes to stderr
+    // --server      compiles the programs sent as jobs on stdin and answers
+    //               them on stdout, see server.c
+    // --socket <p>  serves the same jobs on the Unix socket <p>
+    bool optimize = true;
+    bool registers = true;
+    bool opt_report = false;
+    bool ast_report = false;
+    bool ir_dump = false;
+    bool stats = false;
+    bool server = false;
+    const char* cache_dir = NULL;
+    const char* socket_path = NULL;
+    int jobs = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+            jobs = atoi(argv[++i]);
+            if (jobs < 1) {
+                fprintf(stderr, "Invalid number of jobs %s\n", argv[i]);
+                return INTERNAL_ERR;
+            }
+        } else if (strcmp(argv[i], "-O0") == 0) {
+            optimize = false;
+            registers = false;
+        } else if (strcmp(argv[i], "--stack-exprs") == 0) {
+            registers = false;
+        } else if (strcmp(argv[i], "--opt-report") == 0) {
+            opt_report = true;
+        } else if (strcmp(argv[i], "--ast-report") == 0) {
+            ast_report = true;
+        } else if (strcmp(argv[i], "--ir-dump") == 0) {
+            ir_dump = true;
+        } else if (strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (strcmp(argv[i], "--cache") == 0 && i + 1 < argc) {
+            cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--server") == 0) {
+            server = true;
+        } else if (strcmp(argv[i], "--socket") == 0 && i + 1 < argc) {
+            socket_path = argv[++i];
+        } else {
+            fprintf(stderr, "Unknown option %s\n", argv[i]);
+            return INTERNAL_ERR;
+        }
     }
 
-    error_code err = parse(ast_tree);
-    DEBUG_PRINT("parsing ended with code %d", err)
+    DEBUG_PRINT("%s", "NDEBUG not defined, debugging.")
 
+    driver_options opts = {.optimize = optimize,
+                           .registers = registers,
+                           .opt_report = opt_report,
+                           .ast_report = ast_report,
+                           .ir_dump = ir_dump,
+                           .jobs = jobs,
+                           .cache_dir = cache_dir};
+    driver drv;
+    error_code err = driver_init(&drv);
     if (err != NO_ERR) {
-        fprintf(stderr, "The program encountered a problem during semantic or "
-                        "lexical analysis. Aborting...\n");
-        delete_tree(&ast_tree);
-        return err;
-    }
-
-    vector* symtable_stack = vec_init(4, sizeof(b_tree*));
-
-    if (symtable_stack == NULL) {
-        fprintf(stderr, "Failed to alocate memory!\n Ending program!\n");
-        return INTERNAL_ERR;
-    }
-
-    scope_stack* scp_s = scope_stack_init(3);
-    if (scp_s == NULL) {
         fprintf(stderr, "Failed to alocate memory!\n Ending program!\n");
-        return INTERNAL_ERR;
-    }
-
-    err = enter_scope(symtable_stack);
-    if (err != NO_ERR) {
         return err;
     }
-    int insert_status = populate_with_builtins(symtable_stack);
-    if (insert_status != INSERT_SUCCESS) {
-        return INTERNAL_ERR;
-    }
 
-    DEBUG_PRINT("entering PROG scope with %s", ERROR_STRINGS[err]);
-
-    err = semantically_analyse(ast_tree, symtable_stack, scp_s);
-    if (err != NO_ERR) {
-        fprintf(stderr, "The program encountered a problem during semantical "
-                        "analysis. Aborting...\n");
-        return err;
+    if (socket_path != NULL) {
+        err = server_listen(&drv, &opts, socket_path);
+    } else if (server) {
+        err = server_serve(&drv, &opts, stdin, stdout);
+    } else {
+        err = driver_compile(&drv, &opts, stdin, stdout);
     }
+    driver_free(&drv);
 
-    DEBUG_PRINT("semantical analysis ended with %s", ERROR_STRINGS[err]);
-
-    leave_scope(symtable_stack);
-
-    scope_stack_free(&scp_s);
-    vec_free(&symtable_stack);
-
-    err = generate_code(ast_tree);
-    if (err != NO_ERR) {
-        fprintf(stderr, "The program encountered a problem during code generation "
-                        ". Aborting...\n");
-        return err;
+    if (err == NO_ERR && stats) {
+        stats_report(stderr);
     }
-
-    delete_tree(&ast_tree); // TODO: free allocated strings from some tree nodes
-                            // by TYPE. (IDENTIFIER, FUNCTION)
-    return NO_ERR;
+    return err;
 }
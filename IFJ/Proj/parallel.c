@@ -0,0 +1,59 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Running independent pieces of work on several threads.
+
+#include "parallel.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+
+typedef struct {
+    atomic_int next; // Next item to be taken by a thread
+    int count;
+    parallel_work work;
+    void* arg;
+} parallel_job;
+
+// Takes the items one by one until there are none left.
+void* parallel_worker(void* p) {
+    parallel_job* job = p;
+    int i;
+    while ((i = atomic_fetch_add(&job->next, 1)) < job->count) {
+        job->work(i, job->arg);
+    }
+    return NULL;
+}
+
+// Calls 'work' for every index below 'count' using up to 'jobs' threads
+// including the calling one. The items are handed out in order, but may
+// finish in any order. Runs serially if threads cannot be created.
+void parallel_for(int count, int jobs, parallel_work work, void* arg) {
+    parallel_job job = {.count = count, .work = work, .arg = arg};
+    atomic_init(&job.next, 0);
+
+    if (jobs > count) {
+        jobs = count;
+    }
+    pthread_t* threads = NULL;
+    int started = 0;
+    if (jobs > 1) {
+        threads = malloc(sizeof(pthread_t) * (jobs - 1));
+    }
+    if (threads != NULL) {
+        for (; started < jobs - 1; started++) {
+            if (pthread_create(&threads[started], NULL, parallel_worker,
+                               &job) != 0) {
+                break;
+            }
+        }
+    }
+
+    parallel_worker(&job);
+
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+}
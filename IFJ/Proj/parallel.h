@@ -0,0 +1,14 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Running independent pieces of work on several threads.
+
+#ifndef IFJ_PROJEKT_2024_PARALLEL_H
+#define IFJ_PROJEKT_2024_PARALLEL_H
+
+// Work done for a single item, must not touch the state of other items.
+typedef void (*parallel_work)(int index, void* arg);
+
+void parallel_for(int count, int jobs, parallel_work work, void* arg);
+
+#endif // IFJ_PROJEKT_2024_PARALLEL_H
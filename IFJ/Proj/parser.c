@@ -9,15 +9,38 @@
 #include <stdlib.h>
 #include <string.h> // I hate this
 #include "scanner.h"
+#include "stats.h"
+#include "token_stream.h"
 #include "data_types.h"
 
 // GLOBAL
 // Note: instead of passing down a pointer to an error, error number will be stored here.
 // Note: This variable will stay. it is used when getting new tokens or as it gets a lexical error.
 int g_err=0;
+// Whole input pre-scanned by parse(), tokens are taken from here instead of the scanner.
+token_stream g_ts;
 // since all states return an expression comprised of "and" operands, one false exit in evaluating
 // the previous return statement guarantees not going into another state by the compiler.
 
+/**
+ * Method moves to the next token of the pre-scanned input.
+ * @param t token to be overwritten
+ * @return NO_ERR or lexical error found at the position of the next token.
+ */
+error_code next_token(token* const t){
+    return ts_next(&g_ts, t);
+}
+
+/**
+ * Method looks ahead without consuming anything.
+ * @param k number of tokens after the current one, 0 is the current token.
+ * @return type of the token, TOKEN_EOF if it could not be scanned.
+ */
+token_type peek_token(size_t k){
+    const stream_token* st = ts_peek(&g_ts, k);
+    return st == NULL ? TOKEN_EOF : st->type;
+}
+
 #ifndef NDEBUG
 #define NODE_CPY_TOKEN_PRINT \
         fprintf(stderr, "\x1b[2m" "%s: expected Identifier token, %s. Value copied: %s" "\x1b[2m" "\n", \
@@ -60,12 +83,14 @@ bool apt_t_cpy_id(token* const t, node *dest_n, bool namespace_allowed){
     if(t->type != TOKEN_IDENT)return false;
     // copy id into the node.
     node_cpy_id(t->content.id,dest_n);
-    g_err = get_token(t);
-    if(t->type != TOKEN_DOT || !namespace_allowed) return !g_err;
+    // id followed by a dot is a namespace.
+    bool namespaced = namespace_allowed && peek_token(1) == TOKEN_DOT;
+    g_err = next_token(t);
+    if(!namespaced) return !g_err;
 
     // check if said id was namespace and concatenate.
     // Note: ifj code does not support objects.
-    g_err = get_token(t);
+    g_err = next_token(t);
     if(g_err || t->type != TOKEN_IDENT) return false;
     void* mem;
     mem = realloc(dest_n->data.id_name, strlen(dest_n->data.id_name)+2+strlen(t->content.id)+1);
@@ -77,7 +102,7 @@ bool apt_t_cpy_id(token* const t, node *dest_n, bool namespace_allowed){
     strcat(mem,t->content.id);
     dest_n->data.id_name= mem;
     NODE_CPY_T_PRINT_EXTENDED
-    g_err = get_token(t);
+    g_err = next_token(t);
     return !g_err;
 }
 
@@ -107,7 +132,7 @@ bool apt_t(token* const t, token_type t_type){
     // EOF FOUND
     if(t->type == TOKEN_EOF) return result;
     // next token.
-    g_err = get_token(t);
+    g_err = next_token(t);
     return !g_err;
 }
 
@@ -209,7 +234,7 @@ bool s_prolog(token* const t){
     // ifj
     if(t->type != TOKEN_IDENT)return false;
     if(strcmp(t->content.id,"ifj")!=0) return false;
-    g_err = get_token(t);
+    g_err = next_token(t);
     if(g_err) return false;
     // @import(
     result = result
@@ -221,7 +246,7 @@ bool s_prolog(token* const t){
     // "ifj24.zig"
     if(t->type != TOKEN_LIT_STRING)return false;
     if(strcmp(t->content.string_lit,"ifj24.zig")!=0)return false;
-    g_err = get_token(t);
+    g_err = next_token(t);
     if(g_err) return false;
 
     return apt_t(t, TOKEN_R_PAREN)
@@ -455,7 +480,7 @@ bool s_definition_type(token* const t, node* p){
         default:
             return false;
     }
-    g_err = get_token(t);
+    g_err = next_token(t);
     return !g_err;
 }
 
@@ -811,26 +836,38 @@ bool s_break_stmt(token* const t, node* p){
             fprintf(stderr, "\x1b[2m" "Parsing exit with success" "\x1b[0m" "\n"); \
         else \
             fprintf(stderr, "\x1b[31m" "Parsing exit without success" "\n" \
-            "last known Token Type: %d" "\x1b[0m" "\n",t->type);
+            "last known Token Type: %d on line %zu" "\x1b[0m" "\n",t->type, \
+            ts_peek(&g_ts,0) ? ts_line(&g_ts,ts_peek(&g_ts,0)->start) : 0);
 
 #else
 #define SUCCESS_PRINT
 #endif
 
 
-error_code parse(node *syn_root){
+error_code parse(node *syn_root, FILE *in){
+    g_err = 0;
     token *t = malloc(sizeof (token));
     if (t==NULL) return INTERNAL_ERR;
+    if(ts_tokenize(&g_ts, in)){
+        free(t);
+        return INTERNAL_ERR;
+    }
+    stats_count(COUNT_TOKENS, g_ts.tokens->len);
 
-    if((g_err = get_token(t))) return g_err;
+    if((g_err = next_token(t))){
+        ts_free(&g_ts);
+        free(t);
+        return g_err;
+    }
     bool success = s_start(t, syn_root);
     SUCCESS_PRINT
 
+    ts_free(&g_ts);
+    free(t);
     if(!success){
         if(g_err) return g_err;
         return SYNTACTIC_ERR;
     }
-    free(t);
     return 0;
 }
 
@@ -839,7 +876,7 @@ error_code parse(node *syn_root){
 
 // Expression are parsed topdown with recursive descent.
 #define CATCH_ERR_T \
-    *err = get_token(t); \
+    *err = next_token(t); \
     if(*err) return n;
 
 #define CATCH_ERR_NODE(node_type) \
@@ -896,30 +933,30 @@ node* s_primary(token* const t, error_code* err, bool or_else){
             prim->data.type = LITERAL;
             prim->data.ret_value = BOOLEAN;
             prim->data.bool_value = true;
-            *err = get_token(t);
+            *err = next_token(t);
             break;
         case TOKEN_KW_FALSE:
             prim->data.type = LITERAL;
             prim->data.ret_value = BOOLEAN;
             prim->data.bool_value = false;
-            *err = get_token(t);
+            *err = next_token(t);
             break;
         case TOKEN_LIT_INT:
             prim->data.type = LITERAL;
             prim->data.ret_value = I32;
             prim->data.int_value = t->content.int_lit;
-            *err = get_token(t);
+            *err = next_token(t);
             break;
         case TOKEN_LIT_FLOAT:
             prim->data.type = LITERAL;
             prim->data.ret_value = F64;
             prim->data.float_value = t->content.float_lit;
-            *err = get_token(t);
+            *err = next_token(t);
             break;
         case TOKEN_KW_NULL:
             prim->data.type = NULL_LIT;
             prim->data.ret_value = DT_NULL;
-            *err = get_token(t);
+            *err = next_token(t);
             break;
         case TOKEN_LIT_STRING:
             prim->data.type = LITERAL;
@@ -932,7 +969,7 @@ node* s_primary(token* const t, error_code* err, bool or_else){
                 return NULL;
             }
             strcpy(prim->data.str_value,t->content.string_lit);
-            *err = get_token(t);
+            *err = next_token(t);
             break;
         case TOKEN_AS:
             prim->data.type = AS_FUNC;
@@ -961,17 +998,17 @@ node* s_primary(token* const t, error_code* err, bool or_else){
             break;
         case TOKEN_L_PAREN:
             prim->data.type = EXPR;
-            *err = get_token(t);
+            *err = next_token(t);
             if(*err) break;
             s_expr(t,prim);
             if(t->type != TOKEN_R_PAREN){
                 *err = SYNTACTIC_ERR;
             }
-            *err = get_token(t);
+            *err = next_token(t);
             break;
         case TOKEN_KW_IF: // TERNARY
             prim->data.type = IF_TERNARY;
-            *err = get_token(t);
+            *err = next_token(t);
             if(*err) break;
             // if (cond) expr else expr
             if(!(s_cond(t,prim)
@@ -989,7 +1026,7 @@ node* s_primary(token* const t, error_code* err, bool or_else){
             }
             prim->data.type = UNREACHABLE;
             prim->data.ret_value = VOID;
-            *err = get_token(t);
+            *err = next_token(t);
             break;
 
         default:
@@ -1016,7 +1053,7 @@ node* s_postfix(token* const t,error_code* err, bool or_else){
     node* n = s_primary(t,err, or_else);
     if(t->type == TOKEN_IS_UNREACHABLE){
         CREATE_NODE(this,IS_UNREACHABLE)
-        *err = get_token(t);
+        *err = next_token(t);
         if(*err) return NULL;
         append_node(n,this);
         n = this;
@@ -1029,7 +1066,7 @@ node* s_negate(token* const t,error_code* err, bool or_else){
         node_type nt = neg_nt(t);
         CREATE_NODE(this,nt)
         if (*err) return NULL;
-        *err = get_token(t);
+        *err = next_token(t);
         if (*err) return NULL;
         append_node(s_negate(t,err, false),this);
         return this;
@@ -9,6 +9,8 @@
 #include "ast.h"
 #include "error.h"
 
-error_code parse(node* synroot);
+#include <stdio.h>
+
+error_code parse(node* synroot, FILE* in);
 
 #endif // IFJ_PROJEKT_2024_PARSER_H
@@ -0,0 +1,321 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Peephole optimization of the generated instruction list.
+//
+// The instructions are copied one by one into a new list and after each one
+// the rules from 'RULES' are tried on the tail of that list. A rewritten tail
+// is tried again, so the rules chain, e.g.
+//   PUSHS a / PUSHS b / ADDS / POPS y
+// becomes ADD GF@$tmp a b / PUSHS GF@$tmp / POPS y, then
+// ADD GF@$tmp a b / MOVE y GF@$tmp and finally ADD y a b.
+//
+// GF@$tmp is written only by the instructions created here and always read
+// by the instruction directly following, so it never lives across a label.
+
+#include "peephole.h"
+#include "instr.h"
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Single rewriting rule. 'apply' gets the last 'window' instructions of the
+// output list and returns true if it rewrote them.
+typedef struct {
+    const char* name;
+    size_t window;
+    bool (*apply)(vector* out, instr* tail);
+} peephole_rule;
+
+// Returns the stack opcode 'op' as its three operand variant or
+// I_OPCODE_COUNT if there is none.
+opcode peephole_binary(opcode op) {
+    switch (op) {
+    case I_ADDS:
+        return I_ADD;
+    case I_SUBS:
+        return I_SUB;
+    case I_MULS:
+        return I_MUL;
+    case I_DIVS:
+        return I_DIV;
+    case I_IDIVS:
+        return I_IDIV;
+    case I_LTS:
+        return I_LT;
+    case I_GTS:
+        return I_GT;
+    case I_EQS:
+        return I_EQ;
+    case I_ANDS:
+        return I_AND;
+    case I_ORS:
+        return I_OR;
+    default:
+        return I_OPCODE_COUNT;
+    }
+}
+
+// Returns true if 'ins' is one of the three operand instructions created by
+// the pass storing into GF@$tmp.
+bool peephole_writes_tmp(instr* ins) {
+    switch (ins->op) {
+    case I_ADD:
+    case I_SUB:
+    case I_MUL:
+    case I_DIV:
+    case I_IDIV:
+    case I_LT:
+    case I_GT:
+    case I_EQ:
+    case I_AND:
+    case I_OR:
+    case I_NOT:
+        return strcmp(ins->args[0], PEEPHOLE_TMP) == 0;
+    default:
+        return false;
+    }
+}
+
+// Drops the last 'count' instructions of 'out'.
+void peephole_drop(vector* out, size_t count) {
+    while (count-- > 0) {
+        instr_free(vec_get(out, out->len - 1));
+        vec_remove_last(out);
+    }
+}
+
+// Sets 'ins' to 'op' with the operands 'a', 'b' and 'c' (NULL terminates),
+// the operands are taken over.
+void peephole_set(instr* ins, opcode op, char* a, char* b, char* c) {
+    ins->op = op;
+    ins->args[0] = a;
+    ins->args[1] = b;
+    ins->args[2] = c;
+    ins->argc = (a != NULL) + (b != NULL) + (c != NULL);
+}
+
+// PUSHS x / POPS y -> MOVE y x, dropped entirely when x equals y.
+bool rule_push_pop(vector* out, instr* tail) {
+    if (tail[0].op != I_PUSHS || tail[1].op != I_POPS) {
+        return false;
+    }
+    if (strcmp(tail[0].args[0], tail[1].args[0]) == 0) {
+        peephole_drop(out, 2);
+        return true;
+    }
+    peephole_set(&tail[0], I_MOVE, tail[1].args[0], tail[0].args[0], NULL);
+    tail[1].argc = 0;
+    vec_remove_last(out);
+    return true;
+}
+
+// PUSHS a / PUSHS b / ADDS -> ADD GF@$tmp a b / PUSHS GF@$tmp, likewise for
+// the other binary stack instructions.
+bool rule_binary(vector* out, instr* tail) {
+    (void)out;
+    opcode op = peephole_binary(tail[2].op);
+    if (tail[0].op != I_PUSHS || tail[1].op != I_PUSHS ||
+        op == I_OPCODE_COUNT) {
+        return false;
+    }
+    char* tmp_a = strdup(PEEPHOLE_TMP);
+    char* tmp_b = strdup(PEEPHOLE_TMP);
+    if (tmp_a == NULL || tmp_b == NULL) {
+        free(tmp_a);
+        free(tmp_b);
+        return false;
+    }
+    char* a = tail[0].args[0];
+    char* b = tail[1].args[0];
+    peephole_set(&tail[0], op, tmp_a, a, b);
+    peephole_set(&tail[1], I_PUSHS, tmp_b, NULL, NULL);
+    vec_remove_last(out);
+    return true;
+}
+
+// PUSHS a / OP GF@$tmp ... / PUSHS GF@$tmp / ADDS ->
+// OP GF@$tmp ... / ADD GF@$tmp a GF@$tmp / PUSHS GF@$tmp
+// Handles expressions whose right operand was already rewritten. Not possible
+// when 'a' is GF@$tmp itself, its pushed value would be overwritten.
+bool rule_binary_tmp(vector* out, instr* tail) {
+    (void)out;
+    opcode op = peephole_binary(tail[3].op);
+    if (tail[0].op != I_PUSHS || !peephole_writes_tmp(&tail[1]) ||
+        tail[2].op != I_PUSHS || strcmp(tail[2].args[0], PEEPHOLE_TMP) != 0 ||
+        op == I_OPCODE_COUNT ||
+        strcmp(tail[0].args[0], PEEPHOLE_TMP) == 0) {
+        return false;
+    }
+    char* tmp_a = strdup(PEEPHOLE_TMP);
+    char* tmp_b = strdup(PEEPHOLE_TMP);
+    if (tmp_a == NULL || tmp_b == NULL) {
+        free(tmp_a);
+        free(tmp_b);
+        return false;
+    }
+    char* a = tail[0].args[0];
+    tail[0] = tail[1];
+    peephole_set(&tail[1], op, tmp_a, a, tail[2].args[0]);
+    peephole_set(&tail[2], I_PUSHS, tmp_b, NULL, NULL);
+    vec_remove_last(out);
+    return true;
+}
+
+// PUSHS x / NOTS -> NOT GF@$tmp x / PUSHS GF@$tmp
+bool rule_not(vector* out, instr* tail) {
+    (void)out;
+    if (tail[0].op != I_PUSHS || tail[1].op != I_NOTS) {
+        return false;
+    }
+    char* tmp_a = strdup(PEEPHOLE_TMP);
+    char* tmp_b = strdup(PEEPHOLE_TMP);
+    if (tmp_a == NULL || tmp_b == NULL) {
+        free(tmp_a);
+        free(tmp_b);
+        return false;
+    }
+    peephole_set(&tail[0], I_NOT, tmp_a, tail[0].args[0], NULL);
+    peephole_set(&tail[1], I_PUSHS, tmp_b, NULL, NULL);
+    return true;
+}
+
+// ADD GF@$tmp a b / MOVE y GF@$tmp -> ADD y a b
+bool rule_store_tmp(vector* out, instr* tail) {
+    if (!peephole_writes_tmp(&tail[0]) || tail[1].op != I_MOVE ||
+        strcmp(tail[1].args[1], PEEPHOLE_TMP) != 0) {
+        return false;
+    }
+    instr_free_arg(tail[0].args[0]);
+    tail[0].args[0] = tail[1].args[0];
+    tail[1].args[0] = NULL;
+    instr_free(&tail[1]);
+    vec_remove_last(out);
+    return true;
+}
+
+// PUSHS a / PUSHS b / JUMPIFEQS l -> JUMPIFEQ l a b, likewise for JUMPIFNEQS.
+bool rule_cond_jump(vector* out, instr* tail) {
+    if (tail[0].op != I_PUSHS || tail[1].op != I_PUSHS ||
+        (tail[2].op != I_JUMPIFEQS && tail[2].op != I_JUMPIFNEQS)) {
+        return false;
+    }
+    opcode op = tail[2].op == I_JUMPIFEQS ? I_JUMPIFEQ : I_JUMPIFNEQ;
+    peephole_set(&tail[0], op, tail[2].args[0], tail[0].args[0],
+                 tail[1].args[0]);
+    tail[1].argc = 0;
+    tail[2].argc = 0;
+    vec_remove_last(out);
+    vec_remove_last(out);
+    return true;
+}
+
+// JUMP l / LABEL l -> LABEL l
+bool rule_jump_next(vector* out, instr* tail) {
+    if (tail[0].op != I_JUMP || tail[1].op != I_LABEL ||
+        strcmp(tail[0].args[0], tail[1].args[0]) != 0) {
+        return false;
+    }
+    instr label = tail[1];
+    instr_free(&tail[0]);
+    tail[0] = label;
+    vec_remove_last(out);
+    return true;
+}
+
+// PUSHFRAME / POPFRAME -> nothing, the frames end up as they were.
+bool rule_frame_pair(vector* out, instr* tail) {
+    if (tail[0].op != I_PUSHFRAME || tail[1].op != I_POPFRAME) {
+        return false;
+    }
+    peephole_drop(out, 2);
+    return true;
+}
+
+// CREATEFRAME / CREATEFRAME -> CREATEFRAME
+bool rule_create_frame(vector* out, instr* tail) {
+    if (tail[0].op != I_CREATEFRAME || tail[1].op != I_CREATEFRAME) {
+        return false;
+    }
+    peephole_drop(out, 1);
+    return true;
+}
+
+const peephole_rule RULES[] = {
+    {"push-pop", 2, rule_push_pop},
+    {"binary", 3, rule_binary},
+    {"binary-tmp", 4, rule_binary_tmp},
+    {"not", 2, rule_not},
+    {"store-tmp", 2, rule_store_tmp},
+    {"cond-jump", 3, rule_cond_jump},
+    {"jump-next", 2, rule_jump_next},
+    {"frame-pair", 2, rule_frame_pair},
+    {"create-frame", 2, rule_create_frame},
+};
+
+#define RULE_COUNT (sizeof(RULES) / sizeof(RULES[0]))
+
+// Tries the rules on the tail of 'out' until none of them applies.
+void peephole_tail(vector* out, peephole_stats* stats) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t r = 0; r < RULE_COUNT; r++) {
+            if (out->len < RULES[r].window) {
+                continue;
+            }
+            instr* tail = vec_get(out, out->len - RULES[r].window);
+            if (RULES[r].apply(out, tail)) {
+                stats->rewrites++;
+                changed = true;
+                break;
+            }
+        }
+    }
+}
+
+// Rewrites common stack instruction sequences of 'list' into shorter
+// register frame forms. 'stats' may be NULL if the caller is not interested
+// in the counters.
+error_code peephole_optimize(vector* list, peephole_stats* stats) {
+    assert(list != NULL);
+
+    peephole_stats local = {0};
+    if (stats == NULL) {
+        stats = &local;
+    }
+    stats->before = list->len;
+
+    vector* out = instr_list_init();
+    if (out == NULL) {
+        return INTERNAL_ERR;
+    }
+    for (size_t i = 0; i < list->len; i++) {
+        if (vec_push(out, vec_get(list, i)) == NULL) {
+            // Instructions up to 'i' are owned by 'out' now.
+            for (size_t j = i; j < list->len; j++) {
+                instr_free(vec_get(list, j));
+            }
+            list->len = 0;
+            instr_list_free(&out);
+            return INTERNAL_ERR;
+        }
+        peephole_tail(out, stats);
+    }
+
+    // Move the result back, the operands were taken over by 'out'.
+    vec_clear(list);
+    if (out->len > 0 && vec_push_n(list, vec_get(out, 0), out->len) == NULL) {
+        for (size_t i = 0; i < out->len; i++) {
+            instr_free(vec_get(out, i));
+        }
+        vec_free(&out);
+        return INTERNAL_ERR;
+    }
+    vec_free(&out);
+
+    stats->after = list->len;
+    return NO_ERR;
+}
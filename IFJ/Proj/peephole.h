@@ -0,0 +1,25 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Peephole optimization of the generated instruction list.
+
+#ifndef IFJ_PROJEKT_2024_PEEPHOLE_H
+#define IFJ_PROJEKT_2024_PEEPHOLE_H
+
+#include "error.h"
+#include "vector.h"
+
+// Scratch variable defined in the prolog, holds results of the three operand
+// instructions created by the pass.
+#define PEEPHOLE_TMP "GF@$tmp"
+
+// Counters describing what the peephole pass did.
+typedef struct {
+    size_t before;   // Instructions before the pass
+    size_t after;    // Instructions after the pass
+    size_t rewrites; // Number of applied rules
+} peephole_stats;
+
+error_code peephole_optimize(vector* list, peephole_stats* stats);
+
+#endif // IFJ_PROJEKT_2024_PEEPHOLE_H
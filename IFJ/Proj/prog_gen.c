@@ -0,0 +1,728 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Generator of random well-typed IFJ24 programs for comparing the code of
+// the compiler at different optimization levels and for measuring it.
+//
+// The program consists of functions calling only those generated before
+// them and of main reading its input with ifj.readi32(). Their bodies are
+// random statements: declarations, assignments, IF and WHILE nested up to
+// the given depth, optionals unwrapped by IF, WHILE and orelse, calls of
+// the builtin functions and of the other functions. Everything generated
+// is accepted by the compiler:
+//   - every variable is used and every 'var' is assigned, what a body left
+//     unused is written out and what it left unassigned assigned to itself
+//     at the end of its scope,
+//   - every loop ends, a counter or an optional counting down is changed
+//     only by the loop itself,
+//   - nothing fails at runtime, integers are divided only by nonzero
+//     constants and the numbers are kept small, the arithmetic results are
+//     stored only into variables scaled down when they grow past
+//     PGEN_LIMIT, so neither the compiler nor the interpreter overflows,
+//   - the strings are cut to PGEN_MAX_STRING characters after every
+//     concatenation, calls in loops are limited by PGEN_MAX_CALL_COST.
+
+#include "prog_gen.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "vector.h"
+
+#define PGEN_MAX_FUNCS 64
+#define PGEN_MAX_PARAMS 3
+#define PGEN_MAX_BLOCK 6
+#define PGEN_MAX_STRING 24
+#define PGEN_LIMIT 100000
+// Statements a call may execute at most, counting the loops around it.
+#define PGEN_MAX_CALL_COST 20000
+
+typedef enum {
+    PGEN_INT,
+    PGEN_FLOAT,
+    PGEN_STRING,
+    PGEN_OPT_INT,
+    PGEN_VOID,
+} pgen_type;
+
+const char* const PGEN_TYPE_NAMES[] = {"i32", "f64", "[]u8", "?i32", "void"};
+
+const char* const PGEN_FLOATS[] = {"0.5", "1.0", "1.5", "2.25", "3.0", "10.0"};
+const char* const PGEN_RELATIONS[] = {"<", ">", "<=", ">=", "==", "!="};
+const char* const PGEN_STRINGS[] = {"a", "b", "xyz", " ", "\\n", "\\\"",
+                                    "\\\\", "ifj", "24", "\\x41"};
+
+#define PGEN_COUNT(array) ((int)(sizeof(array) / sizeof(array[0])))
+
+// Variable visible in the generated code, named 'v<id>'.
+typedef struct {
+    int id;
+    pgen_type type;
+    bool constant;
+    bool used;
+    bool mutated;
+    bool locked; // Counter of a loop, assigned only by the loop
+} pgen_var;
+
+// Function named 'fn<id>', as f64 is a keyword.
+typedef struct {
+    int id;
+    pgen_type params[PGEN_MAX_PARAMS];
+    int param_count;
+    pgen_type ret;
+    long cost; // Statements a call executes
+} pgen_func;
+
+typedef struct {
+    FILE* out;
+    const pgen_options* opts;
+    uint64_t rand;
+    vector* vars; // pgen_var, the visible ones, innermost last
+    pgen_func funcs[PGEN_MAX_FUNCS];
+    int func_count;
+    int next_id;
+    int indent;
+    long mult; // Iterations of the loops around the current statement
+    long cost; // Statements executed by the current function so far
+    bool ok;
+} pgen_state;
+
+// Statements of the kinds generated, compound ones go last.
+typedef enum {
+    PGEN_S_DECL,
+    PGEN_S_ASSIGN,
+    PGEN_S_ORELSE,
+    PGEN_S_BUILTIN,
+    PGEN_S_CALL,
+    PGEN_S_WRITE,
+    PGEN_S_IF,
+    PGEN_S_IF_OPT,
+    PGEN_S_WHILE,
+    PGEN_S_WHILE_OPT,
+    PGEN_S_COUNT
+} pgen_stmt_kind;
+
+const int PGEN_WEIGHTS[PGEN_S_COUNT] = {6, 8, 2, 3, 3, 1, 3, 2, 2, 1};
+
+void pgen_defaults(pgen_options* opts) {
+    *opts = (pgen_options){
+        .seed = 1, .statements = 200, .functions = 4, .depth = 3,
+        .iterations = 4};
+}
+
+// Returns a random number from 0 to 'n' - 1 (xorshift64*).
+int pgen_rand(pgen_state* g, int n) {
+    g->rand ^= g->rand >> 12;
+    g->rand ^= g->rand << 25;
+    g->rand ^= g->rand >> 27;
+    return (int)(((g->rand * 0x2545F4914F6CDD1DULL) >> 33) % (uint64_t)n);
+}
+
+void pgen_indent(pgen_state* g) {
+    fprintf(g->out, "%*s", g->indent * 4, "");
+}
+
+// Writes a whole indented line.
+void pgen_line(pgen_state* g, const char* fmt, ...) {
+    pgen_indent(g);
+    va_list args;
+    va_start(args, fmt);
+    vfprintf(g->out, fmt, args);
+    va_end(args);
+    fputc('\n', g->out);
+}
+
+pgen_var* pgen_var_at(pgen_state* g, int index) {
+    return vec_get(g->vars, index);
+}
+
+// Declares a new variable, returns its name number.
+int pgen_declare(pgen_state* g, pgen_type type, bool constant) {
+    pgen_var var = {.id = g->next_id++, .type = type, .constant = constant};
+    if (vec_push(g->vars, &var) == NULL) {
+        g->ok = false;
+    }
+    return var.id;
+}
+
+pgen_var* pgen_find(pgen_state* g, int id) {
+    for (size_t i = g->vars->len; i-- > 0;) {
+        pgen_var* var = pgen_var_at(g, i);
+        if (var->id == id) {
+            return var;
+        }
+    }
+    return NULL;
+}
+
+// Returns a random visible variable of 'type' or NULL. Only those that may
+// be assigned are considered when 'assignable' is set.
+pgen_var* pgen_pick(pgen_state* g, pgen_type type, bool assignable) {
+    int count = 0;
+    for (size_t i = 0; i < g->vars->len; i++) {
+        pgen_var* var = pgen_var_at(g, i);
+        count += var->type == type &&
+                 (!assignable || (!var->constant && !var->locked));
+    }
+    if (count == 0) {
+        return NULL;
+    }
+    int pick = pgen_rand(g, count);
+    for (size_t i = 0; i < g->vars->len; i++) {
+        pgen_var* var = pgen_var_at(g, i);
+        if (var->type == type &&
+            (!assignable || (!var->constant && !var->locked)) &&
+            pick-- == 0) {
+            return var;
+        }
+    }
+    return NULL;
+}
+
+// Writes an integer variable or a small literal.
+void pgen_int_leaf(pgen_state* g) {
+    pgen_var* var = pgen_pick(g, PGEN_INT, false);
+    if (var != NULL && pgen_rand(g, 4) != 0) {
+        var->used = true;
+        fprintf(g->out, "v%d", var->id);
+    } else if (pgen_rand(g, 5) == 0) {
+        fprintf(g->out, "(0 - %d)", pgen_rand(g, 21));
+    } else {
+        fprintf(g->out, "%d", pgen_rand(g, 21));
+    }
+}
+
+void pgen_int_expr(pgen_state* g, int depth) {
+    if (depth == 0 || pgen_rand(g, 3) == 0) {
+        pgen_int_leaf(g);
+        return;
+    }
+    fputc('(', g->out);
+    pgen_int_expr(g, depth - 1);
+    switch (pgen_rand(g, 4)) {
+    case 0:
+        fputs(" + ", g->out);
+        pgen_int_expr(g, depth - 1);
+        break;
+    case 1:
+        fputs(" - ", g->out);
+        pgen_int_expr(g, depth - 1);
+        break;
+    case 2:
+        fprintf(g->out, " * %d", pgen_rand(g, 10));
+        break;
+    default:
+        fprintf(g->out, " / %d", 1 + pgen_rand(g, 9));
+        break;
+    }
+    fputc(')', g->out);
+}
+
+void pgen_float_expr(pgen_state* g, int depth) {
+    if (depth == 0 || pgen_rand(g, 3) == 0) {
+        pgen_var* var = pgen_pick(g, PGEN_FLOAT, false);
+        if (var != NULL && pgen_rand(g, 4) != 0) {
+            var->used = true;
+            fprintf(g->out, "v%d", var->id);
+        } else {
+            fputs(PGEN_FLOATS[pgen_rand(g, PGEN_COUNT(PGEN_FLOATS))], g->out);
+        }
+        return;
+    }
+    fputc('(', g->out);
+    pgen_float_expr(g, depth - 1);
+    switch (pgen_rand(g, 4)) {
+    case 0:
+        fputs(" + ", g->out);
+        pgen_float_expr(g, depth - 1);
+        break;
+    case 1:
+        fputs(" - ", g->out);
+        pgen_float_expr(g, depth - 1);
+        break;
+    case 2:
+        fprintf(g->out, " * %s", pgen_rand(g, 2) == 0 ? "0.5" : "1.5");
+        break;
+    default:
+        fprintf(g->out, " / %s", pgen_rand(g, 2) == 0 ? "2.0" : "4.0");
+        break;
+    }
+    fputc(')', g->out);
+}
+
+void pgen_condition(pgen_state* g) {
+    bool floats = pgen_pick(g, PGEN_FLOAT, false) != NULL &&
+                  pgen_rand(g, 3) == 0;
+    const char* rel = PGEN_RELATIONS[pgen_rand(g, PGEN_COUNT(PGEN_RELATIONS))];
+    if (floats) {
+        pgen_float_expr(g, 1);
+        fprintf(g->out, " %s ", rel);
+        pgen_float_expr(g, 1);
+    } else {
+        pgen_int_expr(g, 1);
+        fprintf(g->out, " %s ", rel);
+        pgen_int_expr(g, 1);
+    }
+}
+
+// Scales the number in variable 'id' down once it grows too large.
+void pgen_limit(pgen_state* g, int id, pgen_type type) {
+    if (type == PGEN_INT) {
+        pgen_line(g, "if (v%d > %d) {", id, PGEN_LIMIT);
+        pgen_line(g, "    v%d = v%d / 1000;", id, id);
+        pgen_line(g, "} else {}");
+        pgen_line(g, "if (v%d < 0 - %d) {", id, PGEN_LIMIT);
+        pgen_line(g, "    v%d = v%d / 1000;", id, id);
+        pgen_line(g, "} else {}");
+    } else {
+        pgen_line(g, "if (v%d > %d.0) {", id, PGEN_LIMIT);
+        pgen_line(g, "    v%d = v%d / 1000.0;", id, id);
+        pgen_line(g, "} else {}");
+        pgen_line(g, "if (v%d < 0.0 - %d.0) {", id, PGEN_LIMIT);
+        pgen_line(g, "    v%d = v%d / 1000.0;", id, id);
+        pgen_line(g, "} else {}");
+    }
+    pgen_find(g, id)->mutated = true;
+}
+
+// Declares a variable of 'type' with a random value, the numbers always
+// as a 'var' so that they can be limited.
+int pgen_decl(pgen_state* g, pgen_type type) {
+    bool constant = type == PGEN_STRING && pgen_rand(g, 2) == 0;
+    pgen_indent(g);
+    fprintf(g->out, "%s v%d: %s = ", constant ? "const" : "var", g->next_id,
+            PGEN_TYPE_NAMES[type]);
+    switch (type) {
+    case PGEN_INT:
+        pgen_int_expr(g, 3);
+        break;
+    case PGEN_FLOAT:
+        pgen_float_expr(g, 3);
+        break;
+    case PGEN_STRING:
+        fprintf(g->out, "ifj.string(\"%s%s\")",
+                PGEN_STRINGS[pgen_rand(g, PGEN_COUNT(PGEN_STRINGS))],
+                PGEN_STRINGS[pgen_rand(g, PGEN_COUNT(PGEN_STRINGS))]);
+        break;
+    default:
+        if (pgen_rand(g, 3) == 0) {
+            fputs("null", g->out);
+        } else {
+            pgen_int_leaf(g);
+        }
+        break;
+    }
+    fputs(";\n", g->out);
+    int id = pgen_declare(g, type, constant);
+    if (type == PGEN_INT || type == PGEN_FLOAT) {
+        pgen_limit(g, id, type);
+    }
+    return id;
+}
+
+// Returns a variable of 'type', declared first if there is none.
+pgen_var* pgen_need(pgen_state* g, pgen_type type) {
+    pgen_var* var = pgen_pick(g, type, false);
+    if (var == NULL) {
+        pgen_decl(g, type);
+        var = pgen_pick(g, type, false);
+    }
+    if (var != NULL) {
+        var->used = true;
+    }
+    return var;
+}
+
+// Leaves the scope whose first variable is at 'mark', its variables are
+// written out if unused and assigned to themselves if never assigned.
+void pgen_leave(pgen_state* g, size_t mark) {
+    for (size_t i = mark; i < g->vars->len; i++) {
+        pgen_var* var = pgen_var_at(g, i);
+        if (!var->constant && !var->mutated) {
+            pgen_line(g, "v%d = v%d;", var->id, var->id);
+            var->used = true;
+        }
+        if (!var->used) {
+            pgen_line(g, "ifj.write(v%d);", var->id);
+        }
+    }
+    g->vars->len = mark;
+}
+
+int pgen_block(pgen_state* g, int depth, int count);
+
+void pgen_assign(pgen_state* g) {
+    pgen_type type = (pgen_type)pgen_rand(g, PGEN_VOID);
+    pgen_var* var = pgen_pick(g, type, true);
+    if (var == NULL) {
+        pgen_decl(g, type);
+        return;
+    }
+    var->mutated = true;
+    int id = var->id;
+    switch (type) {
+    case PGEN_INT:
+    case PGEN_FLOAT:
+        pgen_indent(g);
+        fprintf(g->out, "v%d = ", id);
+        if (type == PGEN_INT) {
+            pgen_int_expr(g, 3);
+        } else {
+            pgen_float_expr(g, 3);
+        }
+        fputs(";\n", g->out);
+        pgen_limit(g, id, type);
+        break;
+    case PGEN_STRING: {
+        pgen_var* other = pgen_pick(g, PGEN_STRING, false);
+        other->used = true;
+        pgen_line(g, "v%d = ifj.concat(v%d, v%d);", id, id, other->id);
+        pgen_line(g, "v%d = ifj.substring(v%d, 0, %d) orelse v%d;", id, id,
+                  PGEN_MAX_STRING, id);
+        pgen_find(g, id)->used = true;
+        break;
+    }
+    default:
+        pgen_indent(g);
+        fprintf(g->out, "v%d = ", id);
+        if (pgen_rand(g, 3) == 0) {
+            fputs("null", g->out);
+        } else {
+            pgen_int_leaf(g);
+        }
+        fputs(";\n", g->out);
+        break;
+    }
+}
+
+void pgen_builtin(pgen_state* g) {
+    pgen_var* a;
+    pgen_var* b;
+    int id;
+    switch (pgen_rand(g, 7)) {
+    case 0:
+        a = pgen_need(g, PGEN_STRING);
+        pgen_line(g, "const v%d: i32 = ifj.length(v%d);", g->next_id, a->id);
+        pgen_declare(g, PGEN_INT, true);
+        break;
+    case 1:
+        id = pgen_need(g, PGEN_STRING)->id;
+        b = pgen_need(g, PGEN_STRING);
+        pgen_line(g, "const v%d: i32 = ifj.strcmp(v%d, v%d);", g->next_id, id,
+                  b->id);
+        pgen_declare(g, PGEN_INT, true);
+        break;
+    case 2:
+        id = pgen_need(g, PGEN_STRING)->id;
+        pgen_indent(g);
+        fprintf(g->out, "const v%d: i32 = ifj.ord(v%d, ", g->next_id, id);
+        pgen_int_leaf(g);
+        fputs(");\n", g->out);
+        pgen_declare(g, PGEN_INT, true);
+        break;
+    case 3:
+        pgen_line(g, "const v%d: []u8 = ifj.chr(%d);", g->next_id,
+                  32 + pgen_rand(g, 95));
+        pgen_declare(g, PGEN_STRING, true);
+        break;
+    case 4:
+        id = pgen_need(g, PGEN_STRING)->id;
+        b = pgen_need(g, PGEN_STRING);
+        pgen_indent(g);
+        fprintf(g->out, "const v%d: []u8 = ifj.substring(v%d, ", g->next_id,
+                id);
+        pgen_int_leaf(g);
+        fputs(", ", g->out);
+        pgen_int_leaf(g);
+        fprintf(g->out, ") orelse v%d;\n", b->id);
+        pgen_declare(g, PGEN_STRING, true);
+        break;
+    case 5:
+        a = pgen_need(g, PGEN_INT);
+        pgen_line(g, "const v%d: f64 = ifj.i2f(v%d);", g->next_id, a->id);
+        pgen_declare(g, PGEN_FLOAT, true);
+        break;
+    default:
+        a = pgen_need(g, PGEN_FLOAT);
+        pgen_line(g, "const v%d: i32 = ifj.f2i(v%d);", g->next_id, a->id);
+        pgen_declare(g, PGEN_INT, true);
+        break;
+    }
+}
+
+// Calls a random earlier function whose cost the loops around allow.
+void pgen_call(pgen_state* g) {
+    int count = 0;
+    for (int f = 0; f < g->func_count; f++) {
+        count += g->funcs[f].cost * g->mult <= PGEN_MAX_CALL_COST;
+    }
+    if (count == 0) {
+        pgen_line(g, "ifj.write(%d);", pgen_rand(g, 10));
+        return;
+    }
+    int pick = pgen_rand(g, count);
+    pgen_func* func = NULL;
+    for (int f = 0; f < g->func_count && func == NULL; f++) {
+        if (g->funcs[f].cost * g->mult <= PGEN_MAX_CALL_COST && pick-- == 0) {
+            func = &g->funcs[f];
+        }
+    }
+
+    // The arguments are variables or number literals, the variables are
+    // declared before the call.
+    int args[PGEN_MAX_PARAMS];
+    for (int p = 0; p < func->param_count; p++) {
+        pgen_var* var =
+            func->params[p] != PGEN_STRING && pgen_rand(g, 4) == 0
+                ? NULL
+                : pgen_need(g, func->params[p]);
+        args[p] = var == NULL ? -1 : var->id;
+    }
+    pgen_indent(g);
+    if (func->ret != PGEN_VOID) {
+        fprintf(g->out, "const v%d: %s = ", g->next_id,
+                PGEN_TYPE_NAMES[func->ret]);
+    }
+    fprintf(g->out, "fn%d(", func->id);
+    for (int p = 0; p < func->param_count; p++) {
+        if (p > 0) {
+            fputs(", ", g->out);
+        }
+        if (args[p] >= 0) {
+            fprintf(g->out, "v%d", args[p]);
+        } else if (func->params[p] == PGEN_INT) {
+            fprintf(g->out, "%d", pgen_rand(g, 21));
+        } else {
+            fputs(PGEN_FLOATS[pgen_rand(g, PGEN_COUNT(PGEN_FLOATS))], g->out);
+        }
+    }
+    fputs(");\n", g->out);
+    if (func->ret != PGEN_VOID) {
+        pgen_declare(g, func->ret, true);
+    }
+    g->cost += func->cost * g->mult;
+}
+
+// Generates a statement, compound ones with at most 'count' statements
+// inside. Returns the number of statements generated.
+int pgen_stmt(pgen_state* g, int depth, int count) {
+    int total = 0;
+    for (int k = 0; k < PGEN_S_COUNT; k++) {
+        total += k < PGEN_S_IF || depth < g->opts->depth ? PGEN_WEIGHTS[k] : 0;
+    }
+    int pick = pgen_rand(g, total);
+    pgen_stmt_kind kind = PGEN_S_DECL;
+    while (pick >= PGEN_WEIGHTS[kind]) {
+        pick -= PGEN_WEIGHTS[kind];
+        kind++;
+    }
+
+    g->cost += g->mult;
+    int inner = count <= 1 ? 0
+                           : 1 + pgen_rand(g, count - 1 < PGEN_MAX_BLOCK
+                                                  ? count - 1
+                                                  : PGEN_MAX_BLOCK);
+    int made = 1;
+    pgen_var* var;
+    int id;
+    switch (kind) {
+    case PGEN_S_DECL:
+        pgen_decl(g, (pgen_type)pgen_rand(g, PGEN_VOID));
+        break;
+    case PGEN_S_ASSIGN:
+        pgen_assign(g);
+        break;
+    case PGEN_S_ORELSE:
+        id = pgen_need(g, PGEN_OPT_INT)->id;
+        pgen_indent(g);
+        fprintf(g->out, "const v%d: i32 = v%d orelse ", g->next_id, id);
+        pgen_int_leaf(g);
+        fputs(";\n", g->out);
+        pgen_declare(g, PGEN_INT, true);
+        break;
+    case PGEN_S_BUILTIN:
+        pgen_builtin(g);
+        break;
+    case PGEN_S_CALL:
+        pgen_call(g);
+        break;
+    case PGEN_S_WRITE:
+        var = pgen_pick(g, (pgen_type)pgen_rand(g, PGEN_VOID), false);
+        if (var != NULL) {
+            var->used = true;
+            pgen_line(g, "ifj.write(v%d);", var->id);
+        } else {
+            pgen_line(g, "ifj.write(%d);", pgen_rand(g, 10));
+        }
+        break;
+    case PGEN_S_IF: {
+        pgen_indent(g);
+        fputs("if (", g->out);
+        pgen_condition(g);
+        fputs(") {\n", g->out);
+        int then_count = inner / 2 + inner % 2;
+        made += pgen_block(g, depth + 1, then_count);
+        pgen_line(g, "} else {");
+        made += pgen_block(g, depth + 1, inner - then_count);
+        pgen_line(g, "}");
+        break;
+    }
+    case PGEN_S_IF_OPT: {
+        id = pgen_need(g, PGEN_OPT_INT)->id;
+        pgen_line(g, "if (v%d) |v%d| {", id, g->next_id);
+        g->indent++;
+        size_t mark = g->vars->len;
+        pgen_declare(g, PGEN_INT, true);
+        g->indent--;
+        int then_count = inner / 2 + inner % 2;
+        made += pgen_block(g, depth + 1, then_count);
+        g->indent++;
+        pgen_leave(g, mark);
+        g->indent--;
+        pgen_line(g, "} else {");
+        made += pgen_block(g, depth + 1, inner - then_count);
+        pgen_line(g, "}");
+        break;
+    }
+    case PGEN_S_WHILE: {
+        int iterations = 1 + pgen_rand(g, g->opts->iterations);
+        id = g->next_id;
+        pgen_line(g, "var v%d: i32 = 0;", id);
+        pgen_declare(g, PGEN_INT, false);
+        var = pgen_find(g, id);
+        var->used = var->mutated = var->locked = true;
+        pgen_line(g, "while (v%d < %d) {", id, iterations);
+        long mult = g->mult;
+        g->mult *= iterations;
+        made += pgen_block(g, depth + 1, inner);
+        g->mult = mult;
+        pgen_line(g, "    v%d = v%d + 1;", id, id);
+        pgen_line(g, "}");
+        break;
+    }
+    default: {
+        // An optional counting down to null.
+        int iterations = 1 + pgen_rand(g, g->opts->iterations);
+        id = g->next_id;
+        pgen_line(g, "var v%d: ?i32 = %d;", id, iterations - 1);
+        pgen_declare(g, PGEN_OPT_INT, false);
+        var = pgen_find(g, id);
+        var->used = var->mutated = var->locked = true;
+        int value = g->next_id;
+        pgen_line(g, "while (v%d) |v%d| {", id, value);
+        g->indent++;
+        size_t mark = g->vars->len;
+        pgen_declare(g, PGEN_INT, true);
+        pgen_find(g, value)->used = true;
+        g->indent--;
+        long mult = g->mult;
+        g->mult *= iterations;
+        made += pgen_block(g, depth + 1, inner);
+        g->mult = mult;
+        g->indent++;
+        pgen_line(g, "if (v%d > 0) {", value);
+        pgen_line(g, "    v%d = v%d - 1;", id, value);
+        pgen_line(g, "} else {");
+        pgen_line(g, "    v%d = null;", id);
+        pgen_line(g, "}");
+        pgen_leave(g, mark);
+        g->indent--;
+        pgen_line(g, "}");
+        break;
+    }
+    }
+    return made;
+}
+
+// Generates an indented block of 'count' statements in a scope of its own.
+// Returns the number of statements generated.
+int pgen_block(pgen_state* g, int depth, int count) {
+    g->indent++;
+    size_t mark = g->vars->len;
+    int made = 0;
+    while (made < count && g->ok) {
+        made += pgen_stmt(g, depth, count - made);
+    }
+    pgen_leave(g, mark);
+    g->indent--;
+    return made;
+}
+
+// Generates the function 'fn<id>' with random parameters and result.
+void pgen_function(pgen_state* g, int count) {
+    pgen_func* func = &g->funcs[g->func_count];
+    *func = (pgen_func){.id = g->next_id++,
+                        .param_count = pgen_rand(g, PGEN_MAX_PARAMS + 1)};
+    int ret = pgen_rand(g, 3);
+    func->ret = ret == 0 ? PGEN_VOID : ret == 1 ? PGEN_INT : PGEN_FLOAT;
+
+    size_t mark = g->vars->len;
+    fprintf(g->out, "pub fn fn%d(", func->id);
+    for (int p = 0; p < func->param_count; p++) {
+        int type = pgen_rand(g, 3);
+        func->params[p] = (pgen_type)type;
+        fprintf(g->out, "%sv%d: %s", p > 0 ? ", " : "", g->next_id,
+                PGEN_TYPE_NAMES[type]);
+        pgen_declare(g, func->params[p], true);
+    }
+    fprintf(g->out, ") %s {\n", PGEN_TYPE_NAMES[func->ret]);
+
+    g->cost = 1;
+    g->mult = 1;
+    // The parameters and the result live in the scope of the whole body.
+    pgen_block(g, 0, count);
+    g->indent++;
+    int result = -1;
+    if (func->ret != PGEN_VOID) {
+        result = pgen_decl(g, func->ret);
+        pgen_find(g, result)->used = true;
+    }
+    pgen_leave(g, mark);
+    if (result >= 0) {
+        pgen_line(g, "return v%d;", result);
+    }
+    g->indent--;
+    fputs("}\n", g->out);
+    func->cost = g->cost;
+    g->func_count++;
+}
+
+// Writes a random program of the shape given by 'opts' to 'out'.
+error_code pgen_program(const pgen_options* opts, FILE* out) {
+    pgen_state g = {.out = out,
+                    .opts = opts,
+                    .rand = opts->seed * 2654435761u + 1,
+                    .vars = vec_init(32, sizeof(pgen_var)),
+                    .ok = true};
+    if (g.vars == NULL) {
+        return INTERNAL_ERR;
+    }
+
+    int functions = opts->functions < PGEN_MAX_FUNCS ? opts->functions
+                                                     : PGEN_MAX_FUNCS;
+    int per_function = opts->statements / (functions + 1);
+    fputs("const ifj = @import(\"ifj24.zig\");\n", out);
+    for (int f = 0; f < functions && g.ok; f++) {
+        pgen_function(&g, per_function);
+    }
+
+    fputs("pub fn main() void {\n", out);
+    g.cost = 1;
+    g.mult = 1;
+    g.indent = 1;
+    size_t mark = g.vars->len;
+    for (int i = 0; i < 2; i++) {
+        pgen_line(&g, "var v%d: ?i32 = ifj.readi32();", g.next_id);
+        pgen_declare(&g, PGEN_OPT_INT, false);
+    }
+    g.indent = 0;
+    pgen_block(&g, 0, opts->statements - per_function * functions);
+    g.indent = 1;
+    pgen_leave(&g, mark);
+    fputs("}\n", out);
+
+    bool ok = g.ok;
+    vec_free(&g.vars);
+    return ok ? NO_ERR : INTERNAL_ERR;
+}
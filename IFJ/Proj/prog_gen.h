@@ -0,0 +1,31 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Generator of random well-typed IFJ24 programs for comparing the code of
+// the compiler at different optimization levels and for measuring it.
+
+#ifndef IFJ_PROJEKT_2024_PROG_GEN_H
+#define IFJ_PROJEKT_2024_PROG_GEN_H
+
+#include "error.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Line the generated programs read with ifj.readi32() in main.
+#define PGEN_INPUT "5\n3\n"
+
+// Shape of the generated program.
+typedef struct {
+    uint64_t seed;  // The same seed and options give the same program
+    int statements; // Statements in all the functions together
+    int functions;  // Functions besides main
+    int depth;      // Deepest nesting of IF and WHILE
+    int iterations; // Most iterations of a single loop
+} pgen_options;
+
+void pgen_defaults(pgen_options* opts);
+
+error_code pgen_program(const pgen_options* opts, FILE* out);
+
+#endif // IFJ_PROJEKT_2024_PROG_GEN_H
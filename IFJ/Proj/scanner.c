@@ -144,6 +144,8 @@ error_code set_int_lit(token* const token, vector* in_vec) {
     char* string_convert = vec_to_str(&in_vec);
 
     char* endptr;
+    // Only the error of this conversion is checked below.
+    errno = 0;
     token->content.int_lit = strtol(string_convert, &endptr, 10);
     free(string_convert);
     if (token->content.int_lit == 0 && errno != 0) {
@@ -167,6 +169,7 @@ error_code set_float_lit(token* const token, vector* in_vec) {
     char* string_convert = vec_to_str(&in_vec);
 
     char* endptr;
+    errno = 0;
     token->content.float_lit = strtod(string_convert, &endptr);
     free(string_convert);
     if (token->content.float_lit == 0.0F && errno != 0) {
@@ -67,7 +67,7 @@ char* get_scope_id(scope_stack* scp_s) {
     char* c;
 
     for (size_t i = 0; i < scp_s->stack->len - 1; i++) {
-        uint16_t* id = vec_get(scp_s->stack, i);
+        uint16_t* id = vec_at(scp_s->stack, i);
 
         if (id == NULL) {
             vec_free(&dyn_str);
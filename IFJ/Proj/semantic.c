@@ -5,7 +5,9 @@
 #include "ast.h"
 #include "data_types.h"
 #include "error.h"
+#include "parallel.h"
 #include "scope_stack.h"
+#include "stats.h"
 #include "symtable.h"
 #include "util.h"
 #include "vector.h"
@@ -59,16 +61,14 @@ error_code check_variable_usage(struct rb_tree_node* node) {
 // Enter a new scope by pushing a new symbol table onto the 'symtable_stack'
 // symbols declare in the current scope will always be pushed to this
 error_code enter_scope(vector* symtable_stack) {
-    b_tree* symtable = malloc(sizeof(b_tree));
+    // The stack holds the symtables themselves, the pushed one is copied.
+    b_tree symtable;
+    rb_tree_init(&symtable);
+    stats_count(COUNT_SCOPES, 1);
 
-    // Check whether the memory was allocated succesfully
-    if (symtable == NULL)
+    if (vec_push(symtable_stack, &symtable) == NULL)
         return INTERNAL_ERR;
 
-    rb_tree_init(symtable);
-
-    vec_push(symtable_stack, symtable);
-
     return NO_ERR;
 }
 
@@ -92,7 +92,7 @@ b_tree_data* find_symbol(vector* symtable_stack, const char* symbol) {
     DEBUG_PRINT("Finding symbol: %s", symbol);
     assert(symbol != NULL);
     for (int i = symtable_stack->len - 1; i >= 0; i--) {
-        b_tree* symtable = vec_get(symtable_stack, i);
+        b_tree* symtable = vec_at(symtable_stack, i);
         b_tree_data* data = rb_tree_find(symtable, symbol);
         if (data != NULL) {
             return data;
@@ -130,7 +130,7 @@ int declare_symbol(vector* symtable_stack, char* symbol, b_tree_data data) {
 
     // Check if the symbol is declared in any of the previous scopes
     for (size_t i = 0; i < symtable_stack->len - 1; i++) {
-        symtable = vec_get(symtable_stack, i);
+        symtable = vec_at(symtable_stack, i);
 
         if (rb_tree_find(symtable, symbol) != NULL) {
             ERROR_PRINT("Redefinition of %s", symbol);
@@ -145,7 +145,9 @@ int declare_symbol(vector* symtable_stack, char* symbol, b_tree_data data) {
     }
 
     int res = rb_tree_insert(symtable, dup_sym, data);
-    if (res == INSERT_ALREADY_IN) {
+    if (res == INSERT_SUCCESS) {
+        stats_count(COUNT_SYMBOLS, 1);
+    } else if (res == INSERT_ALREADY_IN) {
         ERROR_PRINT("Redefinition of %s", dup_sym);
     }
 
@@ -172,7 +174,7 @@ bool expr_is_constant(node* n, vector* symtable_stack) {
 // running semantic analysis, returns result of 'declare_symbol()'.
 int populate_with_builtins(vector* symtable_stack) {
     data_type d;
-    b_tree_data data;
+    b_tree_data data = {0};
     int res;
     data.symbol_type = SYM_FUNC;
 
@@ -364,6 +366,7 @@ error_code call_i2f(node* n) {
             break;
         }
     }
+    func->ancestor = p;
     n->ancestor = NULL;
 
     node* param_list = create_node(INPUT_PARAM_LIST);
@@ -412,6 +415,7 @@ error_code call_f2i(node* n) {
             break;
         }
     }
+    func->ancestor = p;
     n->ancestor = NULL;
 
     node* param_list = create_node(INPUT_PARAM_LIST);
@@ -853,10 +857,12 @@ error_code expression(node* ast) {
 }
 
 error_code param(node* ast, vector* symtable_stack, scope_stack* scp_s) {
-    b_tree_data data;
+    b_tree_data data = {0};
     data.symbol_type = SYM_CONST;
     data.return_type = ast->data.ret_value;
     data.initialized = true;
+    // Parameters are not variables, leaving one unused is not an error.
+    data.used = true;
     data.scope_id = get_scope_id(scp_s);
     ast->data.scope_id = d_string(data.scope_id);
 
@@ -975,7 +981,7 @@ error_code cond(node* ast, vector* symtable_stack, scope_stack* scp_s) {
             null_cond->data.ret_value = U8;
             null_cond->data.scope_id = get_scope_id(scp_s);
 
-            b_tree_data data;
+            b_tree_data data = {0};
             data.initialized = true;
             data.return_type = U8;
             data.symbol_type = SYM_CONST;
@@ -995,7 +1001,7 @@ error_code cond(node* ast, vector* symtable_stack, scope_stack* scp_s) {
         null_cond->data.ret_value = r_type;
         null_cond->data.scope_id = get_scope_id(scp_s);
 
-        b_tree_data data;
+        b_tree_data data = {0};
         data.initialized = true;
         data.return_type = r_type;
         data.symbol_type = SYM_CONST;
@@ -1209,7 +1215,7 @@ error_code declare_function_signatures(node* ast, vector* symtable_stack) {
             continue;
 
         // Set basic symbol information.
-        b_tree_data data;
+        b_tree_data data = {0};
         data.symbol_type = SYM_FUNC;
         data.return_type = f_def->data.ret_value;
 
@@ -1335,6 +1341,29 @@ error_code orelse(node* ast) {
     return SEM_COMPATIBILITY_ERR;
 }
 
+// Declares the signatures of all the functions in 'ast' and checks main.
+// Afterwards the function bodies can be analysed independently.
+error_code declare_program(node* ast, vector* symtable_stack) {
+    // Prioritly declare function signatures
+    error_code return_code = declare_function_signatures(ast, symtable_stack);
+    if (return_code != NO_ERR)
+        return return_code;
+    // Missing main
+    b_tree_data* main_data = find_symbol(symtable_stack, "main");
+    if (main_data == NULL) {
+        ERROR_PRINT("Main is not declared %s", "");
+        return SEM_UNDEFINED_ERR;
+    }
+    if (main_data == NULL || main_data->return_type != VOID ||
+        main_data->func_parameters != NULL) {
+        ERROR_PRINT("Main is declared with incorrect return type or "
+                    "incorrect parameters%s",
+                    "");
+        return SEM_FUNCTION_ERR;
+    }
+    return NO_ERR;
+}
+
 error_code semantically_analyse(node* ast, vector* symtable_stack,
                                 scope_stack* scp_s) {
 
@@ -1374,23 +1403,9 @@ error_code semantically_analyse(node* ast, vector* symtable_stack,
     }
 
     if (ast->data.type == PROG) {
-        // Prioritly declare function signatures
-        return_code = declare_function_signatures(ast, symtable_stack);
+        return_code = declare_program(ast, symtable_stack);
         if (return_code != NO_ERR)
             return return_code;
-        // Missing main
-        b_tree_data* main_data = find_symbol(symtable_stack, "main");
-        if (main_data == NULL) {
-            ERROR_PRINT("Main is not declared %s", "");
-            return SEM_UNDEFINED_ERR;
-        }
-        if (main_data == NULL || main_data->return_type != VOID ||
-            main_data->func_parameters != NULL) {
-            ERROR_PRINT("Main is declared with incorrect return type or "
-                        "incorrect parameters%s",
-                        "");
-            return SEM_FUNCTION_ERR;
-        }
     }
 
     // Recursively analyse the children of this node.
@@ -1402,6 +1417,9 @@ error_code semantically_analyse(node* ast, vector* symtable_stack,
             ERROR_PRINT("Semantic error: %s - %s",
                         NODE_TYPE_STRINGS[ast->children[i]->data.type],
                         ERROR_STRINGS[return_code]);
+            if (ast->data.type == FUNC_DEF) {
+                scope_stack_free(&scp_s);
+            }
             return return_code;
         }
 
@@ -1523,3 +1541,87 @@ error_code semantically_analyse(node* ast, vector* symtable_stack,
 
     return err;
 }
+
+// Shared state of the parallel analysis, every function has its own result.
+typedef struct {
+    node* ast;
+    vector* symtable_stack; // Global scope, only read by the workers
+    const bool* skip;       // Functions not to analyse, may be NULL
+    error_code* results;
+} semantic_job;
+
+// Analyses the function definition at 'index' of the program with its own
+// copy of the symtable stack, the global symtable itself is shared.
+void analyse_function_job(int index, void* arg) {
+    semantic_job* job = arg;
+    size_t global_len = job->symtable_stack->len;
+    if (job->skip != NULL && job->skip[index]) {
+        job->results[index] = NO_ERR;
+        return;
+    }
+
+    vector* symtable_stack = vec_init(global_len + 4, sizeof(b_tree*));
+    scope_stack* scp_s = scope_stack_init(3);
+    if (symtable_stack == NULL || scp_s == NULL) {
+        job->results[index] = INTERNAL_ERR;
+        if (symtable_stack != NULL) {
+            vec_free(&symtable_stack);
+        }
+        if (scp_s != NULL) {
+            scope_stack_free(&scp_s);
+        }
+        return;
+    }
+    for (size_t i = 0; i < global_len; i++) {
+        vec_push(symtable_stack, vec_get(job->symtable_stack, i));
+    }
+
+    job->results[index] = semantically_analyse(job->ast->children[index],
+                                               symtable_stack, scp_s);
+
+    // A failed analysis leaves its scopes behind.
+    while (symtable_stack->len > global_len) {
+        b_tree* symtable = vec_pop(symtable_stack);
+        if (symtable != NULL) {
+            rb_tree_free(symtable);
+            free(symtable);
+        }
+    }
+    vec_free(&symtable_stack);
+    scope_stack_free(&scp_s);
+}
+
+// Same as 'semantically_analyse()' on the PROG node, but the function bodies
+// are analysed on up to 'jobs' threads. The error of the first failing
+// function in source order is returned, like in the serial analysis.
+// Functions marked in 'skip' are only declared, their bodies are left as
+// parsed.
+error_code semantically_analyse_parallel(node* ast, vector* symtable_stack,
+                                         int jobs, const bool* skip) {
+    assert(ast->data.type == PROG);
+
+    error_code err = declare_program(ast, symtable_stack);
+    if (err != NO_ERR) {
+        return err;
+    }
+
+    semantic_job job = {
+        .ast = ast, .symtable_stack = symtable_stack, .skip = skip};
+    job.results = calloc(ast->child_count + 1, sizeof(error_code));
+    if (job.results == NULL) {
+        return INTERNAL_ERR;
+    }
+    parallel_for(ast->child_count, jobs, analyse_function_job, &job);
+
+    for (int i = 0; i < ast->child_count; i++) {
+        if (job.results[i] != NO_ERR) {
+            ERROR_PRINT("Semantic error: %s - %s",
+                        NODE_TYPE_STRINGS[ast->children[i]->data.type],
+                        ERROR_STRINGS[job.results[i]]);
+            err = job.results[i];
+            break;
+        }
+    }
+    free(job.results);
+    return err;
+}
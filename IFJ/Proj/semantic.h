@@ -13,6 +13,8 @@
 
 error_code semantically_analyse(node* ast, vector* symtable_stack,
                                 scope_stack* scp_s);
+error_code semantically_analyse_parallel(node* ast, vector* symtable_stack,
+                                         int jobs, const bool* skip);
 error_code enter_scope(vector* symtable_stack);
 error_code leave_scope(vector* symtable_stack);
 int populate_with_builtins(vector* symtable_stack);
@@ -0,0 +1,158 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Compilation of many programs by one process, each sent as a job over a
+// stream.
+//
+// A job is the length of the source in decimal on a line of its own,
+// followed by that many bytes of the source. It is answered by a line with
+// the exit code the compiler would end with and the length of the code,
+// followed by that many bytes of the code. A failed compilation has no
+// code. The jobs are answered in their order until the end of the stream.
+
+#include "server.h"
+
+#include <ctype.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Reads the header of the next job into 'len'. Returns 1 on success, 0 at
+// the end of the stream and -1 when the header is broken.
+int server_read_header(FILE* in, size_t* len) {
+    int c = fgetc(in);
+    if (c == EOF) {
+        return 0;
+    }
+    *len = 0;
+    int digits = 0;
+    for (; isdigit(c); c = fgetc(in), digits++) {
+        *len = *len * 10 + (size_t)(c - '0');
+        if (*len > SERVER_MAX_SOURCE) {
+            return -1;
+        }
+    }
+    return digits > 0 && c == '\n' ? 1 : -1;
+}
+
+// Compiles the 'len' bytes of source read from 'in' and writes the answer
+// to 'out'. Errors of the program go into the answer, only failures of the
+// streams themselves are returned.
+error_code server_job(driver* drv, const driver_options* opts, FILE* in,
+                      FILE* out, size_t len) {
+    char* source = malloc(len + 1);
+    if (source == NULL) {
+        return INTERNAL_ERR;
+    }
+    if (fread(source, 1, len, in) != len) {
+        fprintf(stderr, "The job ended before its whole source was read.\n");
+        free(source);
+        return INTERNAL_ERR;
+    }
+
+    char* code = NULL;
+    size_t code_len = 0;
+    FILE* src_file = fmemopen(source, len, "r");
+    FILE* code_file = open_memstream(&code, &code_len);
+    error_code err = INTERNAL_ERR;
+    if (src_file != NULL && code_file != NULL) {
+        err = driver_compile(drv, opts, src_file, code_file);
+    }
+    if (src_file != NULL) {
+        fclose(src_file);
+    }
+    if (code_file != NULL && fclose(code_file) != 0) {
+        err = INTERNAL_ERR;
+    }
+    if (err != NO_ERR) {
+        code_len = 0;
+    }
+
+    bool written = fprintf(out, "%d %zu\n", err, code_len) > 0 &&
+                   fwrite(code, 1, code_len, out) == code_len &&
+                   fflush(out) == 0;
+    free(code);
+    free(source);
+    return written ? NO_ERR : INTERNAL_ERR;
+}
+
+// Answers the jobs read from 'in' until its end. Returns INTERNAL_ERR when
+// a request is broken or the answer cannot be written.
+error_code server_serve(driver* drv, const driver_options* opts, FILE* in,
+                        FILE* out) {
+    size_t len;
+    int header;
+    while ((header = server_read_header(in, &len)) == 1) {
+        error_code err = server_job(drv, opts, in, out, len);
+        if (err != NO_ERR) {
+            return err;
+        }
+    }
+    if (header < 0) {
+        fprintf(stderr, "Invalid job header, expected the source length.\n");
+        return INTERNAL_ERR;
+    }
+    return NO_ERR;
+}
+
+// Listens on the Unix socket at 'path' and serves its connections one after
+// another. Returns only when the socket fails.
+error_code server_listen(driver* drv, const driver_options* opts,
+                         const char* path) {
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path %s is too long\n", path);
+        return INTERNAL_ERR;
+    }
+    strcpy(addr.sun_path, path);
+
+    int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        return INTERNAL_ERR;
+    }
+    unlink(path);
+    if (bind(sock, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+        listen(sock, 16) != 0) {
+        perror(path);
+        close(sock);
+        return INTERNAL_ERR;
+    }
+    // A client leaving early must not end the server.
+    signal(SIGPIPE, SIG_IGN);
+
+    while (true) {
+        int conn = accept(sock, NULL, NULL);
+        if (conn < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            perror("accept");
+            break;
+        }
+        int conn_out = dup(conn);
+        FILE* in = fdopen(conn, "r");
+        FILE* out = conn_out < 0 ? NULL : fdopen(conn_out, "w");
+        if (in != NULL && out != NULL) {
+            // A broken connection ends only itself.
+            server_serve(drv, opts, in, out);
+        }
+        if (in != NULL) {
+            fclose(in);
+        } else {
+            close(conn);
+        }
+        if (out != NULL) {
+            fclose(out);
+        } else if (conn_out >= 0) {
+            close(conn_out);
+        }
+    }
+    close(sock);
+    unlink(path);
+    return INTERNAL_ERR;
+}
@@ -0,0 +1,24 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Compilation of many programs by one process, each sent as a job over a
+// stream.
+
+#ifndef IFJ_PROJEKT_2024_SERVER_H
+#define IFJ_PROJEKT_2024_SERVER_H
+
+#include "driver.h"
+#include "error.h"
+
+#include <stdio.h>
+
+// Longer sources are refused, the request is considered broken.
+#define SERVER_MAX_SOURCE ((size_t)256 * 1024 * 1024)
+
+error_code server_serve(driver* drv, const driver_options* opts, FILE* in,
+                        FILE* out);
+
+error_code server_listen(driver* drv, const driver_options* opts,
+                         const char* path);
+
+#endif // IFJ_PROJEKT_2024_SERVER_H
@@ -0,0 +1,145 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Time and memory taken by the compilation phases and counts of what they
+// produced.
+//
+// The vectors and the tree nodes allocate through the track_* wrappers,
+// which keep the number of bytes currently allocated and its peak. The size
+// of a block is asked from the allocator, so no header is added and a block
+// may still be freed by plain free() when it leaves the tracked code, it is
+// only removed from the count by track_forget() before that.
+//
+// Functions are analysed and generated on several threads, so the counters
+// are atomic.
+
+#include "stats.h"
+
+#include <malloc.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "util.h"
+
+atomic_size_t track_current_bytes;
+atomic_size_t track_peak_bytes;
+atomic_size_t stats_counts[COUNT_COUNT];
+
+double stats_phase_start[PHASE_COUNT];
+double stats_phase_ms[PHASE_COUNT];
+size_t stats_phase_peak[PHASE_COUNT];
+
+const char* const STATS_PHASE_NAMES[PHASE_COUNT] = {
+    "parse", "semantic", "optimize", "generate", "peephole", "ir", "output"};
+
+const char* const STATS_COUNT_NAMES[COUNT_COUNT] = {
+    "tokens", "ast nodes", "symbols", "scopes", "instructions"};
+
+// Adds the block 'ptr' to the allocated bytes.
+void track_add(void* ptr) {
+    size_t size = malloc_usable_size(ptr);
+    size_t now = atomic_fetch_add_explicit(&track_current_bytes, size,
+                                           memory_order_relaxed) +
+                 size;
+    size_t peak =
+        atomic_load_explicit(&track_peak_bytes, memory_order_relaxed);
+    while (now > peak && !atomic_compare_exchange_weak_explicit(
+                             &track_peak_bytes, &peak, now,
+                             memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// Removes the block 'ptr' from the allocated bytes, it is not freed.
+void track_forget(void* ptr) {
+    if (ptr != NULL) {
+        atomic_fetch_sub_explicit(&track_current_bytes,
+                                  malloc_usable_size(ptr),
+                                  memory_order_relaxed);
+    }
+}
+
+// malloc() counted in the allocated bytes.
+void* track_malloc(size_t size) {
+    void* ptr = malloc(size);
+    if (ptr != NULL) {
+        track_add(ptr);
+    }
+    return ptr;
+}
+
+// calloc() counted in the allocated bytes.
+void* track_calloc(size_t count, size_t size) {
+    void* ptr = calloc(count, size);
+    if (ptr != NULL) {
+        track_add(ptr);
+    }
+    return ptr;
+}
+
+// reallocarray() counted in the allocated bytes. On failure 'ptr' stays
+// allocated and counted.
+void* track_reallocarray(void* ptr, size_t count, size_t size) {
+    size_t old = ptr != NULL ? malloc_usable_size(ptr) : 0;
+    void* new_ptr = reallocarray(ptr, count, size);
+    if (new_ptr != NULL) {
+        atomic_fetch_sub_explicit(&track_current_bytes, old,
+                                  memory_order_relaxed);
+        track_add(new_ptr);
+    }
+    return new_ptr;
+}
+
+// free() of a block allocated by the track_* functions.
+void track_free(void* ptr) {
+    track_forget(ptr);
+    free(ptr);
+}
+
+// Returns the number of bytes currently allocated by the track_* functions.
+size_t track_current() {
+    return atomic_load_explicit(&track_current_bytes, memory_order_relaxed);
+}
+
+// Adds 'n' to the counter 'c'.
+void stats_count(counter c, size_t n) {
+    atomic_fetch_add_explicit(&stats_counts[c], n, memory_order_relaxed);
+}
+
+// Starts measuring the phase 'p', its peak starts at what is allocated now.
+void stats_begin(phase p) {
+    atomic_store_explicit(&track_peak_bytes, track_current(),
+                          memory_order_relaxed);
+    stats_phase_start[p] = now_ms();
+}
+
+// Ends measuring the phase 'p'. A phase may be measured in several parts,
+// their times are summed up.
+void stats_end(phase p) {
+    stats_phase_ms[p] += now_ms() - stats_phase_start[p];
+    size_t peak =
+        atomic_load_explicit(&track_peak_bytes, memory_order_relaxed);
+    if (peak > stats_phase_peak[p]) {
+        stats_phase_peak[p] = peak;
+    }
+}
+
+// Writes the time and peak memory of every phase and the counters to 'out'.
+void stats_report(FILE* out) {
+    double total_ms = 0;
+    size_t total_peak = 0;
+    fprintf(out, "%-10s %10s %14s\n", "phase", "time [ms]", "peak [B]");
+    for (int p = 0; p < PHASE_COUNT; p++) {
+        fprintf(out, "%-10s %10.3f %14zu\n", STATS_PHASE_NAMES[p],
+                stats_phase_ms[p], stats_phase_peak[p]);
+        total_ms += stats_phase_ms[p];
+        if (stats_phase_peak[p] > total_peak) {
+            total_peak = stats_phase_peak[p];
+        }
+    }
+    fprintf(out, "%-10s %10.3f %14zu\n", "total", total_ms, total_peak);
+    for (int c = 0; c < COUNT_COUNT; c++) {
+        fprintf(out, "%s: %zu\n", STATS_COUNT_NAMES[c],
+                atomic_load_explicit(&stats_counts[c], memory_order_relaxed));
+    }
+}
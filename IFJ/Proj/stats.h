@@ -0,0 +1,53 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Time and memory taken by the compilation phases and counts of what they
+// produced.
+
+#ifndef IFJ_PROJEKT_2024_STATS_H
+#define IFJ_PROJEKT_2024_STATS_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+typedef enum {
+    PHASE_PARSE,
+    PHASE_SEMANTIC,
+    PHASE_OPTIMIZE,
+    PHASE_GENERATE,
+    PHASE_PEEPHOLE,
+    PHASE_IR,
+    PHASE_OUTPUT,
+    PHASE_COUNT
+} phase;
+
+typedef enum {
+    COUNT_TOKENS,
+    COUNT_NODES,
+    COUNT_SYMBOLS,
+    COUNT_SCOPES,
+    COUNT_INSTRS,
+    COUNT_COUNT
+} counter;
+
+void* track_malloc(size_t size);
+
+void* track_calloc(size_t count, size_t size);
+
+void* track_reallocarray(void* ptr, size_t count, size_t size);
+
+void track_free(void* ptr);
+
+void track_forget(void* ptr);
+
+size_t track_current();
+
+void stats_count(counter c, size_t n);
+
+void stats_begin(phase p);
+
+void stats_end(phase p);
+
+void stats_report(FILE* out);
+
+#endif // IFJ_PROJEKT_2024_STATS_H
@@ -0,0 +1,154 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Building of the output text in a char vector.
+//
+// The numbers are formatted without going through printf, the results are
+// the same as those of "%d" and "%a". The text is written to the output in
+// blocks of about STRBUF_FLUSH_SIZE bytes instead of piece by piece.
+
+#include "strbuf.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+// Marks 8 consecutive bytes starting at 'n' in STRBUF_ESCAPED.
+#define STRBUF_ESCAPED_8(n)                                                    \
+    [n] = true, [n + 1] = true, [n + 2] = true, [n + 3] = true,                \
+    [n + 4] = true, [n + 5] = true, [n + 6] = true, [n + 7] = true
+
+// Bytes of a string literal written as an escape sequence '\ddd': the
+// control characters, space, '#' and '\'. Bytes above 127 are copied.
+const bool STRBUF_ESCAPED[256] = {
+    STRBUF_ESCAPED_8(0),  STRBUF_ESCAPED_8(8), STRBUF_ESCAPED_8(16),
+    STRBUF_ESCAPED_8(24), [32] = true,         ['#'] = true,
+    ['\\'] = true,
+};
+
+const char STRBUF_HEX_DIGITS[] = "0123456789abcdef";
+
+// Appends 'len' bytes of 'str'.
+bool strbuf_put(vector* sb, const char* str, size_t len) {
+    return vec_push_n(sb, str, len) != NULL;
+}
+
+// Appends the string 'str'.
+bool strbuf_puts(vector* sb, const char* str) {
+    return strbuf_put(sb, str, strlen(str));
+}
+
+// Appends the character 'c'.
+bool strbuf_putc(vector* sb, char c) {
+    return vec_pushchar(sb, c) != NULL;
+}
+
+// Writes the decimal digits of 'value' right before 'end', returns where
+// they start.
+char* strbuf_digits(char* end, uint64_t value) {
+    do {
+        *--end = (char)('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    return end;
+}
+
+// Appends 'value' in decimal.
+bool strbuf_int(vector* sb, int64_t value) {
+    char buf[24];
+    char* end = buf + sizeof(buf);
+    // Negated as unsigned, so that the smallest value does not overflow.
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    char* start = strbuf_digits(end, magnitude);
+    if (value < 0) {
+        *--start = '-';
+    }
+    return strbuf_put(sb, start, end - start);
+}
+
+// Appends 'value' in the hexadecimal form of "%a".
+bool strbuf_float(vector* sb, double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    bool negative = bits >> 63;
+    int exponent = (int)((bits >> 52) & 0x7ff);
+    uint64_t fraction = bits & ((UINT64_C(1) << 52) - 1);
+
+    char buf[40];
+    char* p = buf;
+    if (negative) {
+        *p++ = '-';
+    }
+    if (exponent == 0x7ff) {
+        memcpy(p, fraction == 0 ? "inf" : "nan", 3);
+        return strbuf_put(sb, buf, p + 3 - buf);
+    }
+
+    *p++ = '0';
+    *p++ = 'x';
+    if (exponent == 0 && fraction == 0) {
+        memcpy(p, "0p+0", 4);
+        return strbuf_put(sb, buf, p + 4 - buf);
+    }
+    // Subnormal numbers keep the exponent of the smallest normal one.
+    *p++ = exponent == 0 ? '0' : '1';
+    exponent = exponent == 0 ? -1022 : exponent - 1023;
+
+    if (fraction != 0) {
+        *p++ = '.';
+        // 13 hexadecimal digits without the trailing zeros
+        int digits = 13;
+        while ((fraction & 0xf) == 0) {
+            fraction >>= 4;
+            digits--;
+        }
+        for (int i = digits - 1; i >= 0; i--) {
+            *p++ = STRBUF_HEX_DIGITS[(fraction >> (4 * i)) & 0xf];
+        }
+    }
+
+    *p++ = 'p';
+    *p++ = exponent < 0 ? '-' : '+';
+    char exp_buf[8];
+    char* exp_end = exp_buf + sizeof(exp_buf);
+    char* exp_start =
+        strbuf_digits(exp_end, exponent < 0 ? -exponent : exponent);
+    memcpy(p, exp_start, exp_end - exp_start);
+    p += exp_end - exp_start;
+    return strbuf_put(sb, buf, p - buf);
+}
+
+// Appends the string literal 'str' with the bytes marked in STRBUF_ESCAPED
+// written as '\ddd'. The other bytes are copied in runs.
+bool strbuf_escape(vector* sb, const char* str) {
+    const unsigned char* s = (const unsigned char*)str;
+    while (*s != '\0') {
+        const unsigned char* run = s;
+        while (*s != '\0' && !STRBUF_ESCAPED[*s]) {
+            s++;
+        }
+        if (s != run && !strbuf_put(sb, (const char*)run, s - run)) {
+            return false;
+        }
+        if (*s == '\0') {
+            break;
+        }
+        char code[4] = {'\\', (char)('0' + *s / 100),
+                        (char)('0' + *s / 10 % 10), (char)('0' + *s % 10)};
+        if (!strbuf_put(sb, code, sizeof(code))) {
+            return false;
+        }
+        s++;
+    }
+    return true;
+}
+
+// Writes the text built in 'sb' to 'out' and empties it.
+bool strbuf_flush(vector* sb, FILE* out) {
+    if (sb->len == 0) {
+        return true;
+    }
+    bool ok = fwrite(vec_get(sb, 0), 1, sb->len, out) == sb->len;
+    vec_clear(sb);
+    return ok;
+}
@@ -0,0 +1,32 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Building of the output text in a char vector.
+
+#ifndef IFJ_PROJEKT_2024_STRBUF_H
+#define IFJ_PROJEKT_2024_STRBUF_H
+
+#include "vector.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// The text is written out once the buffer holds this many bytes.
+#define STRBUF_FLUSH_SIZE (64 * 1024)
+
+bool strbuf_put(vector* sb, const char* str, size_t len);
+
+bool strbuf_puts(vector* sb, const char* str);
+
+bool strbuf_putc(vector* sb, char c);
+
+bool strbuf_int(vector* sb, int64_t value);
+
+bool strbuf_float(vector* sb, double value);
+
+bool strbuf_escape(vector* sb, const char* str);
+
+bool strbuf_flush(vector* sb, FILE* out);
+
+#endif // IFJ_PROJEKT_2024_STRBUF_H
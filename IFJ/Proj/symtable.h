@@ -24,8 +24,8 @@ typedef struct {
 } sym_param;
 
 // Data associated with the symbol.
-// TODO: optimization: Store comptime const values inside and then replace the
-// const variables with their values in AST.
+// Comptime const values are substituted into the AST by 'fold_constants()'
+// after the analysis, the symtable does not need to keep them.
 typedef struct {
     data_type return_type; // Symbol's declared data type
     sym_type symbol_type;
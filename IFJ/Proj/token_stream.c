@@ -0,0 +1,275 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Whole input scanned into an array of tokens the parser can index into.
+//
+// The input is read into memory first and the scanner runs over it in one
+// loop, the parser then walks the array and may look any number of tokens
+// ahead. Whitespace and comments are skipped here before each token, so the
+// span of a token covers exactly its lexeme.
+//
+// A lexical error does not stop the parse right away. It is remembered and
+// returned once the parser asks for the token it was found at, the parser
+// reports the same error at the same place as when it read the input token
+// by token.
+
+#include "token_stream.h"
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Reads the whole 'in' into 'ts->source'.
+error_code ts_read_source(token_stream* ts, FILE* in) {
+    size_t cap = 4096;
+    size_t len = 0;
+    char* source = malloc(cap);
+    if (source == NULL) {
+        return INTERNAL_ERR;
+    }
+    size_t read;
+    while ((read = fread(source + len, 1, cap - len, in)) > 0) {
+        len += read;
+        if (len == cap) {
+            char* grown = realloc(source, cap * 2);
+            if (grown == NULL) {
+                free(source);
+                return INTERNAL_ERR;
+            }
+            source = grown;
+            cap *= 2;
+        }
+    }
+    ts->source = source;
+    ts->source_len = len;
+    return NO_ERR;
+}
+
+// FNV-1a hash of 's'.
+uint32_t ts_hash(const char* s) {
+    uint32_t hash = 2166136261u;
+    for (; *s != '\0'; s++) {
+        hash = (hash ^ (unsigned char)*s) * 16777619u;
+    }
+    return hash;
+}
+
+// Puts the string with index 'index' into the hash table.
+void ts_table_put(token_stream* ts, uint32_t index) {
+    char* s = *(char**)vec_get(ts->strings, index);
+    size_t slot = ts_hash(s) & (ts->table_cap - 1);
+    while (ts->table[slot] != 0) {
+        slot = (slot + 1) & (ts->table_cap - 1);
+    }
+    // Indices are stored shifted by one, zero marks an empty slot.
+    ts->table[slot] = index + 1;
+}
+
+// Doubles the hash table and fills it again.
+bool ts_table_grow(token_stream* ts) {
+    size_t cap = ts->table_cap == 0 ? 256 : ts->table_cap * 2;
+    uint32_t* table = calloc(cap, sizeof(uint32_t));
+    if (table == NULL) {
+        return false;
+    }
+    free(ts->table);
+    ts->table = table;
+    ts->table_cap = cap;
+    for (size_t i = 0; i < ts->strings->len; i++) {
+        ts_table_put(ts, i);
+    }
+    return true;
+}
+
+// Returns the interned copy of 's' and frees 's' or returns NULL on
+// allocation failure, 's' is freed in both cases.
+char* ts_intern(token_stream* ts, char* s) {
+    if (ts->table_cap == 0) {
+        if (!ts_table_grow(ts)) {
+            free(s);
+            return NULL;
+        }
+    }
+
+    size_t slot = ts_hash(s) & (ts->table_cap - 1);
+    while (ts->table[slot] != 0) {
+        char* other = *(char**)vec_get(ts->strings, ts->table[slot] - 1);
+        if (strcmp(other, s) == 0) {
+            free(s);
+            return other;
+        }
+        slot = (slot + 1) & (ts->table_cap - 1);
+    }
+
+    if (vec_push(ts->strings, &s) == NULL) {
+        free(s);
+        return NULL;
+    }
+    // Keeps the table at most half full.
+    if (ts->strings->len * 2 > ts->table_cap) {
+        if (!ts_table_grow(ts)) {
+            return NULL;
+        }
+    } else {
+        ts_table_put(ts, ts->strings->len - 1);
+    }
+    return s;
+}
+
+// Returns the offset of the first character after the whitespace and
+// comments starting at 'pos'.
+size_t ts_skip_trivia(const token_stream* ts, size_t pos) {
+    const char* src = ts->source;
+    size_t len = ts->source_len;
+    while (pos < len) {
+        if (isspace((unsigned char)src[pos])) {
+            pos++;
+        } else if (src[pos] == '/' && pos + 1 < len && src[pos + 1] == '/') {
+            while (pos < len && src[pos] != '\n') {
+                pos++;
+            }
+        } else {
+            break;
+        }
+    }
+    return pos;
+}
+
+// Scans 'file' reading 'ts->source' into 'ts->tokens'.
+error_code ts_scan(token_stream* ts, FILE* file) {
+    while (1) {
+        size_t start = ts_skip_trivia(ts, (size_t)ftell(file));
+        if (fseek(file, (long)start, SEEK_SET) != 0) {
+            return INTERNAL_ERR;
+        }
+
+        token t;
+        error_code err = get_token_file(&t, file);
+        if (err != NO_ERR) {
+            ts->err = err;
+            return NO_ERR;
+        }
+
+        stream_token st = {.type = t.type,
+                           .start = (uint32_t)start,
+                           .length = (uint32_t)((size_t)ftell(file) - start),
+                           .content = t.content};
+        if (t.type == TOKEN_IDENT || t.type == TOKEN_LIT_STRING) {
+            st.content.id = ts_intern(ts, t.content.id);
+            if (st.content.id == NULL) {
+                return INTERNAL_ERR;
+            }
+        }
+        if (vec_push(ts->tokens, &st) == NULL) {
+            return INTERNAL_ERR;
+        }
+        if (t.type == TOKEN_EOF) {
+            return NO_ERR;
+        }
+    }
+}
+
+// Scans the whole 'in' into 'ts'. Returns INTERNAL_ERR on allocation
+// failure, lexical errors are returned later by ts_next.
+error_code ts_tokenize(token_stream* ts, FILE* in) {
+    assert(ts != NULL);
+    assert(in != NULL);
+
+    *ts = (token_stream){0};
+    ts->tokens = vec_init(1024, sizeof(stream_token));
+    ts->strings = vec_init(256, sizeof(char*));
+    if (ts->tokens == NULL || ts->strings == NULL ||
+        ts_read_source(ts, in) != NO_ERR) {
+        ts_free(ts);
+        return INTERNAL_ERR;
+    }
+
+    // Empty buffer cannot be opened as a stream.
+    if (ts->source_len == 0) {
+        stream_token eof = {.type = TOKEN_EOF};
+        if (vec_push(ts->tokens, &eof) == NULL) {
+            ts_free(ts);
+            return INTERNAL_ERR;
+        }
+        return NO_ERR;
+    }
+
+    FILE* file = fmemopen(ts->source, ts->source_len, "r");
+    if (file == NULL) {
+        ts_free(ts);
+        return INTERNAL_ERR;
+    }
+    error_code err = ts_scan(ts, file);
+    fclose(file);
+    if (err != NO_ERR) {
+        ts_free(ts);
+    }
+    return err;
+}
+
+// Stores the next token into 't' and moves past it. After the EOF token
+// 't' stays EOF. Returns the lexical error once the position it was found
+// at is reached.
+error_code ts_next(token_stream* ts, token* t) {
+    assert(ts != NULL);
+    assert(t != NULL);
+
+    if (ts->pos == ts->tokens->len) {
+        if (ts->err != NO_ERR) {
+            return ts->err;
+        }
+        // Only the EOF token may be read repeatedly.
+        ts->pos--;
+    }
+    stream_token* st = vec_at(ts->tokens, ts->pos++);
+    t->type = st->type;
+    t->content = st->content;
+    return NO_ERR;
+}
+
+// Returns the token 'k' positions after the one last returned by ts_next,
+// 0 being that token itself. Returns NULL before the first ts_next and for
+// positions past a lexical error. Past the EOF token returns EOF.
+const stream_token* ts_peek(const token_stream* ts, size_t k) {
+    assert(ts != NULL);
+
+    if (ts->pos == 0) {
+        return NULL;
+    }
+    size_t index = ts->pos - 1 + k;
+    if (index >= ts->tokens->len) {
+        if (ts->err != NO_ERR) {
+            return NULL;
+        }
+        index = ts->tokens->len - 1;
+    }
+    return vec_at(ts->tokens, index);
+}
+
+// Returns the line number (from 1) of 'offset' in the input.
+size_t ts_line(const token_stream* ts, uint32_t offset) {
+    assert(ts != NULL);
+
+    size_t line = 1;
+    for (size_t i = 0; i < offset && i < ts->source_len; i++) {
+        if (ts->source[i] == '\n') {
+            line++;
+        }
+    }
+    return line;
+}
+
+// Frees the tokens, the interned strings and the input held by 'ts'.
+void ts_free(token_stream* ts) {
+    if (ts->strings != NULL) {
+        for (size_t i = 0; i < ts->strings->len; i++) {
+            free(*(char**)vec_get(ts->strings, i));
+        }
+        vec_free(&ts->strings);
+    }
+    vec_free(&ts->tokens);
+    free(ts->table);
+    free(ts->source);
+    *ts = (token_stream){0};
+}
@@ -0,0 +1,47 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Whole input scanned into an array of tokens the parser can index into.
+
+#ifndef IFJ_PROJEKT_2024_TOKEN_STREAM_H
+#define IFJ_PROJEKT_2024_TOKEN_STREAM_H
+
+#include "error.h"
+#include "scanner.h"
+#include "vector.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Token as stored in the stream. Identifiers and string literals point to
+// the interned copy owned by the stream, equal strings share one pointer.
+typedef struct {
+    token_type type;
+    uint32_t start;  // Offset of the first character of the lexeme
+    uint32_t length; // Length of the lexeme in bytes
+    token_content content;
+} stream_token;
+
+typedef struct {
+    char* source;        // Whole input
+    size_t source_len;   // Length of 'source'
+    vector* tokens;      // stream_token, ends with TOKEN_EOF unless 'err' is set
+    vector* strings;     // char*, interned identifiers and string literals
+    uint32_t* table;     // Hash table of indices into 'strings', 0 is empty
+    size_t table_cap;    // Power of two
+    size_t pos;          // Index of the token returned by the next ts_next
+    error_code err;      // Lexical error found right after the last token
+} token_stream;
+
+error_code ts_tokenize(token_stream* ts, FILE* in);
+
+error_code ts_next(token_stream* ts, token* t);
+
+const stream_token* ts_peek(const token_stream* ts, size_t k);
+
+size_t ts_line(const token_stream* ts, uint32_t offset);
+
+void ts_free(token_stream* ts);
+
+#endif // IFJ_PROJEKT_2024_TOKEN_STREAM_H
@@ -6,6 +6,7 @@
 #include <string.h>
 #include <assert.h>
 #include <stdbool.h>
+#include <time.h>
 
 // Duplicates the string, returns NULL if it fails.
 char* d_string(const char* str) {
@@ -23,3 +24,10 @@ char* d_string(const char* str) {
 bool has_decimals(double d) {
     return (d - (int)d) != 0;
 }
+
+// Returns the time of a monotonic clock in milliseconds.
+double now_ms() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
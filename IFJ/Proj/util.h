@@ -8,5 +8,6 @@
 
 char* d_string(const char* str);
 bool has_decimals(double d);
+double now_ms();
 
 #endif // UTIL_H
@@ -0,0 +1,252 @@
+// Projekt: Implementace překladače imperativního jazyka IFJ24
+// Autor: Radim Dvořák (xdvorar00)
+//
+// Compares the vector with the small storage to the previous one, which
+// allocated every buffer and grew it by half, on the work the compiler
+// gives it: building the token strings in the scanner and pushing and
+// popping the scopes in the semantic analysis.
+
+#include "vector.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "util.h"
+
+#define BENCH_TOKENS 2000000
+#define BENCH_SCOPES 2000000
+#define BENCH_DEPTH 8
+#define BENCH_BULK 20000
+#define BENCH_BULK_LEN 200
+
+// The previous vector, kept only to be measured against.
+typedef struct {
+    void* inner;
+    size_t capacity;
+    size_t len;
+    size_t elem_size;
+} old_vector;
+
+old_vector* old_vec_init(size_t init_capacity, size_t sizeof_type) {
+    old_vector* vec = malloc(sizeof(old_vector));
+    if (vec == NULL) {
+        return NULL;
+    }
+    vec->inner = calloc(init_capacity, sizeof_type);
+    if (vec->inner == NULL) {
+        free(vec);
+        return NULL;
+    }
+    vec->elem_size = sizeof_type;
+    vec->capacity = init_capacity;
+    vec->len = 0;
+    return vec;
+}
+
+bool old_vec_resize(old_vector* vec, size_t num_elements) {
+    void* ptr = reallocarray(vec->inner, num_elements, vec->elem_size);
+    if (ptr == NULL) {
+        return false;
+    }
+    vec->capacity = num_elements;
+    if (vec->capacity < vec->len) {
+        vec->len = vec->capacity;
+    }
+    vec->inner = ptr;
+    return true;
+}
+
+void* old_vec_push(old_vector* vec, void* element) {
+    if (vec->len >= vec->capacity) {
+        size_t new_capacity = (vec->capacity * 3) / 2;
+        if (new_capacity <= vec->capacity ||
+            !old_vec_resize(vec, new_capacity)) {
+            return NULL;
+        }
+    }
+    void* mem = memmove((char*)vec->inner + vec->len * vec->elem_size,
+                        element, vec->elem_size);
+    vec->len++;
+    return mem;
+}
+
+void* old_vec_get(old_vector* vec, size_t index) {
+    if (index >= vec->len) {
+        fprintf(stderr, "index out of bounds: %zu.", index);
+        exit(1);
+    }
+    return (char*)vec->inner + index * vec->elem_size;
+}
+
+void* old_vec_pop(old_vector* vec) {
+    if (vec->len == 0) {
+        return NULL;
+    }
+    void* element = malloc(vec->elem_size);
+    if (element == NULL) {
+        return NULL;
+    }
+    memcpy(element, old_vec_get(vec, vec->len - 1), vec->elem_size);
+    vec->len--;
+    return element;
+}
+
+char* old_vec_to_str(old_vector** vec) {
+    size_t len = (*vec)->len + 1;
+    old_vec_resize(*vec, len);
+    char* str = (*vec)->inner;
+    free(*vec);
+    *vec = NULL;
+    str[len - 1] = '\0';
+    return str;
+}
+
+void old_vec_free(old_vector** vec) {
+    free((*vec)->inner);
+    free(*vec);
+    *vec = NULL;
+}
+
+// Length of the token 'i', mostly short identifiers and keywords with an
+// occasional long string literal.
+size_t bench_token_len(size_t i) {
+    return i % 64 == 0 ? 40 + i % 50 : 1 + i % 12;
+}
+
+// Builds the token strings as the scanner does, returns a checksum.
+size_t bench_tokens_old() {
+    size_t sum = 0;
+    for (size_t i = 0; i < BENCH_TOKENS; i++) {
+        old_vector* buffer = old_vec_init(20, sizeof(char));
+        size_t len = bench_token_len(i);
+        for (size_t j = 0; j < len; j++) {
+            char c = 'a' + (i + j) % 26;
+            old_vec_push(buffer, &c);
+        }
+        char* str = old_vec_to_str(&buffer);
+        sum += str[len - 1];
+        free(str);
+    }
+    return sum;
+}
+
+size_t bench_tokens_new() {
+    size_t sum = 0;
+    for (size_t i = 0; i < BENCH_TOKENS; i++) {
+        vector* buffer = vec_init(20, sizeof(char));
+        size_t len = bench_token_len(i);
+        for (size_t j = 0; j < len; j++) {
+            vec_pushchar(buffer, 'a' + (i + j) % 26);
+        }
+        char* str = vec_to_str(&buffer);
+        sum += str[len - 1];
+        free(str);
+    }
+    return sum;
+}
+
+// Enters and leaves nested scopes as the semantic analysis does, looking
+// a symbol up through the whole stack in every scope.
+size_t bench_scopes_old() {
+    size_t sum = 0;
+    old_vector* stack = old_vec_init(4, sizeof(void*));
+    for (size_t i = 0; i < BENCH_SCOPES; i++) {
+        void* scope = (void*)(uintptr_t)(i + 1);
+        old_vec_push(stack, &scope);
+        if (stack->len == BENCH_DEPTH || i % 3 == 0) {
+            for (size_t j = stack->len; j-- > 0;) {
+                sum += *(uintptr_t*)old_vec_get(stack, j);
+            }
+            while (stack->len > 1) {
+                free(old_vec_pop(stack));
+            }
+        }
+    }
+    old_vec_free(&stack);
+    return sum;
+}
+
+size_t bench_scopes_new() {
+    size_t sum = 0;
+    vector* stack = vec_init(4, sizeof(void*));
+    for (size_t i = 0; i < BENCH_SCOPES; i++) {
+        void* scope = (void*)(uintptr_t)(i + 1);
+        vec_push(stack, &scope);
+        if (stack->len == BENCH_DEPTH || i % 3 == 0) {
+            for (size_t j = stack->len; j-- > 0;) {
+                sum += *(uintptr_t*)vec_at(stack, j);
+            }
+            while (stack->len > 1) {
+                free(vec_pop(stack));
+            }
+        }
+    }
+    vec_free(&stack);
+    return sum;
+}
+
+// Appends lists of instruction sized elements to one another, as the code
+// of the functions is joined into the program.
+typedef struct {
+    int op;
+    int argc;
+    char* args[3];
+} bench_elem;
+
+size_t bench_bulk_old() {
+    size_t sum = 0;
+    bench_elem part[BENCH_BULK_LEN] = {{0}};
+    for (size_t i = 0; i < BENCH_BULK / 100; i++) {
+        old_vector* all = old_vec_init(64, sizeof(bench_elem));
+        for (size_t k = 0; k < 100; k++) {
+            for (size_t j = 0; j < BENCH_BULK_LEN; j++) {
+                part[j].op = (int)(i + j);
+                old_vec_push(all, &part[j]);
+            }
+        }
+        sum += all->len;
+        old_vec_free(&all);
+    }
+    return sum;
+}
+
+size_t bench_bulk_new() {
+    size_t sum = 0;
+    bench_elem part[BENCH_BULK_LEN] = {{0}};
+    for (size_t i = 0; i < BENCH_BULK / 100; i++) {
+        vector* all = vec_init(64, sizeof(bench_elem));
+        for (size_t k = 0; k < 100; k++) {
+            for (size_t j = 0; j < BENCH_BULK_LEN; j++) {
+                part[j].op = (int)(i + j);
+            }
+            vec_push_n(all, part, BENCH_BULK_LEN);
+        }
+        sum += all->len;
+        vec_free(&all);
+    }
+    return sum;
+}
+
+// Runs the old and the new version of a benchmark and prints their times.
+void bench_run(const char* name, size_t (*old_bench)(),
+               size_t (*new_bench)()) {
+    double start = now_ms();
+    size_t old_sum = old_bench();
+    double old_ms = now_ms() - start;
+    start = now_ms();
+    size_t new_sum = new_bench();
+    double new_ms = now_ms() - start;
+    printf("%-8s %10.2f %10.2f %8.2fx%s\n", name, old_ms, new_ms,
+           old_ms / new_ms, old_sum == new_sum ? "" : " (results differ)");
+}
+
+int main() {
+    printf("%-8s %10s %10s %9s\n", "bench", "old [ms]", "new [ms]",
+           "speedup");
+    bench_run("tokens", bench_tokens_old, bench_tokens_new);
+    bench_run("scopes", bench_scopes_old, bench_scopes_new);
+    bench_run("bulk", bench_bulk_old, bench_bulk_new);
+    return 0;
+}
@@ -5,9 +5,11 @@
 
 #include "vector.h"
 #include "error.h"
+#include "stats.h"
 #include <assert.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -18,27 +20,35 @@
 
 // Initializes a new vector, preallocating enough space for `init_capacity`
 // elements of `sizeof_type`. If the allocation fails for any reason, returns
-// `NULL`.
+// `NULL`. When they fit, the elements are stored inside the vector and only
+// the vector itself is allocated.
 //
 // The returned vector should be freed with 'vec_free()' or leaked with
 // 'vec_leak()' or 'vec_to_str()'.
 vector* vec_init(size_t init_capacity, const size_t sizeof_type) {
     // Allocate the vec and make sure it's ok
-    vector* vec = (void*)malloc(sizeof(vector));
+    vector* vec = (void*)track_malloc(sizeof(vector));
     if (vec == NULL) {
         return NULL;
     }
 
+    vec->elem_size = sizeof_type;
+    vec->len = 0;
+    if (sizeof_type <= VEC_SMALL_SIZE &&
+        init_capacity <= VEC_SMALL_SIZE / sizeof_type) {
+        memset(vec->small, 0, VEC_SMALL_SIZE);
+        vec->inner = vec->small;
+        vec->capacity = VEC_SMALL_SIZE / sizeof_type;
+        return vec;
+    }
+
     // Allocate the inner buffer and make sure it's ok
-    vec->inner = (void*)calloc(init_capacity, sizeof_type);
+    vec->inner = (void*)track_calloc(init_capacity, sizeof_type);
     if (vec->inner == NULL) {
-        free(vec);
+        track_free(vec);
         return NULL;
     }
-    // Initialize it and return it
-    vec->elem_size = sizeof_type;
     vec->capacity = init_capacity;
-    vec->len = 0;
     return vec;
 }
 
@@ -65,28 +75,72 @@ void vec_validate_idx(vector* vec, size_t index) {
 }
 
 // (https://stackoverflow.com/questions/1100311/what-is-the-ideal-growth-rate-for-a-dynamically-allocated-array)
-// Grows the inner buffer using `realloc()` and the following growth strategy:
-//     `capacity = (capacity * 3) / 2;`
+// Returns the capacity following `capacity` or `0` on overflow. Small buffers
+// double, so a short string is not reallocated for every few characters,
+// buffers of `VEC_DOUBLING_LIMIT` bytes and more grow by half.
+size_t vec_next_capacity(const vector* vec, size_t capacity) {
+    size_t next = capacity < 4 ? 4 : capacity * 2;
+    if (capacity * vec->elem_size >= VEC_DOUBLING_LIMIT)
+        next = capacity + capacity / 2;
+    return next > capacity ? next : 0;
+}
+
+// Grows the inner buffer using `realloc()` and the growth strategy of
+// `vec_next_capacity()`.
 // Returns `true` on success, otherwise `false`.
 bool vec_grow(vector* vec) {
 
     assert(vec != NULL);
 
     // Correctly calculate the new capacity and make sure we don't overflow
-    size_t new_capacity = (vec->capacity * 3) / 2;
-    if (new_capacity <= vec->capacity)
+    size_t new_capacity = vec_next_capacity(vec, vec->capacity);
+    if (new_capacity == 0)
         return false;
 
     return vec_resize(vec, new_capacity);
 }
 
+// Makes room for at least `additional` more elements, growing the same way
+// as `vec_grow()` does.
+// Returns `true` on success, otherwise `false`.
+bool vec_reserve(vector* vec, size_t additional) {
+
+    assert(vec != NULL);
+
+    if (additional > SIZE_MAX - vec->len)
+        return false;
+    size_t needed = vec->len + additional;
+    if (needed <= vec->capacity)
+        return true;
+
+    size_t new_capacity = vec->capacity;
+    while (new_capacity < needed) {
+        new_capacity = vec_next_capacity(vec, new_capacity);
+        if (new_capacity == 0)
+            return false;
+    }
+    return vec_resize(vec, new_capacity);
+}
+
 // Resizes the vector to accommodate exactly `num_elements`.
 // Returns `true` on success, otherwise `false`.
 bool vec_resize(vector* vec, size_t num_elements) {
 
     assert(vec != NULL);
 
-    void* ptr = reallocarray(vec->inner, num_elements, vec->elem_size);
+    void* ptr;
+    if (vec->inner != vec->small) {
+        ptr = track_reallocarray(vec->inner, num_elements, vec->elem_size);
+    } else if (num_elements <= VEC_SMALL_SIZE / vec->elem_size) {
+        // Still fits, the elements stay where they are.
+        ptr = vec->small;
+    } else {
+        // Outgrown, the elements move into an allocated buffer.
+        ptr = track_reallocarray(NULL, num_elements, vec->elem_size);
+        if (ptr != NULL) {
+            memcpy(ptr, vec->small, vec->len * vec->elem_size);
+        }
+    }
     if (ptr == NULL) {
         return false;
     }
@@ -123,6 +177,26 @@ void* vec_push(vector* vec, void* element) {
     return mem;
 }
 
+// Pushes the `count` elements at `elements` at once, the buffer grows at
+// most once.
+//
+// Returns a pointer to the first of the pushed elements within the vector or
+// `NULL` on failure.
+void* vec_push_n(vector* vec, const void* elements, size_t count) {
+
+    assert(vec != NULL);
+    assert(elements != NULL || count == 0);
+
+    if (!vec_reserve(vec, count))
+        return NULL;
+    void* mem = VEC_ADDR_OF(vec, vec->len);
+    if (count > 0) {
+        memcpy(mem, elements, count * vec->elem_size);
+    }
+    vec->len += count;
+    return mem;
+}
+
 // Function for convenient pushing of 'char'
 char* vec_pushchar(vector* vec, const char c) {
     return (char*)vec_push(vec, (void*)&c);
@@ -208,8 +282,9 @@ void vec_free(vector** vec) {
     if ((*vec) == NULL)
         return;
     vector* local_vec = (*vec);
-    free(local_vec->inner);
-    free((*vec));
+    if (local_vec->inner != local_vec->small)
+        track_free(local_vec->inner);
+    track_free((*vec));
     (*vec) = NULL;
 }
 
@@ -218,17 +293,28 @@ void vec_free(vector** vec) {
 // TRUNCATING IT TO ITS CAPACITY BEFOREHAND.
 //
 // The caller should cast the buffer to appropriate type and is responsible for
-// freeing it afterwards.
+// freeing it afterwards. Elements stored inside the vector are copied into
+// a new buffer, `NULL` is returned if it cannot be allocated.
 void* vec_leak(vector** vec) {
     assert(vec != NULL && (*vec) != NULL);
 
     vector* local_vec = (*vec);
     // Leak the inner pointer
     void* ptr = local_vec->inner;
+    if (ptr == local_vec->small) {
+        size_t size = local_vec->capacity * local_vec->elem_size;
+        ptr = malloc(size > 0 ? size : 1);
+        if (ptr != NULL) {
+            memcpy(ptr, local_vec->small, size);
+        }
+    } else {
+        // The caller frees it with plain free().
+        track_forget(ptr);
+    }
     local_vec->inner = NULL;
 
     // Free up the resources used by the struct and return the leaked buffer.
-    free((*vec));
+    track_free((*vec));
     (*vec) = NULL;
     return ptr;
 }
@@ -246,7 +332,9 @@ char* vec_to_str(vector** vec) {
     size_t len = local_vec->len + 1;
     vec_resize(local_vec, len);
     char* str = (char*)vec_leak(vec);
-    str[len - 1] = '\0';
+    if (str != NULL) {
+        str[len - 1] = '\0';
+    }
     return str;
 }
 
@@ -9,8 +9,17 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+// Elements fitting into this many bytes are kept inside the vector itself,
+// the inner buffer is allocated only once they outgrow it.
+#define VEC_SMALL_SIZE 32
+
+// Buffers smaller than this many bytes double when full, larger ones grow
+// by half.
+#define VEC_DOUBLING_LIMIT 4096
+
 typedef struct {
-    // Inner buffer of the allocated bytes.
+    // Inner buffer of the allocated bytes, points to `small` until the
+    // elements outgrow it.
     // This buffer should not *ever* be accessed directly as it may lead to
     // inconsistent state of this struct
     void* inner;
@@ -24,6 +33,9 @@ typedef struct {
     // Size of each elemnt within the `inner` buffer.
     size_t elem_size;
 
+    // Storage of the first few elements.
+    _Alignas(max_align_t) unsigned char small[VEC_SMALL_SIZE];
+
 } vector;
 
 vector* vec_init(size_t init_capacity, const size_t sizeof_type);
@@ -32,9 +44,11 @@ void* vec_leak(vector** vec);
 
 bool vec_grow(vector* vec);
 bool vec_resize(vector* vec, size_t num_elements);
+bool vec_reserve(vector* vec, size_t additional);
 
 void* vec_get(vector* vec, size_t index);
 void* vec_push(vector* vec, void* element);
+void* vec_push_n(vector* vec, const void* elements, size_t count);
 char* vec_pushchar(vector* vec, const char c);
 void* vec_pop(vector* vec);
 void vec_remove(vector* vec, size_t index);
@@ -45,4 +59,13 @@ char* vec_to_str(vector** vec);
 char* vec_get_str(vector* vec);
 
 #define vec_remove_last(vec) vec_remove((vec), (vec)->len - 1)
+
+// 'vec_get()' for hot loops whose index is known to be valid, it is only
+// checked in debug builds.
+#ifdef NDEBUG
+#define vec_at(vec, index)                                                     \
+    ((void*)&((char*)(vec)->inner)[(index) * (vec)->elem_size])
+#else
+#define vec_at(vec, index) vec_get((vec), (index))
+#endif
 #endif /* VECTOR_H */
@@ -25,8 +25,13 @@ ArgParser::Options ArgParser::Parse(int argc, char *argv[]){
         .inteface = "",
         .tcp_port = {},
         .udp_port = {},
-        .domain = "",
+        .targets = {},
         .timeout = 5'000,
+        .parallel = 256,
+        .retries = 1,
+        .rate = 0,
+        .summary = false,
+        .batch = 64,
         .interface_specified = false,
         .help = false,
     };
@@ -37,7 +42,13 @@ ArgParser::Options ArgParser::Parse(int argc, char *argv[]){
         {"pu", required_argument, nullptr, 'u'},
         {"pt", required_argument, nullptr, 't'},
         {"wait",required_argument,nullptr,'w'},
-        {"help", no_argument, nullptr, 'h'}
+        {"parallel",required_argument,nullptr,'p'},
+        {"retries",required_argument,nullptr,'r'},
+        {"rate",required_argument,nullptr,'R'},
+        {"summary",no_argument,nullptr,'s'},
+        {"batch",required_argument,nullptr,'b'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
     };
 
     int opt = 0;
@@ -45,7 +56,7 @@ ArgParser::Options ArgParser::Parse(int argc, char *argv[]){
 
     // Disable error message from function getopt_long
     opterr = 0;
-    while((opt = getopt_long(argc, argv, "iu:t:w:h", longOptions, &optIndex)) != -1){
+    while((opt = getopt_long(argc, argv, "iu:t:w:p:r:R:sb:h", longOptions, &optIndex)) != -1){
         switch (opt)
         {
         case 'i':
@@ -74,6 +85,38 @@ ArgParser::Options ArgParser::Parse(int argc, char *argv[]){
         case 'w':
             options.timeout = atoi(optarg);
             break;
+        case 'p':
+            if(atoi(optarg) < 1){
+                throw std::invalid_argument(std::string("Invalid number of parallel probes"));
+            }
+            options.parallel = atoi(optarg);
+            break;
+        case 'r': {
+            // strtoul accepts a sign, a negative number would wrap to a huge one
+            char *end = nullptr;
+            errno = 0;
+            unsigned long retries = strtoul(optarg, &end, 10);
+            if(optarg[0] == '-' || end == optarg || *end != '\0' || errno != 0 || retries > ArgParser::MAX_RETRIES){
+                throw std::invalid_argument(std::string("Invalid number of retries"));
+            }
+            options.retries = retries;
+            break;
+        }
+        case 'R':
+            if(atof(optarg) < 0){
+                throw std::invalid_argument(std::string("Invalid rate"));
+            }
+            options.rate = atof(optarg);
+            break;
+        case 's':
+            options.summary = true;
+            break;
+        case 'b':
+            if(atoi(optarg) < 1 || atoi(optarg) > 1024){
+                throw std::invalid_argument(std::string("Invalid size of batch"));
+            }
+            options.batch = atoi(optarg);
+            break;
         case '?':
             throw std::invalid_argument(std::string("Invalid option"));
         default:
@@ -82,11 +125,12 @@ ArgParser::Options ArgParser::Parse(int argc, char *argv[]){
         }
     }
 
-    if(argv[optind] != nullptr){
-        options.domain = std::string(argv[optind]);
+    // Hosts, addresses and ranges of addresses, getopt moves them all after the options
+    for(int i = optind; i < argc; i++){
+        options.targets.push_back(std::string(argv[i]));
     }
     
-    if(options.interface_specified && (options.domain.empty() || (options.tcp_port.empty() && options.udp_port.empty()))){
+    if(options.interface_specified && (options.targets.empty() || (options.tcp_port.empty() && options.udp_port.empty()))){
         throw std::invalid_argument(std::string("Missing mandatory option"));
     }
 
@@ -146,12 +190,19 @@ void ArgParser::Help(){
     "\n"
     "Usage: ./ipk-l4-scan [-i interface | --interface interface]"
     " [--pu port-ranges | --pt port-ranges | -u port-ranges | -t port-ranges]"
-    " {-w timeout} [domain-name | ip-address] [-h | --help]\n"
+    " {-w timeout} {-p probes} {-r retries} {-R rate} {-s} {-b batch} [domain-name | ip-address | ip-address/prefix]... [-h | --help]\n"
     "\n"
     "Option:\n"
     "  -i, --interface <INTERFACE>             Choose the interface to scan through.\n"
     "  -t, --pt <PORT>                         TCP ports to be scanned.\n"
     "  -u, --pu <PORT>                         UDP ports to be scanned.\n"
-    "  -w, --wait <NUMBER>                     Wait time for response of each scan in milliseconds (default 5000).\n"
-    "  -h, --help                              Print this message." << std::endl;
+    "  -w, --wait <NUMBER>                     Wait time for the first responses and the longest one in milliseconds (default 5000).\n"
+    "  -p, --parallel <NUMBER>                 Maximum number of probes to a target waiting for response at once (default 256).\n"
+    "  -r, --retries <NUMBER>                  Retransmissions of a probe without response, 0 to 254 (default 1).\n"
+    "  -R, --rate <NUMBER>                     Maximum number of probes sent to a target per second (default unlimited).\n"
+    "  -s, --summary                           Print the statistics of the probes to stderr after each target.\n"
+    "  -b, --batch <NUMBER>                    Maximum number of packets sent or received by one system call (default 64).\n"
+    "  -h, --help                              Print this message.\n"
+    "\n"
+    "All the targets are scanned at once, ranges of IPv4 and IPv6 addresses have at most 65536 addresses." << std::endl;
 };
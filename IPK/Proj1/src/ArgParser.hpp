@@ -21,12 +21,19 @@ class ArgParser{
             std::string inteface;
             std::vector<unsigned int> tcp_port;
             std::vector<unsigned int> udp_port;
-            std::string domain;
+            std::vector<std::string> targets;
             int timeout;
+            unsigned int parallel;
+            unsigned int retries;
+            double rate;
+            bool summary;
+            unsigned int batch;
             bool interface_specified;
             bool help;
         } Options;
 
+        static constexpr unsigned int MAX_RETRIES = 254; ///< Transmissions of a probe are counted in a byte
+
         static ArgParser::Options Parse(int argc, char *argv[]);
         static void Help();      
     private:
@@ -11,6 +11,7 @@
 #include <iostream>
 #include <iomanip>
 #include <memory>
+#include <set>
 #include <arpa/inet.h>
 #include <ifaddrs.h>
 #include <net/if.h>
@@ -234,4 +235,117 @@ struct addrinfo* Network::GetDstAdress(const std::string name){
         throw std::runtime_error(std::string("Could not get address info"));
     }
     return result;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Expands a range in the CIDR notation to all of its addresses.
+ * @param range The range, an IPv4 or IPv6 address with the prefix length after a slash.
+ * @param addresses The vector the addresses are appended to.
+ */
+void Network::ExpandRange(const std::string range, std::vector<struct sockaddr_storage> &addresses){
+    auto slash = range.find('/');
+    std::string address = range.substr(0, slash);
+    std::string prefix_string = range.substr(slash + 1);
+
+    struct sockaddr_storage base = {};
+    uint8_t *bytes;
+    int bits;
+    if (inet_pton(AF_INET, address.data(), &((struct sockaddr_in *)&base)->sin_addr) == 1) {
+        base.ss_family = AF_INET;
+        bytes = (uint8_t *)&((struct sockaddr_in *)&base)->sin_addr;
+        bits = 32;
+    } else if (inet_pton(AF_INET6, address.data(), &((struct sockaddr_in6 *)&base)->sin6_addr) == 1) {
+        base.ss_family = AF_INET6;
+        bytes = (uint8_t *)&((struct sockaddr_in6 *)&base)->sin6_addr;
+        bits = 128;
+    } else {
+        throw std::invalid_argument(std::string("Invalid address range"));
+    }
+
+    if (prefix_string.empty() || prefix_string.find_first_not_of("0123456789") != std::string::npos ||
+        std::stoi(prefix_string) > bits) {
+        throw std::invalid_argument(std::string("Invalid address range"));
+    }
+    int host_bits = bits - std::stoi(prefix_string);
+    if (host_bits > MAX_RANGE_BITS) {
+        throw std::invalid_argument(std::string("Address range too large"));
+    }
+
+    // Clear the host part, the addresses are then counted up from it
+    for (int bit = bits - host_bits; bit < bits; bit++) {
+        bytes[bit / 8] &= ~(0x80 >> (bit % 8));
+    }
+    for (uint32_t host = 0; host < (1u << host_bits); host++) {
+        addresses.push_back(base);
+        for (int byte = bits / 8 - 1; byte >= 0 && ++bytes[byte] == 0; byte--) {
+        }
+    }
+}
+
+/**
+ * @brief Resolves the targets given on the command line to their addresses.
+ *
+ * A target is a hostname, an address or a range in the CIDR notation. Every
+ * address is returned once, in the order of the targets.
+ *
+ * @param names The targets.
+ * @return The addresses of all the targets.
+ */
+std::vector<struct sockaddr_storage> Network::GetDstAdresses(const std::vector<std::string> &names){
+    std::vector<struct sockaddr_storage> addresses;
+    for (auto &name : names) {
+        if (name.find('/') != std::string::npos) {
+            Network::ExpandRange(name, addresses);
+            continue;
+        }
+        auto result = Network::GetDstAdress(name);
+        for (auto info = result; info != nullptr; info = info->ai_next) {
+            struct sockaddr_storage addr = {};
+            memcpy(&addr, info->ai_addr, info->ai_addrlen);
+            addresses.push_back(addr);
+        }
+        freeaddrinfo(result);
+    }
+
+    std::set<std::string> seen;
+    std::vector<struct sockaddr_storage> unique;
+    for (auto &addr : addresses) {
+        if (seen.insert(Network::AddressToString(&addr)).second) {
+            unique.push_back(addr);
+        }
+    }
+    return unique;
+}
+
+/**
+ * @brief Converts an IPv4 or IPv6 address to its text form.
+ * @param addr The address.
+ * @return The address as a string.
+ */
+std::string Network::AddressToString(const struct sockaddr_storage *addr){
+    char text[INET6_ADDRSTRLEN];
+    const void *raw = addr->ss_family == AF_INET ? (const void *)&((const struct sockaddr_in *)addr)->sin_addr
+                                                 : (const void *)&((const struct sockaddr_in6 *)addr)->sin6_addr;
+    if (inet_ntop(addr->ss_family, raw, text, sizeof(text)) == nullptr) {
+        throw std::runtime_error(std::string("Invalid family of address"));
+    }
+    return std::string(text);
+}
+
+/**
+ * @brief Updates an internet checksum after one 16-bit word of the data changed (RFC 1624).
+ *
+ * HC' = ~(~HC + ~m + m'), which never turns a checksum to 0xFFFF the way
+ * subtracting the old word does.
+ *
+ * @param checksum The checksum of the old data.
+ * @param old_word The word before the change, as stored in the packet.
+ * @param new_word The word after the change, as stored in the packet.
+ * @return The checksum of the new data.
+ */
+uint16_t Network::UpdateChecksum(uint16_t checksum, uint16_t old_word, uint16_t new_word){
+    uint32_t sum = (uint16_t)~checksum + (uint16_t)~old_word + new_word;
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
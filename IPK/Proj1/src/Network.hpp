@@ -9,6 +9,7 @@
 #define NETWORK_HPP
 
 #include <iostream>
+#include <vector>
 #include <netinet/in.h>
 #include <sys/socket.h>
 
@@ -42,7 +43,14 @@ class Network{
         static uint16_t GetPort(const struct sockaddr_storage* addr);
         static void SetPort(struct sockaddr_storage* addr, const uint16_t port);
         static struct addrinfo* GetDstAdress(std::string name);
+        static std::vector<struct sockaddr_storage> GetDstAdresses(const std::vector<std::string> &names);
+        static std::string AddressToString(const struct sockaddr_storage *addr);
+        static uint16_t UpdateChecksum(uint16_t checksum, uint16_t old_word, uint16_t new_word);
     private:
+        /// Ranges have at most 2^16 addresses
+        static constexpr int MAX_RANGE_BITS = 16;
+
+        static void ExpandRange(const std::string range, std::vector<struct sockaddr_storage> &addresses);
         static std::string GetSubnetMaskIP4(const char* iface);
         static std::string ConvertToCIDR(const std::string& mask,char delim);
 };
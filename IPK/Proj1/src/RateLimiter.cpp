@@ -0,0 +1,105 @@
+/**
+ * @file RateLimiter.cpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Implementation of the limiter of sent probes
+ */
+
+#include "RateLimiter.hpp"
+#include <algorithm>
+#include <cmath>
+
+/// The limiter never backs off below this rate.
+constexpr double MIN_RATE = 10;
+/// Tokens saved up are enough for bursts of this long.
+constexpr double BURST_SECONDS = 0.01;
+/// Length of the window measuring the rate sent.
+constexpr auto MEASURE_WINDOW = std::chrono::milliseconds(100);
+
+/**
+ * @brief Constructs the limiter.
+ *
+ * @param rate Probes per second at most, 0 for no limit.
+ */
+RateLimiter::RateLimiter(double rate)
+    : rate{rate}, max_rate{rate}, tokens{1}, last_refill{Clock::now()}, last_backoff{}, window_start{Clock::now()} {}
+
+/**
+ * @brief Adds the tokens earned since the last refill.
+ */
+void RateLimiter::Refill(Clock::time_point now) {
+    double elapsed = std::chrono::duration<double>(now - this->last_refill).count();
+    this->tokens = std::min(std::max(1.0, this->rate * BURST_SECONDS), this->tokens + elapsed * this->rate);
+    this->last_refill = now;
+}
+
+/**
+ * @brief Takes a token for sending one probe.
+ *
+ * @param now The current time.
+ * @return False when the probe has to wait, see WaitTime.
+ */
+bool RateLimiter::TryAcquire(Clock::time_point now) {
+    if (now - this->window_start >= MEASURE_WINDOW) {
+        this->measured = this->window_sent / std::chrono::duration<double>(now - this->window_start).count();
+        this->window_start = now;
+        this->window_sent = 0;
+    }
+    if (this->rate > 0) {
+        this->Refill(now);
+        if (this->tokens < 1) {
+            return false;
+        }
+        this->tokens -= 1;
+    }
+    this->window_sent++;
+    return true;
+}
+
+/**
+ * @brief Returns the milliseconds until the next token, 0 when one is ready.
+ */
+int RateLimiter::WaitTime(Clock::time_point now) const {
+    if (this->rate <= 0 || this->tokens >= 1) {
+        return 0;
+    }
+    double elapsed = std::chrono::duration<double>(now - this->last_refill).count();
+    double wait = (1 - this->tokens) / this->rate - elapsed;
+    return std::max(1, (int)std::ceil(wait * 1000));
+}
+
+/**
+ * @brief Halves the rate after a loss, at most once per the given interval.
+ *
+ * @param now The current time.
+ * @param interval Time the losses caused by one rate take to show, the timeout of a probe.
+ */
+void RateLimiter::Backoff(Clock::time_point now, Clock::duration interval) {
+    if (this->backoffs > 0 && now - this->last_backoff < interval) {
+        return;
+    }
+    double current = this->rate;
+    if (current <= 0) {
+        // Sending was not limited yet, the measured rate is the one that lost
+        double window = std::chrono::duration<double>(now - this->window_start).count();
+        current = this->measured > 0 ? this->measured : window > 0 ? this->window_sent / window : MIN_RATE;
+    }
+    this->rate = std::max(MIN_RATE, current / 2);
+    this->tokens = std::min(this->tokens, 1.0);
+    this->last_refill = now;
+    this->last_backoff = now;
+    this->backoffs++;
+}
+
+/**
+ * @brief Raises the rate by one probe per second after a probe answered on its first try.
+ */
+void RateLimiter::Increase() {
+    if (this->rate <= 0) {
+        return;
+    }
+    this->rate += 1;
+    if (this->max_rate > 0) {
+        this->rate = std::min(this->rate, this->max_rate);
+    }
+}
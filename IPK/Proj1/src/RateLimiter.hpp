@@ -0,0 +1,49 @@
+/**
+ * @file RateLimiter.hpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Declaration of class RateLimiter, limiting the probes sent per second
+ */
+
+#ifndef RATE_LIMITER_HPP
+#define RATE_LIMITER_HPP
+
+#include <chrono>
+
+/**
+ * @class RateLimiter
+ * @brief Token bucket of probes adapting its rate to the losses of the replies.
+ *
+ * The rate is halved when a probe is answered only after its retransmission,
+ * as when the target limits its ICMP or RST replies, and grows by one packet
+ * per second with every probe answered on the first try. A limiter without
+ * a rate sends freely until its first loss, it then halves the measured rate.
+ */
+class RateLimiter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit RateLimiter(double rate);
+
+    bool TryAcquire(Clock::time_point now);
+    int WaitTime(Clock::time_point now) const;
+    void Backoff(Clock::time_point now, Clock::duration interval);
+    void Increase();
+    double Rate() const { return this->rate; }
+    unsigned int Backoffs() const { return this->backoffs; }
+
+private:
+    double rate;                    ///< Probes per second, 0 for no limit
+    double max_rate;                ///< The limit given by the user, 0 for none
+    double tokens;
+    Clock::time_point last_refill;
+    Clock::time_point last_backoff;
+    Clock::time_point window_start; ///< Start of the window measuring the rate sent
+    unsigned int window_sent = 0;
+    double measured = 0;            ///< Probes per second sent in the last window
+    unsigned int backoffs = 0;
+
+    void Refill(Clock::time_point now);
+};
+
+#endif
@@ -0,0 +1,66 @@
+/**
+ * @file RttEstimator.cpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Implementation of the round trip time estimation
+ */
+
+#include "RttEstimator.hpp"
+#include <algorithm>
+#include <cmath>
+
+/**
+ * @brief Constructs the estimator of a target without any reply yet.
+ *
+ * @param initial Timeout until the first reply is measured.
+ * @param min The shortest timeout.
+ * @param max The longest timeout, also of the retransmitted probes.
+ */
+RttEstimator::RttEstimator(Duration initial, Duration min, Duration max)
+    : initial{std::clamp(initial, min, max)}, min{min}, max{max} {}
+
+/**
+ * @brief Adds the round trip of a probe answered on its first transmission.
+ *
+ * @param rtt Time from sending the probe to its reply.
+ */
+void RttEstimator::Sample(Duration rtt) {
+    double r = rtt.count();
+    if (this->samples.empty()) {
+        this->srtt = r;
+        this->rttvar = r / 2;
+    } else {
+        this->rttvar = 0.75 * this->rttvar + 0.25 * std::fabs(this->srtt - r);
+        this->srtt = 0.875 * this->srtt + 0.125 * r;
+    }
+    this->samples.push_back(rtt);
+}
+
+/**
+ * @brief Returns the timeout of a probe, doubled for every retransmission.
+ *
+ * @param tries Number of transmissions of the probe including the one being timed.
+ */
+RttEstimator::Duration RttEstimator::Timeout(unsigned int tries) const {
+    auto timeout = this->samples.empty() ? this->initial : Duration((long)(this->srtt + 4 * this->rttvar));
+    for (unsigned int i = 1; i < tries && timeout < this->max; i++) {
+        timeout *= 2;
+    }
+    return std::clamp(timeout, this->min, this->max);
+}
+
+/**
+ * @brief Returns the measured round trip below which the given percent of the samples lies.
+ *
+ * @param percent The percentile from 0 to 100.
+ * @return The round trip, zero without any sample.
+ */
+RttEstimator::Duration RttEstimator::Percentile(double percent) const {
+    if (this->samples.empty()) {
+        return Duration(0);
+    }
+    auto sorted = this->samples;
+    size_t nth = std::min(sorted.size() - 1, (size_t)(percent / 100 * sorted.size()));
+    std::nth_element(sorted.begin(), sorted.begin() + nth, sorted.end());
+    return sorted[nth];
+}
@@ -0,0 +1,42 @@
+/**
+ * @file RttEstimator.hpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Declaration of class RttEstimator, timeouts of probes from the measured round trip
+ */
+
+#ifndef RTT_ESTIMATOR_HPP
+#define RTT_ESTIMATOR_HPP
+
+#include <chrono>
+#include <vector>
+
+/**
+ * @class RttEstimator
+ * @brief Smoothed round trip time and its variation of one target as TCP computes them (RFC 6298).
+ *
+ * The timeout starts at the initial one and follows SRTT + 4 * RTTVAR once
+ * the first reply is measured, never leaving the given bounds.
+ */
+class RttEstimator {
+public:
+    using Duration = std::chrono::microseconds;
+
+    RttEstimator(Duration initial, Duration min, Duration max);
+
+    void Sample(Duration rtt);
+    Duration Timeout(unsigned int tries) const;
+    Duration Percentile(double percent) const;
+    size_t Samples() const { return this->samples.size(); }
+    Duration Smoothed() const { return Duration((long)this->srtt); }
+
+private:
+    Duration initial;
+    Duration min;
+    Duration max;
+    double srtt = 0;     ///< Smoothed round trip time in microseconds
+    double rttvar = 0;   ///< Its variation in microseconds
+    std::vector<Duration> samples;
+};
+
+#endif
@@ -0,0 +1,399 @@
+/**
+ * @file Scanner.cpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Implementation of the pipeline of probes
+ */
+
+#include "Scanner.hpp"
+#include "Network.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <netinet/in.h>
+
+/// Timeouts never get shorter than this, unless the user waits less.
+constexpr auto MIN_TIMEOUT = std::chrono::milliseconds(100);
+/// Probes sent between two reads of the replies, which must fit into the receive buffer.
+constexpr size_t MAX_BURST = 1024;
+
+/**
+ * @brief Returns the shorter of two waits in milliseconds, -1 is no wait at all.
+ */
+static int shorter(int wait, int other){
+    return wait < 0 ? other : other < 0 ? wait : std::min(wait, other);
+}
+
+/**
+ * @brief Returns the raw in_addr or in6_addr of an address as the key of its target.
+ */
+static std::string RawAddress(const struct sockaddr_storage *addr){
+    if (addr->ss_family == AF_INET) {
+        return std::string((const char *)&((const struct sockaddr_in *)addr)->sin_addr, sizeof(struct in_addr));
+    }
+    return std::string((const char *)&((const struct sockaddr_in6 *)addr)->sin6_addr, sizeof(struct in6_addr));
+}
+
+/**
+ * @brief Takes the settings of the pipeline from the command-line options.
+ *
+ * @param options The options parsed from the command-line arguments.
+ */
+void Scanner::SetupPipeline(const ArgParser::Options &options){
+    this->timeout = {.tv_sec = options.timeout / 1000, .tv_usec = (options.timeout % 1000) * 1000};
+    this->parallel = options.parallel;
+    this->retries = options.retries;
+    this->rate = options.rate;
+    this->summary = options.summary;
+    this->batch = options.batch;
+
+    // The messages point to their packet and address for good, only the lengths change
+    this->send_packets.assign(this->batch * MAX_PROBE_SIZE, 0);
+    this->send_addrs.assign(this->batch, {});
+    this->send_iov.assign(this->batch, {});
+    this->send_msgs.assign(this->batch, {});
+    this->recv_packets.assign(this->batch * MAX_REPLY_SIZE, 0);
+    this->recv_addrs.assign(this->batch, {});
+    this->recv_iov.assign(this->batch, {});
+    this->recv_msgs.assign(this->batch, {});
+    for (size_t i = 0; i < this->batch; i++) {
+        this->send_iov[i].iov_base = &this->send_packets[i * MAX_PROBE_SIZE];
+        this->send_msgs[i].msg_hdr.msg_name = &this->send_addrs[i];
+        this->send_msgs[i].msg_hdr.msg_iov = &this->send_iov[i];
+        this->send_msgs[i].msg_hdr.msg_iovlen = 1;
+        this->recv_iov[i] = {.iov_base = &this->recv_packets[i * MAX_REPLY_SIZE], .iov_len = MAX_REPLY_SIZE};
+        this->recv_msgs[i].msg_hdr.msg_name = &this->recv_addrs[i];
+        this->recv_msgs[i].msg_hdr.msg_iov = &this->recv_iov[i];
+        this->recv_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    this->send_ids.reserve(this->batch);
+}
+
+/**
+ * @brief Adds a target to scan, its probes are sent by SendProbes.
+ *
+ * @param addr The address of the target, of the family of the scanner.
+ * @param ports The port numbers to scan, sorted.
+ * @return The index of the target.
+ */
+size_t Scanner::AddTarget(const struct sockaddr_storage &addr, const std::vector<unsigned int> &ports){
+    // The wait time given by the user is the first timeout and the longest one
+    auto max_timeout = RttEstimator::Duration(this->timeout.tv_sec * 1'000'000 + this->timeout.tv_usec);
+    Target target = {
+        .addr = addr,
+        .name = Network::AddressToString(&addr),
+        .first = this->probes.size(),
+        .end = this->probes.size(),
+        .next = this->probes.size(),
+        .printed = this->probes.size(),
+        .inflight = 0,
+        .probe_index = {},
+        .retransmit = {},
+        .rtt = RttEstimator(max_timeout, std::min<RttEstimator::Duration>(max_timeout, MIN_TIMEOUT), max_timeout),
+        .limiter = RateLimiter(this->rate),
+        .stats = {},
+    };
+
+    size_t index = this->targets.size();
+    target.probe_index.reserve(ports.size());
+    for (auto port : ports) {
+        if (target.probe_index.emplace(port, this->probes.size()).second) {
+            this->probes.push_back({uint16_t(port), uint32_t(index), {}, {}, PortState::Pending, 0});
+        }
+    }
+    target.end = this->probes.size();
+    this->PrepareTarget(index, target);
+
+    this->target_index.emplace(RawAddress(&addr), index);
+    this->targets.push_back(std::move(target));
+    return index;
+}
+
+/**
+ * @brief Sends the probes waiting for a retransmission and fills the windows of the targets.
+ *
+ * The targets take turns one probe at a time until none of them can send
+ * more or a burst is sent, a different target starts every call. The
+ * probes are sent in batches.
+ *
+ * @param now The current time.
+ * @return Milliseconds until a probe expires or may be sent, -1 when there is none.
+ */
+int Scanner::SendProbes(TimerWheel::Clock::time_point now){
+    int wait = -1;
+    size_t burst = 0;
+    bool sent = true;
+
+    auto &sending = this->sending;
+    sending.clear();
+    for (size_t i = 0; i < this->targets.size(); i++) {
+        sending.push_back((this->turn + i) % this->targets.size());
+    }
+    this->turn = this->targets.empty() ? 0 : (this->turn + 1) % this->targets.size();
+
+    while (sent && burst < MAX_BURST && !sending.empty()) {
+        size_t kept = 0;
+        for (auto index : sending) {
+            auto &target = this->targets[index];
+            // Answered late, after they expired
+            while (!target.retransmit.empty() && this->probes[target.retransmit.front()].state != PortState::Pending) {
+                target.retransmit.pop_front();
+            }
+
+            bool retry = !target.retransmit.empty();
+            if (!retry && (target.next == target.end || target.inflight >= this->parallel)) {
+                continue;
+            }
+            if (!target.limiter.TryAcquire(now)) {
+                wait = shorter(wait, target.limiter.WaitTime(now));
+                continue;
+            }
+            if (retry) {
+                this->send_ids.push_back(target.retransmit.front());
+                target.retransmit.pop_front();
+            } else {
+                this->send_ids.push_back(target.next++);
+                target.inflight++;
+            }
+            sending[kept++] = index;
+
+            if (this->send_ids.size() == this->batch && !(sent = this->SendBatch(now))) {
+                break;
+            }
+            if (++burst == MAX_BURST) {
+                break;
+            }
+        }
+        sending.resize(kept);
+    }
+    if (sent) {
+        sent = this->SendBatch(now);
+    }
+
+    if (!sent) {
+        // The send buffer is full, it is retried soon
+        wait = shorter(wait, 1);
+    } else if (burst == MAX_BURST) {
+        // The replies are read first, the rest is sent right after
+        wait = 0;
+    }
+    return shorter(wait, this->wheel.NextTimeout(now));
+}
+
+/**
+ * @brief Sends the probes of the batch by one system call.
+ *
+ * Probes the socket did not take wait at the front of the retransmissions
+ * of their target, they are not counted as tries.
+ *
+ * @param now The current time.
+ * @return False when the send buffer is full and not all of them were sent.
+ */
+bool Scanner::SendBatch(TimerWheel::Clock::time_point now){
+    size_t count = this->send_ids.size();
+    if (count == 0) {
+        return true;
+    }
+    for (size_t i = 0; i < count; i++) {
+        auto &probe = this->probes[this->send_ids[i]];
+        auto &target = this->targets[probe.target];
+        this->send_addrs[i] = target.addr;
+        this->send_iov[i].iov_len = this->MakeProbe(target, probe, &this->send_packets[i * MAX_PROBE_SIZE], &this->send_addrs[i]);
+        this->send_msgs[i].msg_hdr.msg_namelen = this->AddressLength();
+    }
+
+    int sent = sendmmsg(this->sendfd, this->send_msgs.data(), count, 0);
+    this->io.send_calls++;
+    if (sent < 0) {
+        if (errno != ENOBUFS && errno != EAGAIN && errno != EWOULDBLOCK) {
+            throw std::runtime_error(std::string("Sending failed"));
+        }
+        sent = 0;
+    }
+    this->io.packets_sent += sent;
+
+    for (size_t i = 0; i < (size_t)sent; i++) {
+        size_t id = this->send_ids[i];
+        auto &probe = this->probes[id];
+        auto &target = this->targets[probe.target];
+        if (probe.tries > 0) {
+            target.stats.retransmitted++;
+        }
+        probe.tries++;
+        probe.sent = now;
+        probe.deadline = now + target.rtt.Timeout(probe.tries);
+        this->wheel.Add(id, probe.deadline);
+        target.stats.sent++;
+    }
+    for (size_t i = count; i > (size_t)sent; i--) {
+        size_t id = this->send_ids[i - 1];
+        this->targets[this->probes[id].target].retransmit.push_front(id);
+    }
+    this->send_ids.clear();
+    return (size_t)sent == count;
+}
+
+/**
+ * @brief Reads the packets waiting on the receiving socket in batches and hands them to the protocol.
+ */
+void Scanner::ReceiveReplies(){
+    while (true) {
+        for (size_t i = 0; i < this->batch; i++) {
+            this->recv_msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        }
+        int count = recvmmsg(this->recvfd, this->recv_msgs.data(), this->batch, MSG_DONTWAIT, nullptr);
+        this->io.receive_calls++;
+        if (count < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                return;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error(std::string("Receiving failed"));
+        }
+        this->io.packets_received += count;
+
+        for (size_t i = 0; i < (size_t)count; i++) {
+            this->HandleReply(&this->recv_packets[i * MAX_REPLY_SIZE], this->recv_msgs[i].msg_len, this->recv_addrs[i]);
+        }
+        // A batch not full drained the socket
+        if ((size_t)count < this->batch) {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Retransmits or gives up the probes whose timeout ran out.
+ *
+ * @param now The current time.
+ */
+void Scanner::ExpireProbes(TimerWheel::Clock::time_point now){
+    for (auto &timer : this->wheel.Expire(now)) {
+        auto &probe = this->probes[timer.id];
+        // Timers of answered or already retransmitted probes are stale
+        if (probe.state != PortState::Pending || timer.deadline != probe.deadline) {
+            continue;
+        }
+        auto &target = this->targets[probe.target];
+        if (probe.tries <= this->retries) {
+            target.retransmit.push_back(timer.id);
+        } else {
+            probe.state = this->ExpiredState();
+            target.inflight--;
+        }
+    }
+}
+
+/**
+ * @brief Prints the results of a target in the order of the ports, as far as its probes are resolved.
+ *
+ * @param index The index of the target.
+ * @return True when all the results of the target are printed.
+ */
+bool Scanner::PrintResults(size_t index){
+    auto &target = this->targets[index];
+    while (target.printed < target.next && this->probes[target.printed].state != PortState::Pending) {
+        auto &probe = this->probes[target.printed];
+        printf("%s %d %s %s\n",target.name.data(),probe.port,this->Protocol(),PortStateName(probe.state));
+        target.printed++;
+    }
+    if (target.printed < target.end) {
+        return false;
+    }
+
+    fflush(stdout);
+    if (this->summary) {
+        this->PrintSummary(target);
+    }
+    return true;
+}
+
+/**
+ * @brief Prints the probes sent to a target and the round trips measured to stderr.
+ *
+ * @param target The scanned target.
+ */
+void Scanner::PrintSummary(const Target &target) const {
+    auto ms = [](RttEstimator::Duration duration) { return duration.count() / 1000.0; };
+    const char *name = target.name.data();
+    fprintf(stderr, "%s %s: %zu probes, %zu sent, %zu retransmitted, %zu answered\n", name, this->Protocol(),
+            target.end - target.first, target.stats.sent, target.stats.retransmitted, target.stats.answered);
+    if (target.rtt.Samples() > 0) {
+        fprintf(stderr, "%s %s: rtt p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, max %.3f ms, srtt %.3f ms, timeout %.3f ms\n",
+                name, this->Protocol(), ms(target.rtt.Percentile(50)), ms(target.rtt.Percentile(90)),
+                ms(target.rtt.Percentile(99)), ms(target.rtt.Percentile(100)), ms(target.rtt.Smoothed()),
+                ms(target.rtt.Timeout(1)));
+    }
+    if (target.limiter.Rate() > 0) {
+        fprintf(stderr, "%s %s: rate %.0f probes/s, %u backoffs\n", name, this->Protocol(),
+                target.limiter.Rate(), target.limiter.Backoffs());
+    } else {
+        fprintf(stderr, "%s %s: rate unlimited\n", name, this->Protocol());
+    }
+}
+
+/**
+ * @brief Finds the target of an address.
+ *
+ * @param address The raw in_addr or in6_addr, of the family of the scanner.
+ * @return The target or nullptr when the address is not scanned.
+ */
+Scanner::Target *Scanner::FindTarget(const void *address){
+    size_t len = this->src_addr->ss_family == AF_INET ? sizeof(struct in_addr) : sizeof(struct in6_addr);
+    auto found = this->target_index.find(std::string((const char *)address, len));
+    return found == this->target_index.end() ? nullptr : &this->targets[found->second];
+}
+
+/**
+ * @brief Finds the probe of a port that was sent and still waits for its reply.
+ *
+ * @param target The target of the probe.
+ * @param port The scanned port.
+ * @return The probe or nullptr when the port has no such probe.
+ */
+Scanner::Probe *Scanner::FindProbe(Target &target, uint16_t port){
+    auto found = target.probe_index.find(port);
+    if (found == target.probe_index.end()) {
+        return nullptr;
+    }
+    auto &probe = this->probes[found->second];
+    if (probe.state != PortState::Pending || probe.tries == 0) {
+        return nullptr;
+    }
+    return &probe;
+}
+
+/**
+ * @brief Resolves a probe by its reply, which frees its place in the window.
+ *
+ * The round trip of a probe answered on its first try is measured, an
+ * answer to a retransmitted one is a loss slowing down the sending.
+ *
+ * @param probe The probe waiting for reply.
+ * @param state The state of its port.
+ */
+void Scanner::Resolve(Probe &probe, PortState state){
+    auto now = TimerWheel::Clock::now();
+    auto &target = this->targets[probe.target];
+    probe.state = state;
+    target.inflight--;
+    target.stats.answered++;
+
+    if (probe.tries == 1) {
+        target.rtt.Sample(std::chrono::duration_cast<RttEstimator::Duration>(now - probe.sent));
+        target.limiter.Increase();
+    } else {
+        // Either the first transmission or its reply was lost, the round trip is ambiguous (Karn)
+        target.limiter.Backoff(now, target.rtt.Timeout(1));
+    }
+}
+
+/**
+ * @brief Returns the size of the addresses of the family of the scanner.
+ */
+socklen_t Scanner::AddressLength() const {
+    return this->src_addr->ss_family == AF_INET ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+}
@@ -8,22 +8,173 @@
 #ifndef SCANNER_HPP
 #define SCANNER_HPP
 
+#include "ArgParser.hpp"
+#include "RateLimiter.hpp"
+#include "RttEstimator.hpp"
+#include "TimerWheel.hpp"
+#include <deque>
 #include <cstdint>
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include <sys/socket.h>
 
+/**
+ * @brief State of a scanned port, Pending until its probe is answered or expires.
+ */
+enum class PortState { Pending, Open, Closed, Filtered };
+
+/**
+ * @brief Returns the name of the state as printed in the results.
+ */
+inline const char *PortStateName(PortState state) {
+    switch (state) {
+        case PortState::Open:
+            return "open";
+        case PortState::Closed:
+            return "closed";
+        case PortState::Filtered:
+            return "filtered";
+        default:
+            return "pending";
+    }
+}
+
+/**
+ * @class Scanner
+ * @brief Pipeline of probes shared by the TCP and UDP scanning.
+ *
+ * One scanner probes any number of targets of one address family. Up to
+ * 'parallel' probes of every target wait for their reply at once, a new one
+ * is sent whenever one of them is resolved, and the targets take turns in
+ * sending so that none of them starves the others. The protocols only send
+ * the probes and resolve them from the replies, probes without a reply
+ * expire on a timer wheel to the state given by the protocol.
+ *
+ * The timeout of a probe follows the round trip measured on the replies of
+ * its target, an expired probe is sent again up to 'retries' times. The
+ * probes are sent no faster than the rate limiter of their target allows,
+ * which slows down when the replies get lost.
+ *
+ * Packets go through the sockets in batches of up to 'batch' of them per
+ * system call, sendmmsg for the probes and recvmmsg for the replies. The
+ * protocols only build the packets of the probes and handle the replies.
+ */
 class Scanner {
 public:
-    struct sockaddr_storage *src_addr;    ///< Source address
-    struct sockaddr_storage *dst_addr;    ///< Destination address
+    struct sockaddr_storage *src_addr;    ///< Source address, its family is the one of all targets
     struct timeval timeout;
+    unsigned int parallel;                ///< Most probes of a target waiting for reply at once
+    unsigned int retries;                 ///< Retransmissions of an unanswered probe
+    double rate;                          ///< Probes per second to a target at most, 0 for no limit
+    bool summary;                         ///< Prints the statistics of every target to stderr
+    unsigned int batch;                   ///< Most packets sent or received by one system call
+    int sendfd;
+    int recvfd;
 
     // Constructor
-    Scanner(struct sockaddr_storage *src_addr, struct sockaddr_storage *dst_addr) : src_addr{src_addr}, dst_addr{dst_addr} , timeout{0, 5000}{};
-     
-    virtual void ScanPort(unsigned int Port,std::string adress) = 0;
+    Scanner(struct sockaddr_storage *src_addr) : src_addr{src_addr}, timeout{0, 5000}, parallel{1}, retries{0}, rate{0}, summary{false}, batch{1}, sendfd{-1}, recvfd{-1}{};
+
+    size_t AddTarget(const struct sockaddr_storage &addr, const std::vector<unsigned int> &ports);
+    int SendProbes(TimerWheel::Clock::time_point now);
+    void ExpireProbes(TimerWheel::Clock::time_point now);
+    bool PrintResults(size_t target);
+    void ReceiveReplies();
     virtual ~Scanner() = default;
+
+    /**
+     * @brief Packets and system calls of all the targets.
+     */
+    struct IoStatistics {
+        size_t packets_sent = 0;
+        size_t packets_received = 0;
+        size_t send_calls = 0;
+        size_t receive_calls = 0;
+    };
+
+    const IoStatistics &Io() const { return this->io; }
+
+protected:
+    /**
+     * @brief Probe of one port.
+     */
+    struct Probe {
+        uint16_t port;
+        uint32_t target;                       ///< Index of the target
+        TimerWheel::Clock::time_point sent;    ///< Time of the last transmission
+        TimerWheel::Clock::time_point deadline;
+        PortState state;
+        uint8_t tries;                         ///< Transmissions so far
+    };
+    static_assert(ArgParser::MAX_RETRIES < UINT8_MAX, "Probe::tries must not wrap after the last retransmission");
+
+    /**
+     * @brief Statistics of one target.
+     */
+    struct Statistics {
+        size_t sent = 0;
+        size_t retransmitted = 0;
+        size_t answered = 0;
+    };
+
+    /**
+     * @brief One scanned address with its probes, which are the ones from 'first' to 'end'.
+     */
+    struct Target {
+        struct sockaddr_storage addr;
+        std::string name;                                  ///< The address as printed in the results
+        size_t first;
+        size_t end;
+        size_t next;                                       ///< First probe not sent yet
+        size_t printed;                                    ///< First probe not printed yet
+        size_t inflight = 0;
+        std::unordered_map<uint16_t, size_t> probe_index;  ///< Probe of every scanned port
+        std::deque<size_t> retransmit;                     ///< Expired probes to send again
+        RttEstimator rtt;
+        RateLimiter limiter;
+        Statistics stats;
+    };
+
+    /// Room for the packet of one probe
+    static constexpr size_t MAX_PROBE_SIZE = 64;
+    /// Room for one reply, longer ones are truncated
+    static constexpr size_t MAX_REPLY_SIZE = 1024;
+
+    void SetupPipeline(const ArgParser::Options &options);
+
+    virtual const char *Protocol() const = 0;
+    virtual PortState ExpiredState() const = 0;
+    virtual void PrepareTarget(size_t index, Target &target) { (void)index; (void)target; }
+    virtual size_t MakeProbe(Target &target, Probe &probe, uint8_t *packet, struct sockaddr_storage *dst) = 0;
+    virtual void HandleReply(const uint8_t *packet, size_t len, const struct sockaddr_storage &from) = 0;
+
+    Target *FindTarget(const void *address);
+    Probe *FindProbe(Target &target, uint16_t port);
+    void Resolve(Probe &probe, PortState state);
+    socklen_t AddressLength() const;
+
+private:
+    std::vector<Target> targets;
+    std::vector<size_t> sending;                            ///< Targets taking turns in SendProbes
+    std::unordered_map<std::string, size_t> target_index;  ///< Target of every raw address
+    std::vector<Probe> probes;                              ///< Probes of all the targets
+    size_t turn = 0;                                        ///< Target sending first in the next round
+    TimerWheel wheel{std::chrono::milliseconds(1), 1024};
+    IoStatistics io;
+
+    // Messages of sendmmsg and recvmmsg, one for every packet of a batch
+    std::vector<size_t> send_ids;                      ///< Probes of the batch being built
+    std::vector<uint8_t> send_packets;
+    std::vector<struct sockaddr_storage> send_addrs;
+    std::vector<struct iovec> send_iov;
+    std::vector<struct mmsghdr> send_msgs;
+    std::vector<uint8_t> recv_packets;
+    std::vector<struct sockaddr_storage> recv_addrs;
+    std::vector<struct iovec> recv_iov;
+    std::vector<struct mmsghdr> recv_msgs;
+
+    bool SendBatch(TimerWheel::Clock::time_point now);
+    void PrintSummary(const Target &target) const;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,111 @@
+/**
+ * @file Scheduler.cpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Implementation of the event loop of all the scanners
+ */
+
+#include "Scheduler.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <sys/epoll.h>
+#include <unistd.h>
+
+/**
+ * @brief Closes the epoll descriptor when Run ends, also by an exception.
+ */
+struct EpollDescriptor {
+    int fd;
+
+    ~EpollDescriptor() {
+        if (this->fd >= 0) {
+            close(this->fd);
+        }
+    }
+};
+
+/**
+ * @brief Adds a target of a scanner to the scans run.
+ *
+ * @param scanner The scanner of the target.
+ * @param target The index of the target in the scanner.
+ */
+void Scheduler::Add(Scanner *scanner, size_t target){
+    if (std::find(this->scanners.begin(), this->scanners.end(), scanner) == this->scanners.end()) {
+        this->scanners.push_back(scanner);
+    }
+    this->scans.push_back({scanner, target});
+}
+
+/**
+ * @brief Runs all the scans until all of their results are printed.
+ *
+ * @param summary Prints the packets sent and received per second to stderr at the end.
+ */
+void Scheduler::Run(bool summary){
+    auto start = TimerWheel::Clock::now();
+    EpollDescriptor epoll{epoll_create1(0)};
+    int epollfd = epoll.fd;
+    if (epollfd < 0) {
+        throw std::runtime_error(std::string("Could not create epoll"));
+    }
+    for (size_t i = 0; i < this->scanners.size(); i++) {
+        struct epoll_event event = {.events = EPOLLIN, .data = {.u64 = i}};
+        if (epoll_ctl(epollfd, EPOLL_CTL_ADD, this->scanners[i]->recvfd, &event) != 0) {
+            throw std::runtime_error(std::string("Could not add the socket to epoll"));
+        }
+    }
+    std::vector<struct epoll_event> events(std::max<size_t>(1, this->scanners.size()));
+
+    size_t printed = 0;  // First scan not printed yet
+    while (printed < this->scans.size()) {
+        // Wait for replies until the next probe of any scanner expires or may be sent
+        auto now = TimerWheel::Clock::now();
+        int wait = -1;
+        for (auto scanner : this->scanners) {
+            int next = scanner->SendProbes(now);
+            wait = wait < 0 ? next : next < 0 ? wait : std::min(wait, next);
+        }
+
+        int ready = epoll_wait(epollfd, events.data(), events.size(), wait);
+        if (ready < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("Waiting for replies failed"));
+        }
+        for (int i = 0; i < ready; i++) {
+            this->scanners[events[i].data.u64]->ReceiveReplies();
+        }
+
+        now = TimerWheel::Clock::now();
+        for (auto scanner : this->scanners) {
+            scanner->ExpireProbes(now);
+        }
+
+        while (printed < this->scans.size() && this->scans[printed].scanner->PrintResults(this->scans[printed].target)) {
+            printed++;
+        }
+    }
+    if (summary) {
+        this->PrintSummary(std::chrono::duration<double>(TimerWheel::Clock::now() - start).count());
+    }
+}
+
+/**
+ * @brief Prints the packets and system calls of all the scanners to stderr.
+ *
+ * @param seconds The time of the whole run.
+ */
+void Scheduler::PrintSummary(double seconds) const {
+    Scanner::IoStatistics total;
+    for (auto scanner : this->scanners) {
+        total.packets_sent += scanner->Io().packets_sent;
+        total.packets_received += scanner->Io().packets_received;
+        total.send_calls += scanner->Io().send_calls;
+        total.receive_calls += scanner->Io().receive_calls;
+    }
+    fprintf(stderr, "total: %zu packets sent by %zu calls, %zu received by %zu calls in %.3f s, %.0f packets/s\n",
+            total.packets_sent, total.send_calls, total.packets_received, total.receive_calls, seconds,
+            (total.packets_sent + total.packets_received) / std::max(seconds, 1e-9));
+}
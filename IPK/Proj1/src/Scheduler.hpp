@@ -0,0 +1,43 @@
+/**
+ * @file Scheduler.hpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Declaration of class Scheduler, the event loop of all the scanners
+ */
+
+#ifndef SCHEDULER_HPP
+#define SCHEDULER_HPP
+
+#include "Scanner.hpp"
+#include <cstddef>
+#include <vector>
+
+/**
+ * @class Scheduler
+ * @brief Event loop sending and receiving the probes of all the scanners at once.
+ *
+ * Every scan is one target of one scanner. All of them run concurrently,
+ * their results are printed whole and in the order the scans were added,
+ * each one as soon as the scans before it are finished.
+ */
+class Scheduler {
+public:
+    void Add(Scanner *scanner, size_t target);
+    void Run(bool summary);
+
+private:
+    /**
+     * @brief Target of a scanner.
+     */
+    struct Scan {
+        Scanner *scanner;
+        size_t target;
+    };
+
+    std::vector<Scanner *> scanners;  ///< Every scanner once
+    std::vector<Scan> scans;          ///< In the order of printing
+
+    void PrintSummary(double seconds) const;
+};
+
+#endif
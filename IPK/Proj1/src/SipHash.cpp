@@ -0,0 +1,66 @@
+/**
+ * @file SipHash.cpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Implementation of SipHash-2-4
+ */
+
+#include "SipHash.hpp"
+
+/**
+ * @brief Rotates a word left.
+ */
+static inline uint64_t Rotate(uint64_t word, int bits){
+    return (word << bits) | (word >> (64 - bits));
+}
+
+/**
+ * @brief One SipRound mixing the state.
+ */
+static inline void Round(uint64_t &v0, uint64_t &v1, uint64_t &v2, uint64_t &v3){
+    v0 += v1; v1 = Rotate(v1, 13); v1 ^= v0; v0 = Rotate(v0, 32);
+    v2 += v3; v3 = Rotate(v3, 16); v3 ^= v2;
+    v0 += v3; v3 = Rotate(v3, 21); v3 ^= v0;
+    v2 += v1; v1 = Rotate(v1, 17); v1 ^= v2; v2 = Rotate(v2, 32);
+}
+
+/**
+ * @brief Hashes a message with the key.
+ *
+ * @param data The message.
+ * @param len The length of the message.
+ * @return The hash.
+ */
+uint64_t SipHash::Hash(const uint8_t *data, size_t len) const {
+    uint64_t v0 = this->key0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = this->key1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = this->key0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = this->key1 ^ 0x7465646279746573ULL;
+
+    // Little endian words of the message, the last one holds the rest and the length
+    size_t end = len - len % 8;
+    for (size_t i = 0; i < end; i += 8) {
+        uint64_t word = 0;
+        for (int byte = 7; byte >= 0; byte--) {
+            word = (word << 8) | data[i + byte];
+        }
+        v3 ^= word;
+        Round(v0, v1, v2, v3);
+        Round(v0, v1, v2, v3);
+        v0 ^= word;
+    }
+    uint64_t last = (uint64_t)len << 56;
+    for (size_t byte = 0; byte < len % 8; byte++) {
+        last |= (uint64_t)data[end + byte] << (8 * byte);
+    }
+    v3 ^= last;
+    Round(v0, v1, v2, v3);
+    Round(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++) {
+        Round(v0, v1, v2, v3);
+    }
+    return v0 ^ v1 ^ v2 ^ v3;
+}
@@ -0,0 +1,32 @@
+/**
+ * @file SipHash.hpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Declaration of class SipHash, the keyed hash of the probe cookies
+ */
+
+#ifndef SIP_HASH_HPP
+#define SIP_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class SipHash
+ * @brief SipHash-2-4, a keyed hash of short messages.
+ *
+ * Without the key nobody can tell the hash of a message, the same way the
+ * kernel makes its SYN cookies.
+ */
+class SipHash {
+public:
+    SipHash(uint64_t key0, uint64_t key1) : key0{key0}, key1{key1} {}
+
+    uint64_t Hash(const uint8_t *data, size_t len) const;
+
+private:
+    uint64_t key0;
+    uint64_t key1;
+};
+
+#endif
@@ -7,6 +7,8 @@
 
 #include "Tcp.hpp"
 #include "Network.hpp"
+#include <cerrno>
+#include <random>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <netinet/ip.h>
@@ -27,17 +29,18 @@ TCPScanner::~TCPScanner()
 /**
   * @brief Constructs a pseudo-header for checksum calculation.
   * 
+  * @param dst_addr The address of the target.
   * @param buffer Pointer to the buffer where the pseudo-header will be stored.
   * @param protocol The protocol number AF_INET or AF_INET6.
   * @param len The length of the TCP segment.* 
   * @return The size of the pseudo-header, or -1 if the address family is unsupported.
   */
-int TCPScanner::MakePseudoHeader(uint8_t *buffer, uint8_t protocol, uint16_t len) {
+int TCPScanner::MakePseudoHeader(const struct sockaddr_storage *dst_addr, uint8_t *buffer, uint8_t protocol, uint16_t len) {
     switch (src_addr->ss_family) {
         case AF_INET: {
             Network::PseudoHeaderIPv4 *header = (Network::PseudoHeaderIPv4 *)buffer;
             header->src = ((struct sockaddr_in *)this->src_addr)->sin_addr.s_addr;
-            header->dst = ((struct sockaddr_in *)this->src_addr)->sin_addr.s_addr;
+            header->dst = ((const struct sockaddr_in *)dst_addr)->sin_addr.s_addr;
             header->zeroes = 0;
             header->protocol = protocol;
             header->len = htons(len);
@@ -47,7 +50,7 @@ int TCPScanner::MakePseudoHeader(uint8_t *buffer, uint8_t protocol, uint16_t len
 
         case AF_INET6: {
             struct sockaddr_in6 *src = (struct sockaddr_in6 *)this->src_addr;
-            struct sockaddr_in6 *dst = (struct sockaddr_in6 *)this->dst_addr;
+            const struct sockaddr_in6 *dst = (const struct sockaddr_in6 *)dst_addr;
             Network::PseudoHeaderIPv6 *header = (Network::PseudoHeaderIPv6 *)buffer;
 
             memcpy(&header->src, &src->sin6_addr, sizeof(struct in6_addr));
@@ -65,23 +68,29 @@ int TCPScanner::MakePseudoHeader(uint8_t *buffer, uint8_t protocol, uint16_t len
 }
 
 /**
- * @brief Computes the TCP checksum.
+ * @brief Computes the TCP checksum over the whole segment and pseudo-header.
  *
+ * Only the templates and the RST packets are summed whole, the probes
+ * update the checksum of their template.
+ *
+ * @param dst_addr The address of the target.
  * @param buf Pointer to the TCP header.
+ * @param len The length of the TCP segment.
  * @param protocol The internet protocol number, AF_INET or AF_INET6.
  * @return The computed checksum.
  */
-uint16_t TCPScanner::ComputeChecksum(uint8_t *buf, uint8_t protocol) {
+uint16_t TCPScanner::ComputeChecksum(const struct sockaddr_storage *dst_addr, uint8_t *buf, uint16_t len, uint8_t protocol) {
 
-    auto buf_len = sizeof(buf);
-    auto data = (uint8_t *)malloc(buf_len + sizeof(Network::PseudoHeaderIPv6));
-    if (!data) {
-        throw std::runtime_error(std::string("Allocation failed"));
+    size_t buf_len = len;
+    if (buf_len > MAX_HEADER_SIZE) {
+        throw std::runtime_error(std::string("Segment too long"));
     }
+    uint8_t data[sizeof(Network::PseudoHeaderIPv6) + MAX_HEADER_SIZE] = {};
 
-    memset(data, 0, buf_len + sizeof(Network::PseudoHeaderIPv6));
-
-    int pseudo_header_len = MakePseudoHeader(data, protocol, buf_len);
+    int pseudo_header_len = MakePseudoHeader(dst_addr, data, protocol, buf_len);
+    if (pseudo_header_len < 0) {
+        throw std::runtime_error(std::string("Unknown family of adresses"));
+    }
 
     memcpy(data + pseudo_header_len, buf, buf_len);
 
@@ -90,8 +99,10 @@ uint16_t TCPScanner::ComputeChecksum(uint8_t *buf, uint8_t protocol) {
     uint32_t sum = 0;
     int i;
 
+    // The words are copied out, the pseudo-header was written through another type
     for (i = 0; i < size - 1; i += 2) {
-        uint16_t word16 = *(uint16_t *)&data[i];
+        uint16_t word16;
+        memcpy(&word16, &data[i], sizeof(word16));
         sum += word16;
     }
     
@@ -105,7 +116,6 @@ uint16_t TCPScanner::ComputeChecksum(uint8_t *buf, uint8_t protocol) {
         sum = (sum & 0xFFFF) + (sum >> 16);
     }
 
-    free(data);
     return (uint16_t)(~sum);
 }
 
@@ -115,49 +125,111 @@ uint16_t TCPScanner::ComputeChecksum(uint8_t *buf, uint8_t protocol) {
  * @param options The options parsed from the command-line arguments.
  */
 void TCPScanner::SetupScanner(ArgParser::Options options){
-    this->timeout = {.tv_sec = 0, .tv_usec = options.timeout * 1000};
-    // Random port
-    this->send_port =  rand() % (65535 - 2000 + 1) + 2000;
+    this->SetupPipeline(options);
+    // Random key and nonce of the cookies
+    std::random_device random;
+    auto random64 = [&random]() { return ((uint64_t)random() << 32) | random(); };
+    this->cookies = SipHash(random64(), random64());
+    this->nonce = random64();
     this->sendfd = Network::CreateSocket(this->src_addr->ss_family,SOCK_RAW, IPPROTO_TCP);
     Network::SetupSocket(this->sendfd,SOL_SOCKET, SO_BINDTODEVICE, options.inteface.c_str());
 
-    bind(sendfd,(struct sockaddr *)this->dst_addr,sizeof(struct sockaddr));
-
     this->recvfd = this->sendfd;
+
+    // Replies to a whole window of probes must fit into the receive buffer
+    int buffer_size = 4 * 1024 * 1024;
+    setsockopt(this->recvfd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
 }
 
 /**
- * @brief Scans a specific TCP port on a given address.
- * 
- * @param Port The port number to scan.
- * @param adress The target address as a string.
+ * @brief Builds the SYN template of a new target, with zero ports and sequence number.
+ *
+ * @param index The index of the target.
+ * @param target The target.
  */
-void TCPScanner::ScanPort(unsigned int Port,std::string adress){
+void TCPScanner::PrepareTarget(size_t index, Target &target){
+    if (this->templates.size() <= index) {
+        this->templates.resize(index + 1);
+    }
+    this->MakeHeader(&target.addr, 0, 0, 0, this->templates[index].header, TH_SYN);
+}
 
-    Network::SetPort(this->dst_addr, Port);
-    uint8_t packet[sizeof(struct tcphdr)];
-    this->MakeHeader(Port,packet,TH_SYN);
-    
-    sendto(this->sendfd, packet, sizeof(packet), 0,(struct sockaddr *)this->dst_addr,sizeof(struct sockaddr_in));
-    auto received = this->HandlePacket(Port);
-    printf("%s %d tcp %s\n",adress.data(),Port,received == 0 ? "closed" : received == 1 ? "open" : "filtered");
+/**
+ * @brief Computes the cookie of a probe, the keyed hash of its target, its port and the nonce.
+ *
+ * @param target The target of the probe.
+ * @param port The scanned port.
+ * @return The cookie, see CookiePort and CookieSeq.
+ */
+uint64_t TCPScanner::Cookie(const Target &target, uint16_t port) const {
+    uint8_t message[sizeof(struct in6_addr) + sizeof(port) + sizeof(this->nonce)];
+    size_t len;
+    if (target.addr.ss_family == AF_INET) {
+        len = sizeof(struct in_addr);
+        memcpy(message, &((const struct sockaddr_in *)&target.addr)->sin_addr, len);
+    } else {
+        len = sizeof(struct in6_addr);
+        memcpy(message, &((const struct sockaddr_in6 *)&target.addr)->sin6_addr, len);
+    }
+    memcpy(message + len, &port, sizeof(port));
+    memcpy(message + len + sizeof(port), &this->nonce, sizeof(this->nonce));
+    return this->cookies.Hash(message, len + sizeof(port) + sizeof(this->nonce));
 }
 
+/**
+ * @brief Builds the SYN packet of a probe from the template of its target.
+ *
+ * The source port and the sequence number come from the cookie of the
+ * probe, so a retransmission is the same packet. The template has zero
+ * ports and sequence number, its checksum is updated by their new words
+ * (RFC 1624), so nothing is allocated or summed whole.
+ *
+ * @param target The target of the probe.
+ * @param probe The probe to send.
+ * @param packet Room for the packet.
+ * @param dst The address the packet is sent to, a copy of the one of the target.
+ * @return The length of the packet.
+ */
+size_t TCPScanner::MakeProbe(Target &target, Probe &probe, uint8_t *packet, struct sockaddr_storage *dst){
+    auto cookie = this->Cookie(target, probe.port);
+    memcpy(packet, this->templates[probe.target].header, sizeof(struct tcphdr));
+
+    struct tcphdr *tcp_header = (struct tcphdr *)packet;
+    tcp_header->th_sport = htons(CookiePort(cookie));
+    tcp_header->th_dport = htons(probe.port);
+    tcp_header->th_seq = htonl(CookieSeq(cookie));
+
+    uint16_t seq_words[2];
+    memcpy(seq_words, &tcp_header->th_seq, sizeof(seq_words));
+    uint16_t sum = tcp_header->th_sum;
+    sum = Network::UpdateChecksum(sum, 0, tcp_header->th_sport);
+    sum = Network::UpdateChecksum(sum, 0, tcp_header->th_dport);
+    sum = Network::UpdateChecksum(sum, 0, seq_words[0]);
+    sum = Network::UpdateChecksum(sum, 0, seq_words[1]);
+    tcp_header->th_sum = sum;
+
+    // Raw IPv6 sockets take the port as the protocol, zero is the one of the socket
+    Network::SetPort(dst, 0);
+    return sizeof(struct tcphdr);
+}
 
 /**
  * @brief Creates TCP header.
  * 
+ * @param dst_addr The address of the target.
+ * @param sport The source port number.
  * @param Port The destination port number.
+ * @param seq The sequence number.
  * @param packet Pointer to the buffer where the TCP header will be stored.
  * @param type The TCP flags, TH_SYN or TH_RST
  */
-void TCPScanner::MakeHeader(unsigned int Port,uint8_t *packet, uint8_t type){
+void TCPScanner::MakeHeader(const struct sockaddr_storage *dst_addr, uint16_t sport, unsigned int Port, uint32_t seq, uint8_t *packet, uint8_t type){
 
     struct tcphdr *tcp_header = (struct tcphdr *)packet;
 
-    tcp_header->th_sport = htons(this->send_port);
+    tcp_header->th_sport = htons(sport); // Source port
     tcp_header->th_dport = htons(Port); // Destination port
-    tcp_header->th_seq = htonl(this->SEQ_NUMBER++); // Sequence number
+    tcp_header->th_seq = htonl(seq); // Sequence number
     tcp_header->th_ack = htonl(0); // Acknowledgment number
     tcp_header->th_off = 5; // Data offset (5 words = 20 bytes)
     tcp_header->th_flags = type;
@@ -167,53 +239,65 @@ void TCPScanner::MakeHeader(unsigned int Port,uint8_t *packet, uint8_t type){
     tcp_header->th_urp = 0; // Urgent pointer
 
     tcp_header->th_sum = ComputeChecksum(
+        dst_addr,
         packet,
+        sizeof(struct tcphdr),
         IPPROTO_TCP
     );
 }
 
 /**
- * @brief Handles the receive of TCP packet from host.
- * 
- * @param Port The port number being scanned.
- * @return  0 when port is closed, 1 if open, if filtered (no response).
+ * @brief Resolves the probe a TCP packet answers.
+ *
+ * A reply belongs to a probe when it comes from its target and port to
+ * the port of its cookie and acknowledges the sequence number of the
+ * cookie. An open port is then closed by RST instead of completing the
+ * handshake.
+ *
+ * @param recv_packet The packet, with the IP header for IPv4 as raw sockets receive it.
+ * @param len The length of the packet.
+ * @param from_addr The address the packet comes from.
  */
-int TCPScanner::HandlePacket(unsigned int Port){
-    fd_set readfds;
-
-    struct timeval timeout;
-    timeout.tv_sec = this->timeout.tv_sec;
-    timeout.tv_usec = this->timeout.tv_usec;
-
-    FD_ZERO(&readfds);
-    FD_SET(this->recvfd, &readfds);
-
-
-    uint8_t recv_packet[sizeof(iphdr) + sizeof(tcphdr)];
-
-    int received;
-        
-    received = select(this->recvfd + 1, &readfds, NULL, NULL, &timeout);
-    if (received < 0) {
-        throw std::runtime_error(std::string("Select failed "));
-    } else if (received == 0) {
-        return 2;
+void TCPScanner::HandleReply(const uint8_t *recv_packet, size_t len, const struct sockaddr_storage &from_addr){
+    // IPv4 raw sockets receive the IP header too, IPv6 ones only the TCP segment
+    size_t offset = 0;
+    Target *target;
+    if (this->src_addr->ss_family == AF_INET) {
+        if (len < sizeof(struct iphdr)) {
+            return;
+        }
+        target = this->FindTarget(&((const struct sockaddr_in *)&from_addr)->sin_addr);
+        offset = ((const struct iphdr *)recv_packet)->ihl * 4;
     } else {
-        socklen_t addr_len = sizeof(this->dst_addr);
-        recvfrom(this->recvfd, recv_packet, sizeof(recv_packet), 0, (struct sockaddr *)this->dst_addr, &addr_len);
-
-        auto ip_header = (iphdr*) recv_packet;
-        auto tcp_header = (tcphdr*)(recv_packet + (ip_header->ihl * 4));
+        target = this->FindTarget(&((const struct sockaddr_in6 *)&from_addr)->sin6_addr);
+    }
+    if (target == nullptr) {
+        return;
+    }
+    if (len < offset + sizeof(struct tcphdr)) {
+        return;
+    }
 
-        if(tcp_header->th_flags & TH_RST){
-            return 0;
-        }
-        else{
-            uint8_t packet[sizeof(tcphdr)];
-            this->MakeHeader(Port,packet,TH_RST);
-            sendto(this->sendfd, packet, sizeof(packet), 0,(struct sockaddr *)this->dst_addr,sizeof(struct sockaddr));
-            return 1;
-        }
+    // The cookie of the address and port the reply comes from tells whether it answers our probe
+    auto tcp_header = (const tcphdr*)(recv_packet + offset);
+    uint16_t port = ntohs(tcp_header->th_sport);
+    auto cookie = this->Cookie(*target, port);
+    if (ntohs(tcp_header->th_dport) != CookiePort(cookie) || ntohl(tcp_header->th_ack) != CookieSeq(cookie) + 1) {
+        return;
+    }
+    auto probe = this->FindProbe(*target, port);
+    if (probe == nullptr) {
+        return;
     }
 
-}
\ No newline at end of file
+    if(tcp_header->th_flags & TH_RST){
+        this->Resolve(*probe, PortState::Closed);
+    }
+    else if((tcp_header->th_flags & (TH_SYN | TH_ACK)) == (TH_SYN | TH_ACK)){
+        this->Resolve(*probe, PortState::Open);
+        uint8_t packet[sizeof(tcphdr)];
+        this->MakeHeader(&target->addr,CookiePort(cookie),port,CookieSeq(cookie) + 1,packet,TH_RST);
+        Network::SetPort(&target->addr, 0);
+        sendto(this->sendfd, packet, sizeof(packet), 0,(struct sockaddr *)&target->addr,this->AddressLength());
+    }
+}
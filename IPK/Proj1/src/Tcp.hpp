@@ -11,33 +11,63 @@
 #include "ArgParser.hpp"
 #include "Network.hpp"
 #include "Scanner.hpp"
+#include "SipHash.hpp"
 #include <cstdint>
 #include <cstring>
+#include <vector>
 #include <arpa/inet.h>
 #include <sys/socket.h>
+#include <netinet/tcp.h>
 
 /**
  * @class TCPScanner
  * @brief A class for TCP scanning.
+ *
+ * The source port and the sequence number of a probe are a cookie, the
+ * keyed hash of the target, the port and a nonce of the scanner. A reply
+ * is checked by recomputing the cookie of the address and the port it comes
+ * from, it must come to the port of the cookie and acknowledge its sequence
+ * number. Nothing is remembered to check it and nobody without the key can
+ * forge it.
  */
 class TCPScanner : public Scanner {
 public:
-    int sendfd;
-    int recvfd;
-    uint16_t SEQ_NUMBER;
-    uint32_t send_port;
-
-    TCPScanner( struct sockaddr_storage *dst_addr,struct sockaddr_storage *src_addr) : Scanner{dst_addr,src_addr} {}
+    TCPScanner(struct sockaddr_storage *src_addr) : Scanner{src_addr} {}
     ~TCPScanner();
 
     void SetupScanner(ArgParser::Options options);
-    void ScanPort(unsigned int Port,std::string adress) override;
-    int HandlePacket(unsigned int Port);
+
+protected:
+    const char *Protocol() const override { return "tcp"; }
+    PortState ExpiredState() const override { return PortState::Filtered; }
+    void PrepareTarget(size_t index, Target &target) override;
+    size_t MakeProbe(Target &target, Probe &probe, uint8_t *packet, struct sockaddr_storage *dst) override;
+    void HandleReply(const uint8_t *recv_packet, size_t len, const struct sockaddr_storage &from_addr) override;
 
 private:
-    void MakeHeader(unsigned int Port,uint8_t *packet, uint8_t type);
-    int MakePseudoHeader(uint8_t *buffer, uint8_t protocol, uint16_t len);
-    uint16_t ComputeChecksum(uint8_t *buf, uint8_t protocol);
+    /// Longest TCP header with options
+    static constexpr size_t MAX_HEADER_SIZE = 60;
+
+    /**
+     * @brief SYN packet to a target with zero port and sequence number, checksum included.
+     */
+    struct SynTemplate {
+        uint8_t header[sizeof(struct tcphdr)];
+    };
+
+    std::vector<SynTemplate> templates;  ///< Template of every target
+    SipHash cookies{0, 0};               ///< Keyed by random numbers in SetupScanner
+    uint64_t nonce;                      ///< Random, makes the cookies of every scan different
+
+    uint64_t Cookie(const Target &target, uint16_t port) const;
+    /// The source port of a probe, above the well-known ones
+    static uint16_t CookiePort(uint64_t cookie) { return 1024 + (cookie >> 32) % (65536 - 1024); }
+    /// The sequence number of a probe
+    static uint32_t CookieSeq(uint64_t cookie) { return (uint32_t)cookie; }
+
+    void MakeHeader(const struct sockaddr_storage *dst_addr, uint16_t sport, unsigned int Port, uint32_t seq, uint8_t *packet, uint8_t type);
+    int MakePseudoHeader(const struct sockaddr_storage *dst_addr, uint8_t *buffer, uint8_t protocol, uint16_t len);
+    uint16_t ComputeChecksum(const struct sockaddr_storage *dst_addr, uint8_t *buf, uint16_t len, uint8_t protocol);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,86 @@
+/**
+ * @file TimerWheel.cpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Implementation of the timer wheel
+ */
+
+#include "TimerWheel.hpp"
+#include <algorithm>
+
+/**
+ * @brief Constructs an empty wheel.
+ *
+ * @param tick Time covered by one slot.
+ * @param slots Number of slots, one round of the wheel is tick * slots.
+ */
+TimerWheel::TimerWheel(std::chrono::milliseconds tick, size_t slots)
+    : tick{tick}, slots(slots), start{Clock::now()}, cursor{0}, count{0} {}
+
+/**
+ * @brief Returns the number of the tick containing the given time.
+ */
+uint64_t TimerWheel::TickOf(Clock::time_point time) const {
+    if (time <= this->start) {
+        return 0;
+    }
+    return std::chrono::duration_cast<std::chrono::milliseconds>(time - this->start) / this->tick;
+}
+
+/**
+ * @brief Adds a timer, deadlines already passed expire on the next call of Expire.
+ *
+ * @param id Identifier returned when the timer expires.
+ * @param deadline Time of the expiration.
+ */
+void TimerWheel::Add(uint32_t id, Clock::time_point deadline) {
+    auto tick = std::max(this->TickOf(deadline), this->cursor);
+    this->slots[tick % this->slots.size()].push_back({id, deadline});
+    this->count++;
+}
+
+/**
+ * @brief Removes and returns all timers whose deadline has passed.
+ *
+ * @param now The current time.
+ * @return The expired timers.
+ */
+std::vector<TimerWheel::Timer> TimerWheel::Expire(Clock::time_point now) {
+    std::vector<Timer> expired;
+    auto now_tick = this->TickOf(now);
+    // A wheel left alone for more than a round has to look at every slot once.
+    auto walk = std::min<uint64_t>(now_tick - this->cursor, this->slots.size() - 1);
+
+    for (uint64_t tick = now_tick - walk; tick <= now_tick; tick++) {
+        auto &slot = this->slots[tick % this->slots.size()];
+        // Timers of later rounds or of later in this tick stay.
+        auto kept = std::partition(slot.begin(), slot.end(),
+            [now](const Timer &timer) { return timer.deadline > now; });
+        expired.insert(expired.end(), kept, slot.end());
+        slot.erase(kept, slot.end());
+    }
+
+    this->cursor = now_tick;
+    this->count -= expired.size();
+    return expired;
+}
+
+/**
+ * @brief Returns how long the owner may wait before the next timer can expire.
+ *
+ * @param now The current time.
+ * @return Milliseconds until the end of the first tick holding a timer, -1 for an empty wheel.
+ */
+int TimerWheel::NextTimeout(Clock::time_point now) const {
+    if (this->count == 0) {
+        return -1;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - this->start);
+    for (uint64_t i = 0; i < this->slots.size(); i++) {
+        if (!this->slots[(this->cursor + i) % this->slots.size()].empty()) {
+            auto end = this->tick * (this->cursor + i + 1);
+            return std::max<int>(0, (end - elapsed).count());
+        }
+    }
+    return 0;
+}
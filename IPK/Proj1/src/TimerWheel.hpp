@@ -0,0 +1,50 @@
+/**
+ * @file TimerWheel.hpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Declaration of class TimerWheel, expiring timeouts of probes
+ */
+
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @class TimerWheel
+ * @brief Hashed timer wheel, every slot holds timers of one tick.
+ *
+ * Timers are not cancelled, the owner ignores expired timers of probes
+ * that were answered in the meantime. Deadlines further than the wheel
+ * covers stay in their slot for more rounds.
+ */
+class TimerWheel {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Timer {
+        uint32_t id;                 ///< Identifier chosen by the owner
+        Clock::time_point deadline;  ///< Time of the expiration
+    };
+
+    TimerWheel(std::chrono::milliseconds tick, size_t slots);
+
+    void Add(uint32_t id, Clock::time_point deadline);
+    std::vector<Timer> Expire(Clock::time_point now);
+    int NextTimeout(Clock::time_point now) const;
+    bool Empty() const { return count == 0; }
+
+private:
+    std::chrono::milliseconds tick;
+    std::vector<std::vector<Timer>> slots;
+    Clock::time_point start;   ///< Time of the tick number 0
+    uint64_t cursor;           ///< First tick not expired yet
+    size_t count;
+
+    uint64_t TickOf(Clock::time_point time) const;
+};
+
+#endif
@@ -7,6 +7,7 @@
 
 #include "Udp.hpp"
 #include "Network.hpp"
+#include <cerrno>
 #include <unistd.h>
 #include <netinet/ip.h>
 #include <netinet/ip6.h>
@@ -26,102 +27,119 @@ UDPScanner::~UDPScanner()
 /**
  * @brief Sets up the UDP scanner by creating sockets for sending and receiving packets.
  * 
- * @param options Command-line options parsed used to setup timeout of scanner.
+ * @param options Command-line options parsed used to setup the pipeline of scanner.
  */
 void UDPScanner::SetupScanner(ArgParser::Options options){
-    this->timeout = {.tv_sec = 0, .tv_usec = options.timeout * 1000};
+    this->SetupPipeline(options);
 
     auto recv_family = this->src_addr->ss_family == int(AF_INET) ? int(IPPROTO_ICMP) : int(IPPROTO_ICMPV6);
     this->sendfd = Network::CreateSocket(this->src_addr->ss_family,SOCK_DGRAM, IPPROTO_UDP);
 
-    this->recvfd = Network::CreateSocket(this->dst_addr->ss_family,SOCK_RAW,recv_family);
+    // The port the probes are sent from is quoted by the ICMP messages
+    struct sockaddr_storage local_addr = {};
+    local_addr.ss_family = this->src_addr->ss_family;
+    socklen_t addr_len = sizeof(local_addr);
+    if (bind(this->sendfd, (struct sockaddr *)&local_addr, this->AddressLength()) != 0 ||
+        getsockname(this->sendfd, (struct sockaddr *)&local_addr, &addr_len) != 0) {
+        throw std::runtime_error(std::string("Could not bind the socket"));
+    }
+    this->send_port = Network::GetPort(&local_addr);
+
+    this->recvfd = Network::CreateSocket(this->src_addr->ss_family,SOCK_RAW,recv_family);
+
+    // Replies to a whole window of probes must fit into the receive buffer
+    int buffer_size = 4 * 1024 * 1024;
+    setsockopt(this->recvfd, SOL_SOCKET, SO_RCVBUF, &buffer_size, sizeof(buffer_size));
 }
 
 /**
- * @brief Scans a specific UDP port on a given address.
- * 
- * @param Port The port number to scan.
- * @param adress The target address to scan.
+ * @brief Builds the probe of a port, an empty datagram.
+ *
+ * @param target The target of the probe.
+ * @param probe The probe to send.
+ * @param packet Room for the packet, unused.
+ * @param dst The address the datagram is sent to, a copy of the one of the target.
+ * @return The length of the datagram, zero.
  */
-void UDPScanner::ScanPort(unsigned int Port,std::string adress){
-    Network::SetPort(this->dst_addr, Port);
-    sendto(this->sendfd, "", 0, 0,(struct sockaddr *)this->dst_addr,(this->dst_addr->ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6));
-    bool isOpen = this->HandlePacket(Port);
-
-    printf("%s %d udp %s\n",adress.data(),Port, isOpen? "open":"closed");
+size_t UDPScanner::MakeProbe(Target &target, Probe &probe, uint8_t *packet, struct sockaddr_storage *dst){
+    (void)target;
+    (void)packet;
+    Network::SetPort(dst, probe.port);
+    return 0;
 }
 
 /**
- * @brief Handles incoming ICMP packets to determine if the scanned port is open or closed.
- * 
- * @param Port The port number being scanned.
- * @return true If the port is open or false If the port is closed.
+ * @brief Finds the probe a port unreachable message answers.
+ *
+ * @param packet The ICMP packet, with the IP header for IPv4 as raw sockets receive it.
+ * @param len The length of the packet.
+ * @return The probe, or nullptr when the packet is not a port unreachable message quoting our probe to a target.
  */
-bool UDPScanner::HandlePacket(unsigned int Port){
-
-    fd_set readfds;
+Scanner::Probe *UDPScanner::QuotedProbe(const uint8_t *packet, size_t len){
+    const struct udphdr *udp_header;
+    Target *target;
 
-    struct timeval timeout;
-    timeout.tv_sec = this->timeout.tv_sec;
-    timeout.tv_usec = this->timeout.tv_usec;
-
-    FD_ZERO(&readfds);
-    FD_SET(this->recvfd, &readfds);
-
-    int received;
-    switch (this->dst_addr->ss_family)
+    switch (this->src_addr->ss_family)
     {
-    case AF_INET:
-        uint8_t recv4_packet[sizeof(struct iphdr) + sizeof(struct icmphdr) + sizeof(udphdr)];
-        
-
-        received = select(this->recvfd + 1, &readfds, NULL, NULL, &timeout);
-        if (received < 0) {
-            throw std::runtime_error(std::string("Select failed "));
-        } else if (received == 0) {
-            return true;
-        } else {
-            socklen_t addr_len = sizeof(this->dst_addr);
-            recvfrom(this->recvfd, recv4_packet, sizeof(recv4_packet), 0, (struct sockaddr *)this->dst_addr, &addr_len);
-
-            auto ip_header = (iphdr*) recv4_packet;
-            auto icmp_header = (icmphdr*)(recv4_packet + (ip_header->ihl * 4));
-            auto udp_header = (udphdr*)(recv4_packet + (ip_header->ihl * 4) + sizeof(icmphdr));
-
-            if(Port != udp_header->uh_dport){
-                return false;
-            }
-            if (icmp_header->code == ICMP_PORT_UNREACH && icmp_header->type == ICMP_DEST_UNREACH){
-                return false;
-            }
-            else{
-                throw std::runtime_error(std::string("Incorrect ICMP type or code"));
-            }
+    case AF_INET: {
+        if (len < sizeof(struct iphdr)) {
+            return nullptr;
         }
-    case AF_INET6:
-        uint8_t recv6_packet[sizeof(iphdr) + sizeof(icmp6_hdr) + sizeof(udphdr)];
-        
-        received = select(this->recvfd + 1, &readfds, NULL, NULL, &timeout);
-        if (received < 0) {
-            throw std::runtime_error(std::string("Select failed "));
-        } else if (received == 0) {
-            return true;
-        } else {
-            socklen_t addr_len = sizeof(this->dst_addr);
-            recvfrom(this->recvfd, recv6_packet, sizeof(recv6_packet), 0, (struct sockaddr *)this->dst_addr, &addr_len);
-
-            auto ip_header = (iphdr*) recv6_packet;
-            auto icmp6_header = (icmp6_hdr*)(recv6_packet + (ip_header->ihl * 4));
-            if (icmp6_header->icmp6_code == ICMP6_DST_UNREACH && icmp6_header->icmp6_code == ICMP6_DST_UNREACH_NOPORT){
-                return false;
-            }
-            else{
-                throw std::runtime_error(std::string("Incorrect ICMP type or code"));
-            }
+        size_t offset = ((struct iphdr *)packet)->ihl * 4;
+        if (len < offset + sizeof(struct icmphdr) + sizeof(struct iphdr)) {
+            return nullptr;
+        }
+        auto icmp_header = (struct icmphdr *)(packet + offset);
+        auto quoted = (struct iphdr *)(packet + offset + sizeof(struct icmphdr));
+        if (icmp_header->type != ICMP_DEST_UNREACH || icmp_header->code != ICMP_PORT_UNREACH ||
+            quoted->protocol != IPPROTO_UDP) {
+            return nullptr;
         }
-    
+        target = this->FindTarget(&quoted->daddr);
+        offset += sizeof(struct icmphdr) + quoted->ihl * 4;
+        if (len < offset + sizeof(struct udphdr)) {
+            return nullptr;
+        }
+        udp_header = (struct udphdr *)(packet + offset);
+        break;
+    }
+    case AF_INET6: {
+        // Raw ICMPv6 sockets receive the message without the IPv6 header
+        size_t offset = sizeof(struct icmp6_hdr) + sizeof(struct ip6_hdr);
+        if (len < offset + sizeof(struct udphdr)) {
+            return nullptr;
+        }
+        auto icmp6_header = (struct icmp6_hdr *)packet;
+        auto quoted = (struct ip6_hdr *)(packet + sizeof(struct icmp6_hdr));
+        if (icmp6_header->icmp6_type != ICMP6_DST_UNREACH || icmp6_header->icmp6_code != ICMP6_DST_UNREACH_NOPORT ||
+            quoted->ip6_nxt != IPPROTO_UDP) {
+            return nullptr;
+        }
+        target = this->FindTarget(&quoted->ip6_dst);
+        udp_header = (struct udphdr *)(packet + offset);
+        break;
+    }
     default:
         throw std::runtime_error(std::string("Unknown family of adresses"));
     }
-    
-}
\ No newline at end of file
+
+    if (target == nullptr || ntohs(udp_header->uh_sport) != this->send_port) {
+        return nullptr;
+    }
+    return this->FindProbe(*target, ntohs(udp_header->uh_dport));
+}
+
+/**
+ * @brief Closes the port whose probe an ICMP message answers.
+ *
+ * @param packet The ICMP message.
+ * @param len The length of the message.
+ * @param from The address the message comes from, not the target when a router sends it.
+ */
+void UDPScanner::HandleReply(const uint8_t *packet, size_t len, const struct sockaddr_storage &from){
+    (void)from;
+    auto probe = this->QuotedProbe(packet, len);
+    if (probe != nullptr) {
+        this->Resolve(*probe, PortState::Closed);
+    }
+}
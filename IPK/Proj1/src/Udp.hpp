@@ -15,22 +15,34 @@
 #include <cstring>
 #include <arpa/inet.h>
 
+/**
+ * @class UDPScanner
+ * @brief A class for UDP scanning.
+ *
+ * Empty datagrams are sent from one socket, a raw ICMP(V6) socket receives
+ * the port unreachable messages. The UDP header they quote tells the probe
+ * they answer, so no other ICMP message can close a port.
+ */
 class UDPScanner : public Scanner {
 public:
-    int sendfd;
-    int recvfd;
-    struct timeval timeout;
+    uint16_t send_port;   ///< Port the probes are sent from
 
      /**
     * @brief Constructor for the UDPScanner class.
     */
-    UDPScanner( struct sockaddr_storage *src_addr, struct sockaddr_storage *dst_addr) : Scanner{src_addr, dst_addr} {}
+    UDPScanner(struct sockaddr_storage *src_addr) : Scanner{src_addr} {}
     ~UDPScanner();
 
     void SetupScanner(ArgParser::Options options);
-    void ScanPort(unsigned int Port,std::string adress) override;
-    bool HandlePacket(unsigned int Port);
 
+protected:
+    const char *Protocol() const override { return "udp"; }
+    PortState ExpiredState() const override { return PortState::Open; }
+    size_t MakeProbe(Target &target, Probe &probe, uint8_t *packet, struct sockaddr_storage *dst) override;
+    void HandleReply(const uint8_t *packet, size_t len, const struct sockaddr_storage &from) override;
+
+private:
+    Probe *QuotedProbe(const uint8_t *packet, size_t len);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -9,28 +9,13 @@
 #include "Network.hpp"
 #include "Udp.hpp"
 #include "Tcp.hpp"
+#include "Scheduler.hpp"
+#include <memory>
 #include <signal.h>
 #include <unistd.h>
 #include <arpa/inet.h>
 #include <netdb.h>
 
-/**
- * @brief Iterates over a list of ports and calls scanning function.
- * 
- * @param ports A vector containing the list of port numbers to be scanned.
- * @param Scanner A pointer to the Scanner object, which can do UDP or TCP scanning
- * @param adress The address to be scanned.
- */
-void ForEachPort(std::vector<unsigned int> ports, Scanner *Scanner,std::string adress) {
-    if (ports.empty()) {
-        return;
-    }
-
-    for(auto port : ports){
-        Scanner->ScanPort(port,adress);
-    }
-}
-
 /**
  * @brief Handles the CTRL+C signal.
  */
@@ -60,61 +45,38 @@ int main(int argc, char *argv[]){
             return EXIT_SUCCESS;
         }
 
-        struct sockaddr_storage src_addr = {};
-        //socklen_t src_len = sizeof(struct sockaddr_storage);
-        auto DstAdresses = Network::GetDstAdress(options.domain);
-
-        // For each IP address
-        for(auto dst_addr = DstAdresses; dst_addr != nullptr; dst_addr = dst_addr->ai_next){
-
-            memcpy(&src_addr, dst_addr->ai_addr, dst_addr->ai_addrlen);
-
-            sockaddr_in *adress_IP4;
-            sockaddr_in6 *adress_IP6;
-
-            Network::GetInterfaceAdress(dst_addr->ai_family, options.inteface,&src_addr);
-
-            // Initialization of scanner, and both objects for UDP and TCP scanner
-            Scanner *scanner;
-            UDPScanner udpScanner(&src_addr, (struct sockaddr_storage *)dst_addr->ai_addr);
-            udpScanner.SetupScanner(options);
-            TCPScanner tcpScanner(&src_addr, (struct sockaddr_storage *)dst_addr->ai_addr);
-            tcpScanner.SetupScanner(options);
-
-            // For each family of IP adress of host
-            switch (dst_addr->ai_family)
-            {
-            case AF_INET:
-                // Gets string version of IPV4 of host
-                adress_IP4 = (struct sockaddr_in *)dst_addr->ai_addr;
-                char ipv4[INET_ADDRSTRLEN];
-                inet_ntop(AF_INET, &(adress_IP4->sin_addr), ipv4, INET_ADDRSTRLEN);
-
-                // Performing of UDP and TCP scanning
-                scanner = &udpScanner;
-                ForEachPort(options.udp_port, scanner,ipv4);
-                scanner = &tcpScanner;
-                ForEachPort(options.tcp_port, scanner, ipv4);
-                break;
-
-            case AF_INET6:
-                // Gets string version of IPV4 of host
-                adress_IP6 = (struct sockaddr_in6 *)dst_addr->ai_addr;
-                char ipv6[INET6_ADDRSTRLEN];
-                inet_ntop(AF_INET6, &(adress_IP6->sin6_addr), ipv6, INET6_ADDRSTRLEN);
+        // Scanners of both families are created with the first target of the family
+        struct sockaddr_storage src_addr[2] = {};
+        std::unique_ptr<UDPScanner> udpScanner[2];
+        std::unique_ptr<TCPScanner> tcpScanner[2];
+        Scheduler scheduler;
+
+        // For each IP address of all the targets
+        for(auto &dst_addr : Network::GetDstAdresses(options.targets)){
+            int family = dst_addr.ss_family == AF_INET6;
+            if(src_addr[family].ss_family == AF_UNSPEC){
+                src_addr[family].ss_family = dst_addr.ss_family;
+                Network::GetInterfaceAdress(dst_addr.ss_family, options.inteface, &src_addr[family]);
+            }
 
-                // Performing of UDP and TCP scanning
-                scanner = &udpScanner;
-                ForEachPort(options.udp_port, scanner, ipv6);
-                scanner = &tcpScanner;
-                ForEachPort(options.tcp_port, scanner, ipv6);
-                break;
-            
-            default:
-                break;
+            // UDP results of an address are printed before the TCP ones
+            if(!options.udp_port.empty()){
+                if(!udpScanner[family]){
+                    udpScanner[family] = std::make_unique<UDPScanner>(&src_addr[family]);
+                    udpScanner[family]->SetupScanner(options);
+                }
+                scheduler.Add(udpScanner[family].get(), udpScanner[family]->AddTarget(dst_addr, options.udp_port));
+            }
+            if(!options.tcp_port.empty()){
+                if(!tcpScanner[family]){
+                    tcpScanner[family] = std::make_unique<TCPScanner>(&src_addr[family]);
+                    tcpScanner[family]->SetupScanner(options);
+                }
+                scheduler.Add(tcpScanner[family].get(), tcpScanner[family]->AddTarget(dst_addr, options.tcp_port));
             }
         }
-        
+
+        scheduler.Run(options.summary);
     }
     catch(const std::exception& e)
     {
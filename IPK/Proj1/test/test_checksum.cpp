@@ -0,0 +1,137 @@
+/**
+ * @file test_checksum.cpp
+ * @author Radim Dvořák (xdvorar00)
+ * @date 27/03/2025
+ * @brief Tests of the incremental checksum of the SYN probes against a full one
+ *
+ * A SYN template with zero ports and sequence number is summed whole, then
+ * the ports and the sequence number of a probe are written into it and its
+ * checksum is updated by Network::UpdateChecksum word by word, the way
+ * TCPScanner::MakeProbe does. The result must equal the one's complement
+ * sum of the whole pseudo-header and segment, computed here byte by byte.
+ */
+
+#include "../src/Network.hpp"
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+
+static int failures = 0;
+
+/**
+ * @brief The reference checksum of a TCP segment, summed over big-endian words.
+ *
+ * @param pseudo The pseudo-header.
+ * @param segment The TCP segment with a zero checksum field.
+ * @return The checksum in host byte order.
+ */
+static uint16_t ReferenceChecksum(const std::vector<uint8_t> &pseudo, const uint8_t *segment, size_t len){
+    std::vector<uint8_t> data(pseudo);
+    data.insert(data.end(), segment, segment + len);
+    if (data.size() % 2) {
+        data.push_back(0);
+    }
+    uint64_t sum = 0;
+    for (size_t i = 0; i < data.size(); i += 2) {
+        sum += (data[i] << 8) | data[i + 1];
+    }
+    while (sum >> 16) {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)~sum;
+}
+
+/**
+ * @brief The pseudo-header of a segment of 20 bytes between two addresses.
+ */
+static std::vector<uint8_t> PseudoHeader(int family, const char *src, const char *dst){
+    std::vector<uint8_t> pseudo;
+    size_t len = family == AF_INET ? 4 : 16;
+    uint8_t addr[16];
+    inet_pton(family, src, addr);
+    pseudo.insert(pseudo.end(), addr, addr + len);
+    inet_pton(family, dst, addr);
+    pseudo.insert(pseudo.end(), addr, addr + len);
+    if (family == AF_INET) {
+        pseudo.insert(pseudo.end(), {0, IPPROTO_TCP, 0, sizeof(struct tcphdr)});
+    } else {
+        pseudo.insert(pseudo.end(), {0, 0, 0, sizeof(struct tcphdr), 0, 0, 0, IPPROTO_TCP});
+    }
+    return pseudo;
+}
+
+/**
+ * @brief Builds the SYN of a probe from the template and checks its checksum.
+ *
+ * @return The checksum of the probe in host byte order.
+ */
+static uint16_t CheckProbe(const char *name, const std::vector<uint8_t> &pseudo, uint16_t sport, uint16_t dport, uint32_t seq){
+    uint8_t packet[sizeof(struct tcphdr)] = {};
+    struct tcphdr *tcp_header = (struct tcphdr *)packet;
+    tcp_header->th_off = 5;
+    tcp_header->th_flags = TH_SYN;
+    tcp_header->th_win = htons(0xFFFF);
+    tcp_header->th_sum = htons(ReferenceChecksum(pseudo, packet, sizeof(packet)));
+
+    tcp_header->th_sport = htons(sport);
+    tcp_header->th_dport = htons(dport);
+    tcp_header->th_seq = htonl(seq);
+    uint16_t seq_words[2];
+    memcpy(seq_words, &tcp_header->th_seq, sizeof(seq_words));
+    uint16_t sum = tcp_header->th_sum;
+    sum = Network::UpdateChecksum(sum, 0, tcp_header->th_sport);
+    sum = Network::UpdateChecksum(sum, 0, tcp_header->th_dport);
+    sum = Network::UpdateChecksum(sum, 0, seq_words[0]);
+    sum = Network::UpdateChecksum(sum, 0, seq_words[1]);
+
+    tcp_header->th_sum = 0;
+    uint16_t expected = ReferenceChecksum(pseudo, packet, sizeof(packet));
+    if (ntohs(sum) != expected) {
+        fprintf(stderr, "FAIL %s sport %u dport %u seq %08x: %04x, expected %04x\n", name, sport, dport, seq, ntohs(sum), expected);
+        failures++;
+    }
+    return ntohs(sum);
+}
+
+/**
+ * @brief Checks the probes of one pair of addresses.
+ */
+static void CheckPair(const char *name, int family, const char *src, const char *dst){
+    auto pseudo = PseudoHeader(family, src, dst);
+    const uint16_t ports[] = {0, 1, 80, 1024, 0x7FFF, 0x8000, 0xFF00, 0xFFFE, 0xFFFF};
+    const uint32_t seqs[] = {0, 1, 0x0000FFFF, 0xFFFF0000, 0x7FFFFFFF, 0x80000000, 0xFFFFFFFE, 0xFFFFFFFF, 0x12345678};
+
+    for (auto sport : ports) {
+        for (auto dport : ports) {
+            for (auto seq : seqs) {
+                CheckProbe(name, pseudo, sport, dport, seq);
+            }
+        }
+    }
+
+    // The low word of the sequence number completing the sum to 0xFFFF gives the checksum 0x0000,
+    // a checksum updated by subtracting the words would give the other zero, 0xFFFF
+    uint16_t sport = 0xFFFF;
+    uint16_t dport = 0xFFFF;
+    uint16_t seq_high = 0xFFFF;
+    uint16_t rest = ~CheckProbe(name, pseudo, sport, dport, (uint32_t)seq_high << 16);
+    uint16_t seq_low = 0xFFFF - rest;
+    uint16_t zero = CheckProbe(name, pseudo, sport, dport, ((uint32_t)seq_high << 16) | seq_low);
+    if (zero != 0x0000) {
+        fprintf(stderr, "FAIL %s checksum edge: %04x, expected 0000\n", name, zero);
+        failures++;
+    }
+}
+
+int main(){
+    CheckPair("ipv4", AF_INET, "192.168.1.10", "147.229.8.12");
+    CheckPair("ipv6", AF_INET6, "fe80::1ff:fe23:4567:890a", "2001:67c:1220:809::93e5:917");
+    if (failures) {
+        fprintf(stderr, "%d checksum tests failed\n", failures);
+        return 1;
+    }
+    printf("checksum tests passed\n");
+    return 0;
+}